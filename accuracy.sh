@@ -0,0 +1,84 @@
+#!/bin/sh
+# Run a test problem and compare its outputs against the gold outputs
+# that come with it, normally to check what a build with
+# -DFLOAT_TEMPORARIES costs in accuracy.  Prints the largest absolute
+# and relative difference of each zone quantity in the .xy file, and
+# exits nonzero if any relative difference is above TOL.  If BASELINE
+# is set to a build without the flag, it is run on the same deck too,
+# and the run times of the two builds are printed side by side.
+#
+# usage: accuracy.sh <pennant> [legion args...]
+# TESTDIR (default test/sedov), TOL (default 1.e-5) and BASELINE can
+# be set in the environment.
+
+PENNANT=$1
+shift
+TESTDIR=${TESTDIR:-test/sedov}
+TOL=${TOL:-1.e-5}
+
+if [ ! -x "$PENNANT" ] || [ ! -d "$TESTDIR" ] || \
+   ( [ -n "$BASELINE" ] && [ ! -x "$BASELINE" ] ); then
+    echo "usage: accuracy.sh <pennant> [legion args...]"
+    exit 1
+fi
+
+# The outputs are named after the deck, so run a copy of it somewhere
+# else to keep from overwriting the gold files
+DECK=`ls "$TESTDIR"/*.pnt | head -1`
+NAME=`basename "$DECK" .pnt`
+RUNDIR=`mktemp -d`
+cp "$DECK" "$RUNDIR"
+TIME=`"$PENNANT" "$@" -f "$RUNDIR/$NAME.pnt" | grep -e "hydro cycle run time" \
+    | awk '{ print $5 }'`
+
+if [ ! -f "$RUNDIR/$NAME.xy" ]; then
+    echo "no output written to $RUNDIR/$NAME.xy"
+    rm -rf "$RUNDIR"
+    exit 1
+fi
+
+if [ -n "$BASELINE" ]; then
+    # Its own directory so the outputs of the two runs stay apart
+    mkdir "$RUNDIR/baseline"
+    cp "$DECK" "$RUNDIR/baseline"
+    BASETIME=`"$BASELINE" "$@" -f "$RUNDIR/baseline/$NAME.pnt" \
+        | grep -e "hydro cycle run time" | awk '{ print $5 }'`
+    echo "$TIME $BASETIME" | awk '{
+        if (NF != 2) { print "a run failed, no run time comparison"; exit }
+        printf "run time %.8g us, baseline %.8g us, speedup %.3f\n", $1, $2, $2 / $1
+    }'
+else
+    echo "run time $TIME us"
+fi
+
+# Both files are sections of "index value" lines, each headed by
+# "#  <name>", with the zones in the same order
+paste "$TESTDIR/$NAME.xy" "$RUNDIR/$NAME.xy" | awk -v tol="$TOL" '
+function report() {
+    if (name != "")
+        printf "%-4s max abs diff %.3e  max rel diff %.3e\n", name, maxabs, maxrel
+}
+BEGIN { worst = 0. }
+$1 == "#" {
+    report()
+    name = $2; maxabs = 0.; maxrel = 0.
+    next
+}
+{
+    gold = $2; val = $4
+    d = val - gold; if (d < 0.) d = -d
+    g = gold; if (g < 0.) g = -g
+    r = (g > 0.) ? d / g : d
+    if (d > maxabs) maxabs = d
+    if (r > maxrel) maxrel = r
+    if (r > worst) worst = r
+}
+END {
+    report()
+    printf "all  max rel diff %.3e  tolerance %s: %s\n", worst, tol,
+        (worst > tol) ? "FAIL" : "pass"
+    exit (worst > tol) ? 1 : 0
+}'
+STATUS=$?
+rm -rf "$RUNDIR"
+exit $STATUS
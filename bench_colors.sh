@@ -0,0 +1,45 @@
+#!/bin/sh
+# Compare the OpenMP point scatters of two pennant builds, normally one
+# built as usual and one built with -DCOLOR_SIDE_SCATTERS, on a rect
+# (sedov), a pie (noh) and a hex (nohpoly) deck.  Run with OpenMP
+# processors (-ll:ocpu/-ll:othr) so the OMP variants get picked.  Ends
+# with a table of the cycle run times with atomics and with colors.
+#
+# usage: bench_colors.sh <pennant> <pennant-colored> [legion args...]
+# DECKS can be set in the environment.
+
+BEFORE=$1
+AFTER=$2
+shift 2
+DECKS=${DECKS:-"test/sedov/sedov.pnt test/noh/noh.pnt test/nohpoly/nohpoly.pnt"}
+
+if [ ! -x "$BEFORE" ] || [ ! -x "$AFTER" ]; then
+    echo "usage: bench_colors.sh <pennant> <pennant-colored> [legion args...]"
+    exit 1
+fi
+
+# Run copies of the decks so the gold outputs next to them survive
+RUNDIR=`mktemp -d`
+for DECK in $DECKS; do
+    cp "$DECK" "$RUNDIR"
+    for BUILD in atomics colors; do
+        if [ $BUILD = atomics ]; then PENNANT=$BEFORE; else PENNANT=$AFTER; fi
+        echo "=== `basename $DECK` $PENNANT ==="
+        "$PENNANT" "$@" -f "$RUNDIR/`basename $DECK`" | grep -e "hydro cycle run time" \
+            | sed -e "s|^|`basename $DECK .pnt` $BUILD |" | tee -a "$RUNDIR/results"
+    done
+done
+# One row per deck, atomics (the plain build) against colors
+awk 'BEGIN { n = 0 }
+     { if (!($1 in seen)) { seen[$1] = 1; deck[n++] = $1 }
+       if ($2 == "atomics") atomics[$1] = $7; else colors[$1] = $7 }
+     END {
+       printf("%-12s %16s %16s %10s\n", "deck", "atomics (us)", "colors (us)", "speedup")
+       for (i = 0; i < n; i++) {
+         d = deck[i]
+         if (!(d in atomics) || !(d in colors)) { printf("%-12s a run failed, no comparison\n", d); continue }
+         printf("%-12s %16.8g %16.8g %10.3f\n", d, atomics[d], colors[d],
+                atomics[d] / colors[d])
+       }
+     }' "$RUNDIR/results"
+rm -rf "$RUNDIR"
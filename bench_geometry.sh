@@ -0,0 +1,26 @@
+#!/bin/sh
+# Compare two pennant builds, normally one built with -DFUSED_QCS and
+# one built with -DFUSED_QCS -DRECOMPUTE_EDGE_GEOMETRY, on the memory
+# estimate printed at startup and on the cycle run time.
+#
+# usage: bench_geometry.sh <pennant> <pennant-recompute> <deck.pnt> [legion args...]
+
+BEFORE=$1
+AFTER=$2
+DECK=$3
+shift 3
+
+if [ ! -x "$BEFORE" ] || [ ! -x "$AFTER" ] || [ ! -f "$DECK" ]; then
+    echo "usage: bench_geometry.sh <pennant> <pennant-recompute> <deck.pnt> [legion args...]"
+    exit 1
+fi
+
+# Run a copy of the deck so the gold outputs next to it survive
+RUNDIR=`mktemp -d`
+cp "$DECK" "$RUNDIR"
+for PENNANT in "$BEFORE" "$AFTER"; do
+    echo "=== $PENNANT ==="
+    "$PENNANT" "$@" -f "$RUNDIR/`basename $DECK`" | \
+        grep -e "Memory estimate" -e "hydro cycle run time"
+done
+rm -rf "$RUNDIR"
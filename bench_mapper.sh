@@ -0,0 +1,39 @@
+#!/bin/sh
+# Compare mapping throughput of two pennant builds, normally one built
+# as usual and one built with -DENABLE_CONCURRENT_MAPPER.  Tracing is
+# turned off so that every operation in every cycle gets mapped.
+#
+# usage: bench_mapper.sh <pennant> <pennant-concurrent> <deck.pnt> [legion args...]
+
+BEFORE=$1
+AFTER=$2
+DECK=$3
+shift 3
+
+if [ ! -x "$BEFORE" ] || [ ! -x "$AFTER" ] || [ ! -f "$DECK" ]; then
+    echo "usage: bench_mapper.sh <pennant> <pennant-concurrent> <deck.pnt> [legion args...]"
+    exit 1
+fi
+
+# Run a copy of the deck so its outputs don't land next to the gold ones
+RUNDIR=`mktemp -d`
+BENCHDECK=$RUNDIR/`basename "$DECK"`
+grep -v -e '^tracing' "$DECK" > "$BENCHDECK"
+echo "tracing 0" >> "$BENCHDECK"
+for PENNANT in "$BEFORE" "$AFTER"; do
+    echo "=== $PENNANT ==="
+    "$PENNANT" "$@" -f "$BENCHDECK" | grep -e "hydro cycle run time" -e "mapper calls" \
+        | tee -a "$RUNDIR/results"
+done
+# Put the two runs side by side
+awk 'BEGIN { n = 0 }
+     /hydro cycle run time/ { wall[n] = $5 }
+     /mapper calls/ { tput[n] = $(NF-1); n++ }
+     END {
+       if (n != 2) { print "a run failed, no comparison"; exit 1 }
+       printf("%-12s %16s %16s\n", "", "run time (us)", "calls/s")
+       printf("%-12s %16.8g %16.8g\n", "before", wall[0], tput[0])
+       printf("%-12s %16.8g %16.8g\n", "after", wall[1], tput[1])
+       printf("%-12s %16.3f %16.3f\n", "speedup", wall[0] / wall[1], tput[1] / tput[0])
+     }' "$RUNDIR/results"
+rm -rf "$RUNDIR"
@@ -23,6 +23,8 @@
 #include "InputFile.hh"
 #include "Mesh.hh"
 #include "Hydro.hh"
+#include "PennantMapper.hh"
+#include "TuningDB.hh"
 
 using namespace std;
 using namespace Legion;
@@ -66,9 +68,10 @@ Driver::Driver(
         const InputFile* inp,
         const std::string& pname,
         const int numpcs,
+        TuningDB* tdb,
         Context c,
         Runtime* rt)
-        : probname(pname), ctx(c), runtime(rt) {
+        : tunedb(tdb), probname(pname), ctx(c), runtime(rt) {
     LEGION_PRINT_ONCE(runtime, ctx, stdout, "********************\n");
     LEGION_PRINT_ONCE(runtime, ctx, stdout, "Running PENNANT v0.6\n");
     LEGION_PRINT_ONCE(runtime, ctx, stdout, "********************\n\n");
@@ -85,10 +88,37 @@ Driver::Driver(
     dtinit = inp->getDouble("dtinit", 1.e99);
     dtfac = inp->getDouble("dtfac", 1.2);
     dtreport = inp->getInt("dtreport", 10);
+    tunecycles = inp->getInt("autotunecycles", 0);
+    // The variants are only chosen after the last tuning cycle
+    if (tunecycles < 0 || (tunecycles > 0 && tunecycles >= cstop)) {
+        LEGION_PRINT_ONCE(runtime, ctx, stderr,
+            "autotunecycles must be from 0 to cstop - 1\n");
+        exit(1);
+    }
+    tracing = (inp->getInt("tracing", 1) != 0);
+    rebalancecycles = inp->getInt("rebalancecycles", 0);
+    rebalancetimecycles = inp->getInt("rebalancetimecycles", 5);
+    if (rebalancecycles > 0 &&
+            (rebalancetimecycles < 1 || rebalancetimecycles > rebalancecycles)) {
+        LEGION_PRINT_ONCE(runtime, ctx, stderr,
+            "rebalancetimecycles must be from 1 to rebalancecycles\n");
+        exit(1);
+    }
 
     // initialize mesh, hydro
     mesh = new Mesh(inp, numpcs, ctx, runtime);
     hydro = new Hydro(inp, mesh, ctx, runtime);
+    // The tags go with every launch so the mappers on all the nodes
+    // know whether to try out the variants or use the fastest one,
+    // and whether to time the pieces for rebalancing
+    if (tunecycles > 0)
+        hydro->tunetag = PennantMapper::TUNE_VARIANT;
+    else {
+        // Any choices from the tuning database
+        selectVariantChoices();
+        if (!variantchoices.empty())
+            hydro->tunetag = PennantMapper::TUNED_VARIANT;
+    }
 
 }
 
@@ -111,7 +141,7 @@ void Driver::run(void) {
     Future f_cdt = Future::from_value(runtime, 0.0);
     Future f_prev_report;
     // Create a trace ID for all of Pennant to use
-    const TraceID trace_id = 
+    TraceID trace_id = 
       runtime->generate_library_trace_ids("pennant", 1/*one ID*/);
 
     // Better timing for Legion
@@ -122,11 +152,34 @@ void Driver::run(void) {
     // Get our start time
     Future f_start = runtime->issue_timing_measurement(ctx, timing_launcher);
     Future f_prev_measurement = f_start;
+    // Start of the cycles that run the chosen variants
+    Future f_tuned = f_start;
+    // Don't count the mapping done for setup in the throughput
+    unsigned long long mapcalls_init, maptime_init;
+    PennantMapper::get_mapping_stats(mapcalls_init, maptime_init);
 
     // main event loop
     for (int cycle = 0; cycle < cstop; cycle++) {
 
-        runtime->begin_trace(ctx, trace_id);
+        const bool rebalance_cycle = (rebalancecycles > 0) &&
+            (((cycle+1) % rebalancecycles) == 0) && ((cycle+1) < cstop);
+        // The pieces are timed over the last few cycles before each
+        // rebalance, one cycle alone is too noisy to go by
+        const int next_rebalance = (rebalancecycles > 0) ?
+            (cycle / rebalancecycles + 1) * rebalancecycles - 1 : cstop;
+        const bool time_cycle = (next_rebalance + 1 < cstop) &&
+            (next_rebalance - cycle < rebalancetimecycles);
+        if (time_cycle)
+            hydro->tunetag |= PennantMapper::TIME_PIECES;
+        else
+            hydro->tunetag &= ~PennantMapper::TIME_PIECES;
+        // Don't trace while the mapper is trying out different variants,
+        // or while it times the pieces, since it only gets to time the
+        // tasks that it maps
+        const bool trace_cycle = tracing && (cycle >= tunecycles) &&
+            !time_cycle;
+        if (trace_cycle)
+            runtime->begin_trace(ctx, trace_id);
         // get timestep
         f_dt = calcGlobalDt(f_dt, f_cdt, f_time, cycle, p_not_done);
 
@@ -142,7 +195,40 @@ void Driver::run(void) {
 
         p_not_done = runtime->create_predicate(ctx, f_not_done);
 #endif
-        runtime->end_trace(ctx, trace_id);
+        if (trace_cycle)
+            runtime->end_trace(ctx, trace_id);
+        if (cycle == (tunecycles - 1)) {
+            // Wait for the trial runs to finish so the mapper has
+            // timings for both variants before it locks in a choice
+            runtime->issue_execution_fence(ctx).get_void_result(true/*silence warnings*/);
+            selectVariantChoices();
+            hydro->tunetag = (hydro->tunetag & ~PennantMapper::TUNE_VARIANT) |
+                PennantMapper::TUNED_VARIANT;
+            timing_launcher.preconditions.clear();
+            f_tuned = runtime->issue_timing_measurement(ctx, timing_launcher);
+        }
+        if (rebalance_cycle) {
+            // Everything has to stop while the fields move to their new
+            // pieces, and the mappers only have all the times of the
+            // timed tasks once those are done
+            runtime->issue_execution_fence(ctx).get_void_result(true/*silence warnings*/);
+            mesh->rebalance();
+            hydro->initBCs();
+#ifdef CACHE_INVARIANTS
+            // the zone constants didn't move with the zones
+            hydro->initInvariants();
+#endif
+            // Every piece runs until the next activity update
+            hydro->resetActivePieces();
+            // The old trace recorded the old pieces
+            trace_id = runtime->generate_dynamic_trace_id();
+        }
+        if ((hydro->activecycles > 0) &&
+                (((cycle+1) % hydro->activecycles) == 0) && ((cycle+1) < cstop)) {
+            // The old trace launched over the old set of pieces
+            if (hydro->updateActivePieces(f_dt))
+                trace_id = runtime->generate_dynamic_trace_id();
+        }
 
         if ((cycle == 0) || (((cycle+1) % dtreport) == 0)) {
             timing_launcher.preconditions.clear();
@@ -179,6 +265,33 @@ void Driver::run(void) {
     LEGION_PRINT_ONCE(runtime, ctx, stdout, "hydro cycle run time= %14.8g us\n", walltime);
     LEGION_PRINT_ONCE(runtime, ctx, stdout, "************************************\n");
 
+    // Mapping throughput for the mappers in the first process
+    unsigned long long mapcalls, maptime;
+    PennantMapper::get_mapping_stats(mapcalls, maptime);
+    mapcalls -= mapcalls_init;
+    maptime -= maptime_init;
+    LEGION_PRINT_ONCE(runtime, ctx, stdout, "mapper calls = %llu, time in mapper = %14.8g us, "
+                      "throughput = %14.8g calls/s\n", mapcalls, 1e-3 * maptime,
+                      1e6 * mapcalls / walltime);
+
+    reportMemoryUsage();
+
+    // Save the settings for this run if they are the fastest so far,
+    // timed without the tuning cycles, which also run the slower
+    // variants and aren't traced, but scaled up to all the cycles so
+    // it compares with runs that tuned for more or fewer cycles
+    const int ncycles = f_cycle.get_result<int>();
+    if ((tunedb != NULL) && (ncycles > tunecycles) &&
+        (runtime->get_executing_processor(ctx).address_space() == 0)) {
+        const double ttuned = f_tuned.get_result<long long>(true/*silence warnings*/);
+        TuningDB::Entry entry;
+        entry.numpcs = mesh->numpcs;
+        entry.chunksize = mesh->chunksize;
+        entry.walltime = (tend - ttuned) * ncycles / (ncycles - tunecycles);
+        entry.variants = variantchoices;
+        tunedb->record(entry);
+    }
+
     // Write out any output from running this
     // Note this is inherently not scalable in its current implementation so you can skip
     // it if it is causing you problems by trying to suck all the data to one node to 
@@ -343,7 +456,68 @@ void Driver::reportMeasurementTask(
   const long long tdiff = measurement - previous; 
   fprintf(stdout, "End cycle %6d, time = %11.5g, dt = %11.5g, wall = %11lld us\n", 
           cycle, time, dt, tdiff);
+  // Instance memory of the fullest memory used by the mappers in this process
+  std::map<Memory,PennantMapper::MemoryUsage> memories;
+  std::map<FieldSpace,PennantMapper::MemoryUsage> field_spaces;
+  PennantMapper::get_memory_usage(memories, field_spaces);
+  // both numbers are for the memory with the highest peak, so they
+  // can be read against each other
+  size_t current = 0, peak = 0;
+  for (std::map<Memory,PennantMapper::MemoryUsage>::const_iterator it = 
+        memories.begin(); it != memories.end(); it++) {
+    if (it->second.peak < peak) continue;
+    current = it->second.current;
+    peak = it->second.peak;
+  }
+  fprintf(stdout, "                 memory = %11.1f MB, peak = %11.1f MB\n",
+          current / 1048576.0, peak / 1048576.0);
   fflush(stdout);
 }
 
 
+void Driver::reportMemoryUsage(void) {
+  std::map<Memory,PennantMapper::MemoryUsage> memories;
+  std::map<FieldSpace,PennantMapper::MemoryUsage> field_spaces;
+  PennantMapper::get_memory_usage(memories, field_spaces);
+
+  // Like the mapping throughput this is only for the first process
+  LEGION_PRINT_ONCE(runtime, ctx, stdout, "instance memory by memory and field space:\n");
+  for (std::map<Memory,PennantMapper::MemoryUsage>::const_iterator it = 
+        memories.begin(); it != memories.end(); it++) {
+    const char *kind;
+    switch (it->first.kind()) {
+      case Memory::SYSTEM_MEM:  kind = "sysmem"; break;
+      case Memory::SOCKET_MEM:  kind = "numa"; break;
+      case Memory::GPU_FB_MEM:  kind = "framebuffer"; break;
+      case Memory::Z_COPY_MEM:  kind = "zero-copy"; break;
+      default:                  kind = "other"; break;
+    }
+    LEGION_PRINT_ONCE(runtime, ctx, stdout, "  %s " IDFMT ": %.1f MB now, %.1f MB peak\n",
+        kind, it->first.id, it->second.current / 1048576.0, it->second.peak / 1048576.0);
+  }
+  for (std::map<FieldSpace,PennantMapper::MemoryUsage>::const_iterator it = 
+        field_spaces.begin(); it != field_spaces.end(); it++) {
+    const char *name = "other";
+    if (it->first == mesh->lrp.get_field_space())
+      name = "points";
+    else if (it->first == mesh->lrz.get_field_space())
+      name = "zones";
+    else if (it->first == mesh->lrs.get_field_space())
+      name = "sides";
+    LEGION_PRINT_ONCE(runtime, ctx, stdout, "  %s: %.1f MB now, %.1f MB peak\n",
+        name, it->second.current / 1048576.0, it->second.peak / 1048576.0);
+  }
+}
+
+
+
+
+void Driver::selectVariantChoices(void) {
+  // The mapper that selects it gathers the timings from every process
+  // and only returns once they all use the choices it made
+  Future f_choices = runtime->select_tunable_value(ctx,
+      PennantMapper::VARIANT_CHOICES_TUNABLE);
+  variantchoices.clear();
+  PennantMapper::unpack_variant_choices(f_choices.get_untyped_pointer(),
+      f_choices.get_untyped_size(), variantchoices);
+}
@@ -17,6 +17,8 @@
 
 #include "legion.h"
 
+#include "PennantMapper.hh"
+
 enum DriverTaskID {
     TID_CALCGLOBALDT = 'D' * 100,
     TID_UPDATETIME,
@@ -29,6 +31,7 @@ enum DriverTaskID {
 class InputFile;
 class Mesh;
 class Hydro;
+class TuningDB;
 
 
 class Driver {
@@ -54,6 +57,7 @@ public:
     // children of this object
     Mesh *mesh;
     Hydro *hydro;
+    TuningDB *tunedb;              // records run time if not NULL
 
     std::string probname;          // problem name
     //double time;                   // simulation time
@@ -64,6 +68,11 @@ public:
     double dtinit;                 // initial timestep size
     double dtfac;                  // factor limiting timestep growth
     int dtreport;                  // frequency for timestep reports
+    int tunecycles;                // cycles for mapper to time variants
+    PennantMapper::VariantChoices variantchoices; // variants mappers use
+    bool tracing;                  // trace cycles (off to time mapping)
+    int rebalancecycles;           // cycles between rebalancing pieces
+    int rebalancetimecycles;       // untraced cycles timed before each
     //double dt;                     // current timestep
     //double dtlast;                 // previous timestep
     std::string msgdt;             // dt limiter message
@@ -75,6 +84,7 @@ public:
             const InputFile* inp,
             const std::string& pname,
             const int numpcs,
+            TuningDB* tdb,
             Legion::Context ctx,
             Legion::Runtime* runtime);
     ~Driver();
@@ -105,6 +115,13 @@ public:
                                       Legion::Future f_dt,
                                       Legion::Predicate pred);
 
+    // print the instance memory the mappers in this process are using
+    void reportMemoryUsage(void);
+
+    // have the mappers in every process settle on the same variants,
+    // and keep them in variantchoices
+    void selectVariantChoices(void);
+
     static double calcGlobalDtTask(
             const Legion::Task *task,
             const std::vector<Legion::PhysicalRegion> &regions,
@@ -0,0 +1,109 @@
+/*
+ * EOS.hh
+ *
+ * Copyright (c) 2012, Los Alamos National Security, LLC.
+ * All rights reserved.
+ * Use of this source code is governed by a BSD-style open-source
+ * license; see top-level LICENSE file for full license text.
+ */
+
+#ifndef EOS_HH_
+#define EOS_HH_
+
+#include "CudaHelp.hh"
+
+// The equations of state PolyGas can use.  Each one gives the
+// pressure for a density r and specific energy e, along with its
+// partial derivatives pre = dp/dr (at constant e) and per = dp/de
+// (at constant r), which is everything calcStateHalf needs for the
+// sound speed and the half-step pressure.  They are plain structs
+// with everything inline so the same code runs in the CPU, OpenMP
+// and GPU variants.
+
+enum EOSType {
+    EOS_GAMMA,                     // ideal gas, p = (gamma - 1) r e
+    EOS_TABLE                      // bilinear in a (r, e) table of p
+};
+
+
+struct GammaEOS {
+    double gm1;                    // gamma - 1
+
+    __CUDA_HD__
+    inline void eval(const double r, const double e,
+            double& p, double& pre, double& per) const
+    {
+        p = gm1 * r * e;
+        pre = gm1 * e;
+        per = gm1 * r;
+    }
+
+}; // GammaEOS
+
+
+// The table is one array of doubles, laid out as
+//     rtab[nr] etab[ne] rdinv[nr-1] edinv[ne-1] ptab[nr*ne]
+// where rtab and etab are the increasing density and energy values,
+// rdinv and edinv are 1 / the width of each interval of them, and
+// ptab holds the pressure with e varying fastest.  Values outside
+// the table are extrapolated linearly from the cell at its edge.
+struct TableEOS {
+    const double* rtab;
+    const double* etab;
+    const double* rdinv;
+    const double* edinv;
+    const double* ptab;
+    int nr, ne;
+
+    static inline int tableSize(const int nr, const int ne)
+    {
+        return 2 * (nr + ne) - 2 + nr * ne;
+    }
+
+    __CUDA_HD__
+    inline TableEOS() : rtab(0), etab(0), rdinv(0), edinv(0), ptab(0),
+          nr(0), ne(0) {}
+    __CUDA_HD__
+    inline TableEOS(const double* tab, const int nr_, const int ne_)
+        : rtab(tab), etab(tab + nr_), rdinv(tab + nr_ + ne_),
+          edinv(tab + 2 * nr_ + ne_ - 1), ptab(tab + 2 * (nr_ + ne_) - 2),
+          nr(nr_), ne(ne_) {}
+
+    // Move an interval index from where it was last time to the
+    // interval holding x.  Zones don't move far in (r, e) in one
+    // cycle, so this almost always stops without taking a step.
+    __CUDA_HD__
+    static inline int bracket(const double* tab, const int n,
+            const double x, int i)
+    {
+        if (i < 0 || i > n - 2) i = 0;
+        while (i > 0 && x < tab[i]) --i;
+        while (i < n - 2 && x >= tab[i + 1]) ++i;
+        return i;
+    }
+
+    // ir and ie come in as the intervals this zone was in last time
+    // and go out as the ones it is in now
+    __CUDA_HD__
+    inline void eval(const double r, const double e, int& ir, int& ie,
+            double& p, double& pre, double& per) const
+    {
+        ir = bracket(rtab, nr, r, ir);
+        ie = bracket(etab, ne, e, ie);
+        const double tr = (r - rtab[ir]) * rdinv[ir];
+        const double te = (e - etab[ie]) * edinv[ie];
+        const double* p0 = ptab + ir * ne + ie;
+        const double* p1 = p0 + ne;
+        const double dp0 = p0[1] - p0[0];
+        const double dp1 = p1[1] - p1[0];
+        const double pe0 = p0[0] + te * dp0;
+        const double pe1 = p1[0] + te * dp1;
+        p = pe0 + tr * (pe1 - pe0);
+        pre = (pe1 - pe0) * rdinv[ir];
+        per = (dp0 + tr * (dp1 - dp0)) * edinv[ie];
+    }
+
+}; // TableEOS
+
+
+#endif /* EOS_HH_ */
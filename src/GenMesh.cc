@@ -480,9 +480,8 @@ coord_t GenMesh::calcNumPoints(const int numpcs) {
       const coord_t np = npx * (npy - 1) + 1;
       return np;
     } else if (meshtype == "hex") {
-      const coord_t npx = nzx + 1;
-      const coord_t npy = nzy + 1;
-      const coord_t np = 2 * npx * npy;
+      // two points at each corner inside the mesh, one on its edges
+      const coord_t np = 2 * nzx * nzy + 2;
       return np;
     } else {
       assert(false);
@@ -518,13 +517,21 @@ coord_t GenMesh::calcNumSides(const int numpcs) {
       return 4 * nzx * (nzy - 1) + 3 * nzx; 
     } else if (meshtype == "hex") {
       const coord_t nz = calcNumZones(numpcs);
-      return 6 * nz;
+      // zones along the edges of the mesh have fewer than 6 sides
+      return 6 * nz - 2 * nzx - 2 * nzy + 2;
     } else {
       assert(false);
       return -1;
     }
 }
 
+int GenMesh::calcMaxZoneSides() const {
+    if (meshtype == "hex")
+      return 6;
+    // rect and pie zones are quads, or triangles at the pie's origin
+    return 4;
+}
+
 void GenMesh::generatePointsParallel(
             const int numpcs,
             Runtime *runtime,
@@ -599,18 +606,13 @@ void GenMesh::generateZonesParallel(
       launcher.add_region_requirement(req);
       runtime->execute_index_space(ctx, launcher);
     } else if (meshtype == "hex") {
-      // Fill for number of points per zone
-      const int num_points = 6;
-      FillLauncher fill(zones_lr, zones_lr, 
-          TaskArgument(&num_points, sizeof(num_points)));
-      fill.add_field(FID_ZNUMP);
-      runtime->fill_fields(ctx, fill);
-      // Task launch for figuring out piece for a zone
+      // Task launch for number of points per zone and piece for zone
       RegionRequirement req(zones_lp, 0/*identity projection*/,
                           LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, zones_lr);
+      req.add_field(FID_ZNUMP);
       req.add_field(FID_PIECE);
       const GenZoneArgs args(this);
-      IndexTaskLauncher launcher(TID_GENZONES_RECT, piece_is,
+      IndexTaskLauncher launcher(TID_GENZONES_HEX, piece_is,
           TaskArgument(&args, sizeof(args)), ArgumentMap());
       launcher.add_region_requirement(req);
       runtime->execute_index_space(ctx, launcher);
@@ -664,129 +666,428 @@ void GenMesh::generateSidesParallel(
     }
 }
 
+// Which of the mesh types a point numbering is for
+enum MeshKind {
+    MESH_RECT,
+    MESH_PIE,
+    MESH_HEX
+};
+
+// Maps between the index of a generated point and where it is in the
+// mesh.  Points are named by the corner (i, j) of the zone grid they
+// are at, with k = 0 or 1 picking one of the two points a hex mesh has
+// at each corner inside the mesh; a pie mesh has one point at the
+// origin for its whole j = 0 row.
+//
+// Normally the points are numbered a row at a time, the same way the
+// serial generators do it.  With PRECOMPACTED_RECT_POINTS they are
+// numbered the way initPieces would have compacted them:  the private
+// points of each piece in piece order, then the shared points grouped
+// by the piece that owns them.  A point is owned by the piece with
+// zone (i, j) in it, clamped to the last zone in each direction, and
+// is shared if it is on the low x or y edge of that piece.
+class PointNumbering {
+public:
+  PointNumbering(const coord_t nzx, const coord_t nzy,
+                 const coord_t numpcx, const coord_t numpcy,
+                 const MeshKind kind);
+
+  coord_t index(const coord_t i, const coord_t j, const coord_t k) const;
+  void coord(coord_t index, coord_t &i, coord_t &j, coord_t &k) const;
+
+private:
+  // number of corners in i0..i1 that have two points in a hex mesh
+  coord_t innerCorners(const coord_t i0, const coord_t i1) const;
 #ifdef PRECOMPACTED_RECT_POINTS
-static void rect_point_index_to_coord(const GenMesh::GenPointArgs *args,
-				      coord_t index, coord_t&i, coord_t &j)
+  // the corners i0..i1 by j0..j1, numbered a row at a time
+  struct Block {
+    Block(void) : i0(0), i1(-1), j0(0), j1(-1) { }
+    Block(coord_t i0_, coord_t i1_, coord_t j0_, coord_t j1_)
+      : i0(i0_), i1(i1_), j0(j0_), j1(j1_) { }
+    bool contains(const coord_t i, const coord_t j) const
+    { return (i0 <= i) && (i <= i1) && (j0 <= j) && (j <= j1); }
+    coord_t i0, i1, j0, j1;
+  };
+  int pieceBlocks(const coord_t piece, const bool shared, Block *blocks) const;
+  bool hasOrigin(const coord_t piece, const bool shared) const;
+  coord_t blockCount(const Block &b) const;
+  coord_t blockOffset(const Block &b,
+                      const coord_t i, const coord_t j, const coord_t k) const;
+  void blockCoord(const Block &b, coord_t off,
+                  coord_t &i, coord_t &j, coord_t &k) const;
+#endif
+private:
+  const coord_t nzx, nzy;
+  const coord_t numpcx, numpcy;
+  const MeshKind kind;
+#ifdef PRECOMPACTED_RECT_POINTS
+  coord_t zones_per_piecex, zones_per_piecey;
+  coord_t eff_numpcx, eff_numpcy;
+  // first private [0] and shared [1] point of each piece
+  std::vector<coord_t> starts[2];
+#endif
+};
+
+PointNumbering::PointNumbering(const coord_t nzx_, const coord_t nzy_,
+                               const coord_t numpcx_, const coord_t numpcy_,
+                               const MeshKind kind_)
+  : nzx(nzx_), nzy(nzy_), numpcx(numpcx_), numpcy(numpcy_), kind(kind_)
 {
-  const coord_t zones_per_piecex = (args->nzx + args->numpcx - 1) / args->numpcx;
-  const coord_t zones_per_piecey = (args->nzy + args->numpcy - 1) / args->numpcy;
+#ifdef PRECOMPACTED_RECT_POINTS
+  zones_per_piecex = (nzx + numpcx - 1) / numpcx;
+  zones_per_piecey = (nzy + numpcy - 1) / numpcy;
 
   // due to the rounding up above, some pieces can actually be empty
-  const coord_t eff_numpcx = (args->nzx + zones_per_piecex - 1) / zones_per_piecex;
-  const coord_t eff_numpcy = (args->nzy + zones_per_piecey - 1) / zones_per_piecey;
-  assert(eff_numpcx <= args->numpcx);
-  assert(eff_numpcy <= args->numpcy);
-
-  const coord_t num_points = (args->nzx + 1) * (args->nzy + 1);
-  const coord_t num_private = (args->nzx - eff_numpcx + 2) * (args->nzy - eff_numpcy + 2);
-  const bool is_shared = (index >= num_private);
-  if(is_shared) index -= num_private;
-  // not the most efficient, but hopefully easier to read: step through each 
-  //  piece and compute its local size, stopping on our piece
-  for(coord_t y = 0; y < eff_numpcy; y++) {
-    const coord_t pppy = ((y < (eff_numpcy - 1)) ?
-		        zones_per_piecey :
-		        (args->nzy + 1 - (eff_numpcy - 1) * zones_per_piecey));
-    const coord_t local_shared_y = ((y > 0) ? 1 : 0);
-    const coord_t local_private_y = pppy - local_shared_y;
-    for(coord_t x = 0; x < eff_numpcx; x++) {
-      const coord_t pppx = ((x < (eff_numpcx - 1)) ?
-		        zones_per_piecex :
-		        (args->nzx + 1 - (eff_numpcx - 1) * zones_per_piecex));
-      const coord_t local_shared_x = ((x > 0) ? 1 : 0);
-      const coord_t local_private_x = pppx - local_shared_x;
-
-      if(is_shared) {
-	if(local_shared_y > 0) {
-	  if(index < pppx) {
-	    i = x * zones_per_piecex + index;
-	    j = y * zones_per_piecey;
-	    return;
-	  } else
-	    index -= pppx;
-	}
-	if(local_shared_x > 0) {
-	  if(index < local_private_y) {
-	    i = x * zones_per_piecex;
-	    j = y * zones_per_piecey + index + local_shared_y;
-	    return;
-	  } else
-	    index -= local_private_y;
-	}
-      } else {
-	const coord_t local_private = local_private_x * local_private_y;
-	if(index < local_private) {
-	  i = x * zones_per_piecex + (index % local_private_x) + local_shared_x;
-	  j = y * zones_per_piecey + (index / local_private_x) + local_shared_y;
-	  return;
-	} else
-	  index -= local_private;
-      }
+  eff_numpcx = (nzx + zones_per_piecex - 1) / zones_per_piecex;
+  eff_numpcy = (nzy + zones_per_piecey - 1) / zones_per_piecey;
+  assert(eff_numpcx <= numpcx);
+  assert(eff_numpcy <= numpcy);
+
+  const coord_t numpcs = numpcx * numpcy;
+  coord_t next = 0;
+  for (int shared = 0; shared < 2; shared++) {
+    starts[shared].resize(numpcs + 1);
+    for (coord_t p = 0; p < numpcs; p++) {
+      starts[shared][p] = next;
+      if (hasOrigin(p, shared)) next++;
+      Block blocks[2];
+      const int nb = pieceBlocks(p, shared, blocks);
+      for (int b = 0; b < nb; b++)
+        next += blockCount(blocks[b]);
     }
+    starts[shared][numpcs] = next;
   }
-  // should never get here
-  assert(0);
+#endif
 }
 
-static coord_t rect_point_coord_to_index(const GenMesh::GenSideArgs *args,
-				         coord_t i, coord_t j)
+coord_t PointNumbering::innerCorners(const coord_t i0, const coord_t i1) const
 {
-  const coord_t zones_per_piecex = (args->nzx + args->numpcx - 1) / args->numpcx;
-  const coord_t zones_per_piecey = (args->nzy + args->numpcy - 1) / args->numpcy;
+  if (kind != MESH_HEX) return 0;
+  const coord_t lo = std::max(i0, coord_t(1));
+  const coord_t hi = std::min(i1, nzx - 1);
+  return std::max(hi - lo + 1, coord_t(0));
+}
 
-  // due to the rounding up above, some pieces can actually be empty
-  const coord_t eff_numpcx = (args->nzx + zones_per_piecex - 1) / zones_per_piecex;
-  const coord_t eff_numpcy = (args->nzy + zones_per_piecey - 1) / zones_per_piecey;
-  assert(eff_numpcx <= args->numpcx);
-  assert(eff_numpcy <= args->numpcy);
-
-  const coord_t piecex = std::min(i / zones_per_piecex, eff_numpcx - 1);
-  const coord_t piecey = std::min(j / zones_per_piecey, eff_numpcy - 1);
-  const coord_t subpiecex = i - piecex * zones_per_piecex;
-  const coord_t subpiecey = j - piecey * zones_per_piecey;
-  const bool is_shared = (((i > 0) && (subpiecex == 0)) ||
-			  ((j > 0) && (subpiecey == 0)));
-  const coord_t num_points = (args->nzx + 1) * (args->nzy + 1);
-  const coord_t num_private = (args->nzx - eff_numpcx + 2) * (args->nzy - eff_numpcy + 2);
-  coord_t index = 0;
-  if(is_shared) index += num_private;
-  // not the most efficient, but hopefully easier to read: step through each 
-  //  piece and compute its local size, stopping on our piece
-  for(coord_t y = 0; y < eff_numpcy; y++) {
-    const coord_t pppy = ((y < (eff_numpcy - 1)) ?
-		        zones_per_piecey :
-		        (args->nzy + 1 - (eff_numpcy - 1) * zones_per_piecey));
-    for(coord_t x = 0; x < eff_numpcx; x++) {
-      const coord_t pppx = ((x < (eff_numpcx - 1)) ?
-		        zones_per_piecex :
-		        (args->nzx + 1 - (eff_numpcx - 1) * zones_per_piecex));
-      if((x == piecex) && (y == piecey)) {
-	if(is_shared) {
-	  if(piecey > 0)
-	    index += ((subpiecey > 0) ? pppx + subpiecey - 1 : subpiecex);
-	  else
-	    index += subpiecey;
-	} else {
-	  index += ((subpiecey - ((piecey > 0) ? 1 : 0)) * 
-		    (pppx - ((piecex > 0) ? 1 : 0)));
-	  index += (subpiecex - ((piecex > 0) ? 1 : 0));
-	}
-	return index;
-      } else {
-	const coord_t local_shared = ((x > 0) ?
-				    ((y > 0) ? (pppx + pppy - 1) : pppy) :
-				    ((y > 0) ? pppx : 0));
-	const coord_t local_private = pppx * pppy - local_shared;
-	index += (is_shared ? local_shared : local_private);
-      }
+#ifdef PRECOMPACTED_RECT_POINTS
+bool PointNumbering::hasOrigin(const coord_t piece, const bool shared) const
+{
+  // it goes first in piece 0, and is shared if there are other pieces
+  // along the bottom row
+  return (kind == MESH_PIE) && (piece == 0) && (shared == (eff_numpcx > 1));
+}
+
+int PointNumbering::pieceBlocks(const coord_t piece, const bool shared,
+                                Block *blocks) const
+{
+  const coord_t x = piece % numpcx;
+  const coord_t y = piece / numpcx;
+  if ((x >= eff_numpcx) || (y >= eff_numpcy)) return 0;
+  // the last piece in each direction also gets the corners on the
+  // high edge of the mesh
+  const coord_t ilo = x * zones_per_piecex;
+  const coord_t ihi = (x < (eff_numpcx - 1)) ? ilo + zones_per_piecex - 1 : nzx;
+  const coord_t jlo = y * zones_per_piecey;
+  const coord_t jhi = (y < (eff_numpcy - 1)) ? jlo + zones_per_piecey - 1 : nzy;
+  // first row off the low y edge, skipping the row at the pie origin
+  const coord_t jin = std::max(jlo + ((y > 0) ? 1 : 0),
+                               coord_t((kind == MESH_PIE) ? 1 : 0));
+  int nb = 0;
+  if (!shared)
+    blocks[nb++] = Block(ilo + ((x > 0) ? 1 : 0), ihi, jin, jhi);
+  else {
+    if (y > 0)
+      blocks[nb++] = Block(ilo, ihi, jlo, jlo);
+    if (x > 0)
+      blocks[nb++] = Block(ilo, ilo, jin, jhi);
+  }
+  return nb;
+}
+
+coord_t PointNumbering::blockCount(const Block &b) const
+{
+  if ((b.i1 < b.i0) || (b.j1 < b.j0)) return 0;
+  const coord_t n = b.i1 - b.i0 + 1;
+  const coord_t rows = b.j1 - b.j0 + 1;
+  // rows on the bottom and top of a hex mesh have one point per corner
+  const coord_t inner = rows - ((b.j0 == 0) ? 1 : 0) - ((b.j1 == nzy) ? 1 : 0);
+  return rows * n + inner * innerCorners(b.i0, b.i1);
+}
+
+coord_t PointNumbering::blockOffset(const Block &b,
+    const coord_t i, const coord_t j, const coord_t k) const
+{
+  const coord_t n = b.i1 - b.i0 + 1;
+  const coord_t ninner = innerCorners(b.i0, b.i1);
+  coord_t off = (j - b.j0) * (n + ninner);
+  if ((b.j0 == 0) && (j > 0)) off -= ninner;
+  off += i - b.i0;
+  if ((j > 0) && (j < nzy))
+    off += innerCorners(b.i0, i - 1) + k;
+  return off;
+}
+
+void PointNumbering::blockCoord(const Block &b, coord_t off,
+    coord_t &i, coord_t &j, coord_t &k) const
+{
+  const coord_t n = b.i1 - b.i0 + 1;
+  const coord_t ninner = innerCorners(b.i0, b.i1);
+  i = b.i0;
+  j = b.j0;
+  k = 0;
+  if ((b.j0 == 0) && (ninner > 0)) {
+    if (off < n) {
+      i += off;
+      return;
     }
+    off -= n;
+    j++;
+  }
+  // every row left is the same length, except maybe a shorter top one
+  j += off / (n + ninner);
+  off %= (n + ninner);
+  if ((ninner == 0) || (j == nzy)) {
+    i += off;
+    return;
+  }
+  // the corners on the sides of a hex mesh have one point
+  if (b.i0 == 0) {
+    if (off == 0) return;
+    off--;
+    i++;
+  }
+  i += off / 2;
+  k = off % 2;
+}
+
+coord_t PointNumbering::index(const coord_t i, const coord_t j,
+                              const coord_t k) const
+{
+  if ((kind == MESH_PIE) && (j == 0))
+    return starts[(eff_numpcx > 1) ? 1 : 0][0];
+  const coord_t x = std::min(i / zones_per_piecex, eff_numpcx - 1);
+  const coord_t y = std::min(j / zones_per_piecey, eff_numpcy - 1);
+  const bool shared = ((x > 0) && (i == x * zones_per_piecex)) ||
+                      ((y > 0) && (j == y * zones_per_piecey));
+  const coord_t piece = y * numpcx + x;
+  coord_t index = starts[shared][piece];
+  if (hasOrigin(piece, shared)) index++;
+  Block blocks[2];
+  const int nb = pieceBlocks(piece, shared, blocks);
+  for (int b = 0; b < nb; b++) {
+    if (blocks[b].contains(i, j))
+      return index + blockOffset(blocks[b], i, j, k);
+    index += blockCount(blocks[b]);
   }
   // should never get here
   assert(0);
   return index;
 }
+
+void PointNumbering::coord(coord_t index,
+                           coord_t &i, coord_t &j, coord_t &k) const
+{
+  const bool shared = (index >= starts[1][0]);
+  const std::vector<coord_t> &start = starts[shared];
+  const coord_t piece =
+    std::upper_bound(start.begin(), start.end(), index) - start.begin() - 1;
+  index -= start[piece];
+  if (hasOrigin(piece, shared)) {
+    if (index == 0) {
+      i = j = k = 0;
+      return;
+    }
+    index--;
+  }
+  Block blocks[2];
+  const int nb = pieceBlocks(piece, shared, blocks);
+  for (int b = 0; b < nb; b++) {
+    const coord_t count = blockCount(blocks[b]);
+    if (index < count) {
+      blockCoord(blocks[b], index, i, j, k);
+      return;
+    }
+    index -= count;
+  }
+  // should never get here
+  assert(0);
+}
+#else
+coord_t PointNumbering::index(const coord_t i, const coord_t j,
+                              const coord_t k) const
+{
+  const coord_t npx = nzx + 1;
+  switch (kind)
+  {
+    case MESH_RECT:
+      return j * npx + i;
+    case MESH_PIE:
+      return (j == 0) ? 0 : (j - 1) * npx + i + 1;
+    case MESH_HEX:
+      {
+        // rows inside the mesh have two points for each inner corner
+        if (j == 0) return i;
+        const coord_t base = npx + (j - 1) * 2 * nzx;
+        if ((j == nzy) || (i == 0)) return base + i;
+        return base + 2 * i - 1 + k;
+      }
+    default:
+      assert(false);
+  }
+  return -1;
+}
+
+void PointNumbering::coord(coord_t index,
+                           coord_t &i, coord_t &j, coord_t &k) const
+{
+  const coord_t npx = nzx + 1;
+  k = 0;
+  switch (kind)
+  {
+    case MESH_RECT:
+      {
+        i = index % npx;
+        j = index / npx;
+        break;
+      }
+    case MESH_PIE:
+      {
+        if (index == 0)
+          i = j = 0;
+        else {
+          i = (index - 1) % npx;
+          j = (index - 1) / npx + 1;
+        }
+        break;
+      }
+    case MESH_HEX:
+      {
+        if (index < npx) {
+          i = index;
+          j = 0;
+          break;
+        }
+        const coord_t off = (index - npx) % (2 * nzx);
+        j = (index - npx) / (2 * nzx) + 1;
+        if (j == nzy)
+          i = off;
+        else {
+          i = (off + 1) / 2;
+          k = (off + 1) % 2;
+        }
+        break;
+      }
+    default:
+      assert(false);
+  }
+}
 #endif
 
+// Finds the piece a zone is in and where it is in that piece, for the
+// zone numbering genZonesRect sets up
+static void zone_index_to_piece(const coord_t nzx, const coord_t nzy,
+                                const coord_t numpcx, const coord_t numpcy,
+                                const coord_t zone,
+                                coord_t &piecex, coord_t &piecey,
+                                coord_t &localx, coord_t &localy,
+                                coord_t &local_zones_per_piecex,
+                                coord_t &local_zones_per_piecey)
+{
+  const coord_t zones_per_piecex = (nzx + numpcx - 1) / numpcx;
+  const coord_t zones_per_piecey = (nzy + numpcy - 1) / numpcy;
+
+  piecey = zone / (zones_per_piecey * nzx);
+  assert(piecey < numpcy);
+  const coord_t remainder = zone % (zones_per_piecey * nzx);
+
+  local_zones_per_piecey = 
+    piecey < (numpcy-1) ? zones_per_piecey : // not the last
+      ((nzy % zones_per_piecey) == 0) ? // last so see if evenly divisible
+        zones_per_piecey : nzy % zones_per_piecey;
+  const coord_t zones_per_row_piece = local_zones_per_piecey * zones_per_piecex;
+
+  piecex = remainder / zones_per_row_piece;
+  assert(piecex < numpcx);
+  const coord_t piece_zone = remainder % zones_per_row_piece;
+
+  local_zones_per_piecex =
+    piecex < (numpcx-1) ? zones_per_piecex : // not the last
+      ((nzx % zones_per_piecex) == 0) ? // last so see if evenly divisible 
+        zones_per_piecex : nzx % zones_per_piecex;
+
+  localx = piece_zone % local_zones_per_piecex;
+  localy = piece_zone / local_zones_per_piecex;
+}
+
+// Number of sides in the hex zones i0..i1 by j0..j1.  Zones have six
+// sides except along the edges of the mesh, where two of their points
+// land on the same corner:  zones on the bottom and top rows lose one,
+// and so do zones in the left column above the bottom row and in the
+// right column below the top row.
+static coord_t hex_block_sides(const coord_t nzx, const coord_t nzy,
+                               const coord_t i0, const coord_t i1,
+                               const coord_t j0, const coord_t j1)
+{
+  if ((i1 < i0) || (j1 < j0)) return 0;
+  const coord_t nx = i1 - i0 + 1;
+  const coord_t ny = j1 - j0 + 1;
+  coord_t lost = 0;
+  if (j0 == 0) lost += nx;
+  if (j1 == (nzy - 1)) lost += nx;
+  if (i0 == 0) lost += ny - ((j0 == 0) ? 1 : 0);
+  if (i1 == (nzx - 1)) lost += ny - ((j1 == (nzy - 1)) ? 1 : 0);
+  return 6 * nx * ny - lost;
+}
+
+// Index of the first side of a hex zone; sides are numbered in zone order
+static coord_t hex_zone_first_side(const GenMesh::GenSideArgs *args,
+                                   const coord_t zone)
+{
+  const coord_t zones_per_piecex = (args->nzx + args->numpcx - 1) / args->numpcx;
+  const coord_t zones_per_piecey = (args->nzy + args->numpcy - 1) / args->numpcy;
+  coord_t piecex, piecey, localx, localy, lzx, lzy;
+  zone_index_to_piece(args->nzx, args->nzy, args->numpcx, args->numpcy, zone,
+                      piecex, piecey, localx, localy, lzx, lzy);
+  const coord_t zi = piecex * zones_per_piecex;
+  const coord_t zj = piecey * zones_per_piecey;
+  // the rows of pieces below, the pieces to the left in this row,
+  // the rows below in this piece, then the zones to the left in this row
+  return hex_block_sides(args->nzx, args->nzy, 0, args->nzx - 1, 0, zj - 1) +
+    hex_block_sides(args->nzx, args->nzy, 0, zi - 1, zj, zj + lzy - 1) +
+    hex_block_sides(args->nzx, args->nzy, zi, zi + lzx - 1, zj, zj + localy - 1) +
+    hex_block_sides(args->nzx, args->nzy, zi, zi + localx - 1,
+                    zj + localy, zj + localy);
+}
+
+// Finds the points of a hex zone in order around it, and returns how
+// many there are
+static coord_t hex_zone_points(const GenMesh::GenSideArgs *args,
+                               const PointNumbering &numbering,
+                               const coord_t zone, coord_t *pts)
+{
+  const coord_t zones_per_piecex = (args->nzx + args->numpcx - 1) / args->numpcx;
+  const coord_t zones_per_piecey = (args->nzy + args->numpcy - 1) / args->numpcy;
+  coord_t piecex, piecey, localx, localy, lzx, lzy;
+  zone_index_to_piece(args->nzx, args->nzy, args->numpcx, args->numpcy, zone,
+                      piecex, piecey, localx, localy, lzx, lzy);
+  const coord_t zidx = piecex * zones_per_piecex + localx;
+  const coord_t zidy = piecey * zones_per_piecey + localy;
+  // The same six corners generateHex uses; the two points it has at a
+  // corner on the edge of the mesh are really the one point there
+  const coord_t ci[6] = { zidx, zidx, zidx + 1, zidx + 1, zidx + 1, zidx };
+  const coord_t cj[6] = { zidy, zidy, zidy, zidy + 1, zidy + 1, zidy + 1 };
+  const coord_t ck[6] = { 0, 1, 0, 1, 0, 1 };
+  coord_t n = 0;
+  for (int c = 0; c < 6; c++) {
+    const bool edge = (ci[c] == 0) || (ci[c] == args->nzx) ||
+                      (cj[c] == 0) || (cj[c] == args->nzy);
+    const coord_t p = numbering.index(ci[c], cj[c], edge ? 0 : ck[c]);
+    if ((n == 0) || (pts[n - 1] != p))
+      pts[n++] = p;
+  }
+  assert(n == hex_block_sides(args->nzx, args->nzy, zidx, zidx, zidy, zidy));
+  return n;
+}
+
 void GenMesh::genPointsRect(
             const Task *task,
             const std::vector<PhysicalRegion> &regions,
@@ -794,7 +1095,8 @@ void GenMesh::genPointsRect(
             Runtime *runtime)
 {
   const GenPointArgs *args = reinterpret_cast<const GenPointArgs*>(task->args);
-  const coord_t npx = args->nzx + 1;
+  const PointNumbering numbering(args->nzx, args->nzy,
+                                 args->numpcx, args->numpcy, MESH_RECT);
 
   const double dx = args->lenx / (double) args->nzx;
   const double dy = args->leny / (double) args->nzy;
@@ -808,13 +1110,8 @@ void GenMesh::genPointsRect(
   for (PointIterator itr(runtime, isp); itr(); itr++)
   {
     // Figure out the physical location based on the logical ID
-#ifdef PRECOMPACTED_RECT_POINTS
-    coord_t i, j;
-    rect_point_index_to_coord(args, itr[0], i, j);
-#else
-    const coord_t i = itr[0] % npx;
-    const coord_t j = itr[0] / npx;
-#endif
+    coord_t i, j, k;
+    numbering.coord(itr[0], i, j, k);
     const double x = dx * double(i);
     const double y = dy * double(j);
     acc_px[*itr] = make_double2(x, y);
@@ -835,7 +1132,8 @@ void GenMesh::genPointsPie(
             Runtime *runtime)
 {
   const GenPointArgs *args = reinterpret_cast<const GenPointArgs*>(task->args);
-  const coord_t npx = args->nzx + 1;
+  const PointNumbering numbering(args->nzx, args->nzy,
+                                 args->numpcx, args->numpcy, MESH_PIE);
 
   const double dth = args->lenx / (double) args->nzx;
   const double dr  = args->leny / (double) args->nzy;
@@ -849,13 +1147,13 @@ void GenMesh::genPointsPie(
   for (PointIterator itr(runtime, isp); itr(); itr++)
   {
     // Figure out the physical location based on the logical ID
-    if (itr[0] == 0) {
+    coord_t i, j, k;
+    numbering.coord(itr[0], i, j, k);
+    if (j == 0) {
       // Special case for the origin
       acc_px[*itr] = make_double2(0., 0.);
       acc_piece[*itr] = 0;
     } else {
-      const coord_t i = (itr[0]-1) % npx;
-      const coord_t j = (itr[0]-1) / npx + 1;
       const double th = dth * (double)(args->nzx - i);
       const double r = dr * (double) j;
       const double x = r * cos(th);
@@ -878,21 +1176,40 @@ void GenMesh::genPointsHex(
             Context ctx,
             Runtime *runtime)
 {
-#if 0
   const GenPointArgs *args = reinterpret_cast<const GenPointArgs*>(task->args);
-  const coord_t npx = args->nzx + 1;
+  const PointNumbering numbering(args->nzx, args->nzy,
+                                 args->numpcx, args->numpcy, MESH_HEX);
 
   const double dx = args->lenx / (double) (args->nzx - 1);
   const double dy = args->leny / (double) (args->nzy - 1);
 
+  const coord_t zones_per_piecex = (args->nzx + args->numpcx - 1) / args->numpcx;
+  const coord_t zones_per_piecey = (args->nzy + args->numpcy - 1) / args->numpcy;
+
   const IndexSpace &isp = task->regions[0].region.get_index_space();
   const AccessorWD<double2> acc_px(regions[0], FID_PX);
+  const AccessorWD<coord_t> acc_piece(regions[0], FID_PIECE);
   for (PointIterator itr(runtime, isp); itr(); itr++)
   {
+    // Figure out the physical location based on the logical ID
+    coord_t i, j, k;
+    numbering.coord(itr[0], i, j, k);
+    const double x = max(0., min(args->lenx, dx * ((double) i - 0.5)));
+    const double y = max(0., min(args->leny, dy * ((double) j - 0.5)));
+    if (i == 0 || i == args->nzx || j == 0 || j == args->nzy)
+      acc_px[*itr] = make_double2(x, y);
+    else if (k == 0)
+      acc_px[*itr] = make_double2(x - dx / 6., y + dy / 6.);
+    else
+      acc_px[*itr] = make_double2(x + dx / 6., y - dy / 6.);
+    // Tile the mesh so pieces are dense rectangles 
+    // Boundary zones will own a few extra points
+    const coord_t piecex = ((i == args->nzx) ? i-1 : i) / zones_per_piecex;
+    assert(piecex < args->numpcx);
+    const coord_t piecey = ((j == args->nzy) ? j-1 : j) / zones_per_piecey;
+    assert(piecey < args->numpcy);
+    acc_piece[*itr] = piecey * args->numpcx + piecex;
   }
-#else
-  assert(false); // TODO
-#endif
 }
 
 void GenMesh::genZonesRect(
@@ -980,8 +1297,27 @@ void GenMesh::genZonesHex(
             Context ctx,
             Runtime *runtime)
 {
-  // TODO: Implement hex mesh type
-  assert(false);
+  const GenZoneArgs *args = reinterpret_cast<const GenZoneArgs*>(task->args);
+
+  const coord_t zones_per_piecex = (args->nzx + args->numpcx - 1) / args->numpcx;
+  const coord_t zones_per_piecey = (args->nzy + args->numpcy - 1) / args->numpcy;
+
+  const IndexSpace &isz = task->regions[0].region.get_index_space();
+  const AccessorWD<int> acc_nump(regions[0], FID_ZNUMP);
+  const AccessorWD<Pointer> acc_piece(regions[0], FID_PIECE);
+  for (PointIterator itr(runtime, isz); itr(); itr++)
+  {
+    coord_t piecex, piecey, localx, localy, lzx, lzy;
+    zone_index_to_piece(args->nzx, args->nzy, args->numpcx, args->numpcy,
+                        itr[0], piecex, piecey, localx, localy, lzx, lzy);
+    const coord_t zidx = piecex * zones_per_piecex + localx;
+    const coord_t zidy = piecey * zones_per_piecey + localy;
+
+    // Six points, less the ones that fall on the same corner at the edges
+    acc_nump[*itr] = hex_block_sides(args->nzx, args->nzy, zidx, zidx, zidy, zidy);
+    // Fill in the piece for this zone
+    acc_piece[*itr] = piecey * args->numpcx + piecex;
+  }
 }
 
 void GenMesh::genSidesRect(
@@ -991,6 +1327,8 @@ void GenMesh::genSidesRect(
             Runtime *runtime)
 {
   const GenSideArgs *args = reinterpret_cast<const GenSideArgs*>(task->args);
+  const PointNumbering numbering(args->nzx, args->nzy,
+                                 args->numpcx, args->numpcy, MESH_RECT);
 
   const coord_t zones_per_piecex = (args->nzx + args->numpcx - 1) / args->numpcx;
   const coord_t zones_per_piecey = (args->nzy + args->numpcy - 1) / args->numpcy;
@@ -1089,13 +1427,8 @@ void GenMesh::genSidesRect(
       default:
         assert(false);
     }
-#ifdef PRECOMPACTED_RECT_POINTS
-    acc_sp1[*itr] = Pointer(rect_point_coord_to_index(args, pidx1, pidy1));
-    acc_sp2[*itr] = Pointer(rect_point_coord_to_index(args, pidx2, pidy2));
-#else
-    acc_sp1[*itr] = Pointer(pidy1 * (args->nzx + 1) + pidx1);
-    acc_sp2[*itr] = Pointer(pidy2 * (args->nzx + 1) + pidx2);
-#endif
+    acc_sp1[*itr] = Pointer(numbering.index(pidx1, pidy1, 0));
+    acc_sp2[*itr] = Pointer(numbering.index(pidx2, pidy2, 0));
   }
 }
 
@@ -1106,14 +1439,20 @@ void GenMesh::genSidesPie(
             Runtime *runtime)
 {
   const GenSideArgs *args = reinterpret_cast<const GenSideArgs*>(task->args);
+  const PointNumbering numbering(args->nzx, args->nzy,
+                                 args->numpcx, args->numpcy, MESH_PIE);
 
   const coord_t zones_per_piecex = (args->nzx + args->numpcx - 1) / args->numpcx;
   const coord_t zones_per_piecey = (args->nzy + args->numpcy - 1) / args->numpcy;
-  const coord_t npx = args->nzx + 1;
   
   const IndexSpace &iss = task->regions[0].region.get_index_space();
+#ifdef PRECOMPACTED_RECT_POINTS
+  const AccessorWD<Pointer> acc_sp1(regions[0], FID_MAPSP1);
+  const AccessorWD<Pointer> acc_sp2(regions[0], FID_MAPSP2);
+#else
   const AccessorWD<Pointer> acc_sp1(regions[0], FID_MAPSP1TEMP);
   const AccessorWD<Pointer> acc_sp2(regions[0], FID_MAPSP2TEMP);
+#endif
   const AccessorWD<Pointer> acc_sz(regions[0], FID_MAPSZ);
   const AccessorWD<Pointer> acc_ss3(regions[0], FID_MAPSS3);
   const AccessorWD<Pointer> acc_ss4(regions[0], FID_MAPSS4);
@@ -1211,25 +1550,26 @@ void GenMesh::genSidesPie(
         acc_ss4[*itr] = *itr - Pointer(2);
       else
         acc_ss4[*itr] = *itr + Pointer(1);
-      const coord_t p0 = zidx + 1;
+      // the bottom corners are both the origin
+      const coord_t origin = numbering.index(0, 0, 0);
       switch (side)
       {
         case 0:
           {
-            acc_sp1[*itr] = 0;
-            acc_sp2[*itr] = p0 + 1;
+            acc_sp1[*itr] = origin;
+            acc_sp2[*itr] = numbering.index(zidx + 1, 1, 0);
             break;
           }
         case 1:
           {
-            acc_sp1[*itr] = p0 + 1;
-            acc_sp2[*itr] = p0;
+            acc_sp1[*itr] = numbering.index(zidx + 1, 1, 0);
+            acc_sp2[*itr] = numbering.index(zidx, 1, 0);
             break;
           }
         case 2:
           {
-            acc_sp1[*itr] = p0;
-            acc_sp2[*itr] = 0;
+            acc_sp1[*itr] = numbering.index(zidx, 1, 0);
+            acc_sp2[*itr] = origin;
             break;
           }
         default:
@@ -1247,31 +1587,34 @@ void GenMesh::genSidesPie(
         acc_ss4[*itr] = *itr - Pointer(3);
       else
         acc_ss4[*itr] = *itr + Pointer(1);
-      const coord_t p0 = (zidy - 1) * npx + zidx + 1;
+      const coord_t p00 = numbering.index(zidx, zidy, 0);
+      const coord_t p10 = numbering.index(zidx + 1, zidy, 0);
+      const coord_t p11 = numbering.index(zidx + 1, zidy + 1, 0);
+      const coord_t p01 = numbering.index(zidx, zidy + 1, 0);
       switch (side)
       {
         case 0:
           {
-            acc_sp1[*itr] = p0;
-            acc_sp2[*itr] = p0 + 1;
+            acc_sp1[*itr] = p00;
+            acc_sp2[*itr] = p10;
             break;
           }
         case 1:
           {
-            acc_sp1[*itr] = p0 + 1;
-            acc_sp2[*itr] = p0 + npx + 1;
+            acc_sp1[*itr] = p10;
+            acc_sp2[*itr] = p11;
             break;
           }
         case 2:
           {
-            acc_sp1[*itr] = p0 + npx + 1;
-            acc_sp2[*itr] = p0 + npx;
+            acc_sp1[*itr] = p11;
+            acc_sp2[*itr] = p01;
             break;
           }
         case 3:
           {
-            acc_sp1[*itr] = p0 + npx;
-            acc_sp2[*itr] = p0;
+            acc_sp1[*itr] = p01;
+            acc_sp2[*itr] = p00;
             break;
           }
         default:
@@ -1287,6 +1630,60 @@ void GenMesh::genSidesHex(
             Context ctx,
             Runtime *runtime)
 {
-  assert(false); // TODO
+  const GenSideArgs *args = reinterpret_cast<const GenSideArgs*>(task->args);
+  const PointNumbering numbering(args->nzx, args->nzy,
+                                 args->numpcx, args->numpcy, MESH_HEX);
+
+  const coord_t zones_per_piecex = (args->nzx + args->numpcx - 1) / args->numpcx;
+  const coord_t zones_per_piecey = (args->nzy + args->numpcy - 1) / args->numpcy;
+  const coord_t nz = args->nzx * args->nzy;
+
+  const IndexSpace &iss = task->regions[0].region.get_index_space();
+#ifdef PRECOMPACTED_RECT_POINTS
+  const AccessorWD<Pointer> acc_sp1(regions[0], FID_MAPSP1);
+  const AccessorWD<Pointer> acc_sp2(regions[0], FID_MAPSP2);
+#else
+  const AccessorWD<Pointer> acc_sp1(regions[0], FID_MAPSP1TEMP);
+  const AccessorWD<Pointer> acc_sp2(regions[0], FID_MAPSP2TEMP);
+#endif
+  const AccessorWD<Pointer> acc_sz(regions[0], FID_MAPSZ);
+  const AccessorWD<Pointer> acc_ss3(regions[0], FID_MAPSS3);
+  const AccessorWD<Pointer> acc_ss4(regions[0], FID_MAPSS4);
+  // Zones have different numbers of sides, so find the zone with our
+  // first side and then walk through the zones from there
+  const Rect<1> rects = runtime->get_index_space_domain(iss);
+  if (rects.empty()) return;
+  coord_t zone = 0, zhi = nz - 1;
+  while (zone < zhi) {
+    const coord_t zmid = (zone + zhi + 1) / 2;
+    if (hex_zone_first_side(args, zmid) <= rects.lo[0])
+      zone = zmid;
+    else
+      zhi = zmid - 1;
+  }
+  coord_t first = hex_zone_first_side(args, zone);
+  coord_t pts[6];
+  coord_t nside = hex_zone_points(args, numbering, zone, pts);
+  for (coord_t s = rects.lo[0]; s <= rects.hi[0]; s++)
+  {
+    if (s == (first + nside)) {
+      first += nside;
+      zone++;
+      nside = hex_zone_points(args, numbering, zone, pts);
+    }
+    const coord_t side = s - first;
+    const Pointer ptr(s);
+    acc_sz[ptr] = zone;
+    if (side == 0)
+      acc_ss3[ptr] = ptr + Pointer(nside - 1);
+    else
+      acc_ss3[ptr] = ptr - Pointer(1);
+    if (side == (nside - 1))
+      acc_ss4[ptr] = ptr - Pointer(nside - 1);
+    else
+      acc_ss4[ptr] = ptr + Pointer(1);
+    acc_sp1[ptr] = Pointer(pts[side]);
+    acc_sp2[ptr] = Pointer(pts[(side + 1) % nside]);
+  }
 }
 
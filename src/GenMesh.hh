@@ -134,6 +134,9 @@ public:
 
     Legion::coord_t calcNumSides(const int numpc);
 
+    // most sides any one zone of this mesh type has
+    int calcMaxZoneSides() const;
+
     void generatePointsParallel(
             const int numpcs,
             Legion::Runtime *runtime,
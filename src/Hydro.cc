@@ -193,6 +193,44 @@ static void __attribute__ ((constructor)) registerTasks() {
       registrar.set_leaf();
       Runtime::preregister_task_variant<Hydro::initRadialVelTask>(registrar, "init radial vel");
     }
+    {
+      TaskVariantRegistrar registrar(TID_PULLCRNRMASS, "CPU pullcrnrmass");
+      registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+      registrar.set_leaf();
+      Runtime::preregister_task_variant<Hydro::pullCrnrMassTask>(registrar, "pullcrnrmass");
+    }
+    {
+      TaskVariantRegistrar registrar(TID_PULLCRNRFORCE, "CPU pullcrnrforce");
+      registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+      registrar.set_leaf();
+      Runtime::preregister_task_variant<Hydro::pullCrnrForceTask>(registrar, "pullcrnrforce");
+    }
+    {
+      TaskVariantRegistrar registrar(TID_INITINVARIANTS, "CPU init invariants");
+      registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+      registrar.set_leaf();
+      Runtime::preregister_task_variant<Hydro::initInvariantsTask>(registrar, "init invariants");
+    }
+    {
+      TaskVariantRegistrar registrar(TID_CALCACTIVITY, "CPU calc activity");
+      registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+      registrar.set_leaf();
+      Runtime::preregister_task_variant<Hydro::PieceActivity,
+          Hydro::calcActivityTask>(registrar, "calc activity");
+    }
+    {
+      TaskVariantRegistrar registrar(TID_MARKPOINTOWNERS, "CPU mark point owners");
+      registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+      registrar.set_leaf();
+      Runtime::preregister_task_variant<Hydro::markPointOwnersTask>(registrar, "mark point owners");
+    }
+    {
+      TaskVariantRegistrar registrar(TID_CALCPIECENBRS, "CPU calc piece nbrs");
+      registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+      registrar.set_leaf();
+      Runtime::preregister_task_variant<Hydro::PieceNeighbors,
+          Hydro::calcPieceNbrsTask>(registrar, "calc piece nbrs");
+    }
 }
 }; // namespace
 
@@ -202,7 +240,7 @@ Hydro::Hydro(
         Mesh* m,
         Context ctxa,
         Runtime* runtimea)
-        : mesh(m), ctx(ctxa), runtime(runtimea) {
+        : mesh(m), bc(NULL), ctx(ctxa), runtime(runtimea) {
     cfl = inp->getDouble("cfl", 0.6);
     cflv = inp->getDouble("cflv", 0.1);
     rinit = inp->getDouble("rinit", 1.);
@@ -212,29 +250,50 @@ Hydro::Hydro(
     uinitradial = inp->getDouble("uinitradial", 0.);
     bcx = inp->getDoubleList("bcx", vector<double>());
     bcy = inp->getDoubleList("bcy", vector<double>());
+    activecycles = inp->getInt("activecycles", 0);
+    // an absolute speed, in the deck's units, so a piece's state
+    // doesn't depend on how fast the rest of the mesh is moving
+    activetol = inp->getDouble("activetol", 1.e-10);
+    tunetag = 0;
+#ifdef ALIAS_SCRATCH_FIELDS
+    // a piece that sits out a cycle would keep whichever quantity was
+    // last in an aliased field, not the one the next cycle expects
+    if (activecycles > 0) {
+        LEGION_PRINT_ONCE(runtime, ctx, stderr,
+            "activecycles can't be used with ALIAS_SCRATCH_FIELDS\n");
+        exit(1);
+    }
+#endif
 
     pgas = new PolyGas(inp, this);
     tts = new TTS(inp, this);
     qcs = new QCS(inp, this);
 
-    const double2 vfixx = double2(1., 0.);
-    const double2 vfixy = double2(0., 1.);
-    for (int i = 0; i < bcx.size(); ++i)
-      bcs.push_back(new HydroBC(mesh, vfixx, bcx[i], true/*xplane*/));
-    for (int i = 0; i < bcy.size(); ++i)
-      bcs.push_back(new HydroBC(mesh, vfixy, bcy[i], false/*xplane*/));
+    initBCs();
 
     init();
+
+    resetActivePieces();
 }
 
 
 Hydro::~Hydro() {
 
+    delete pgas;
     delete tts;
     delete qcs;
-    for (int i = 0; i < bcs.size(); ++i) {
-        delete bcs[i];
-    }
+    delete bc;
+}
+
+
+void Hydro::initBCs() {
+    // the boundary point list is per piece, so throw away
+    // any from before the mesh was rebalanced
+    delete bc;
+    bc = NULL;
+
+    if (!bcx.empty() || !bcy.empty())
+        bc = new HydroBC(mesh, bcx, bcy);
 }
 
 
@@ -336,6 +395,44 @@ void Hydro::init() {
     launcher.add_field(FID_PU);
     runtime->fill_fields(ctx, launcher);
   }
+
+  // A force package whose coefficients are all zero adds nothing, so
+  // doCycle skips its launches and its fields are freed.  Without QCS
+  // zdu is zero, and it still goes into the timestep.
+  usetts = (tts->alfa != 0.);
+  useqcs = (qcs->q1 != 0. || qcs->q2 != 0.);
+  if (!usetts)
+  {
+    LEGION_PRINT_ONCE(runtime, ctx, stdout, "TTS is off (alfa = 0)\n");
+  }
+  if (!useqcs)
+  {
+    LEGION_PRINT_ONCE(runtime, ctx, stdout, "QCS is off (q1 = q2 = 0)\n");
+    const double zero = 0.;
+    FillLauncher launcher(lrz, lrz, TaskArgument(&zero, sizeof(zero)));
+    launcher.add_field(FID_ZDU);
+    runtime->fill_fields(ctx, launcher);
+  }
+  mesh->releaseForceFields(!usetts, !useqcs);
+
+#ifdef CACHE_INVARIANTS
+  initInvariants();
+#endif
+}
+
+
+void Hydro::initInvariants() {
+  IndexTaskLauncher launcher(TID_INITINVARIANTS, mesh->ispc,
+                        TaskArgument(), ArgumentMap());
+  launcher.add_region_requirement(
+      RegionRequirement(mesh->lpz, 0/*identity*/, LEGION_READ_ONLY, LEGION_EXCLUSIVE, mesh->lrz));
+  launcher.add_field(0/*index*/, FID_ZNUMP);
+  launcher.add_field(0/*index*/, FID_ZM);
+  launcher.add_region_requirement(
+      RegionRequirement(mesh->lpzc, 0/*identity*/, LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, mesh->lrzc));
+  launcher.add_field(1/*index*/, FID_ZNUMPINV);
+  launcher.add_field(1/*index*/, FID_ZMINV);
+  runtime->execute_index_space(ctx, launcher);
 }
 
 
@@ -350,10 +447,24 @@ Future Hydro::doCycle(
     LogicalPartition& lppprv = mesh->lppprv;
     LogicalPartition& lppmstr = mesh->lppmstr;
     LogicalPartition& lppshr = mesh->lppshr;
+    LogicalPartition& lppnshr = mesh->lppnshr;
+    LogicalPartition& lppxshr = mesh->lppxshr;
+    LogicalRegion& lrgh = mesh->lrgh;
+    LogicalPartition& lpgh = mesh->lpgh;
+    LogicalPartition& lpghown = mesh->lpghown;
     LogicalPartition& lps = mesh->lps;
     LogicalPartition& lpz = mesh->lpz;
+    LogicalRegion& lrzc = mesh->lrzc;
+    LogicalPartition& lpzc = mesh->lpzc;
     //LogicalRegion& lrglb = mesh->lrglb;
     const IndexSpace& ispc= mesh->ispc;
+    // Pieces at rest sit out the launches that only update their own
+    // zones and points.  updateActivePieces also wakes every piece a
+    // disturbance could reach before the next update, so the points
+    // of the ones that sit out stay at rest; the shared point sums
+    // still cover them all, and the timestep takes the pieces at rest
+    // from f_dtrest
+    const IndexSpace& ispa = ispcact;
 
     TaskArgument ta;
     ArgumentMap am;
@@ -382,7 +493,7 @@ Future Hydro::doCycle(
     launchffd2.argument = TaskArgument(ffd2args, sizeof(ffd2args));
     launchffd2.predicate = p_not_done;
     
-    IndexTaskLauncher launchaph(TID_ADVPOSHALF, ispc, ta, am, p_not_done);
+    IndexTaskLauncher launchaph(TID_ADVPOSHALF, ispa, ta, am, p_not_done);
     launchaph.add_future(f_dt);
     // do point routines twice, once each for private and master
     // partitions
@@ -430,13 +541,13 @@ Future Hydro::doCycle(
         // Only really need OpenMP for the private part
         if (part == 0)
           launchaph.tag |= PennantMapper::CRITICAL |
-            PennantMapper::PREFER_OMP | PennantMapper::PREFER_GPU;
+            PennantMapper::PREFER_OMP | PennantMapper::PREFER_GPU | tunetag;
         else
           launchaph.tag &= ~(PennantMapper::PREFER_OMP);
         runtime->execute_index_space(ctx, launchaph);
     }  // for part
 
-    IndexTaskLauncher launchcc(TID_CALCCTRS, ispc, ta, am, p_not_done);
+    IndexTaskLauncher launchcc(TID_CALCCTRS, ispa, ta, am, p_not_done);
     launchcc.add_region_requirement(
             RegionRequirement(lps, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrs));
     launchcc.add_field(0, FID_MAPSP1);
@@ -447,23 +558,32 @@ Future Hydro::doCycle(
     launchcc.add_region_requirement(
             RegionRequirement(lpz, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrz));
     launchcc.add_field(1, FID_ZNUMP);
+    launchcc.add_field(1, FID_MAPZS1);
     launchcc.add_region_requirement(
             RegionRequirement(lppprv, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrp));
     launchcc.add_field(2, FID_PXP);
     launchcc.add_region_requirement(
             RegionRequirement(lppshr, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrp));
     launchcc.add_field(3, FID_PXP);
+    launchcc.add_region_requirement(
+            RegionRequirement(lpz, 0, LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, lrz));
+    launchcc.add_field(4, FID_ZXP);
+#ifndef RECOMPUTE_EDGE_GEOMETRY
     launchcc.add_region_requirement(
             RegionRequirement(lps, 0, LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, lrs));
-    launchcc.add_field(4, FID_EXP);
+    launchcc.add_field(5, FID_EXP);
+#endif
+#ifdef CACHE_INVARIANTS
+    // calcCtrs looks for this as its last region
     launchcc.add_region_requirement(
-            RegionRequirement(lpz, 0, LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, lrz));
-    launchcc.add_field(5, FID_ZXP);
+            RegionRequirement(lpzc, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrzc));
+    launchcc.add_field(launchcc.region_requirements.size() - 1, FID_ZNUMPINV);
+#endif
     launchcc.tag |= PennantMapper::CRITICAL | 
-      PennantMapper::PREFER_OMP | PennantMapper::PREFER_GPU;
+      PennantMapper::PREFER_OMP | PennantMapper::PREFER_GPU | tunetag;
     runtime->execute_index_space(ctx, launchcc);
 
-    IndexTaskLauncher launchcv(TID_CALCVOLS, ispc, ta, am, p_not_done);
+    IndexTaskLauncher launchcv(TID_CALCVOLS, ispa, ta, am, p_not_done);
     launchcv.add_region_requirement(
             RegionRequirement(lps, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrs));
     launchcv.add_field(0, FID_MAPSP1);
@@ -482,17 +602,24 @@ Future Hydro::doCycle(
     launchcv.add_field(3, FID_ZXP);
     launchcv.add_region_requirement(
             RegionRequirement(lps, 0, LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, lrs));
+#ifndef RECOMPUTE_EDGE_GEOMETRY
     launchcv.add_field(4, FID_SAREAP);
+#endif
     launchcv.add_field(4, FID_SVOLP);
     launchcv.add_region_requirement(
             RegionRequirement(lpz, 0, LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, lrz));
     launchcv.add_field(5, FID_ZAREAP);
     launchcv.add_field(5, FID_ZVOLP);
+    launchcv.add_region_requirement(
+            RegionRequirement(lpz, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrz));
+    launchcv.add_field(6, FID_ZNUMP);
+    launchcv.add_field(6, FID_MAPZS1);
     launchcv.tag |= PennantMapper::CRITICAL | 
-      PennantMapper::PREFER_OMP | PennantMapper::PREFER_GPU;
+      PennantMapper::PREFER_OMP | PennantMapper::PREFER_GPU | tunetag;
     Future f_cv = runtime->execute_index_space(ctx, launchcv, OPID_SUMINT);
 
-    IndexTaskLauncher launchcsv(TID_CALCSURFVECS, ispc, ta, am, p_not_done);
+#ifndef RECOMPUTE_EDGE_GEOMETRY
+    IndexTaskLauncher launchcsv(TID_CALCSURFVECS, ispa, ta, am, p_not_done);
     launchcsv.add_region_requirement(
             RegionRequirement(lps, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrs));
     launchcsv.add_field(0, FID_MAPSZ);
@@ -503,10 +630,10 @@ Future Hydro::doCycle(
     launchcsv.add_region_requirement(
             RegionRequirement(lps, 0, LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, lrs));
     launchcsv.add_field(2, FID_SSURFP);
-    launchcsv.tag |= PennantMapper::PREFER_OMP | PennantMapper::PREFER_GPU;
+    launchcsv.tag |= PennantMapper::PREFER_OMP | PennantMapper::PREFER_GPU | tunetag;
     runtime->execute_index_space(ctx, launchcsv);
 
-    IndexTaskLauncher launchcel(TID_CALCEDGELEN, ispc, ta, am, p_not_done);
+    IndexTaskLauncher launchcel(TID_CALCEDGELEN, ispa, ta, am, p_not_done);
     launchcel.add_region_requirement(
             RegionRequirement(lps, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrs));
     launchcel.add_field(0, FID_MAPSP1);
@@ -523,25 +650,42 @@ Future Hydro::doCycle(
             RegionRequirement(lps, 0, LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, lrs));
     launchcel.add_field(3, FID_ELEN);
     launchcel.tag |= PennantMapper::CRITICAL | 
-      PennantMapper::PREFER_OMP | PennantMapper::PREFER_GPU;
+      PennantMapper::PREFER_OMP | PennantMapper::PREFER_GPU | tunetag;
     runtime->execute_index_space(ctx, launchcel);
+#endif
 
-    IndexTaskLauncher launchccl(TID_CALCCHARLEN, ispc, ta, am, p_not_done);
+    IndexTaskLauncher launchccl(TID_CALCCHARLEN, ispa, ta, am, p_not_done);
     launchccl.add_region_requirement(
             RegionRequirement(lps, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrs));
     launchccl.add_field(0, FID_MAPSZ);
+#ifndef RECOMPUTE_EDGE_GEOMETRY
     launchccl.add_field(0, FID_SAREAP);
     launchccl.add_field(0, FID_ELEN);
+#endif
     launchccl.add_region_requirement(
             RegionRequirement(lpz, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrz));
     launchccl.add_field(1, FID_ZNUMP);
     launchccl.add_region_requirement(
             RegionRequirement(lpz, 0, LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, lrz));
     launchccl.add_field(2, FID_ZDL);
-    launchccl.tag |= PennantMapper::PREFER_OMP | PennantMapper::PREFER_GPU;
+#ifdef RECOMPUTE_EDGE_GEOMETRY
+    // what SideGeometry recomputes the side quantities from
+    launchccl.add_field(0, FID_MAPSP1);
+    launchccl.add_field(0, FID_MAPSP2);
+    launchccl.add_field(0, FID_MAPSP1REG);
+    launchccl.add_field(0, FID_MAPSP2REG);
+    launchccl.add_field(1, FID_ZXP);
+    launchccl.add_region_requirement(
+            RegionRequirement(lppprv, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrp));
+    launchccl.add_field(3, FID_PXP);
+    launchccl.add_region_requirement(
+            RegionRequirement(lppshr, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrp));
+    launchccl.add_field(4, FID_PXP);
+#endif
+    launchccl.tag |= PennantMapper::PREFER_OMP | PennantMapper::PREFER_GPU | tunetag;
     runtime->execute_index_space(ctx, launchccl);
 
-    IndexTaskLauncher launchcr(TID_CALCRHO, ispc, ta, am, p_not_done);
+    IndexTaskLauncher launchcr(TID_CALCRHO, ispa, ta, am, p_not_done);
     launchcr.add_region_requirement(
             RegionRequirement(lpz, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrz));
     launchcr.add_field(0, FID_ZM);
@@ -550,17 +694,34 @@ Future Hydro::doCycle(
             RegionRequirement(lpz, 0, LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, lrz));
     launchcr.add_field(1, FID_ZRP);
     launchcr.tag |= PennantMapper::CRITICAL | 
-      PennantMapper::PREFER_OMP | PennantMapper::PREFER_GPU;
+      PennantMapper::PREFER_OMP | PennantMapper::PREFER_GPU | tunetag;
     runtime->execute_index_space(ctx, launchcr);
 
+#ifdef PULL_GHOST_POINTS
+    launchffd.partition = lpgh;
+    launchffd.parent = lrgh;
+    launchffd.fields.clear();
+    launchffd.add_field(FID_GHOSTMASWT);
+    runtime->fill_fields(ctx, launchffd);
+#endif
+
     IndexTaskLauncher launchccm(TID_CALCCRNRMASS, ispc, ta, am, p_not_done);
     launchccm.add_region_requirement(
             RegionRequirement(lps, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrs));
     launchccm.add_field(0, FID_MAPSP1);
     launchccm.add_field(0, FID_MAPSP1REG);
+#ifdef PULL_GHOST_POINTS
+    launchccm.add_field(0, FID_MAPSP1GHOST);
+#else
+    launchccm.add_field(0, FID_MAPSP1NODE);
+#endif
     launchccm.add_field(0, FID_MAPSS3);
     launchccm.add_field(0, FID_MAPSZ);
     launchccm.add_field(0, FID_SMF);
+#ifdef COLOR_SIDE_SCATTERS
+    launchccm.add_field(0, FID_COLORSIDE);
+    launchccm.add_field(0, FID_SIDECOLOR);
+#endif
     launchccm.add_region_requirement(
             RegionRequirement(lpz, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrz));
     launchccm.add_field(1, FID_ZRP);
@@ -568,16 +729,43 @@ Future Hydro::doCycle(
     launchccm.add_region_requirement(
             RegionRequirement(lppprv, 0, LEGION_READ_WRITE, LEGION_EXCLUSIVE, lrp));
     launchccm.add_field(2, FID_PMASWT);
+#ifdef PULL_GHOST_POINTS
+    // sum into our masters directly and into our own (zeroed) slots
+    // for the ghost points, then the owners of those pull the slots over
+    launchccm.add_region_requirement(
+            RegionRequirement(lppmstr, 0, LEGION_READ_WRITE, LEGION_EXCLUSIVE, lrp));
+    launchccm.add_field(3, FID_PMASWT);
     launchccm.add_region_requirement(
-            RegionRequirement(lppshr, 0, OPID_SUMDBL,
+            RegionRequirement(lpgh, 0, LEGION_READ_WRITE, LEGION_EXCLUSIVE, lrgh));
+    launchccm.add_field(4, FID_GHOSTMASWT);
+#else
+    launchccm.add_region_requirement(
+            RegionRequirement(lppxshr, 0, OPID_SUMDBL,
                     LEGION_SIMULTANEOUS, lrp));
     launchccm.add_field(3, FID_PMASWT);
-    launchccm.tag |= PennantMapper::PREFER_OMP | PennantMapper::PREFER_GPU;
+    launchccm.add_region_requirement(
+            RegionRequirement(lppnshr, 0, OPID_SUMDBL,
+                    LEGION_SIMULTANEOUS, lrp, PennantMapper::NODE_REDUCE));
+    launchccm.add_field(4, FID_PMASWT);
+#endif
+    launchccm.tag |= PennantMapper::PREFER_OMP | PennantMapper::PREFER_GPU | tunetag;
     runtime->execute_index_space(ctx, launchccm);
 
-    double cshargs[] = { pgas->gamma, pgas->ssmin };
-    IndexTaskLauncher launchcsh(TID_CALCSTATEHALF, ispc,
-            TaskArgument(cshargs, sizeof(cshargs)), am, p_not_done);
+#ifdef PULL_GHOST_POINTS
+    IndexTaskLauncher launchpcm(TID_PULLCRNRMASS, ispc, ta, am, p_not_done);
+    launchpcm.add_region_requirement(
+            RegionRequirement(lpghown, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrgh));
+    launchpcm.add_field(0, FID_GHOSTP);
+    launchpcm.add_field(0, FID_GHOSTMASWT);
+    launchpcm.add_region_requirement(
+            RegionRequirement(lppmstr, 0, LEGION_READ_WRITE, LEGION_EXCLUSIVE, lrp));
+    launchpcm.add_field(1, FID_PMASWT);
+    runtime->execute_index_space(ctx, launchpcm);
+#endif
+
+    const PolyGas::StateHalfArgs cshargs = pgas->stateHalfArgs();
+    IndexTaskLauncher launchcsh(TID_CALCSTATEHALF, ispa,
+            TaskArgument(&cshargs, sizeof(cshargs)), am, p_not_done);
     launchcsh.add_future(f_dt);
     launchcsh.add_region_requirement(
             RegionRequirement(lpz, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrz));
@@ -586,230 +774,360 @@ Future Hydro::doCycle(
     launchcsh.add_field(0, FID_ZVOL0);
     launchcsh.add_field(0, FID_ZE);
     launchcsh.add_field(0, FID_ZWRATE);
+#ifndef CACHE_INVARIANTS
     launchcsh.add_field(0, FID_ZM);
+#endif
     launchcsh.add_region_requirement(
             RegionRequirement(lpz, 0, LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, lrz));
     launchcsh.add_field(1, FID_ZP);
     launchcsh.add_field(1, FID_ZSS);
+#ifdef CACHE_INVARIANTS
+    launchcsh.add_region_requirement(
+            RegionRequirement(lpzc, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrzc));
+    launchcsh.add_field(2, FID_ZMINV);
+#endif
+    if (pgas->eostype == EOS_TABLE) {
+        // calcStateHalf looks for these as its last two regions
+        launchcsh.add_region_requirement(
+                RegionRequirement(pgas->lreos, LEGION_READ_ONLY, LEGION_EXCLUSIVE,
+                    pgas->lreos));
+        launchcsh.add_field(launchcsh.region_requirements.size() - 1, FID_EOSTAB);
+        launchcsh.add_region_requirement(
+                RegionRequirement(pgas->getZonePieces(), 0, LEGION_READ_WRITE,
+                    LEGION_EXCLUSIVE, pgas->lrzeos));
+        launchcsh.add_field(launchcsh.region_requirements.size() - 1, FID_ZEOSIR);
+        launchcsh.add_field(launchcsh.region_requirements.size() - 1, FID_ZEOSIE);
+    }
     launchcsh.tag |= PennantMapper::CRITICAL | 
-      PennantMapper::PREFER_OMP | PennantMapper::PREFER_GPU;
+      PennantMapper::PREFER_OMP | PennantMapper::PREFER_GPU | tunetag;
     runtime->execute_index_space(ctx, launchcsh);
 
-    IndexTaskLauncher launchcfp(TID_CALCFORCEPGAS, ispc, ta, am, p_not_done);
+    IndexTaskLauncher launchcfp(TID_CALCFORCEPGAS, ispa, ta, am, p_not_done);
     launchcfp.add_region_requirement(
             RegionRequirement(lps, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrs));
     launchcfp.add_field(0, FID_MAPSZ);
+#ifndef RECOMPUTE_EDGE_GEOMETRY
     launchcfp.add_field(0, FID_SSURFP);
+#endif
     launchcfp.add_region_requirement(
             RegionRequirement(lpz, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrz));
     launchcfp.add_field(1, FID_ZP);
     launchcfp.add_region_requirement(
             RegionRequirement(lps, 0, LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, lrs));
     launchcfp.add_field(2, FID_SFP);
+#ifdef RECOMPUTE_EDGE_GEOMETRY
+    // what SideGeometry recomputes the side quantities from
+    launchcfp.add_field(0, FID_MAPSP1);
+    launchcfp.add_field(0, FID_MAPSP2);
+    launchcfp.add_field(0, FID_MAPSP1REG);
+    launchcfp.add_field(0, FID_MAPSP2REG);
+    launchcfp.add_field(1, FID_ZXP);
+    launchcfp.add_region_requirement(
+            RegionRequirement(lppprv, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrp));
+    launchcfp.add_field(3, FID_PXP);
+    launchcfp.add_region_requirement(
+            RegionRequirement(lppshr, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrp));
+    launchcfp.add_field(4, FID_PXP);
+#endif
     launchcfp.tag |= PennantMapper::CRITICAL | 
-      PennantMapper::PREFER_OMP | PennantMapper::PREFER_GPU;
+      PennantMapper::PREFER_OMP | PennantMapper::PREFER_GPU | tunetag;
     runtime->execute_index_space(ctx, launchcfp);
 
-    double cftargs[] = { tts->alfa, tts->ssmin };
-    IndexTaskLauncher launchcft(TID_CALCFORCETTS, ispc,
-            TaskArgument(cftargs, sizeof(cftargs)), am, p_not_done);
-    launchcft.add_region_requirement(
-            RegionRequirement(lps, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrs));
-    launchcft.add_field(0, FID_MAPSZ);
-    launchcft.add_field(0, FID_SAREAP);
-    launchcft.add_field(0, FID_SMF);
-    launchcft.add_field(0, FID_SSURFP);
-    launchcft.add_region_requirement(
-            RegionRequirement(lpz, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrz));
-    launchcft.add_field(1, FID_ZAREAP);
-    launchcft.add_field(1, FID_ZRP);
-    launchcft.add_field(1, FID_ZSS);
-    launchcft.add_region_requirement(
-            RegionRequirement(lps, 0, LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, lrs));
-    launchcft.add_field(2, FID_SFT);
-    launchcft.tag |= PennantMapper::CRITICAL | 
-      PennantMapper::PREFER_OMP | PennantMapper::PREFER_GPU;
-    runtime->execute_index_space(ctx, launchcft);
-
-    IndexTaskLauncher launchscd(TID_SETCORNERDIV, ispc, ta, am, p_not_done);
-    launchscd.add_region_requirement(
-            RegionRequirement(lps, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrs));
-    launchscd.add_field(0, FID_MAPSZ);
-    launchscd.add_field(0, FID_MAPSP1);
-    launchscd.add_field(0, FID_MAPSP2);
-    launchscd.add_field(0, FID_MAPSS3);
-    launchscd.add_field(0, FID_MAPSP1REG);
-    launchscd.add_field(0, FID_MAPSP2REG);
-    launchscd.add_field(0, FID_EXP);
-    launchscd.add_field(0, FID_ELEN);
-    launchscd.add_region_requirement(
-            RegionRequirement(lpz, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrz));
-    launchscd.add_field(1, FID_ZNUMP);
-    launchscd.add_field(1, FID_ZXP);
-    launchscd.add_region_requirement(
-            RegionRequirement(lppprv, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrp));
-    launchscd.add_field(2, FID_PXP);
-    launchscd.add_field(2, FID_PU0);
-    launchscd.add_region_requirement(
-            RegionRequirement(lppshr, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrp));
-    launchscd.add_field(3, FID_PXP);
-    launchscd.add_field(3, FID_PU0);
-    launchscd.add_region_requirement(
-            RegionRequirement(lpz, 0, LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, lrz));
-    launchscd.add_field(4, FID_ZUC);
-    launchscd.add_region_requirement(
-            RegionRequirement(lps, 0, LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, lrs));
-    launchscd.add_field(5, FID_CAREA);
-    launchscd.add_field(5, FID_CCOS);
-    launchscd.add_field(5, FID_CDIV);
-    launchscd.add_field(5, FID_CEVOL);
-    launchscd.add_field(5, FID_CDU);
-    launchscd.tag |= PennantMapper::CRITICAL | 
-      PennantMapper::PREFER_OMP | PennantMapper::PREFER_GPU;
-    runtime->execute_index_space(ctx, launchscd);
-
-    double sqcfargs[] = { qcs->qgamma, qcs->q1, qcs->q2 };
-    IndexTaskLauncher launchsqcf(TID_SETQCNFORCE, ispc,
-            TaskArgument(sqcfargs, sizeof(sqcfargs)), am, p_not_done);
-    launchsqcf.add_region_requirement(
-            RegionRequirement(lps, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrs));
-    launchsqcf.add_field(0, FID_MAPSZ);
-    launchsqcf.add_field(0, FID_MAPSP1);
-    launchsqcf.add_field(0, FID_MAPSP2);
-    launchsqcf.add_field(0, FID_MAPSS3);
-    launchsqcf.add_field(0, FID_MAPSP1REG);
-    launchsqcf.add_field(0, FID_MAPSP2REG);
-    launchsqcf.add_field(0, FID_ELEN);
-    launchsqcf.add_field(0, FID_CDIV);
-    launchsqcf.add_field(0, FID_CDU);
-    launchsqcf.add_field(0, FID_CEVOL);
-    launchsqcf.add_region_requirement(
-            RegionRequirement(lpz, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrz));
-    launchsqcf.add_field(1, FID_ZRP);
-    launchsqcf.add_field(1, FID_ZSS);
-    launchsqcf.add_region_requirement(
-            RegionRequirement(lppprv, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrp));
-    launchsqcf.add_field(2, FID_PU0);
-    launchsqcf.add_region_requirement(
-            RegionRequirement(lppshr, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrp));
-    launchsqcf.add_field(3, FID_PU0);
-    launchsqcf.add_region_requirement(
-            RegionRequirement(lps, 0, LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, lrs));
-    launchsqcf.add_field(4, FID_CRMU);
-    launchsqcf.add_field(4, FID_CQE1);
-    launchsqcf.add_field(4, FID_CQE2);
-    launchsqcf.tag |= PennantMapper::CRITICAL | 
-      PennantMapper::PREFER_OMP | PennantMapper::PREFER_GPU;
-    runtime->execute_index_space(ctx, launchsqcf);
-
-    IndexTaskLauncher launchsfq(TID_SETFORCEQCS, ispc, ta, am, p_not_done);
-    launchsfq.add_region_requirement(
-            RegionRequirement(lps, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrs));
-    launchsfq.add_field(0, FID_MAPSS4);
-    launchsfq.add_field(0, FID_CAREA);
-    launchsfq.add_field(0, FID_CQE1);
-    launchsfq.add_field(0, FID_CQE2);
-    launchsfq.add_field(0, FID_ELEN);
-    launchsfq.add_region_requirement(
-            RegionRequirement(lps, 0, LEGION_READ_WRITE, LEGION_EXCLUSIVE, lrs));
-    launchsfq.add_field(1, FID_CCOS);
-    launchsfq.add_region_requirement(
-            RegionRequirement(lps, 0, LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, lrs));
-    launchsfq.add_field(2, FID_CW);
-    launchsfq.add_field(2, FID_SFQ);
-    launchsfq.tag |= PennantMapper::CRITICAL | 
-      PennantMapper::PREFER_OMP | PennantMapper::PREFER_GPU;
-    runtime->execute_index_space(ctx, launchsfq);
-
-    double svdargs[] = { qcs->q1, qcs->q2 };
-    IndexTaskLauncher launchsvd(TID_SETVELDIFF, ispc,
-            TaskArgument(svdargs, sizeof(svdargs)), am, p_not_done);
-    launchsvd.add_region_requirement(
-            RegionRequirement(lps, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrs));
-    launchsvd.add_field(0, FID_MAPSZ);
-    launchsvd.add_field(0, FID_MAPSP1);
-    launchsvd.add_field(0, FID_MAPSP2);
-    launchsvd.add_field(0, FID_MAPSP1REG);
-    launchsvd.add_field(0, FID_MAPSP2REG);
-    launchsvd.add_field(0, FID_ELEN);
-    launchsvd.add_region_requirement(
-            RegionRequirement(lpz, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrz));
-    launchsvd.add_field(1, FID_ZSS);
-    launchsvd.add_region_requirement(
-            RegionRequirement(lppprv, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrp));
-    launchsvd.add_field(2, FID_PXP);
-    launchsvd.add_field(2, FID_PU0);
-    launchsvd.add_region_requirement(
-            RegionRequirement(lppshr, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrp));
-    launchsvd.add_field(3, FID_PXP);
-    launchsvd.add_field(3, FID_PU0);
-    launchsvd.add_region_requirement(
-            RegionRequirement(lpz, 0, LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, lrz));
-    launchsvd.add_field(4, FID_ZTMP);
-    launchsvd.add_field(4, FID_ZDU);
-    launchsvd.tag |= PennantMapper::CRITICAL | 
-      PennantMapper::PREFER_OMP | PennantMapper::PREFER_GPU;
-    runtime->execute_index_space(ctx, launchsvd);
+    if (usetts) {
+        double cftargs[] = { tts->alfa, tts->ssmin };
+        IndexTaskLauncher launchcft(TID_CALCFORCETTS, ispa,
+                TaskArgument(cftargs, sizeof(cftargs)), am, p_not_done);
+        launchcft.add_region_requirement(
+                RegionRequirement(lps, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrs));
+        launchcft.add_field(0, FID_MAPSZ);
+        launchcft.add_field(0, FID_SMF);
+#ifndef RECOMPUTE_EDGE_GEOMETRY
+        launchcft.add_field(0, FID_SAREAP);
+        launchcft.add_field(0, FID_SSURFP);
+#endif
+        launchcft.add_region_requirement(
+                RegionRequirement(lpz, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrz));
+        launchcft.add_field(1, FID_ZAREAP);
+        launchcft.add_field(1, FID_ZRP);
+        launchcft.add_field(1, FID_ZSS);
+        launchcft.add_region_requirement(
+                RegionRequirement(lps, 0, LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, lrs));
+        launchcft.add_field(2, FID_SFT);
+#ifdef RECOMPUTE_EDGE_GEOMETRY
+        // what SideGeometry recomputes the side quantities from
+        launchcft.add_field(0, FID_MAPSP1);
+        launchcft.add_field(0, FID_MAPSP2);
+        launchcft.add_field(0, FID_MAPSP1REG);
+        launchcft.add_field(0, FID_MAPSP2REG);
+        launchcft.add_field(1, FID_ZXP);
+        launchcft.add_region_requirement(
+                RegionRequirement(lppprv, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrp));
+        launchcft.add_field(3, FID_PXP);
+        launchcft.add_region_requirement(
+                RegionRequirement(lppshr, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrp));
+        launchcft.add_field(4, FID_PXP);
+#endif
+        launchcft.tag |= PennantMapper::CRITICAL | 
+          PennantMapper::PREFER_OMP | PennantMapper::PREFER_GPU | tunetag;
+        runtime->execute_index_space(ctx, launchcft);
+    }  // if usetts
+
+    if (useqcs) {
+#ifdef FUSED_QCS
+        // All of QCS in one pass over the zones; the corner quantities
+        // never leave the task, so only SFQ and ZDU are written
+        double cfqargs[] = { qcs->qgamma, qcs->q1, qcs->q2 };
+        IndexTaskLauncher launchcfq(TID_CALCFORCEQCS, ispa,
+                TaskArgument(cfqargs, sizeof(cfqargs)), am, p_not_done);
+        launchcfq.add_region_requirement(
+                RegionRequirement(lps, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrs));
+        launchcfq.add_field(0, FID_MAPSP1);
+        launchcfq.add_field(0, FID_MAPSS3);
+        launchcfq.add_field(0, FID_MAPSS4);
+        launchcfq.add_field(0, FID_MAPSP1REG);
+#ifndef RECOMPUTE_EDGE_GEOMETRY
+        launchcfq.add_field(0, FID_EXP);
+        launchcfq.add_field(0, FID_ELEN);
+#endif
+        launchcfq.add_region_requirement(
+                RegionRequirement(lpz, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrz));
+        launchcfq.add_field(1, FID_ZNUMP);
+        launchcfq.add_field(1, FID_MAPZS1);
+        launchcfq.add_field(1, FID_ZXP);
+        launchcfq.add_field(1, FID_ZRP);
+        launchcfq.add_field(1, FID_ZSS);
+        launchcfq.add_region_requirement(
+                RegionRequirement(lppprv, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrp));
+        launchcfq.add_field(2, FID_PXP);
+        launchcfq.add_field(2, FID_PU0);
+        launchcfq.add_region_requirement(
+                RegionRequirement(lppshr, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrp));
+        launchcfq.add_field(3, FID_PXP);
+        launchcfq.add_field(3, FID_PU0);
+        launchcfq.add_region_requirement(
+                RegionRequirement(lps, 0, LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, lrs));
+        launchcfq.add_field(4, FID_SFQ);
+        launchcfq.add_region_requirement(
+                RegionRequirement(lpz, 0, LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, lrz));
+        launchcfq.add_field(5, FID_ZDU);
+#ifdef CACHE_INVARIANTS
+        launchcfq.add_region_requirement(
+                RegionRequirement(lpzc, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrzc));
+        launchcfq.add_field(6, FID_ZNUMPINV);
+#endif
+        launchcfq.tag |= PennantMapper::CRITICAL | 
+          PennantMapper::PREFER_OMP | PennantMapper::PREFER_GPU | tunetag;
+        runtime->execute_index_space(ctx, launchcfq);
+#else
+        IndexTaskLauncher launchscd(TID_SETCORNERDIV, ispa, ta, am, p_not_done);
+        launchscd.add_region_requirement(
+                RegionRequirement(lps, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrs));
+        launchscd.add_field(0, FID_MAPSZ);
+        launchscd.add_field(0, FID_MAPSP1);
+        launchscd.add_field(0, FID_MAPSP2);
+        launchscd.add_field(0, FID_MAPSS3);
+        launchscd.add_field(0, FID_MAPSP1REG);
+        launchscd.add_field(0, FID_MAPSP2REG);
+        launchscd.add_field(0, FID_EXP);
+        launchscd.add_field(0, FID_ELEN);
+        launchscd.add_region_requirement(
+                RegionRequirement(lpz, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrz));
+        launchscd.add_field(1, FID_ZNUMP);
+        launchscd.add_field(1, FID_MAPZS1);
+        launchscd.add_field(1, FID_ZXP);
+        launchscd.add_region_requirement(
+                RegionRequirement(lppprv, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrp));
+        launchscd.add_field(2, FID_PXP);
+        launchscd.add_field(2, FID_PU0);
+        launchscd.add_region_requirement(
+                RegionRequirement(lppshr, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrp));
+        launchscd.add_field(3, FID_PXP);
+        launchscd.add_field(3, FID_PU0);
+        launchscd.add_region_requirement(
+                RegionRequirement(lpz, 0, LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, lrz));
+        launchscd.add_field(4, FID_ZUC);
+        launchscd.add_region_requirement(
+                RegionRequirement(lps, 0, LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, lrs));
+        launchscd.add_field(5, FID_CAREA);
+        launchscd.add_field(5, FID_CCOS);
+        launchscd.add_field(5, FID_CDIV);
+        launchscd.add_field(5, FID_CEVOL);
+        launchscd.add_field(5, FID_CDU);
+#ifdef CACHE_INVARIANTS
+        launchscd.add_region_requirement(
+                RegionRequirement(lpzc, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrzc));
+        launchscd.add_field(6, FID_ZNUMPINV);
+#endif
+        launchscd.tag |= PennantMapper::CRITICAL | 
+          PennantMapper::PREFER_OMP | PennantMapper::PREFER_GPU | tunetag;
+        runtime->execute_index_space(ctx, launchscd);
+
+        double sqcfargs[] = { qcs->qgamma, qcs->q1, qcs->q2 };
+        IndexTaskLauncher launchsqcf(TID_SETQCNFORCE, ispa,
+                TaskArgument(sqcfargs, sizeof(sqcfargs)), am, p_not_done);
+        launchsqcf.add_region_requirement(
+                RegionRequirement(lps, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrs));
+        launchsqcf.add_field(0, FID_MAPSZ);
+        launchsqcf.add_field(0, FID_MAPSP1);
+        launchsqcf.add_field(0, FID_MAPSP2);
+        launchsqcf.add_field(0, FID_MAPSS3);
+        launchsqcf.add_field(0, FID_MAPSP1REG);
+        launchsqcf.add_field(0, FID_MAPSP2REG);
+        launchsqcf.add_field(0, FID_ELEN);
+        launchsqcf.add_field(0, FID_CDIV);
+        launchsqcf.add_field(0, FID_CDU);
+        launchsqcf.add_field(0, FID_CEVOL);
+        launchsqcf.add_region_requirement(
+                RegionRequirement(lpz, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrz));
+        launchsqcf.add_field(1, FID_ZRP);
+        launchsqcf.add_field(1, FID_ZSS);
+        launchsqcf.add_region_requirement(
+                RegionRequirement(lppprv, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrp));
+        launchsqcf.add_field(2, FID_PU0);
+        launchsqcf.add_region_requirement(
+                RegionRequirement(lppshr, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrp));
+        launchsqcf.add_field(3, FID_PU0);
+        launchsqcf.add_region_requirement(
+                RegionRequirement(lps, 0, LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, lrs));
+        launchsqcf.add_field(4, FID_CRMU);
+        launchsqcf.add_field(4, FID_CQE1);
+        launchsqcf.add_field(4, FID_CQE2);
+        launchsqcf.tag |= PennantMapper::CRITICAL | 
+          PennantMapper::PREFER_OMP | PennantMapper::PREFER_GPU | tunetag;
+        runtime->execute_index_space(ctx, launchsqcf);
+
+        IndexTaskLauncher launchsfq(TID_SETFORCEQCS, ispa, ta, am, p_not_done);
+        launchsfq.add_region_requirement(
+                RegionRequirement(lps, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrs));
+        launchsfq.add_field(0, FID_MAPSS4);
+        launchsfq.add_field(0, FID_CAREA);
+        launchsfq.add_field(0, FID_CQE1);
+        launchsfq.add_field(0, FID_CQE2);
+        launchsfq.add_field(0, FID_ELEN);
+        launchsfq.add_region_requirement(
+                RegionRequirement(lps, 0, LEGION_READ_WRITE, LEGION_EXCLUSIVE, lrs));
+        launchsfq.add_field(1, FID_CCOS);
+        launchsfq.add_region_requirement(
+                RegionRequirement(lps, 0, LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, lrs));
+        launchsfq.add_field(2, FID_CW);
+        launchsfq.add_field(2, FID_SFQ);
+        launchsfq.tag |= PennantMapper::CRITICAL | 
+          PennantMapper::PREFER_OMP | PennantMapper::PREFER_GPU | tunetag;
+        runtime->execute_index_space(ctx, launchsfq);
+
+        double svdargs[] = { qcs->q1, qcs->q2 };
+        IndexTaskLauncher launchsvd(TID_SETVELDIFF, ispa,
+                TaskArgument(svdargs, sizeof(svdargs)), am, p_not_done);
+        launchsvd.add_region_requirement(
+                RegionRequirement(lps, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrs));
+        launchsvd.add_field(0, FID_MAPSP1);
+        launchsvd.add_field(0, FID_MAPSP2);
+        launchsvd.add_field(0, FID_MAPSP1REG);
+        launchsvd.add_field(0, FID_MAPSP2REG);
+        launchsvd.add_field(0, FID_ELEN);
+        launchsvd.add_region_requirement(
+                RegionRequirement(lpz, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrz));
+        launchsvd.add_field(1, FID_ZSS);
+        launchsvd.add_field(1, FID_ZNUMP);
+        launchsvd.add_field(1, FID_MAPZS1);
+        launchsvd.add_region_requirement(
+                RegionRequirement(lppprv, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrp));
+        launchsvd.add_field(2, FID_PXP);
+        launchsvd.add_field(2, FID_PU0);
+        launchsvd.add_region_requirement(
+                RegionRequirement(lppshr, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrp));
+        launchsvd.add_field(3, FID_PXP);
+        launchsvd.add_field(3, FID_PU0);
+        launchsvd.add_region_requirement(
+                RegionRequirement(lpz, 0, LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, lrz));
+        launchsvd.add_field(4, FID_ZDU);
+        launchsvd.tag |= PennantMapper::CRITICAL | 
+          PennantMapper::PREFER_OMP | PennantMapper::PREFER_GPU | tunetag;
+        runtime->execute_index_space(ctx, launchsvd);
+#endif
+    }  // if useqcs
+
+#ifdef PULL_GHOST_POINTS
+    launchffd2.partition = lpgh;
+    launchffd2.parent = lrgh;
+    launchffd2.fields.clear();
+    launchffd2.add_field(FID_GHOSTF);
+    runtime->fill_fields(ctx, launchffd2);
+#endif
 
     IndexTaskLauncher launchscf(TID_SUMCRNRFORCE, ispc, ta, am, p_not_done);
     launchscf.add_region_requirement(
             RegionRequirement(lps, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrs));
     launchscf.add_field(0, FID_MAPSP1);
     launchscf.add_field(0, FID_MAPSP1REG);
+#ifdef PULL_GHOST_POINTS
+    launchscf.add_field(0, FID_MAPSP1GHOST);
+#else
+    launchscf.add_field(0, FID_MAPSP1NODE);
+#endif
     launchscf.add_field(0, FID_MAPSS3);
     launchscf.add_field(0, FID_SFP);
-    launchscf.add_field(0, FID_SFQ);
-    launchscf.add_field(0, FID_SFT);
+    if (useqcs)
+        launchscf.add_field(0, FID_SFQ);
+    if (usetts)
+        launchscf.add_field(0, FID_SFT);
+#ifdef COLOR_SIDE_SCATTERS
+    launchscf.add_field(0, FID_COLORSIDE);
+    launchscf.add_field(0, FID_SIDECOLOR);
+#endif
     launchscf.add_region_requirement(
             RegionRequirement(lppprv, 0, LEGION_READ_WRITE, LEGION_EXCLUSIVE, lrp));
     launchscf.add_field(1, FID_PF);
+#ifdef PULL_GHOST_POINTS
+    launchscf.add_region_requirement(
+            RegionRequirement(lppmstr, 0, LEGION_READ_WRITE, LEGION_EXCLUSIVE, lrp));
+    launchscf.add_field(2, FID_PF);
+    launchscf.add_region_requirement(
+            RegionRequirement(lpgh, 0, LEGION_READ_WRITE, LEGION_EXCLUSIVE, lrgh));
+    launchscf.add_field(3, FID_GHOSTF);
+#else
     launchscf.add_region_requirement(
-            RegionRequirement(lppshr, 0, OPID_SUMDBL2,
+            RegionRequirement(lppxshr, 0, OPID_SUMDBL2,
                     LEGION_SIMULTANEOUS, lrp));
     launchscf.add_field(2, FID_PF);
-    launchscf.tag |= PennantMapper::PREFER_OMP | PennantMapper::PREFER_GPU;
+    launchscf.add_region_requirement(
+            RegionRequirement(lppnshr, 0, OPID_SUMDBL2,
+                    LEGION_SIMULTANEOUS, lrp, PennantMapper::NODE_REDUCE));
+    launchscf.add_field(3, FID_PF);
+#endif
+    launchscf.tag |= PennantMapper::PREFER_OMP | PennantMapper::PREFER_GPU | tunetag;
     runtime->execute_index_space(ctx, launchscf);
 
-    // 4a. apply boundary conditions
-    IndexTaskLauncher launchafbc(TID_APPLYFIXEDBC, ispc, ta, am, p_not_done);
-    for (int i = 0; i < bcs.size(); ++i) {
-        double2 afbcargs[1] = { bcs[i]->vfix };
-        launchafbc.global_arg =
-                TaskArgument(afbcargs, sizeof(afbcargs));
-        launchafbc.region_requirements.clear();
-        launchafbc.add_region_requirement(
-                RegionRequirement(bcs[i]->lpb, 0,
-                        LEGION_READ_ONLY, LEGION_EXCLUSIVE, bcs[i]->lrb));
-        launchafbc.add_field(0, FID_MAPBP);
-        launchafbc.add_field(0, FID_MAPBPREG);
-        launchafbc.add_region_requirement(
-                RegionRequirement(lppprv, 0,
-                        LEGION_READ_WRITE, LEGION_EXCLUSIVE, lrp));
-        launchafbc.add_field(1, FID_PF);
-        launchafbc.add_field(1, FID_PU0);
-        launchafbc.add_region_requirement(
-                RegionRequirement(lppmstr, 0,
-                        LEGION_READ_WRITE, LEGION_EXCLUSIVE, lrp, PennantMapper::PREFER_ZCOPY));
-        launchafbc.add_field(2, FID_PF);
-        launchafbc.add_field(2, FID_PU0);
-        launchafbc.tag |= PennantMapper::CRITICAL | 
-          PennantMapper::PREFER_OMP | PennantMapper::PREFER_GPU;
-        runtime->execute_index_space(ctx, launchafbc);
-    }
+#ifdef PULL_GHOST_POINTS
+    IndexTaskLauncher launchpcf(TID_PULLCRNRFORCE, ispc, ta, am, p_not_done);
+    launchpcf.add_region_requirement(
+            RegionRequirement(lpghown, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrgh));
+    launchpcf.add_field(0, FID_GHOSTP);
+    launchpcf.add_field(0, FID_GHOSTF);
+    launchpcf.add_region_requirement(
+            RegionRequirement(lppmstr, 0, LEGION_READ_WRITE, LEGION_EXCLUSIVE, lrp));
+    launchpcf.add_field(1, FID_PF);
+    runtime->execute_index_space(ctx, launchpcf);
+#endif
 
     // check for negative volumes on predictor step
     mesh->checkBadSides(cycle, f_cv, p_not_done);
 
-    IndexTaskLauncher launchca(TID_CALCACCEL, ispc, ta, am, p_not_done);
-    IndexTaskLauncher launchapf(TID_ADVPOSFULL, ispc, ta, am, p_not_done);
+    IndexTaskLauncher launchca(TID_CALCACCEL, ispa, ta, am, p_not_done);
+    IndexTaskLauncher launchapf(TID_ADVPOSFULL, ispa, ta, am, p_not_done);
     launchapf.add_future(f_dt);
-    launchapf.tag |= PennantMapper::PREFER_OMP | PennantMapper::PREFER_GPU;
+    launchapf.tag |= PennantMapper::PREFER_OMP | PennantMapper::PREFER_GPU | tunetag;
     // do point routines twice, once each for private and master
     // partitions
     for (int part = 0; part < 2; ++part) {
         LogicalPartition& lppcurr = (part == 0 ? lppprv : lppmstr);
 
+        // 4a. apply boundary conditions
         // 5. compute accelerations
+        // calcAccel fixes the accelerations and PU0 of the boundary
+        // points in this part as it goes, instead of a launch per
+        // plane going back over PF and PU0 first
+        launchca.global_arg = TaskArgument(&part, sizeof(part));
         launchca.region_requirements.clear();
         launchca.add_region_requirement(
                 RegionRequirement(lppcurr, 0,
@@ -821,10 +1139,23 @@ Future Hydro::doCycle(
                 RegionRequirement(lppcurr, 0,
                         LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, lrp));
         launchca.add_field(1, FID_PAP);
+        if (bc != NULL) {
+            launchca.add_region_requirement(
+                    RegionRequirement(bc->lpb, 0,
+                            LEGION_READ_ONLY, LEGION_EXCLUSIVE, bc->lrb));
+            launchca.add_field(2, FID_MAPBP);
+            launchca.add_field(2, FID_MAPBPREG);
+            launchca.add_field(2, FID_MAPBPMASK);
+            launchca.add_region_requirement(
+                    RegionRequirement(lppcurr, 0,
+                            LEGION_READ_WRITE, LEGION_EXCLUSIVE, lrp,
+                            (part == 0) ? 0 : PennantMapper::PREFER_ZCOPY));
+            launchca.add_field(3, FID_PU0);
+        }
         // Only really need OpenMP for the private part
         // But the shared part is the one on the critical path
         if (part == 0)
-          launchca.tag |= PennantMapper::PREFER_OMP | PennantMapper::PREFER_GPU;
+          launchca.tag |= PennantMapper::PREFER_OMP | PennantMapper::PREFER_GPU | tunetag;
         else
         {
           launchca.tag &= ~(PennantMapper::PREFER_OMP);
@@ -848,7 +1179,7 @@ Future Hydro::doCycle(
         launchapf.add_field(1, FID_PU);
         // Only really need OpenMP for the private part
         if (part == 0)
-          launchca.tag |= PennantMapper::PREFER_OMP | PennantMapper::PREFER_GPU;
+          launchca.tag |= PennantMapper::PREFER_OMP | PennantMapper::PREFER_GPU | tunetag;
         else
         {
           launchca.tag &= ~(PennantMapper::PREFER_OMP);
@@ -859,14 +1190,19 @@ Future Hydro::doCycle(
 
     // 6a. compute new mesh geometry
     // reuse launchers from earlier, with corrector-step fields
-    for (int r = 2; r < 6; ++r) {
+    for (int r = 2; r < launchcc.region_requirements.size(); ++r) {
         launchcc.region_requirements[r].privilege_fields.clear();
         launchcc.region_requirements[r].instance_fields.clear();
     }
     launchcc.add_field(2, FID_PX);
     launchcc.add_field(3, FID_PX);
-    launchcc.add_field(4, FID_EX);
-    launchcc.add_field(5, FID_ZX);
+    launchcc.add_field(4, FID_ZX);
+#ifndef RECOMPUTE_EDGE_GEOMETRY
+    launchcc.add_field(5, FID_EX);
+#endif
+#ifdef CACHE_INVARIANTS
+    launchcc.add_field(launchcc.region_requirements.size() - 1, FID_ZNUMPINV);
+#endif
     runtime->execute_index_space(ctx, launchcc);
 
     for (int r = 1; r < 6; ++r) {
@@ -883,7 +1219,7 @@ Future Hydro::doCycle(
     f_cv = runtime->execute_index_space(ctx, launchcv, OPID_SUMINT);
 
     // 7. compute work
-    IndexTaskLauncher launchcw(TID_CALCWORK, ispc, ta, am, p_not_done);
+    IndexTaskLauncher launchcw(TID_CALCWORK, ispa, ta, am, p_not_done);
     launchcw.add_future(f_dt);
     launchcw.add_region_requirement(
             RegionRequirement(lps, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrs));
@@ -893,7 +1229,8 @@ Future Hydro::doCycle(
     launchcw.add_field(0, FID_MAPSP1REG);
     launchcw.add_field(0, FID_MAPSP2REG);
     launchcw.add_field(0, FID_SFP);
-    launchcw.add_field(0, FID_SFQ);
+    if (useqcs)
+        launchcw.add_field(0, FID_SFQ);
     launchcw.add_region_requirement(
             RegionRequirement(lppprv, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrp));
     launchcw.add_field(1, FID_PU);
@@ -910,10 +1247,14 @@ Future Hydro::doCycle(
     launchcw.add_region_requirement(
             RegionRequirement(lpz, 0, LEGION_READ_WRITE, LEGION_EXCLUSIVE, lrz));
     launchcw.add_field(4, FID_ZETOT);
-    launchcw.tag |= PennantMapper::PREFER_OMP | PennantMapper::PREFER_GPU;
+    launchcw.add_region_requirement(
+            RegionRequirement(lpz, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrz));
+    launchcw.add_field(5, FID_ZNUMP);
+    launchcw.add_field(5, FID_MAPZS1);
+    launchcw.tag |= PennantMapper::PREFER_OMP | PennantMapper::PREFER_GPU | tunetag;
     runtime->execute_index_space(ctx, launchcw);
 
-    IndexTaskLauncher launchcwr(TID_CALCWORKRATE, ispc, ta, am, p_not_done);
+    IndexTaskLauncher launchcwr(TID_CALCWORKRATE, ispa, ta, am, p_not_done);
     launchcwr.add_future(f_dt);
     launchcwr.add_region_requirement(
             RegionRequirement(lpz, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrz));
@@ -924,19 +1265,26 @@ Future Hydro::doCycle(
     launchcwr.add_region_requirement(
             RegionRequirement(lpz, 0, LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, lrz));
     launchcwr.add_field(1, FID_ZWRATE);
-    launchcwr.tag |= PennantMapper::PREFER_OMP | PennantMapper::PREFER_GPU;
+    launchcwr.tag |= PennantMapper::PREFER_OMP | PennantMapper::PREFER_GPU | tunetag;
     runtime->execute_index_space(ctx, launchcwr);
 
     // 8. update state variables
-    IndexTaskLauncher launchce(TID_CALCENERGY, ispc, ta, am, p_not_done);
+    IndexTaskLauncher launchce(TID_CALCENERGY, ispa, ta, am, p_not_done);
     launchce.add_region_requirement(
             RegionRequirement(lpz, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrz));
     launchce.add_field(0, FID_ZETOT);
+#ifndef CACHE_INVARIANTS
     launchce.add_field(0, FID_ZM);
+#endif
     launchce.add_region_requirement(
             RegionRequirement(lpz, 0, LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, lrz));
     launchce.add_field(1, FID_ZE);
-    launchce.tag |= PennantMapper::PREFER_OMP | PennantMapper::PREFER_GPU;
+#ifdef CACHE_INVARIANTS
+    launchce.add_region_requirement(
+            RegionRequirement(lpzc, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrzc));
+    launchce.add_field(2, FID_ZMINV);
+#endif
+    launchce.tag |= PennantMapper::PREFER_OMP | PennantMapper::PREFER_GPU | tunetag;
     runtime->execute_index_space(ctx, launchce);
 
     // reuse launcher from earlier, with corrector-step fields
@@ -950,23 +1298,25 @@ Future Hydro::doCycle(
     runtime->execute_index_space(ctx, launchcr);
 
     // 9.  compute timestep for next cycle
-    IndexTaskLauncher launchdtnew(TID_CALCDTNEW, ispc, 
+    IndexTaskLauncher launchdtnew(TID_CALCDTNEW, ispa, 
         TaskArgument(&cfl, sizeof(cfl)), am, p_not_done);
     launchdtnew.add_region_requirement(
         RegionRequirement(lpz, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrz));
     launchdtnew.add_field(0, FID_ZDL);
     launchdtnew.add_field(0, FID_ZDU);
     launchdtnew.add_field(0, FID_ZSS);
-    launchdtnew.tag |= PennantMapper::PREFER_OMP | PennantMapper::PREFER_GPU;
+    launchdtnew.tag |= PennantMapper::PREFER_OMP | PennantMapper::PREFER_GPU | tunetag;
     Future f_dtnew = runtime->execute_index_space(ctx, launchdtnew, OPID_MINDBL);
 
-    IndexTaskLauncher launchdvol(TID_CALCDVOL, ispc, ta, am, p_not_done);
+    // the zones of pieces at rest kept their volumes, so they
+    // don't change dvol
+    IndexTaskLauncher launchdvol(TID_CALCDVOL, ispa, ta, am, p_not_done);
     launchdvol.add_region_requirement(
         RegionRequirement(lpz, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrz));
     launchdvol.add_field(0, FID_ZVOL);
     launchdvol.add_field(0, FID_ZVOL0);
     launchdvol.tag |= PennantMapper::CRITICAL | 
-      PennantMapper::PREFER_OMP | PennantMapper::PREFER_GPU;
+      PennantMapper::PREFER_OMP | PennantMapper::PREFER_GPU | tunetag;
     Future f_dvol = runtime->execute_index_space(ctx, launchdvol, OPID_MAXDBL);
 
     // Single task launch to compute the future result
@@ -974,6 +1324,7 @@ Future Hydro::doCycle(
     launchcdt.add_future(f_dt);
     launchcdt.add_future(f_dtnew);
     launchcdt.add_future(f_dvol);
+    launchcdt.add_future(f_dtrest);
     Future f_cdt = runtime->execute_task(ctx, launchcdt);
 
     // check for negative volumes on corrector step
@@ -1087,13 +1438,26 @@ void Hydro::calcCrnrMassTask(
         Runtime *runtime) {
     const AccessorRO<Pointer> acc_mapsp1(regions[0], FID_MAPSP1);
     const AccessorRO<int> acc_mapsp1reg(regions[0], FID_MAPSP1REG);
+#ifdef PULL_GHOST_POINTS
+    const AccessorRO<Pointer> acc_mapsp1ghost(regions[0], FID_MAPSP1GHOST);
+#else
+    const AccessorRO<int> acc_mapsp1node(regions[0], FID_MAPSP1NODE);
+#endif
     const AccessorRO<Pointer> acc_mapss3(regions[0], FID_MAPSS3);
     const AccessorRO<Pointer> acc_mapsz(regions[0], FID_MAPSZ);
     const AccessorRO<double> acc_smf(regions[0], FID_SMF);
     const AccessorRO<double> acc_zr(regions[1], FID_ZRP);
     const AccessorRO<double> acc_zarea(regions[1], FID_ZAREAP);
     const AccessorRW<double> acc_pmas_prv(regions[2], FID_PMASWT);
+#ifdef PULL_GHOST_POINTS
+    const AccessorRW<double> acc_pmas_mstr(regions[3], FID_PMASWT);
+    const AccessorRW<double> acc_pmas_ghost(regions[4], FID_GHOSTMASWT);
+#else
     const AccessorRD<SumOp<double> > acc_pmas_shr(regions[3], FID_PMASWT, OPID_SUMDBL);
+    // other pieces on this node are summing into the same instance
+    const AccessorRD<SumOp<double>,false/*exclusive*/> 
+      acc_pmas_nshr(regions[4], FID_PMASWT, OPID_SUMDBL);
+#endif
 
     const IndexSpace& iss = task->regions[0].region.get_index_space();
 
@@ -1109,12 +1473,48 @@ void Hydro::calcCrnrMassTask(
         const double mf = acc_smf[s];
         const double mf3 = acc_smf[s3];
         const double mwt = r * area * 0.5 * (mf + mf3);
+#ifdef PULL_GHOST_POINTS
+        const Pointer g = acc_mapsp1ghost[s];
+        if (preg == 0)
+            SumOp<double>::apply<true/*exclusive*/>(acc_pmas_prv[p], mwt);
+        else if (g[0] < 0)
+            SumOp<double>::apply<true/*exclusive*/>(acc_pmas_mstr[p], mwt);
+        else
+            SumOp<double>::apply<true/*exclusive*/>(acc_pmas_ghost[g], mwt);
+#else
         if (preg == 0)
             SumOp<double>::apply<true/*exclusive*/>(acc_pmas_prv[p], mwt);
+        else if (acc_mapsp1node[s])
+            acc_pmas_nshr[p] <<= mwt;
         else
             acc_pmas_shr[p] <<= mwt;
+#endif
+    }
+}
+
+
+#ifdef COLOR_SIDE_SCATTERS
+// Find where each color starts in a piece's slots of FID_COLORSIDE,
+// the colors are in order so each one is a binary search
+static void findColorStarts(
+        const AccessorRO<int>& acc_sidecolor,
+        const Rect<1>& rects,
+        coord_t colorstart[NUMSIDECOLORS + 1]) {
+    for (int c = 0; c <= NUMSIDECOLORS; c++)
+    {
+      coord_t lo = rects.lo[0], hi = rects.hi[0] + 1;
+      while (lo < hi)
+      {
+        const coord_t mid = lo + (hi - lo) / 2;
+        if (acc_sidecolor[mid] < c)
+          lo = mid + 1;
+        else
+          hi = mid;
+      }
+      colorstart[c] = lo;
     }
 }
+#endif
 
 
 void Hydro::calcCrnrMassOMPTask(
@@ -1122,23 +1522,57 @@ void Hydro::calcCrnrMassOMPTask(
         const std::vector<PhysicalRegion> &regions,
         Context ctx,
         Runtime *runtime) {
+#ifdef COLOR_SIDE_SCATTERS
+    // sides of the same color never sum into the same point, but the
+    // reduction instances can be shared with other pieces on the node
+    const bool exclusive = true;
+    const AccessorRO<Pointer> acc_colorside(regions[0], FID_COLORSIDE);
+    const AccessorRO<int> acc_sidecolor(regions[0], FID_SIDECOLOR);
+#else
+    const bool exclusive = false;
+#endif
     const AccessorRO<Pointer> acc_mapsp1(regions[0], FID_MAPSP1);
     const AccessorRO<int> acc_mapsp1reg(regions[0], FID_MAPSP1REG);
+#ifdef PULL_GHOST_POINTS
+    const AccessorRO<Pointer> acc_mapsp1ghost(regions[0], FID_MAPSP1GHOST);
+#else
+    const AccessorRO<int> acc_mapsp1node(regions[0], FID_MAPSP1NODE);
+#endif
     const AccessorRO<Pointer> acc_mapss3(regions[0], FID_MAPSS3);
     const AccessorRO<Pointer> acc_mapsz(regions[0], FID_MAPSZ);
     const AccessorRO<double> acc_smf(regions[0], FID_SMF);
     const AccessorRO<double> acc_zr(regions[1], FID_ZRP);
     const AccessorRO<double> acc_zarea(regions[1], FID_ZAREAP);
     const AccessorRW<double> acc_pmas_prv(regions[2], FID_PMASWT);
+#ifdef PULL_GHOST_POINTS
+    const AccessorRW<double> acc_pmas_mstr(regions[3], FID_PMASWT);
+    const AccessorRW<double> acc_pmas_ghost(regions[4], FID_GHOSTMASWT);
+#else
     const AccessorRD<SumOp<double>,false/*exclusive*/> 
       acc_pmas_shr(regions[3], FID_PMASWT, OPID_SUMDBL);
+    const AccessorRD<SumOp<double>,false/*exclusive*/> 
+      acc_pmas_nshr(regions[4], FID_PMASWT, OPID_SUMDBL);
+#endif
 
     const IndexSpace& iss = task->regions[0].region.get_index_space();
     // This will assert if it is not dense
     const Rect<1> rects = runtime->get_index_space_domain(iss);
-    #pragma omp parallel for
-    for (coord_t s = rects.lo[0]; s <= rects.hi[0]; s++)
+#ifdef COLOR_SIDE_SCATTERS
+    coord_t colorstart[NUMSIDECOLORS + 1];
+    findColorStarts(acc_sidecolor, rects, colorstart);
+    for (int color = 0; color < NUMSIDECOLORS; color++)
     {
+      // the last color can have sides on the same point
+      #pragma omp parallel for if(color < NUMSIDECOLORS - 1)
+      for (coord_t i = colorstart[color]; i < colorstart[color + 1]; i++)
+      {
+        const Pointer s = acc_colorside[i];
+#else
+    {
+      #pragma omp parallel for
+      for (coord_t s = rects.lo[0]; s <= rects.hi[0]; s++)
+      {
+#endif
         const Pointer s3 = acc_mapss3[s];
         const Pointer z  = acc_mapsz[s];
         const Pointer p = acc_mapsp1[s];
@@ -1148,10 +1582,23 @@ void Hydro::calcCrnrMassOMPTask(
         const double mf = acc_smf[s];
         const double mf3 = acc_smf[s3];
         const double mwt = r * area * 0.5 * (mf + mf3);
+#ifdef PULL_GHOST_POINTS
+        const Pointer g = acc_mapsp1ghost[s];
+        if (preg == 0)
+            SumOp<double>::apply<exclusive>(acc_pmas_prv[p], mwt);
+        else if (g[0] < 0)
+            SumOp<double>::apply<exclusive>(acc_pmas_mstr[p], mwt);
+        else
+            SumOp<double>::apply<exclusive>(acc_pmas_ghost[g], mwt);
+#else
         if (preg == 0)
-            SumOp<double>::apply<false/*exclusive*/>(acc_pmas_prv[p], mwt);
+            SumOp<double>::apply<exclusive>(acc_pmas_prv[p], mwt);
+        else if (acc_mapsp1node[s])
+            acc_pmas_nshr[p] <<= mwt;
         else
             acc_pmas_shr[p] <<= mwt;
+#endif
+      }
     }
 }
 
@@ -1163,12 +1610,32 @@ void Hydro::sumCrnrForceTask(
         Runtime *runtime) {
     const AccessorRO<Pointer> acc_mapsp1(regions[0], FID_MAPSP1);
     const AccessorRO<int> acc_mapsp1reg(regions[0], FID_MAPSP1REG);
+#ifdef PULL_GHOST_POINTS
+    const AccessorRO<Pointer> acc_mapsp1ghost(regions[0], FID_MAPSP1GHOST);
+#else
+    const AccessorRO<int> acc_mapsp1node(regions[0], FID_MAPSP1NODE);
+#endif
     const AccessorRO<Pointer> acc_mapss3(regions[0], FID_MAPSS3);
-    const AccessorRO<double2> acc_sfp(regions[0], FID_SFP);
-    const AccessorRO<double2> acc_sfq(regions[0], FID_SFQ);
-    const AccessorRO<double2> acc_sft(regions[0], FID_SFT);
+    const AccessorRO<TempReal2> acc_sfp(regions[0], FID_SFP);
+    // the force packages that are turned off leave their fields out
+    const std::set<FieldID>& fids_s = task->regions[0].privilege_fields;
+    const bool useqcs = (fids_s.count(FID_SFQ) > 0);
+    const bool usetts = (fids_s.count(FID_SFT) > 0);
+    AccessorRO<TempReal2> acc_sfq, acc_sft;
+    if (useqcs)
+        acc_sfq = AccessorRO<TempReal2>(regions[0], FID_SFQ);
+    if (usetts)
+        acc_sft = AccessorRO<TempReal2>(regions[0], FID_SFT);
     const AccessorRW<double2> acc_pf_prv(regions[1], FID_PF);
+#ifdef PULL_GHOST_POINTS
+    const AccessorRW<double2> acc_pf_mstr(regions[2], FID_PF);
+    const AccessorRW<double2> acc_pf_ghost(regions[3], FID_GHOSTF);
+#else
     const AccessorRD<SumOp<double2> > acc_pf_shr(regions[2], FID_PF, OPID_SUMDBL2);
+    // other pieces on this node are summing into the same instance
+    const AccessorRD<SumOp<double2>,false/*exclusive*/> 
+      acc_pf_nshr(regions[3], FID_PF, OPID_SUMDBL2);
+#endif
 
     const IndexSpace& iss = task->regions[0].region.get_index_space();
 
@@ -1178,17 +1645,33 @@ void Hydro::sumCrnrForceTask(
         const Pointer s3 = acc_mapss3[s];
         const Pointer p = acc_mapsp1[s];
         const int preg = acc_mapsp1reg[s];
-        const double2 sfp = acc_sfp[s];
-        const double2 sfq = acc_sfq[s];
-        const double2 sft = acc_sft[s];
-        const double2 sfp3 = acc_sfp[s3];
-        const double2 sfq3 = acc_sfq[s3];
-        const double2 sft3 = acc_sft[s3];
-        const double2 cf = (sfp + sfq + sft) - (sfp3 + sfq3 + sft3);
+        double2 sf = acc_sfp[s];
+        double2 sf3 = acc_sfp[s3];
+        if (useqcs) {
+            sf += acc_sfq[s];
+            sf3 += acc_sfq[s3];
+        }
+        if (usetts) {
+            sf += acc_sft[s];
+            sf3 += acc_sft[s3];
+        }
+        const double2 cf = sf - sf3;
+#ifdef PULL_GHOST_POINTS
+        const Pointer g = acc_mapsp1ghost[s];
         if (preg == 0)
             SumOp<double2>::apply<true/*exclusive*/>(acc_pf_prv[p], cf);
+        else if (g[0] < 0)
+            SumOp<double2>::apply<true/*exclusive*/>(acc_pf_mstr[p], cf);
+        else
+            SumOp<double2>::apply<true/*exclusive*/>(acc_pf_ghost[g], cf);
+#else
+        if (preg == 0)
+            SumOp<double2>::apply<true/*exclusive*/>(acc_pf_prv[p], cf);
+        else if (acc_mapsp1node[s])
+            acc_pf_nshr[p] <<= cf;
         else
             acc_pf_shr[p] <<= cf;
+#endif
     }
 }
 
@@ -1198,36 +1681,131 @@ void Hydro::sumCrnrForceOMPTask(
         const std::vector<PhysicalRegion> &regions,
         Context ctx,
         Runtime *runtime) {
+#ifdef COLOR_SIDE_SCATTERS
+    // sides of the same color never sum into the same point, but the
+    // reduction instances can be shared with other pieces on the node
+    const bool exclusive = true;
+    const AccessorRO<Pointer> acc_colorside(regions[0], FID_COLORSIDE);
+    const AccessorRO<int> acc_sidecolor(regions[0], FID_SIDECOLOR);
+#else
+    const bool exclusive = false;
+#endif
     const AccessorRO<Pointer> acc_mapsp1(regions[0], FID_MAPSP1);
     const AccessorRO<int> acc_mapsp1reg(regions[0], FID_MAPSP1REG);
+#ifdef PULL_GHOST_POINTS
+    const AccessorRO<Pointer> acc_mapsp1ghost(regions[0], FID_MAPSP1GHOST);
+#else
+    const AccessorRO<int> acc_mapsp1node(regions[0], FID_MAPSP1NODE);
+#endif
     const AccessorRO<Pointer> acc_mapss3(regions[0], FID_MAPSS3);
-    const AccessorRO<double2> acc_sfp(regions[0], FID_SFP);
-    const AccessorRO<double2> acc_sfq(regions[0], FID_SFQ);
-    const AccessorRO<double2> acc_sft(regions[0], FID_SFT);
+    const AccessorRO<TempReal2> acc_sfp(regions[0], FID_SFP);
+    // the force packages that are turned off leave their fields out
+    const std::set<FieldID>& fids_s = task->regions[0].privilege_fields;
+    const bool useqcs = (fids_s.count(FID_SFQ) > 0);
+    const bool usetts = (fids_s.count(FID_SFT) > 0);
+    AccessorRO<TempReal2> acc_sfq, acc_sft;
+    if (useqcs)
+        acc_sfq = AccessorRO<TempReal2>(regions[0], FID_SFQ);
+    if (usetts)
+        acc_sft = AccessorRO<TempReal2>(regions[0], FID_SFT);
     const AccessorRW<double2> acc_pf_prv(regions[1], FID_PF);
+#ifdef PULL_GHOST_POINTS
+    const AccessorRW<double2> acc_pf_mstr(regions[2], FID_PF);
+    const AccessorRW<double2> acc_pf_ghost(regions[3], FID_GHOSTF);
+#else
     const AccessorRD<SumOp<double2>,false/*exclusive*/> 
       acc_pf_shr(regions[2], FID_PF, OPID_SUMDBL2);
+    const AccessorRD<SumOp<double2>,false/*exclusive*/> 
+      acc_pf_nshr(regions[3], FID_PF, OPID_SUMDBL2);
+#endif
 
     const IndexSpace& iss = task->regions[0].region.get_index_space();
     // This will assert if it is not dense
     const Rect<1> rects = runtime->get_index_space_domain(iss);
-    #pragma omp parallel for
-    for (coord_t s = rects.lo[0]; s <= rects.hi[0]; s++)
+#ifdef COLOR_SIDE_SCATTERS
+    coord_t colorstart[NUMSIDECOLORS + 1];
+    findColorStarts(acc_sidecolor, rects, colorstart);
+    for (int color = 0; color < NUMSIDECOLORS; color++)
+    {
+      // the last color can have sides on the same point
+      #pragma omp parallel for if(color < NUMSIDECOLORS - 1)
+      for (coord_t i = colorstart[color]; i < colorstart[color + 1]; i++)
+      {
+        const Pointer s = acc_colorside[i];
+#else
     {
+      #pragma omp parallel for
+      for (coord_t s = rects.lo[0]; s <= rects.hi[0]; s++)
+      {
+#endif
         const Pointer s3 = acc_mapss3[s];
         const Pointer p = acc_mapsp1[s];
         const int preg = acc_mapsp1reg[s];
-        const double2 sfp = acc_sfp[s];
-        const double2 sfq = acc_sfq[s];
-        const double2 sft = acc_sft[s];
-        const double2 sfp3 = acc_sfp[s3];
-        const double2 sfq3 = acc_sfq[s3];
-        const double2 sft3 = acc_sft[s3];
-        const double2 cf = (sfp + sfq + sft) - (sfp3 + sfq3 + sft3);
+        double2 sf = acc_sfp[s];
+        double2 sf3 = acc_sfp[s3];
+        if (useqcs) {
+            sf += acc_sfq[s];
+            sf3 += acc_sfq[s3];
+        }
+        if (usetts) {
+            sf += acc_sft[s];
+            sf3 += acc_sft[s3];
+        }
+        const double2 cf = sf - sf3;
+#ifdef PULL_GHOST_POINTS
+        const Pointer g = acc_mapsp1ghost[s];
+        if (preg == 0)
+            SumOp<double2>::apply<exclusive>(acc_pf_prv[p], cf);
+        else if (g[0] < 0)
+            SumOp<double2>::apply<exclusive>(acc_pf_mstr[p], cf);
+        else
+            SumOp<double2>::apply<exclusive>(acc_pf_ghost[g], cf);
+#else
         if (preg == 0)
-            SumOp<double2>::apply<false/*exclusive*/>(acc_pf_prv[p], cf);
+            SumOp<double2>::apply<exclusive>(acc_pf_prv[p], cf);
+        else if (acc_mapsp1node[s])
+            acc_pf_nshr[p] <<= cf;
         else
             acc_pf_shr[p] <<= cf;
+#endif
+      }
+    }
+}
+
+
+void Hydro::pullCrnrMassTask(
+        const Task *task,
+        const std::vector<PhysicalRegion> &regions,
+        Context ctx,
+        Runtime *runtime) {
+    const AccessorRO<Pointer> acc_ghostp(regions[0], FID_GHOSTP);
+    const AccessorRO<double> acc_pmas_ghost(regions[0], FID_GHOSTMASWT);
+    const AccessorRW<double> acc_pmas_mstr(regions[1], FID_PMASWT);
+
+    // add the partials from every piece that touches our masters
+    const IndexSpace& isg = task->regions[0].region.get_index_space();
+    for (PointIterator itg(runtime, isg); itg(); itg++)
+    {
+        const Pointer p = acc_ghostp[*itg];
+        acc_pmas_mstr[p] += acc_pmas_ghost[*itg];
+    }
+}
+
+
+void Hydro::pullCrnrForceTask(
+        const Task *task,
+        const std::vector<PhysicalRegion> &regions,
+        Context ctx,
+        Runtime *runtime) {
+    const AccessorRO<Pointer> acc_ghostp(regions[0], FID_GHOSTP);
+    const AccessorRO<double2> acc_pf_ghost(regions[0], FID_GHOSTF);
+    const AccessorRW<double2> acc_pf_mstr(regions[1], FID_PF);
+
+    const IndexSpace& isg = task->regions[0].region.get_index_space();
+    for (PointIterator itg(runtime, isg); itg(); itg++)
+    {
+        const Pointer p = acc_ghostp[*itg];
+        acc_pf_mstr[p] += acc_pf_ghost[*itg];
     }
 }
 
@@ -1251,6 +1829,24 @@ void Hydro::calcAccelTask(
         const double2 a = f / max(m, fuzz);
         acc_pa[*itp] = a;
     }
+
+    // apply boundary conditions to the points of this part
+    if (regions.size() < 4) return;
+    const int part = *(const int*) task->args;
+    const AccessorRO<Pointer> acc_mapbp(regions[2], FID_MAPBP);
+    const AccessorRO<int> acc_mapbpreg(regions[2], FID_MAPBPREG);
+    const AccessorRO<int> acc_mapbpmask(regions[2], FID_MAPBPMASK);
+    const AccessorRW<double2> acc_pu(regions[3], FID_PU0);
+
+    const IndexSpace& isb = task->regions[2].region.get_index_space();
+    for (PointIterator itb(runtime, isb); itb(); itb++)
+    {
+        if (acc_mapbpreg[*itb] != part) continue;
+        const Pointer p = acc_mapbp[*itb];
+        const int mask = acc_mapbpmask[*itb];
+        acc_pa[p] = HydroBC::applyMask(acc_pa[p], mask);
+        acc_pu[p] = HydroBC::applyMask(acc_pu[p], mask);
+    }
 }
 
 
@@ -1275,6 +1871,28 @@ void Hydro::calcAccelOMPTask(
         const double2 a = f / max(m, fuzz);
         acc_pa[p] = a;
     }
+
+    // apply boundary conditions to the points of this part, each
+    // boundary point is in the list once so there are no races
+    if (regions.size() < 4) return;
+    const int part = *(const int*) task->args;
+    const AccessorRO<Pointer> acc_mapbp(regions[2], FID_MAPBP);
+    const AccessorRO<int> acc_mapbpreg(regions[2], FID_MAPBPREG);
+    const AccessorRO<int> acc_mapbpmask(regions[2], FID_MAPBPMASK);
+    const AccessorRW<double2> acc_pu(regions[3], FID_PU0);
+
+    const IndexSpace& isb = task->regions[2].region.get_index_space();
+    // This will assert if its not dense
+    const Rect<1> rectb = runtime->get_index_space_domain(isb);
+    #pragma omp parallel for
+    for (coord_t b = rectb.lo[0]; b <= rectb.hi[0]; b++)
+    {
+        if (acc_mapbpreg[b] != part) continue;
+        const Pointer p = acc_mapbp[b];
+        const int mask = acc_mapbpmask[b];
+        acc_pa[p] = HydroBC::applyMask(acc_pa[p], mask);
+        acc_pu[p] = HydroBC::applyMask(acc_pu[p], mask);
+    }
 }
 
 
@@ -1348,8 +1966,13 @@ void Hydro::calcWorkTask(
     const AccessorRO<Pointer> acc_mapsz(regions[0], FID_MAPSZ);
     const AccessorRO<int> acc_mapsp1reg(regions[0], FID_MAPSP1REG);
     const AccessorRO<int> acc_mapsp2reg(regions[0], FID_MAPSP2REG);
-    const AccessorRO<double2> acc_sf(regions[0], FID_SFP);
-    const AccessorRO<double2> acc_sf2(regions[0], FID_SFQ);
+    const AccessorRO<TempReal2> acc_sf(regions[0], FID_SFP);
+    // SFQ is left out when QCS is turned off
+    const bool useqcs =
+        (task->regions[0].privilege_fields.count(FID_SFQ) > 0);
+    AccessorRO<TempReal2> acc_sf2;
+    if (useqcs)
+        acc_sf2 = AccessorRO<TempReal2>(regions[0], FID_SFQ);
     const AccessorRO<double2> acc_pu0[2] = {
         AccessorRO<double2>(regions[1], FID_PU0),
         AccessorRO<double2>(regions[2], FID_PU0)
@@ -1388,8 +2011,7 @@ void Hydro::calcWorkTask(
         const int p2reg = acc_mapsp2reg[s];
         const Pointer z = acc_mapsz[s];
         const double2 sf = acc_sf[s];
-        const double2 sf2 = acc_sf2[s];
-        const double2 sftot = sf + sf2;
+        const double2 sftot = (useqcs ? sf + acc_sf2[s] : sf);
         const double2 pu01 = acc_pu0[p1reg][p1];
         const double2 pu1 = acc_pu[p1reg][p1];
         const double sd1 = dot(sftot, (pu01 + pu1));
@@ -1415,11 +2037,15 @@ void Hydro::calcWorkOMPTask(
 
     const AccessorRO<Pointer> acc_mapsp1(regions[0], FID_MAPSP1);
     const AccessorRO<Pointer> acc_mapsp2(regions[0], FID_MAPSP2);
-    const AccessorRO<Pointer> acc_mapsz(regions[0], FID_MAPSZ);
     const AccessorRO<int> acc_mapsp1reg(regions[0], FID_MAPSP1REG);
     const AccessorRO<int> acc_mapsp2reg(regions[0], FID_MAPSP2REG);
-    const AccessorRO<double2> acc_sf(regions[0], FID_SFP);
-    const AccessorRO<double2> acc_sf2(regions[0], FID_SFQ);
+    const AccessorRO<TempReal2> acc_sf(regions[0], FID_SFP);
+    // SFQ is left out when QCS is turned off
+    const bool useqcs =
+        (task->regions[0].privilege_fields.count(FID_SFQ) > 0);
+    AccessorRO<TempReal2> acc_sf2;
+    if (useqcs)
+        acc_sf2 = AccessorRO<TempReal2>(regions[0], FID_SFQ);
     const AccessorRO<double2> acc_pu0[2] = {
         AccessorRO<double2>(regions[1], FID_PU0),
         AccessorRO<double2>(regions[2], FID_PU0)
@@ -1434,47 +2060,48 @@ void Hydro::calcWorkOMPTask(
     };
     const AccessorRW<double> acc_zw(regions[3], FID_ZW);
     const AccessorRW<double> acc_zetot(regions[4], FID_ZETOT);
+    const AccessorRO<int> acc_znump(regions[5], FID_ZNUMP);
+    const AccessorRO<Pointer> acc_mapzs1(regions[5], FID_MAPZS1);
 
     // Compute the work done by finding, for each element/node pair,
     //   dwork= force * vavg
     // where force is the force of the element on the node
     // and vavg is the average velocity of the node over the time period
 
+    const double dth = 0.5 * dt;
+
+    // Each thread sums the sides of its own zones, so the zone
+    // totals need no atomics
     const IndexSpace& isz = task->regions[3].region.get_index_space();
     // This will assert if it is not dense
     const Rect<1> rectz = runtime->get_index_space_domain(isz);
     #pragma omp parallel for
     for (coord_t z = rectz.lo[0]; z <= rectz.hi[0]; z++)
-      acc_zw[z] = 0.;
-
-    const double dth = 0.5 * dt;
-
-    const IndexSpace& iss = task->regions[0].region.get_index_space();
-    // This will assert if it is not dense
-    const Rect<1> rects = runtime->get_index_space_domain(iss); 
-    #pragma omp parallel for
-    for (coord_t s = rects.lo[0]; s <= rects.hi[0]; s++)
     {
-        const Pointer p1 = acc_mapsp1[s];
-        const int p1reg = acc_mapsp1reg[s];
-        const Pointer p2 = acc_mapsp2[s];
-        const int p2reg = acc_mapsp2reg[s];
-        const Pointer z = acc_mapsz[s];
-        const double2 sf = acc_sf[s];
-        const double2 sf2 = acc_sf2[s];
-        const double2 sftot = sf + sf2;
-        const double2 pu01 = acc_pu0[p1reg][p1];
-        const double2 pu1 = acc_pu[p1reg][p1];
-        const double sd1 = dot(sftot, (pu01 + pu1));
-        const double2 pu02 = acc_pu0[p2reg][p2];
-        const double2 pu2 = acc_pu[p2reg][p2];
-        const double sd2 = dot(-sftot, (pu02 + pu2));
-        const double2 px1 = acc_px[p1reg][p1];
-        const double2 px2 = acc_px[p2reg][p2];
-        const double dwork = -dth * (sd1 * px1.x + sd2 * px2.x);
-
-        SumOp<double>::apply<false/*exclusive*/>(acc_zetot[z], dwork);
-        SumOp<double>::apply<false/*exclusive*/>(acc_zw[z], dwork);
+        const int n = acc_znump[z];
+        const coord_t sfirst = acc_mapzs1[z][0];
+        double zw = 0.;
+        for (coord_t s = sfirst; s < sfirst + n; s++)
+        {
+            const Pointer p1 = acc_mapsp1[s];
+            const int p1reg = acc_mapsp1reg[s];
+            const Pointer p2 = acc_mapsp2[s];
+            const int p2reg = acc_mapsp2reg[s];
+            const double2 sf = acc_sf[s];
+            const double2 sftot = (useqcs ? sf + acc_sf2[s] : sf);
+            const double2 pu01 = acc_pu0[p1reg][p1];
+            const double2 pu1 = acc_pu[p1reg][p1];
+            const double sd1 = dot(sftot, (pu01 + pu1));
+            const double2 pu02 = acc_pu0[p2reg][p2];
+            const double2 pu2 = acc_pu[p2reg][p2];
+            const double sd2 = dot(-sftot, (pu02 + pu2));
+            const double2 px1 = acc_px[p1reg][p1];
+            const double2 px2 = acc_px[p2reg][p2];
+            const double dwork = -dth * (sd1 * px1.x + sd2 * px2.x);
+            zw += dwork;
+        }
+        acc_zetot[z] += zw;
+        acc_zw[z] = zw;
     }
 }
 
@@ -1548,7 +2175,11 @@ void Hydro::calcEnergyTask(
         Context ctx,
         Runtime *runtime) {
     const AccessorRO<double> acc_zetot(regions[0], FID_ZETOT);
+#ifdef CACHE_INVARIANTS
+    const AccessorRO<double> acc_zminv(regions[2], FID_ZMINV);
+#else
     const AccessorRO<double> acc_zm(regions[0], FID_ZM);
+#endif
     const AccessorWD<double> acc_ze(regions[1], FID_ZE);
 
     const double fuzz = 1.e-99;
@@ -1557,8 +2188,12 @@ void Hydro::calcEnergyTask(
     for (PointIterator itz(runtime, isz); itz(); itz++)
     {
         const double zetot = acc_zetot[*itz];
+#ifdef CACHE_INVARIANTS
+        const double ze = zetot * acc_zminv[*itz];
+#else
         const double zm = acc_zm[*itz];
         const double ze = zetot / (zm + fuzz);
+#endif
         acc_ze[*itz] = ze;
     }
 }
@@ -1570,7 +2205,11 @@ void Hydro::calcEnergyOMPTask(
         Context ctx,
         Runtime *runtime) {
     const AccessorRO<double> acc_zetot(regions[0], FID_ZETOT);
+#ifdef CACHE_INVARIANTS
+    const AccessorRO<double> acc_zminv(regions[2], FID_ZMINV);
+#else
     const AccessorRO<double> acc_zm(regions[0], FID_ZM);
+#endif
     const AccessorWD<double> acc_ze(regions[1], FID_ZE);
 
     const double fuzz = 1.e-99;
@@ -1581,8 +2220,12 @@ void Hydro::calcEnergyOMPTask(
     for (coord_t z = rectz.lo[0]; z <= rectz.hi[0]; z++)
     {
         const double zetot = acc_zetot[z];
+#ifdef CACHE_INVARIANTS
+        const double ze = zetot * acc_zminv[z];
+#else
         const double zm = acc_zm[z];
         const double ze = zetot / (zm + fuzz);
+#endif
         acc_ze[z] = ze;
     }
 }
@@ -1654,8 +2297,9 @@ double Hydro::calcDtTask(
     const double dtlast = task->futures[0].get_result<double>();
     const double dtnew  = task->futures[1].get_result<double>();
     const double dvovmax = task->futures[2].get_result<double>();
+    const double dtrest = task->futures[3].get_result<double>();
 
-    double dtrec = 1.e99;
+    double dtrec = dtrest;
     if (dtnew < dtrec) {
         dtrec = dtnew;
     }
@@ -1762,6 +2406,181 @@ void Hydro::initSubrgnTask(
 }
 
 
+void Hydro::resetActivePieces() {
+    if (ispcact.exists() && ispcact != mesh->ispc)
+        runtime->destroy_index_space(ctx, ispcact);
+    ispcact = mesh->ispc;
+    const Rect<1> rectpc = runtime->get_index_space_domain(mesh->ispc);
+    const int numpcs = rectpc.volume();
+    pcactive.assign(numpcs, true);
+    f_dtrest = Future::from_value<double>(1.e99);
+    if (activecycles == 0) return;
+
+    // Mark each shared point with the piece that owns it, in a
+    // region of its own that only lives for this
+    FieldSpace fso = runtime->create_field_space(ctx);
+    {
+      FieldAllocator fa = runtime->create_field_allocator(ctx, fso);
+      fa.allocate_field(sizeof(coord_t), FID_PIECE);
+    }
+    LogicalRegion lro = runtime->create_logical_region(ctx,
+        mesh->lrp.get_index_space(), fso);
+    LogicalPartition lpomstr = runtime->get_logical_partition_by_tree(ctx,
+        mesh->lppmstr.get_index_partition(), fso, lro.get_tree_id());
+    LogicalPartition lposhr = runtime->get_logical_partition_by_tree(ctx,
+        mesh->lppshr.get_index_partition(), fso, lro.get_tree_id());
+    {
+      IndexTaskLauncher launcher(TID_MARKPOINTOWNERS, mesh->ispc,
+          TaskArgument(), ArgumentMap());
+      launcher.add_region_requirement(
+          RegionRequirement(lpomstr, 0/*identity*/, LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, lro));
+      launcher.add_field(0/*index*/, FID_PIECE);
+      runtime->execute_index_space(ctx, launcher);
+    }
+    // Then each piece names the owners of the points it touches
+    IndexTaskLauncher launcher(TID_CALCPIECENBRS, mesh->ispc,
+        TaskArgument(), ArgumentMap());
+    launcher.add_region_requirement(
+        RegionRequirement(lposhr, 0/*identity*/, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lro));
+    launcher.add_field(0/*index*/, FID_PIECE);
+    FutureMap fm = runtime->execute_index_space(ctx, launcher);
+
+    // A point's owner touches it too, so the pieces sharing points
+    // are the pairs one of them names, in either direction
+    pcnbrs.assign(numpcs, vector<int>());
+    for (int i = 0; i < numpcs; ++i) {
+        const PieceNeighbors pn = fm.get_result<PieceNeighbors>(
+            DomainPoint(Point<1>(rectpc.lo[0] + i)), true/*silence warnings*/);
+        for (int k = 0; k < (pn.numnbrs < 0 ? numpcs : pn.numnbrs); ++k) {
+            const int j = (pn.numnbrs < 0 ? k : pn.nbrs[k] - rectpc.lo[0]);
+            if (j == i) continue;
+            pcnbrs[i].push_back(j);
+            pcnbrs[j].push_back(i);
+        }
+    }
+    for (int i = 0; i < numpcs; ++i) {
+        sort(pcnbrs[i].begin(), pcnbrs[i].end());
+        pcnbrs[i].erase(unique(pcnbrs[i].begin(), pcnbrs[i].end()),
+                        pcnbrs[i].end());
+    }
+
+    runtime->destroy_logical_region(ctx, lro);
+    runtime->destroy_field_space(ctx, fso);
+}
+
+
+bool Hydro::updateActivePieces(Future f_dt) {
+    const IndexSpace& ispc = mesh->ispc;
+    IndexTaskLauncher launcher(TID_CALCACTIVITY, ispc,
+                          TaskArgument(), ArgumentMap());
+    launcher.add_future(f_dt);
+    launcher.add_region_requirement(
+        RegionRequirement(mesh->lppprv, 0/*identity*/, LEGION_READ_ONLY, LEGION_EXCLUSIVE, mesh->lrp));
+    launcher.add_field(0/*index*/, FID_PX);
+    launcher.add_field(0/*index*/, FID_PU);
+    launcher.add_field(0/*index*/, FID_PU0);
+    launcher.add_field(0/*index*/, FID_PAP);
+    launcher.add_region_requirement(
+        RegionRequirement(mesh->lppshr, 0/*identity*/, LEGION_READ_ONLY, LEGION_EXCLUSIVE, mesh->lrp));
+    launcher.add_field(1/*index*/, FID_PX);
+    launcher.add_field(1/*index*/, FID_PU);
+    launcher.add_field(1/*index*/, FID_PU0);
+    launcher.add_field(1/*index*/, FID_PAP);
+    launcher.add_region_requirement(
+        RegionRequirement(mesh->lpz, 0/*identity*/, LEGION_READ_ONLY, LEGION_EXCLUSIVE, mesh->lrz));
+    launcher.add_field(2/*index*/, FID_ZDL);
+    FutureMap fm = runtime->execute_index_space(ctx, launcher);
+
+    const Rect<1> rectpc = runtime->get_index_space_domain(ispc);
+    const int numpcs = rectpc.volume();
+    vector<PieceActivity> acts(numpcs);
+    double zdlmax = 0.;
+    vector<int> moving;
+    for (int i = 0; i < numpcs; ++i) {
+        acts[i] = fm.get_result<PieceActivity>(
+            DomainPoint(Point<1>(rectpc.lo[0] + i)), true/*silence warnings*/);
+        zdlmax = max(zdlmax, acts[i].zdlmax);
+        if (acts[i].umax > activetol) moving.push_back(i);
+    }
+
+    vector<bool> active(numpcs, false);
+    if (moving.empty())
+        // nothing has started moving yet, so there's nothing to tell
+        // the pieces apart by
+        active.assign(numpcs, true);
+    else {
+        // Every piece sharing points with a moving one has to run, or
+        // the moving one's zones would push on points that don't
+        // move.  Past those, a disturbance gets across at most about
+        // one zone a cycle, so the wave goes on through the pieces
+        // within a couple of zone lengths a cycle of a moving one
+        // until the next update.  Each piece it reaches carries the
+        // moving piece it came from.
+        const double reach = 2. * (activecycles + 1) * zdlmax;
+        vector<int> src(numpcs, -1);
+        vector<int> wave(moving);
+        for (size_t n = 0; n < moving.size(); ++n) {
+            active[moving[n]] = true;
+            src[moving[n]] = moving[n];
+        }
+        for (size_t n = 0; n < wave.size(); ++n) {
+            const int j = wave[n];
+            const PieceActivity& as = acts[src[j]];
+            for (size_t k = 0; k < pcnbrs[j].size(); ++k) {
+                const int i = pcnbrs[j][k];
+                if (active[i]) continue;
+                const double dx = max(acts[i].xlo.x - as.xhi.x,
+                                      as.xlo.x - acts[i].xhi.x);
+                const double dy = max(acts[i].xlo.y - as.xhi.y,
+                                      as.xlo.y - acts[i].xhi.y);
+                if (src[j] != j && (dx >= reach || dy >= reach)) continue;
+                active[i] = true;
+                src[i] = src[j];
+                wave.push_back(i);
+            }
+        }
+    }
+    if (active == pcactive) return false;
+
+    pcactive = active;
+    if (ispcact != ispc)
+        runtime->destroy_index_space(ctx, ispcact);
+    vector<DomainPoint> pts, rest;
+    for (int i = 0; i < numpcs; ++i) {
+        const DomainPoint pt(Point<1>(rectpc.lo[0] + i));
+        if (active[i])
+            pts.push_back(pt);
+        else
+            rest.push_back(pt);
+    }
+    if (rest.empty()) {
+        ispcact = ispc;
+        f_dtrest = Future::from_value<double>(1.e99);
+    }
+    else {
+        ispcact = runtime->create_index_space(ctx, pts);
+        runtime->attach_name(ispcact, "active pieces");
+        // None of the points of a piece at rest move, so its zones
+        // keep the fields calcDtNew reads from the last cycle they
+        // ran, and their limit is the same until they wake up again
+        const IndexSpace isrest = runtime->create_index_space(ctx, rest);
+        IndexTaskLauncher launchdtnew(TID_CALCDTNEW, isrest,
+            TaskArgument(&cfl, sizeof(cfl)), ArgumentMap());
+        launchdtnew.add_region_requirement(
+            RegionRequirement(mesh->lpz, 0, LEGION_READ_ONLY, LEGION_EXCLUSIVE, mesh->lrz));
+        launchdtnew.add_field(0, FID_ZDL);
+        launchdtnew.add_field(0, FID_ZDU);
+        launchdtnew.add_field(0, FID_ZSS);
+        launchdtnew.tag |= PennantMapper::PREFER_OMP | PennantMapper::PREFER_GPU | tunetag;
+        f_dtrest = runtime->execute_index_space(ctx, launchdtnew, OPID_MINDBL);
+        runtime->destroy_index_space(ctx, isrest);
+    }
+    LEGION_PRINT_ONCE(runtime, ctx, stdout,
+        "Active pieces: %d of %d\n", int(pts.size()), numpcs);
+    return true;
+}
+
+
 void Hydro::initHydroTask(
         const Task *task,
         const std::vector<PhysicalRegion> &regions,
@@ -1784,6 +2603,121 @@ void Hydro::initHydroTask(
 }
 
 
+void Hydro::initInvariantsTask(
+        const Task *task,
+        const std::vector<PhysicalRegion> &regions,
+        Context ctx,
+        Runtime *runtime) {
+  const AccessorRO<int> acc_znump(regions[0], FID_ZNUMP);
+  const AccessorRO<double> acc_zm(regions[0], FID_ZM);
+
+  const AccessorWD<double> acc_znumpinv(regions[1], FID_ZNUMPINV);
+  const AccessorWD<double> acc_zminv(regions[1], FID_ZMINV);
+
+  // same fuzz as calcEnergy, which divided by zm + fuzz
+  const double fuzz = 1.e-99;
+  IndexSpace isz = task->regions[0].region.get_index_space();
+  for (PointIterator itr(runtime, isz); itr(); itr++)
+  {
+    acc_znumpinv[*itr] = 1. / acc_znump[*itr];
+    acc_zminv[*itr] = 1. / (acc_zm[*itr] + fuzz);
+  }
+}
+
+
+Hydro::PieceActivity Hydro::calcActivityTask(
+        const Task *task,
+        const std::vector<PhysicalRegion> &regions,
+        Context ctx,
+        Runtime *runtime) {
+  const double dt = task->futures[0].get_result<double>();
+  const AccessorRO<double2> acc_px[2] = {
+      AccessorRO<double2>(regions[0], FID_PX),
+      AccessorRO<double2>(regions[1], FID_PX)
+  };
+  const AccessorRO<double2> acc_pu[2] = {
+      AccessorRO<double2>(regions[0], FID_PU),
+      AccessorRO<double2>(regions[1], FID_PU)
+  };
+  const AccessorRO<double2> acc_pu0[2] = {
+      AccessorRO<double2>(regions[0], FID_PU0),
+      AccessorRO<double2>(regions[1], FID_PU0)
+  };
+  const AccessorRO<double2> acc_pap[2] = {
+      AccessorRO<double2>(regions[0], FID_PAP),
+      AccessorRO<double2>(regions[1], FID_PAP)
+  };
+  const AccessorRO<double> acc_zdl(regions[2], FID_ZDL);
+
+  PieceActivity act;
+  act.umax = 0.;
+  act.zdlmax = 0.;
+  act.xlo = double2(1.e99, 1.e99);
+  act.xhi = double2(-1.e99, -1.e99);
+  // The force on a point is checked through PAP, the acceleration
+  // calcAccel made of it after the fixed boundary components were
+  // zeroed, since the force on a wall point holds the wall up
+  for (int part = 0; part < 2; ++part) {
+    IndexSpace isp = task->regions[part].region.get_index_space();
+    for (PointIterator itr(runtime, isp); itr(); itr++)
+    {
+      const double2 px = acc_px[part][*itr];
+      act.xlo = double2(min(act.xlo.x, px.x), min(act.xlo.y, px.y));
+      act.xhi = double2(max(act.xhi.x, px.x), max(act.xhi.y, px.y));
+      act.umax = max(act.umax, max(length(acc_pu[part][*itr]),
+                                   length(acc_pu0[part][*itr])));
+      act.umax = max(act.umax, length(acc_pap[part][*itr]) * dt);
+    }
+  }
+  IndexSpace isz = task->regions[2].region.get_index_space();
+  for (PointIterator itr(runtime, isz); itr(); itr++)
+    act.zdlmax = max(act.zdlmax, acc_zdl[*itr]);
+  return act;
+}
+
+
+void Hydro::markPointOwnersTask(
+        const Task *task,
+        const std::vector<PhysicalRegion> &regions,
+        Context ctx,
+        Runtime *runtime) {
+  const AccessorWD<coord_t> acc_owner(regions[0], FID_PIECE);
+  const coord_t pc = task->index_point[0];
+
+  IndexSpace isp = task->regions[0].region.get_index_space();
+  for (PointIterator itr(runtime, isp); itr(); itr++)
+    acc_owner[*itr] = pc;
+}
+
+
+Hydro::PieceNeighbors Hydro::calcPieceNbrsTask(
+        const Task *task,
+        const std::vector<PhysicalRegion> &regions,
+        Context ctx,
+        Runtime *runtime) {
+  const AccessorRO<coord_t> acc_owner(regions[0], FID_PIECE);
+  const coord_t pc = task->index_point[0];
+
+  PieceNeighbors pn;
+  pn.numnbrs = 0;
+  IndexSpace isp = task->regions[0].region.get_index_space();
+  for (PointIterator itr(runtime, isp); itr(); itr++)
+  {
+    const coord_t owner = acc_owner[*itr];
+    if (owner == pc) continue;
+    int k = 0;
+    while (k < pn.numnbrs && pn.nbrs[k] != owner) ++k;
+    if (k < pn.numnbrs) continue;
+    if (pn.numnbrs == MAXPIECENBRS) {
+      pn.numnbrs = -1;
+      break;
+    }
+    pn.nbrs[pn.numnbrs++] = owner;
+  }
+  return pn;
+}
+
+
 void Hydro::initRadialVelTask(
         const Task *task,
         const std::vector<PhysicalRegion> &regions,
@@ -1,5 +1,6 @@
 
 #include "Hydro.hh"
+#include "HydroBC.hh"
 #include "MyLegion.hh"
 #include "CudaHelp.hh"
 
@@ -166,13 +167,24 @@ __global__ void
 __launch_bounds__(THREADS_PER_BLOCK,MIN_CTAS_PER_SM)
 gpu_calc_crnr_mass(const AccessorRO<Pointer> acc_mapsp1,
                    const AccessorRO<int> acc_mapsp1reg,
+#ifdef PULL_GHOST_POINTS
+                   const AccessorRO<Pointer> acc_mapsp1ghost,
+#else
+                   const AccessorRO<int> acc_mapsp1node,
+#endif
                    const AccessorRO<Pointer> acc_mapss3,
                    const AccessorRO<Pointer> acc_mapsz,
                    const AccessorRO<double> acc_smf,
                    const AccessorRO<double> acc_zr,
                    const AccessorRO<double> acc_zarea,
                    const AccessorRW<double> acc_pmas_prv,
+#ifdef PULL_GHOST_POINTS
+                   const AccessorRW<double> acc_pmas_mstr,
+                   const AccessorRW<double> acc_pmas_ghost,
+#else
                    const AccessorRD<SumOp<double>,false/*exclusive*/> acc_pmas_shr,
+                   const AccessorRD<SumOp<double>,false/*exclusive*/> acc_pmas_nshr,
+#endif
                    const Point<1> origin, const size_t max)
 {
   const size_t offset = blockIdx.x * blockDim.x + threadIdx.x;
@@ -188,10 +200,22 @@ gpu_calc_crnr_mass(const AccessorRO<Pointer> acc_mapsp1,
   const double mf = acc_smf[s];
   const double mf3 = acc_smf[s3];
   const double mwt = r * area * 0.5 * (mf + mf3);
+#ifdef PULL_GHOST_POINTS
+  const Pointer g = acc_mapsp1ghost[s];
   if (preg == 0)
       SumOp<double>::apply<false/*exclusive*/>(acc_pmas_prv[p], mwt);
+  else if (g[0] < 0)
+      SumOp<double>::apply<false/*exclusive*/>(acc_pmas_mstr[p], mwt);
+  else
+      SumOp<double>::apply<false/*exclusive*/>(acc_pmas_ghost[g], mwt);
+#else
+  if (preg == 0)
+      SumOp<double>::apply<false/*exclusive*/>(acc_pmas_prv[p], mwt);
+  else if (acc_mapsp1node[s])
+      acc_pmas_nshr[p] <<= mwt;
   else
       acc_pmas_shr[p] <<= mwt;
+#endif
 }
 
 __host__
@@ -202,14 +226,26 @@ void Hydro::calcCrnrMassGPUTask(
         Runtime *runtime) {
     const AccessorRO<Pointer> acc_mapsp1(regions[0], FID_MAPSP1);
     const AccessorRO<int> acc_mapsp1reg(regions[0], FID_MAPSP1REG);
+#ifdef PULL_GHOST_POINTS
+    const AccessorRO<Pointer> acc_mapsp1ghost(regions[0], FID_MAPSP1GHOST);
+#else
+    const AccessorRO<int> acc_mapsp1node(regions[0], FID_MAPSP1NODE);
+#endif
     const AccessorRO<Pointer> acc_mapss3(regions[0], FID_MAPSS3);
     const AccessorRO<Pointer> acc_mapsz(regions[0], FID_MAPSZ);
     const AccessorRO<double> acc_smf(regions[0], FID_SMF);
     const AccessorRO<double> acc_zr(regions[1], FID_ZRP);
     const AccessorRO<double> acc_zarea(regions[1], FID_ZAREAP);
     const AccessorRW<double> acc_pmas_prv(regions[2], FID_PMASWT);
+#ifdef PULL_GHOST_POINTS
+    const AccessorRW<double> acc_pmas_mstr(regions[3], FID_PMASWT);
+    const AccessorRW<double> acc_pmas_ghost(regions[4], FID_GHOSTMASWT);
+#else
     const AccessorRD<SumOp<double>,false/*exclusive*/> 
       acc_pmas_shr(regions[3], FID_PMASWT, OPID_SUMDBL);
+    const AccessorRD<SumOp<double>,false/*exclusive*/> 
+      acc_pmas_nshr(regions[4], FID_PMASWT, OPID_SUMDBL);
+#endif
 
     const IndexSpace& iss = task->regions[0].region.get_index_space();
     // This will assert if it is not dense
@@ -218,21 +254,39 @@ void Hydro::calcCrnrMassGPUTask(
     if (volume == 0)
       return;
     const size_t blocks = (volume + THREADS_PER_BLOCK - 1) / THREADS_PER_BLOCK;
+#ifdef PULL_GHOST_POINTS
     gpu_calc_crnr_mass<<<blocks,THREADS_PER_BLOCK>>>(acc_mapsp1, acc_mapsp1reg,
-        acc_mapss3, acc_mapsz, acc_smf, acc_zr, acc_zarea, acc_pmas_prv,
-        acc_pmas_shr, rects.lo, volume);
+        acc_mapsp1ghost, acc_mapss3, acc_mapsz, acc_smf, acc_zr, acc_zarea,
+        acc_pmas_prv, acc_pmas_mstr, acc_pmas_ghost, rects.lo, volume);
+#else
+    gpu_calc_crnr_mass<<<blocks,THREADS_PER_BLOCK>>>(acc_mapsp1, acc_mapsp1reg,
+        acc_mapsp1node, acc_mapss3, acc_mapsz, acc_smf, acc_zr, acc_zarea,
+        acc_pmas_prv, acc_pmas_shr, acc_pmas_nshr, rects.lo, volume);
+#endif
 }
 
 __global__ void
 __launch_bounds__(THREADS_PER_BLOCK,MIN_CTAS_PER_SM)
 gpu_sum_crnr_force(const AccessorRO<Pointer> acc_mapsp1,
                    const AccessorRO<int> acc_mapsp1reg,
+#ifdef PULL_GHOST_POINTS
+                   const AccessorRO<Pointer> acc_mapsp1ghost,
+#else
+                   const AccessorRO<int> acc_mapsp1node,
+#endif
                    const AccessorRO<Pointer> acc_mapss3,
-                   const AccessorRO<double2> acc_sfp,
-                   const AccessorRO<double2> acc_sfq,
-                   const AccessorRO<double2> acc_sft,
+                   const AccessorRO<TempReal2> acc_sfp,
+                   const AccessorRO<TempReal2> acc_sfq,
+                   const AccessorRO<TempReal2> acc_sft,
+                   const bool useqcs, const bool usetts,
                    const AccessorRW<double2> acc_pf_prv,
+#ifdef PULL_GHOST_POINTS
+                   const AccessorRW<double2> acc_pf_mstr,
+                   const AccessorRW<double2> acc_pf_ghost,
+#else
                    const AccessorRD<SumOp<double2>,false/*exclusive*/> acc_pf_shr,
+                   const AccessorRD<SumOp<double2>,false/*exclusive*/> acc_pf_nshr,
+#endif
                    const Point<1> origin, const size_t max)
 {
   const size_t offset = blockIdx.x * blockDim.x + threadIdx.x;
@@ -242,17 +296,33 @@ gpu_sum_crnr_force(const AccessorRO<Pointer> acc_mapsp1,
   const Pointer s3 = acc_mapss3[s];
   const Pointer p = acc_mapsp1[s];
   const int preg = acc_mapsp1reg[s];
-  const double2 sfp = acc_sfp[s];
-  const double2 sfq = acc_sfq[s];
-  const double2 sft = acc_sft[s];
-  const double2 sfp3 = acc_sfp[s3];
-  const double2 sfq3 = acc_sfq[s3];
-  const double2 sft3 = acc_sft[s3];
-  const double2 cf = (sfp + sfq + sft) - (sfp3 + sfq3 + sft3);
+  double2 sf = acc_sfp[s];
+  double2 sf3 = acc_sfp[s3];
+  if (useqcs) {
+    sf = sf + acc_sfq[s];
+    sf3 = sf3 + acc_sfq[s3];
+  }
+  if (usetts) {
+    sf = sf + acc_sft[s];
+    sf3 = sf3 + acc_sft[s3];
+  }
+  const double2 cf = sf - sf3;
+#ifdef PULL_GHOST_POINTS
+  const Pointer g = acc_mapsp1ghost[s];
   if (preg == 0)
       SumOp<double2>::apply<false/*exclusive*/>(acc_pf_prv[p], cf);
+  else if (g[0] < 0)
+      SumOp<double2>::apply<false/*exclusive*/>(acc_pf_mstr[p], cf);
+  else
+      SumOp<double2>::apply<false/*exclusive*/>(acc_pf_ghost[g], cf);
+#else
+  if (preg == 0)
+      SumOp<double2>::apply<false/*exclusive*/>(acc_pf_prv[p], cf);
+  else if (acc_mapsp1node[s])
+      acc_pf_nshr[p] <<= cf;
   else
       acc_pf_shr[p] <<= cf;
+#endif
 }
 
 __host__
@@ -263,13 +333,32 @@ void Hydro::sumCrnrForceGPUTask(
         Runtime *runtime) {
     const AccessorRO<Pointer> acc_mapsp1(regions[0], FID_MAPSP1);
     const AccessorRO<int> acc_mapsp1reg(regions[0], FID_MAPSP1REG);
+#ifdef PULL_GHOST_POINTS
+    const AccessorRO<Pointer> acc_mapsp1ghost(regions[0], FID_MAPSP1GHOST);
+#else
+    const AccessorRO<int> acc_mapsp1node(regions[0], FID_MAPSP1NODE);
+#endif
     const AccessorRO<Pointer> acc_mapss3(regions[0], FID_MAPSS3);
-    const AccessorRO<double2> acc_sfp(regions[0], FID_SFP);
-    const AccessorRO<double2> acc_sfq(regions[0], FID_SFQ);
-    const AccessorRO<double2> acc_sft(regions[0], FID_SFT);
+    const AccessorRO<TempReal2> acc_sfp(regions[0], FID_SFP);
+    // the force packages that are turned off leave their fields out
+    const std::set<FieldID>& fids_s = task->regions[0].privilege_fields;
+    const bool useqcs = (fids_s.count(FID_SFQ) > 0);
+    const bool usetts = (fids_s.count(FID_SFT) > 0);
+    AccessorRO<TempReal2> acc_sfq, acc_sft;
+    if (useqcs)
+        acc_sfq = AccessorRO<TempReal2>(regions[0], FID_SFQ);
+    if (usetts)
+        acc_sft = AccessorRO<TempReal2>(regions[0], FID_SFT);
     const AccessorRW<double2> acc_pf_prv(regions[1], FID_PF);
+#ifdef PULL_GHOST_POINTS
+    const AccessorRW<double2> acc_pf_mstr(regions[2], FID_PF);
+    const AccessorRW<double2> acc_pf_ghost(regions[3], FID_GHOSTF);
+#else
     const AccessorRD<SumOp<double2>,false/*exclusive*/> 
       acc_pf_shr(regions[2], FID_PF, OPID_SUMDBL2);
+    const AccessorRD<SumOp<double2>,false/*exclusive*/> 
+      acc_pf_nshr(regions[3], FID_PF, OPID_SUMDBL2);
+#endif
 
     const IndexSpace& iss = task->regions[0].region.get_index_space();
     // This will assert if it is not dense
@@ -278,8 +367,15 @@ void Hydro::sumCrnrForceGPUTask(
     if (volume == 0)
       return;
     const size_t blocks = (volume + THREADS_PER_BLOCK - 1) / THREADS_PER_BLOCK;
+#ifdef PULL_GHOST_POINTS
+    gpu_sum_crnr_force<<<blocks,THREADS_PER_BLOCK>>>(acc_mapsp1, acc_mapsp1reg,
+        acc_mapsp1ghost, acc_mapss3, acc_sfp, acc_sfq, acc_sft, useqcs, usetts,
+        acc_pf_prv, acc_pf_mstr, acc_pf_ghost, rects.lo, volume);
+#else
     gpu_sum_crnr_force<<<blocks,THREADS_PER_BLOCK>>>(acc_mapsp1, acc_mapsp1reg,
-        acc_mapss3, acc_sfp, acc_sfq, acc_sft, acc_pf_prv, acc_pf_shr, rects.lo, volume);
+        acc_mapsp1node, acc_mapss3, acc_sfp, acc_sfq, acc_sft, useqcs, usetts,
+        acc_pf_prv, acc_pf_shr, acc_pf_nshr, rects.lo, volume);
+#endif
 }
 
 __global__ void
@@ -299,6 +395,27 @@ gpu_calc_accel(const AccessorRO<double2> acc_pf,
   acc_pa[p] = a;
 }
 
+__global__ void
+__launch_bounds__(THREADS_PER_BLOCK,MIN_CTAS_PER_SM)
+gpu_apply_bc_masks(const AccessorRO<Pointer> acc_mapbp,
+                   const AccessorRO<int> acc_mapbpreg,
+                   const AccessorRO<int> acc_mapbpmask,
+                   const AccessorWD<double2> acc_pa,
+                   const AccessorRW<double2> acc_pu,
+                   const int part, const Point<1> origin, const size_t max)
+{
+  const size_t offset = blockIdx.x * blockDim.x + threadIdx.x;
+  if (offset >= max)
+    return;
+  const coord_t b = origin[0] + offset;
+  if (acc_mapbpreg[b] != part)
+    return;
+  const Pointer p = acc_mapbp[b];
+  const int mask = acc_mapbpmask[b];
+  acc_pa[p] = HydroBC::applyMask(acc_pa[p], mask);
+  acc_pu[p] = HydroBC::applyMask(acc_pu[p], mask);
+}
+
 __host__
 void Hydro::calcAccelGPUTask(
         const Task *task,
@@ -320,6 +437,25 @@ void Hydro::calcAccelGPUTask(
     const size_t blocks = (volume + THREADS_PER_BLOCK - 1) / THREADS_PER_BLOCK;
     gpu_calc_accel<<<blocks,THREADS_PER_BLOCK>>>(acc_pf, acc_pmass, acc_pa, 
                                                  fuzz, rectp.lo, volume);
+
+    // apply boundary conditions to the points of this part, after
+    // the kernel above in the same stream
+    if (regions.size() < 4) return;
+    const int part = *(const int*) task->args;
+    const AccessorRO<Pointer> acc_mapbp(regions[2], FID_MAPBP);
+    const AccessorRO<int> acc_mapbpreg(regions[2], FID_MAPBPREG);
+    const AccessorRO<int> acc_mapbpmask(regions[2], FID_MAPBPMASK);
+    const AccessorRW<double2> acc_pu(regions[3], FID_PU0);
+
+    const IndexSpace& isb = task->regions[2].region.get_index_space();
+    // This will assert if its not dense
+    const Rect<1> rectb = runtime->get_index_space_domain(isb);
+    const size_t volumeb = rectb.volume();
+    if (volumeb == 0)
+      return;
+    const size_t blocksb = (volumeb + THREADS_PER_BLOCK - 1) / THREADS_PER_BLOCK;
+    gpu_apply_bc_masks<<<blocksb,THREADS_PER_BLOCK>>>(acc_mapbp, acc_mapbpreg,
+        acc_mapbpmask, acc_pa, acc_pu, part, rectb.lo, volumeb);
 }
 
 __global__ void
@@ -377,8 +513,9 @@ gpu_calc_work(const AccessorRO<Pointer> acc_mapsp1,
               const AccessorRO<Pointer> acc_mapsz,
               const AccessorRO<int> acc_mapsp1reg,
               const AccessorRO<int> acc_mapsp2reg,
-              const AccessorRO<double2> acc_sf,
-              const AccessorRO<double2> acc_sf2,
+              const AccessorRO<TempReal2> acc_sf,
+              const AccessorRO<TempReal2> acc_sf2,
+              const bool useqcs,
               const AccessorRO<double2> acc_pu00,
               const AccessorRO<double2> acc_pu01,
               const AccessorRO<double2> acc_pu0,
@@ -399,8 +536,7 @@ gpu_calc_work(const AccessorRO<Pointer> acc_mapsp1,
   const int p2reg = acc_mapsp2reg[s];
   const Pointer z = acc_mapsz[s];
   const double2 sf = acc_sf[s];
-  const double2 sf2 = acc_sf2[s];
-  const double2 sftot = sf + sf2;
+  const double2 sftot = (useqcs ? sf + acc_sf2[s] : sf);
   const double2 pu01 = (p1reg == 0) ? acc_pu00[p1] : acc_pu01[p1];
   const double2 pu1 = (p1reg == 0) ? acc_pu0[p1] : acc_pu1[p1];
   const double sd1 = dot(sftot, (pu01 + pu1));
@@ -428,8 +564,13 @@ void Hydro::calcWorkGPUTask(
     const AccessorRO<Pointer> acc_mapsz(regions[0], FID_MAPSZ);
     const AccessorRO<int> acc_mapsp1reg(regions[0], FID_MAPSP1REG);
     const AccessorRO<int> acc_mapsp2reg(regions[0], FID_MAPSP2REG);
-    const AccessorRO<double2> acc_sf(regions[0], FID_SFP);
-    const AccessorRO<double2> acc_sf2(regions[0], FID_SFQ);
+    const AccessorRO<TempReal2> acc_sf(regions[0], FID_SFP);
+    // SFQ is left out when QCS is turned off
+    const bool useqcs =
+        (task->regions[0].privilege_fields.count(FID_SFQ) > 0);
+    AccessorRO<TempReal2> acc_sf2;
+    if (useqcs)
+        acc_sf2 = AccessorRO<TempReal2>(regions[0], FID_SFQ);
     const AccessorRO<double2> acc_pu0[2] = {
         AccessorRO<double2>(regions[1], FID_PU0),
         AccessorRO<double2>(regions[2], FID_PU0)
@@ -467,9 +608,9 @@ void Hydro::calcWorkGPUTask(
       return;
     const size_t blocks = (volume + THREADS_PER_BLOCK - 1) / THREADS_PER_BLOCK;
     gpu_calc_work<<<blocks,THREADS_PER_BLOCK>>>(acc_mapsp1, acc_mapsp2, acc_mapsz,
-        acc_mapsp1reg, acc_mapsp2reg, acc_sf, acc_sf2, acc_pu0[0], acc_pu0[1],
-        acc_pu[0], acc_pu[1], acc_px[0], acc_px[1], acc_zw, acc_zetot, dth,
-        rects.lo, volume);
+        acc_mapsp1reg, acc_mapsp2reg, acc_sf, acc_sf2, useqcs, acc_pu0[0],
+        acc_pu0[1], acc_pu[0], acc_pu[1], acc_px[0], acc_px[1], acc_zw,
+        acc_zetot, dth, rects.lo, volume);
 }
 
 __global__ void
@@ -524,7 +665,11 @@ void Hydro::calcWorkRateGPUTask(
 __global__ void
 __launch_bounds__(THREADS_PER_BLOCK,MIN_CTAS_PER_SM)
 gpu_calc_energy(const AccessorRO<double> acc_zetot,
+#ifdef CACHE_INVARIANTS
+                const AccessorRO<double> acc_zminv,
+#else
                 const AccessorRO<double> acc_zm,
+#endif
                 const AccessorWD<double> acc_ze,
                 const double fuzz, const Point<1> origin, const size_t max)
 {
@@ -533,8 +678,12 @@ gpu_calc_energy(const AccessorRO<double> acc_zetot,
     return;
   const coord_t z = origin[0] + offset;
   const double zetot = acc_zetot[z];
+#ifdef CACHE_INVARIANTS
+  const double ze = zetot * acc_zminv[z];
+#else
   const double zm = acc_zm[z];
   const double ze = zetot / (zm + fuzz);
+#endif
   acc_ze[z] = ze;
 }
 
@@ -545,7 +694,11 @@ void Hydro::calcEnergyGPUTask(
         Context ctx,
         Runtime *runtime) {
     const AccessorRO<double> acc_zetot(regions[0], FID_ZETOT);
+#ifdef CACHE_INVARIANTS
+    const AccessorRO<double> acc_zminv(regions[2], FID_ZMINV);
+#else
     const AccessorRO<double> acc_zm(regions[0], FID_ZM);
+#endif
     const AccessorWD<double> acc_ze(regions[1], FID_ZE);
 
     const double fuzz = 1.e-99;
@@ -556,8 +709,13 @@ void Hydro::calcEnergyGPUTask(
     if (volume == 0)
       return;
     const size_t blocks = (volume + THREADS_PER_BLOCK - 1) / THREADS_PER_BLOCK;
+#ifdef CACHE_INVARIANTS
+    gpu_calc_energy<<<blocks,THREADS_PER_BLOCK>>>(acc_zetot, acc_zminv, acc_ze,
+                                                  fuzz, rectz.lo, volume);
+#else
     gpu_calc_energy<<<blocks,THREADS_PER_BLOCK>>>(acc_zetot, acc_zm, acc_ze,
                                                   fuzz, rectz.lo, volume);
+#endif
 }
 
 __global__ void
@@ -47,9 +47,19 @@ enum HydroTaskID {
     TID_CALCDT,
     TID_INITSUBRGN,
     TID_INITHYDRO,
-    TID_INITRADIALVEL
+    TID_INITRADIALVEL,
+    TID_PULLCRNRMASS,
+    TID_PULLCRNRFORCE,
+    TID_INITINVARIANTS,
+    TID_CALCACTIVITY,
+    TID_MARKPOINTOWNERS,
+    TID_CALCPIECENBRS
 };
 
+// Most pieces calcPieceNbrs can name for one piece; one that touches
+// the points of more than this many is taken to neighbor them all.
+const int MAXPIECENBRS = 32;
+
 
 class Hydro {
 public:
@@ -74,6 +84,20 @@ public:
     public:
       double vel, eps;
     };
+    // what calcActivity finds for a piece
+    struct PieceActivity {
+    public:
+      double umax;              // largest point speed, before or after,
+                                // or speed its acceleration adds in dt
+      double zdlmax;            // longest zone length
+      double2 xlo, xhi;         // box around its points
+    };
+    // the other pieces owning points a piece touches
+    struct PieceNeighbors {
+    public:
+      int numnbrs;              // or -1 if more than MAXPIECENBRS
+      coord_t nbrs[MAXPIECENBRS];
+    };
 public:
 
     // associated mesh object
@@ -83,7 +107,7 @@ public:
     PolyGas* pgas;
     TTS* tts;
     QCS* qcs;
-    std::vector<HydroBC*> bcs;
+    HydroBC* bc;                // all the fixed planes, if there are any
 
     Context ctx;
     Runtime* runtime;
@@ -97,6 +121,17 @@ public:
     double uinitradial;         // initial velocity in radial direction
     std::vector<double> bcx;    // x values of x-plane fixed boundaries
     std::vector<double> bcy;    // y values of y-plane fixed boundaries
+    bool usetts;                // false if alfa is 0 and TTS adds no force
+    bool useqcs;                // false if q1 and q2 are 0 and QCS adds none
+    int activecycles;           // cycles between active piece updates, or 0
+    double activetol;           // point speed at or below which it is at rest
+    std::vector<bool> pcactive; // pieces that can't skip the next cycles
+    std::vector<std::vector<int> > pcnbrs;
+                                // pieces that share points with each one
+    Legion::IndexSpace ispcact; // the same, as a launch space
+    Legion::Future f_dtrest;    // timestep limit of the others, from
+                                // the last cycle each of them ran
+    Legion::MappingTagID tunetag; // tuning and timing tags, set by Driver
 
     Hydro(
             const InputFile* inp,
@@ -107,6 +142,23 @@ public:
 
     void init();
 
+    // (re)build the boundary conditions for the current pieces
+    void initBCs();
+
+    // (re)compute the zone constants in lrzc for the current pieces
+    void initInvariants();
+
+    // find the pieces with a point moving faster than activetol, or
+    // speeding up by that much in a cycle of f_dt, and wake the
+    // pieces around them that a disturbance could reach in the next
+    // activecycles cycles; the rest are left out of the zone-local
+    // launches until the next update.  Returns true if the set changed.
+    bool updateActivePieces(Legion::Future f_dt);
+
+    // make every piece active again and find which pieces share
+    // points, as after a rebalance
+    void resetActivePieces();
+
     Legion::Future doCycle(Legion::Future f_dt, const int cycle,
                            Legion::Predicate p_not_done);
 
@@ -200,6 +252,42 @@ public:
             Legion::Context ctx,
             Legion::Runtime *runtime);
 
+    static void pullCrnrMassTask(
+            const Legion::Task *task,
+            const std::vector<Legion::PhysicalRegion> &regions,
+            Legion::Context ctx,
+            Legion::Runtime *runtime);
+
+    static void pullCrnrForceTask(
+            const Legion::Task *task,
+            const std::vector<Legion::PhysicalRegion> &regions,
+            Legion::Context ctx,
+            Legion::Runtime *runtime);
+
+    static void initInvariantsTask(
+            const Legion::Task *task,
+            const std::vector<Legion::PhysicalRegion> &regions,
+            Legion::Context ctx,
+            Legion::Runtime *runtime);
+
+    static PieceActivity calcActivityTask(
+            const Legion::Task *task,
+            const std::vector<Legion::PhysicalRegion> &regions,
+            Legion::Context ctx,
+            Legion::Runtime *runtime);
+
+    static void markPointOwnersTask(
+            const Legion::Task *task,
+            const std::vector<Legion::PhysicalRegion> &regions,
+            Legion::Context ctx,
+            Legion::Runtime *runtime);
+
+    static PieceNeighbors calcPieceNbrsTask(
+            const Legion::Task *task,
+            const std::vector<Legion::PhysicalRegion> &regions,
+            Legion::Context ctx,
+            Legion::Runtime *runtime);
+
     // OpenMP variants
 
     static void calcWorkOMPTask(
@@ -26,18 +26,6 @@ using namespace Legion;
 
 namespace {  // unnamed
 static void __attribute__ ((constructor)) registerTasks() {
-  {
-    TaskVariantRegistrar registrar(TID_APPLYFIXEDBC, "CPU applyfixedbc");
-    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
-    registrar.set_leaf();
-    Runtime::preregister_task_variant<HydroBC::applyFixedBCTask>(registrar, "applyfixedbc");
-  }
-  {
-    TaskVariantRegistrar registrar(TID_APPLYFIXEDBC, "OMP applyfixedbc");
-    registrar.add_constraint(ProcessorConstraint(Processor::OMP_PROC));
-    registrar.set_leaf();
-    Runtime::preregister_task_variant<HydroBC::applyFixedBCOMPTask>(registrar, "applyfixedbc");
-  }
   {
     TaskVariantRegistrar registrar(TID_COUNTBCPOINTS, "CPU count BC points");
     registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
@@ -62,10 +50,9 @@ static void __attribute__ ((constructor)) registerTasks() {
 
 HydroBC::HydroBC(
         Mesh* msh,
-        const double2 v,
-        const double bound,
-        const bool xplane)
-  : mesh(msh), vfix(v) {
+        const vector<double>& bcx,
+        const vector<double>& bcy)
+  : mesh(msh) {
   Context ctx = mesh->ctx;
   Runtime* runtime = mesh->runtime;
   IndexSpace is_piece = mesh->ispc;
@@ -73,7 +60,7 @@ HydroBC::HydroBC(
   LogicalRegion lrp = mesh->lrp;
   LogicalPartition lppprv = mesh->lppprv;
   LogicalPartition lppmstr = mesh->lppmstr;
-  // First compute how many points we have in this boundary condition 
+  // First compute how many points are on any of the planes
   FieldSpace fsc = runtime->create_field_space(ctx); 
   {
     FieldAllocator fac = runtime->create_field_allocator(ctx, fsc); 
@@ -82,12 +69,19 @@ HydroBC::HydroBC(
   }
   LogicalRegion lrc = runtime->create_logical_region(ctx, is_piece, fsc);
   LogicalPartition lpc = runtime->get_logical_partition(lrc, ip_piece);
+  coord_t numb;                   // number of bdy points
   const double eps = 1.e-12;
+  vector<double> planes;
+  planes.push_back(eps);
+  planes.push_back(bcx.size());
+  planes.push_back(bcy.size());
+  planes.insert(planes.end(), bcx.begin(), bcx.end());
+  planes.insert(planes.end(), bcy.begin(), bcy.end());
+  const TaskArgument args(&planes[0], planes.size() * sizeof(double));
   // Count how many boundary points are in each piece
   {
-    const CountBCArgs args(bound, eps, xplane);
     IndexTaskLauncher launcher(TID_COUNTBCPOINTS, is_piece,
-          TaskArgument(&args, sizeof(args)), ArgumentMap());
+          args, ArgumentMap());
     launcher.add_region_requirement(
         RegionRequirement(lppprv, 0/*identity*/, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrp));
     launcher.add_field(0/*index*/, FID_PX);
@@ -118,6 +112,7 @@ HydroBC::HydroBC(
     FieldAllocator fab = runtime->create_field_allocator(ctx, fsb);
     fab.allocate_field(sizeof(Pointer), FID_MAPBP);
     fab.allocate_field(sizeof(int), FID_MAPBPREG);
+    fab.allocate_field(sizeof(int), FID_MAPBPMASK);
   }
   lrb = runtime->create_logical_region(ctx, isb, fsb);
   IndexPartition ipb = 
@@ -126,9 +121,8 @@ HydroBC::HydroBC(
   lpb = runtime->get_logical_partition(lrb, ipb);
   // Then fill in the mapping to points and their location
   {
-    const CountBCArgs args(bound, eps, xplane);
     IndexTaskLauncher launcher(TID_CREATEBCMAPS, is_piece,
-        TaskArgument(&args, sizeof(args)), ArgumentMap());
+        args, ArgumentMap());
     launcher.add_region_requirement(
         RegionRequirement(lppprv, 0/*identity*/, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrp));
     launcher.add_field(0/*index*/, FID_PX);
@@ -139,83 +133,40 @@ HydroBC::HydroBC(
         RegionRequirement(lpb, 0/*identity*/, LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, lrb));
     launcher.add_field(2/*index*/, FID_MAPBP);
     launcher.add_field(2/*index*/, FID_MAPBPREG);
+    launcher.add_field(2/*index*/, FID_MAPBPMASK);
     runtime->execute_index_space(ctx, launcher);
   }
+  // The counts were only needed to size and partition lrb
+  runtime->destroy_logical_region(ctx, lrc);
+  runtime->destroy_field_space(ctx, fsc);
 }
 
 
-HydroBC::~HydroBC() {}
-
-
-void HydroBC::applyFixedBCTask(
-        const Task *task,
-        const std::vector<PhysicalRegion> &regions,
-        Context ctx,
-        Runtime *runtime) {
-    const double2* args = (const double2*) task->args;
-    const double2 vfix = args[0];
-    const AccessorRO<Pointer> acc_mapbp(regions[0], FID_MAPBP);
-    const AccessorRO<int> acc_mapbpreg(regions[0], FID_MAPBPREG);
-    const AccessorRW<double2> acc_pf[2] = {
-        AccessorRW<double2>(regions[1], FID_PF),
-        AccessorRW<double2>(regions[2], FID_PF)
-    };
-    const AccessorRW<double2> acc_pu[2] = {
-        AccessorRW<double2>(regions[1], FID_PU0),
-        AccessorRW<double2>(regions[2], FID_PU0)
-    };
-
-    const IndexSpace& isb = task->regions[0].region.get_index_space();
-   
-    for (PointIterator itb(runtime, isb); itb(); itb++)
-    {
-        const Pointer p = acc_mapbp[*itb];
-        const int preg = acc_mapbpreg[*itb];
-        double2 pu = acc_pu[preg][p];
-        double2 pf = acc_pf[preg][p];
-        pu = project(pu, vfix);
-        pf = project(pf, vfix);
-        acc_pu[preg][p] = pu;
-        acc_pf[preg][p] = pf;
-    }
-
+HydroBC::~HydroBC() {
+  Context ctx = mesh->ctx;
+  Runtime* runtime = mesh->runtime;
+  const IndexSpace isb = lrb.get_index_space();
+  const FieldSpace fsb = lrb.get_field_space();
+  runtime->destroy_logical_region(ctx, lrb);
+  runtime->destroy_field_space(ctx, fsb);
+  runtime->destroy_index_space(ctx, isb);
 }
 
 
-void HydroBC::applyFixedBCOMPTask(
-        const Task *task,
-        const std::vector<PhysicalRegion> &regions,
-        Context ctx,
-        Runtime *runtime) {
-    const double2* args = (const double2*) task->args;
-    const double2 vfix = args[0];
-    const AccessorRO<Pointer> acc_mapbp(regions[0], FID_MAPBP);
-    const AccessorRO<int> acc_mapbpreg(regions[0], FID_MAPBPREG);
-    const AccessorRW<double2> acc_pf[2] = {
-        AccessorRW<double2>(regions[1], FID_PF),
-        AccessorRW<double2>(regions[2], FID_PF)
-    };
-    const AccessorRW<double2> acc_pu[2] = {
-        AccessorRW<double2>(regions[1], FID_PU0),
-        AccessorRW<double2>(regions[2], FID_PU0)
-    };
-
-    const IndexSpace& isb = task->regions[0].region.get_index_space();
-    // This will fail if it is not dense
-    const Rect<1> rectb = runtime->get_index_space_domain(isb);
-    #pragma omp parallel for
-    for (coord_t b = rectb.lo[0]; b <= rectb.hi[0]; b++)
-    {
-        const Pointer p = acc_mapbp[b];
-        const int preg = acc_mapbpreg[b];
-        double2 pu = acc_pu[preg][p];
-        double2 pf = acc_pf[preg][p];
-        pu = project(pu, vfix);
-        pf = project(pf, vfix);
-        acc_pu[preg][p] = pu;
-        acc_pf[preg][p] = pf;
-    }
-
+int HydroBC::calcMask(const double2& px, const double* planes) {
+    const double eps = planes[0];
+    const int nx = int(planes[1]);
+    const int ny = int(planes[2]);
+    const double* bx = planes + 3;
+    const double* by = bx + nx;
+    int mask = 0;
+    for (int i = 0; i < nx; ++i)
+        if (fabs(px.x - bx[i]) < eps)
+            mask |= BC_FIXX;
+    for (int i = 0; i < ny; ++i)
+        if (fabs(px.y - by[i]) < eps)
+            mask |= BC_FIXY;
+    return mask;
 }
 
 
@@ -224,7 +175,7 @@ void HydroBC::countBCPointsTask(
         const std::vector<PhysicalRegion> &regions,
         Context ctx,
         Runtime *runtime) {
-    const CountBCArgs *args = reinterpret_cast<const CountBCArgs*>(task->args);
+    const double* planes = (const double*) task->args;
     const AccessorRO<double2> acc_priv(regions[0], FID_PX);
     const AccessorRO<double2> acc_mstr(regions[1], FID_PX);
     const AccessorWD<coord_t> acc_cnt(regions[2], FID_COUNT);
@@ -233,21 +184,12 @@ void HydroBC::countBCPointsTask(
     IndexSpace is_mstr = task->regions[1].region.get_index_space();
 
     coord_t count = 0;
-    if (args->xplane) {
-      for (PointIterator itr(runtime, is_priv); itr(); itr++)
-        if (fabs(acc_priv[*itr].x - args->bound) < args->eps)
-          count++;
-      for (PointIterator itr(runtime, is_mstr); itr(); itr++)
-        if (fabs(acc_mstr[*itr].x - args->bound) < args->eps)
-          count++;
-    } else {
-      for (PointIterator itr(runtime, is_priv); itr(); itr++)
-        if (fabs(acc_priv[*itr].y - args->bound) < args->eps)
-          count++;
-      for (PointIterator itr(runtime, is_mstr); itr(); itr++)
-        if (fabs(acc_mstr[*itr].y - args->bound) < args->eps)
-          count++;
-    }
+    for (PointIterator itr(runtime, is_priv); itr(); itr++)
+      if (calcMask(acc_priv[*itr], planes) != 0)
+        count++;
+    for (PointIterator itr(runtime, is_mstr); itr(); itr++)
+      if (calcMask(acc_mstr[*itr], planes) != 0)
+        count++;
     acc_cnt[task->index_point] = count;
 }
 
@@ -277,51 +219,37 @@ void HydroBC::createBCMapsTask(
         const std::vector<PhysicalRegion> &regions,
         Context ctx,
         Runtime *runtime) {
-    const CountBCArgs *args = reinterpret_cast<const CountBCArgs*>(task->args);
+    const double* planes = (const double*) task->args;
     const AccessorRO<double2> acc_priv(regions[0], FID_PX);
     const AccessorRO<double2> acc_mstr(regions[1], FID_PX);
     const AccessorWD<Pointer> acc_ptr(regions[2], FID_MAPBP);
     const AccessorWD<int>     acc_reg(regions[2], FID_MAPBPREG);
+    const AccessorWD<int>     acc_mask(regions[2], FID_MAPBPMASK);
 
     IndexSpace is_priv = task->regions[0].region.get_index_space();
     IndexSpace is_mstr = task->regions[1].region.get_index_space();
     IndexSpace is_out  = task->regions[2].region.get_index_space();
 
     PointIterator out_itr(runtime, is_out);
-    if (args->xplane) {
-      for (PointIterator itr(runtime, is_priv); itr(); itr++)
-        if (fabs(acc_priv[*itr].x - args->bound) < args->eps)
-        {
-          assert(out_itr());
-          acc_ptr[*out_itr] = *itr;
-          acc_reg[*out_itr] = 0;
-          out_itr++;
-        }
-      for (PointIterator itr(runtime, is_mstr); itr(); itr++)
-        if (fabs(acc_mstr[*itr].x - args->bound) < args->eps)
-        {
-          assert(out_itr());
-          acc_ptr[*out_itr] = *itr;
-          acc_reg[*out_itr] = 1;
-          out_itr++;
-        }
-    } else {
-      for (PointIterator itr(runtime, is_priv); itr(); itr++)
-        if (fabs(acc_priv[*itr].y - args->bound) < args->eps)
-        {
-          assert(out_itr());
-          acc_ptr[*out_itr] = *itr;
-          acc_reg[*out_itr] = 0;
-          out_itr++;
-        }
-      for (PointIterator itr(runtime, is_mstr); itr(); itr++)
-        if (fabs(acc_mstr[*itr].y - args->bound) < args->eps)
-        {
-          assert(out_itr());
-          acc_ptr[*out_itr] = *itr;
-          acc_reg[*out_itr] = 1;
-          out_itr++;
-        }
+    for (PointIterator itr(runtime, is_priv); itr(); itr++)
+    {
+      const int mask = calcMask(acc_priv[*itr], planes);
+      if (mask == 0) continue;
+      assert(out_itr());
+      acc_ptr[*out_itr] = *itr;
+      acc_reg[*out_itr] = 0;
+      acc_mask[*out_itr] = mask;
+      out_itr++;
+    }
+    for (PointIterator itr(runtime, is_mstr); itr(); itr++)
+    {
+      const int mask = calcMask(acc_mstr[*itr], planes);
+      if (mask == 0) continue;
+      assert(out_itr());
+      acc_ptr[*out_itr] = *itr;
+      acc_reg[*out_itr] = 1;
+      acc_mask[*out_itr] = mask;
+      out_itr++;
     }
 }
 
@@ -24,68 +24,57 @@ class Mesh;
 
 enum HydroBCFieldID {
     FID_MAPBP = 'B' * 100,
-    FID_MAPBPREG
+    FID_MAPBPREG,
+    FID_MAPBPMASK
 };
 
 enum HydroBCTaskID {
-    TID_APPLYFIXEDBC = 'B' * 100,
-    TID_COUNTBCPOINTS,
+    TID_COUNTBCPOINTS = 'B' * 100,
     TID_COUNTBCRANGES,
     TID_CREATEBCMAPS
 };
 
+// The velocity and force components a boundary point has fixed at 0,
+// one bit for each direction any of its planes is perpendicular to
+enum HydroBCMask {
+    BC_FIXX = 1,                   // on an x plane
+    BC_FIXY = 2                    // on a y plane
+};
+
 
+// All the fixed planes together, as one list of the points on any of
+// them with a mask of what each one fixes.  calcAccel applies them to
+// the points of the part it is computing, so a point on two planes
+// is only visited once and there is no launch of its own for them.
 class HydroBC {
-public:
-    struct CountBCArgs {
-    public:
-        CountBCArgs(double b, double e, bool x)
-          : bound(b), eps(e), xplane(x) { }
-    public:
-        double bound, eps;
-        bool xplane;
-    };
 public:
 
     // associated mesh object
     Mesh* mesh;
 
-    int numb;                      // number of bdy points
-    double2 vfix;                  // vector perp. to fixed plane
-    int* mapbp;                    // map: bdy point -> point
-    std::vector<int> pchbfirst;    // start/stop index for bdy pt chunks
-    std::vector<int> pchblast;
-
     Legion::LogicalRegion lrb;
     Legion::LogicalPartition lpb;
 
     HydroBC(
             Mesh* msh,
-            const double2 v,
-            const double bound, 
-            const bool xplane);
+            const std::vector<double>& bcx,
+            const std::vector<double>& bcy);
 
+    // destroys lrb along with its index and field spaces
     ~HydroBC();
 
-    static void applyFixedBCTask(
-            const Legion::Task *task,
-            const std::vector<Legion::PhysicalRegion> &regions,
-            Legion::Context ctx,
-            Legion::Runtime *runtime);
-    
-    // OpenMP variant
-    static void applyFixedBCOMPTask(
-            const Legion::Task *task,
-            const std::vector<Legion::PhysicalRegion> &regions,
-            Legion::Context ctx,
-            Legion::Runtime *runtime);
-
-    // GPU variant
-    static void applyFixedBCGPUTask(
-            const Legion::Task *task,
-            const std::vector<Legion::PhysicalRegion> &regions,
-            Legion::Context ctx,
-            Legion::Runtime *runtime);
+    // the components of v left after the ones in mask are fixed
+    __CUDA_HD__
+    static inline double2 applyMask(const double2& v, const int mask)
+    {
+        return make_double2((mask & BC_FIXX) ? 0. : v.x,
+                            (mask & BC_FIXY) ? 0. : v.y);
+    }
+
+    // the mask for a point at px, given the planes in the form the
+    // tasks below get them: eps, number of x planes, number of y
+    // planes, then the x values and the y values
+    static int calcMask(const double2& px, const double* planes);
 
     static void countBCPointsTask(
             const Legion::Task *task,
@@ -102,3 +102,10 @@ vector<double> InputFile::getDoubleList(
     while (iss >> val) vallist.push_back(val);
     return vallist;
 }
+
+
+void InputFile::setDefault(const string& key, const string& val) {
+    if (pairs.find(key) == pairs.end())
+        pairs[key] = val;
+}
+
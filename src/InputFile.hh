@@ -29,6 +29,8 @@ public:
     std::vector<double> getDoubleList(
             const std::string& key,
             const std::vector<double>& dflt) const;
+    // add a value for key only if the file didn't already have one
+    void setDefault(const std::string& key, const std::string& val);
 
 private:
     typedef std::map<std::string, std::string> pairstype;
@@ -24,6 +24,7 @@
 #include "Memory.hh"
 #include "InputFile.hh"
 #include "GenMesh.hh"
+#include "Partitioner.hh"
 #include "WriteXY.hh"
 #include "ExportGold.hh"
 #include "PennantMapper.hh"
@@ -143,6 +144,30 @@ static void __attribute__ ((constructor)) registerTasks() {
       registrar.set_leaf();
       Runtime::preregister_task_variant<Mesh::writeTask>(registrar, "write out");
     }
+    {
+      TaskVariantRegistrar registrar(TID_CALCGHOSTRANGES, "CPU calc ghost ranges");
+      registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+      registrar.set_leaf();
+      Runtime::preregister_task_variant<coord_t, Mesh::calcGhostRangesTask>(registrar, "calc ghost ranges");
+    }
+    {
+      TaskVariantRegistrar registrar(TID_INITGHOSTS, "CPU init ghosts");
+      registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+      registrar.set_leaf();
+      Runtime::preregister_task_variant<Mesh::initGhostsTask>(registrar, "init ghosts");
+    }
+    {
+      TaskVariantRegistrar registrar(TID_CALCZONESIDES, "CPU calc zone sides");
+      registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+      registrar.set_leaf();
+      Runtime::preregister_task_variant<Mesh::calcZoneSidesTask>(registrar, "calc zone sides");
+    }
+    {
+      TaskVariantRegistrar registrar(TID_CALCSIDECOLORS, "CPU calc side colors");
+      registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+      registrar.set_leaf();
+      Runtime::preregister_task_variant<Mesh::calcSideColorsTask>(registrar, "calc side colors");
+    }
 
     Runtime::register_reduction_op<SumOp<int> >(
             OPID_SUMINT);
@@ -213,9 +238,11 @@ Mesh::Mesh(
         const int numpcsa,
         Context ctxa,
         Runtime* runtimea)
-        : gmesh(NULL), numpcs(numpcsa), ctx(ctxa), runtime(runtimea) {
+        : gmesh(NULL), partitioner(NULL), numpcs(numpcsa), ctx(ctxa), runtime(runtimea) {
 
     chunksize = inp->getInt("chunksize", 0);
+    keeppieces = (inp->getInt("rebalancecycles", 0) > 0);
+    memreport = (inp->getInt("memreport", 0) != 0);
     subregion = inp->getDoubleList("subregion", vector<double>());
     if (subregion.size() != 0 && subregion.size() != 4) {
         cerr << "Error:  subregion must have 4 entries" << endl;
@@ -223,6 +250,7 @@ Mesh::Mesh(
     }
 
     gmesh = new GenMesh(inp);
+    partitioner = new Partitioner(inp);
 
     // Call this to populate the numpcx and numpcy fields
     gmesh->calcNumPieces(numpcs);
@@ -243,6 +271,7 @@ Mesh::Mesh(
 
 Mesh::~Mesh() {
     delete gmesh;
+    delete partitioner;
 }
 
 
@@ -283,15 +312,7 @@ void Mesh::init() {
       runtime->attach_name(fsp, FID_MAPLOAD2DENSE, "MAPLOAD2DENSE");
     }
 
-    // load fields into temp points with equal partition
-    LogicalRegion lr_temp_points = runtime->create_logical_region(ctx, isp, fsp);
-    IndexPartition ip_points_equal = runtime->create_equal_partition(ctx, isp, is_piece);
-    LogicalPartition lp_points_equal = 
-      runtime->get_logical_partition(lr_temp_points, ip_points_equal);
-    gmesh->generatePointsParallel(numpcs, runtime, ctx, 
-                                  lr_temp_points, lp_points_equal, is_piece); 
-
-    // equal partition zones
+    // Create zone index space and field space
     numz = gmesh->calcNumZones(numpcs);
     IndexSpace isz = runtime->create_index_space(ctx, Rect<1>(0, numz-1));
     FieldSpace fsz = runtime->create_field_space(ctx);
@@ -299,6 +320,8 @@ void Mesh::init() {
       FieldAllocator faz = runtime->create_field_allocator(ctx, fsz);
       faz.allocate_field(sizeof(int), FID_ZNUMP);
       runtime->attach_name(fsz, FID_ZNUMP, "ZNUMP");
+      faz.allocate_field(sizeof(Pointer), FID_MAPZS1);
+      runtime->attach_name(fsz, FID_MAPZS1, "MAPZS1");
       faz.allocate_field(sizeof(double2), FID_ZX);
       runtime->attach_name(fsz, FID_ZX, "ZX");
       faz.allocate_field(sizeof(double2), FID_ZXP);
@@ -325,8 +348,10 @@ void Mesh::init() {
       runtime->attach_name(fsz, FID_ZE, "ZE");
       faz.allocate_field(sizeof(double), FID_ZETOT);
       runtime->attach_name(fsz, FID_ZETOT, "ZETOT");
+#ifndef ALIAS_SCRATCH_FIELDS
       faz.allocate_field(sizeof(double), FID_ZW);
       runtime->attach_name(fsz, FID_ZW, "ZW");
+#endif
       faz.allocate_field(sizeof(double), FID_ZWRATE);
       runtime->attach_name(fsz, FID_ZWRATE, "ZWRATE");
       faz.allocate_field(sizeof(double), FID_ZP);
@@ -335,21 +360,14 @@ void Mesh::init() {
       runtime->attach_name(fsz, FID_ZSS, "ZSS");
       faz.allocate_field(sizeof(double), FID_ZDU);
       runtime->attach_name(fsz, FID_ZDU, "ZDU");
+#if !defined(ALIAS_SCRATCH_FIELDS) && !defined(FUSED_QCS)
       faz.allocate_field(sizeof(double2), FID_ZUC);
       runtime->attach_name(fsz, FID_ZUC, "ZUC");
-      faz.allocate_field(sizeof(double), FID_ZTMP);
-      runtime->attach_name(fsz, FID_ZTMP, "ZTMP");
+#endif
       faz.allocate_field(sizeof(Pointer), FID_PIECE);
       runtime->attach_name(fsz, FID_PIECE, "PIECE");
     }
-    lrz = runtime->create_logical_region(ctx, isz, fsz);
-    runtime->attach_name(lrz, "lrz");
-    IndexPartition zones_equal = runtime->create_equal_partition(ctx, isz, is_piece);
-    // fill in the number of sides for each zone
-    gmesh->generateZonesParallel(numpcs, runtime, ctx, lrz, 
-        runtime->get_logical_partition(ctx, lrz, zones_equal), is_piece);
-
-    // Create sides logical region
+    // Create side index space and field space
     nums = gmesh->calcNumSides(numpcs);
     numc = nums;
     IndexSpace iss = runtime->create_index_space(ctx, Rect<1>(0, nums-1));
@@ -378,80 +396,198 @@ void Mesh::init() {
       runtime->attach_name(fss, FID_MAPSP1REG, "MAPSP1REG");
       fas.allocate_field(sizeof(int), FID_MAPSP2REG);
       runtime->attach_name(fss, FID_MAPSP2REG, "MAPSP2REG");
+      fas.allocate_field(sizeof(int), FID_MAPSP1NODE);
+      runtime->attach_name(fss, FID_MAPSP1NODE, "MAPSP1NODE");
+#ifdef PULL_GHOST_POINTS
+      fas.allocate_field(sizeof(Pointer), FID_MAPSP1GHOST);
+      runtime->attach_name(fss, FID_MAPSP1GHOST, "MAPSP1GHOST");
+#endif
+#ifdef COLOR_SIDE_SCATTERS
+      fas.allocate_field(sizeof(Pointer), FID_COLORSIDE);
+      runtime->attach_name(fss, FID_COLORSIDE, "COLORSIDE");
+      fas.allocate_field(sizeof(int), FID_SIDECOLOR);
+      runtime->attach_name(fss, FID_SIDECOLOR, "SIDECOLOR");
+#endif
+#if !defined(ALIAS_SCRATCH_FIELDS) && !defined(RECOMPUTE_EDGE_GEOMETRY)
       fas.allocate_field(sizeof(double2), FID_EX);
       runtime->attach_name(fss, FID_EX, "EX");
+#endif
+#ifndef RECOMPUTE_EDGE_GEOMETRY
       fas.allocate_field(sizeof(double2), FID_EXP);
       runtime->attach_name(fss, FID_EXP, "EXP");
+#endif
+#ifndef ALIAS_SCRATCH_FIELDS
       fas.allocate_field(sizeof(double), FID_SAREA);
       runtime->attach_name(fss, FID_SAREA, "SAREA");
       fas.allocate_field(sizeof(double), FID_SVOL);
       runtime->attach_name(fss, FID_SVOL, "SVOL");
+#endif
+#ifndef RECOMPUTE_EDGE_GEOMETRY
       fas.allocate_field(sizeof(double), FID_SAREAP);
       runtime->attach_name(fss, FID_SAREAP, "SAREAP");
+#endif
       fas.allocate_field(sizeof(double), FID_SVOLP);
       runtime->attach_name(fss, FID_SVOLP, "SVOLP");
+#ifndef RECOMPUTE_EDGE_GEOMETRY
       fas.allocate_field(sizeof(double2), FID_SSURFP);
       runtime->attach_name(fss, FID_SSURFP, "SSURFP");
       fas.allocate_field(sizeof(double), FID_ELEN);
       runtime->attach_name(fss, FID_ELEN, "ELEN");
+#endif
       fas.allocate_field(sizeof(double), FID_SMF);
       runtime->attach_name(fss, FID_SMF, "SMF");
-      fas.allocate_field(sizeof(double2), FID_SFP);
+      fas.allocate_field(sizeof(TempReal2), FID_SFP);
       runtime->attach_name(fss, FID_SFP, "SFP");
-      fas.allocate_field(sizeof(double2), FID_SFQ);
+      fas.allocate_field(sizeof(TempReal2), FID_SFQ);
       runtime->attach_name(fss, FID_SFQ, "SFQ");
-      fas.allocate_field(sizeof(double2), FID_SFT);
+      fas.allocate_field(sizeof(TempReal2), FID_SFT);
       runtime->attach_name(fss, FID_SFT, "SFT");
-      fas.allocate_field(sizeof(double), FID_CAREA);
-      runtime->attach_name(fss, FID_CAREA, "CAREA");
-      fas.allocate_field(sizeof(double), FID_CEVOL);
+#ifndef FUSED_QCS
+      fas.allocate_field(sizeof(TempReal), FID_CEVOL);
       runtime->attach_name(fss, FID_CEVOL, "CEVOL");
-      fas.allocate_field(sizeof(double), FID_CDU);
+      fas.allocate_field(sizeof(TempReal), FID_CDU);
       runtime->attach_name(fss, FID_CDU, "CDU");
-      fas.allocate_field(sizeof(double), FID_CDIV);
+      fas.allocate_field(sizeof(TempReal), FID_CDIV);
       runtime->attach_name(fss, FID_CDIV, "CDIV");
-      fas.allocate_field(sizeof(double), FID_CCOS);
+      fas.allocate_field(sizeof(double), FID_CRMU);
+      runtime->attach_name(fss, FID_CRMU, "CRMU");
+#endif
+#if !defined(ALIAS_SCRATCH_FIELDS) && !defined(FUSED_QCS)
+      fas.allocate_field(sizeof(TempReal), FID_CAREA);
+      runtime->attach_name(fss, FID_CAREA, "CAREA");
+      fas.allocate_field(sizeof(TempReal), FID_CCOS);
       runtime->attach_name(fss, FID_CCOS, "CCOS");
-      fas.allocate_field(sizeof(double2), FID_CQE1);
+      fas.allocate_field(sizeof(TempReal2), FID_CQE1);
       runtime->attach_name(fss, FID_CQE1, "CQE1");
-      fas.allocate_field(sizeof(double2), FID_CQE2);
+      fas.allocate_field(sizeof(TempReal2), FID_CQE2);
       runtime->attach_name(fss, FID_CQE2, "CQE2");
-      fas.allocate_field(sizeof(double), FID_CRMU);
-      runtime->attach_name(fss, FID_CRMU, "CRMU");
       fas.allocate_field(sizeof(double), FID_CW);
       runtime->attach_name(fss, FID_CW, "CW");
+#endif
     }
+    // Stop now if the mesh can't fit rather than after all the setup
+    checkMemory(fsp, fsz, fss);
+
+    // load fields into temp points with equal partition
+    LogicalRegion lr_temp_points = runtime->create_logical_region(ctx, isp, fsp);
+    IndexPartition ip_points_equal = runtime->create_equal_partition(ctx, isp, is_piece);
+    LogicalPartition lp_points_equal = 
+      runtime->get_logical_partition(lr_temp_points, ip_points_equal);
+    gmesh->generatePointsParallel(numpcs, runtime, ctx, 
+                                  lr_temp_points, lp_points_equal, is_piece); 
+
+    // equal partition zones
+    lrz = runtime->create_logical_region(ctx, isz, fsz);
+    runtime->attach_name(lrz, "lrz");
+#ifdef CACHE_INVARIANTS
+    FieldSpace fszc = runtime->create_field_space(ctx);
+    {
+      FieldAllocator fazc = runtime->create_field_allocator(ctx, fszc);
+      fazc.allocate_field(sizeof(double), FID_ZNUMPINV);
+      runtime->attach_name(fszc, FID_ZNUMPINV, "ZNUMPINV");
+      fazc.allocate_field(sizeof(double), FID_ZMINV);
+      runtime->attach_name(fszc, FID_ZMINV, "ZMINV");
+    }
+    lrzc = runtime->create_logical_region(ctx, isz, fszc);
+    runtime->attach_name(lrzc, "lrzc");
+#endif
+    IndexPartition zones_equal = runtime->create_equal_partition(ctx, isz, is_piece);
+    // fill in the number of sides for each zone
+    gmesh->generateZonesParallel(numpcs, runtime, ctx, lrz, 
+        runtime->get_logical_partition(ctx, lrz, zones_equal), is_piece);
+
+    // Create sides logical region
     lrs = runtime->create_logical_region(ctx, iss, fss);
     runtime->attach_name(lrs, "lrs");
     IndexPartition equal_sides = runtime->create_equal_partition(ctx, iss, is_piece);
     // construct temp side maps with equal partition (iterate over zones and find sides)
     gmesh->generateSidesParallel(numpcs, runtime, ctx, lrs, 
         runtime->get_logical_partition(lrs, equal_sides), is_piece);
+#ifndef PRECOMPACTED_RECT_POINTS
+    // repartition the zones if we aren't using the generated block pieces
+    partitioner->partitionZones(gmesh->numpcx, gmesh->numpcy, runtime, ctx,
+        lrz, lrs, lr_temp_points);
+#endif
+
+#ifdef PRECOMPACTED_RECT_POINTS
+    initPieces(lr_temp_points, lp_points_equal, false/*compact*/);
+#else
+    initPieces(lr_temp_points, lp_points_equal, true/*compact*/);
+#endif
+
+    // Calculate centers, volumes, and side fractions
+    calcCtrsParallel(runtime, ctx, lrs, lps, lrz, lpz, lrp, lppprv, lppshr, is_piece);
+    Future numsbad = 
+      calcVolsParallel(runtime, ctx, lrs, lps, lrz, lpz, lrp, lppprv, lppshr, is_piece);
+    checkBadSides(-1/*init cycle*/, numsbad, Predicate::TRUE_PRED);
+    calcSideFracsParallel(runtime, ctx, lrs, lps, lrz, lpz, is_piece);
+
+    // create index spaces and fields for global vars
+    IndexSpace isglb = runtime->create_index_space(ctx, Rect<1>(Point<1>(0),Point<1>(0)));
+    FieldSpace fsglb = runtime->create_field_space(ctx);
+    {
+      FieldAllocator faglb = runtime->create_field_allocator(ctx, fsglb);
+      faglb.allocate_field(sizeof(int), FID_NUMSBAD);
+      faglb.allocate_field(sizeof(double), FID_DTREC);
+    }
+    lrglb = runtime->create_logical_region(ctx, isglb, fsglb);
+    runtime->attach_name(lrglb, "lrglb");
+    {
+      FillLauncher fill(lrglb, lrglb, numsbad);
+      fill.add_field(FID_NUMSBAD);
+      runtime->fill_fields(ctx, fill);
+    }
+
+    // Delete our temporary regions
+    setupbytes = 0;
+#ifndef PRECOMPACTED_RECT_POINTS
+    setupbytes += calcRegionBytes(lr_temp_points);
+    runtime->destroy_logical_region(ctx, lr_temp_points);
+#endif
+    releaseSetupFields();
+
+    // Ignore chunking for now
+
+    writeStats();
+}
+
+
+void Mesh::initPieces(
+        LogicalRegion lr_temp_points,
+        LogicalPartition lp_points_equal,
+        const bool compact) {
+    const IndexSpace is_piece = ispc;
+    const IndexPartition ip_piece = ippc;
+    const IndexSpace isp = lr_temp_points.get_index_space();
+    const FieldSpace fsp = lr_temp_points.get_field_space();
 
     // Get the proper zone and side partitions for our pieces
     IndexPartition zone_pieces = 
       runtime->create_partition_by_field(ctx, lrz, lrz, FID_PIECE, is_piece);
     lpz = runtime->get_logical_partition(lrz, zone_pieces);
+    runtime->attach_name(lpz, "lpz");
+#ifdef CACHE_INVARIANTS
+    lpzc = runtime->get_logical_partition(lrzc, zone_pieces);
+    runtime->attach_name(lpzc, "lpzc");
+#endif
     IndexPartition side_pieces = 
       runtime->create_partition_by_preimage(ctx, zone_pieces, lrs, lrs, FID_MAPSZ, is_piece);
     lps = runtime->get_logical_partition(lrs, side_pieces);
+    runtime->attach_name(lps, "lps");
 
     // Now we need to compact our points and generate our point partition tree
-    // First compute our owned points
+    // First find the set of points that we can reach through all our sides
+    IndexPartition ip_reachable_points = runtime->create_partition_by_image(ctx, isp,
+                                    lps, lrs, compact ? FID_MAPSP1TEMP : FID_MAPSP1,
+                                    is_piece);
+    runtime->attach_name(ip_reachable_points, "reachable points");
+
+    // Then compute our owned points
+    partitioner->partitionPoints(numpcs, runtime, ctx, lr_temp_points,
+        runtime->get_logical_partition(lr_temp_points, ip_reachable_points), is_piece);
     IndexPartition ip_owned_points = runtime->create_partition_by_field(ctx, 
                                     lr_temp_points, lr_temp_points, FID_PIECE, is_piece);
     runtime->attach_name(ip_owned_points, "owned points");
-    
-    // Now find the set of points that we can reach from our points through all our sides
-    IndexPartition ip_reachable_points = runtime->create_partition_by_image(ctx, isp,
-                                                  lps, lrs, 
-#ifdef PRECOMPACTED_RECT_POINTS
-                                                  FID_MAPSP1,
-#else
-                                                  FID_MAPSP1TEMP, 
-#endif
-                                                  is_piece);
-    runtime->attach_name(ip_reachable_points, "reachable points");
 
     // Now we can make the temp ghost partition
     IndexPartition ip_temp_ghost_points = runtime->create_partition_by_difference(ctx,
@@ -517,91 +653,91 @@ void Mesh::init() {
         lp_shared_range, lr_shared_range, FID_RANGE, is_piece);
 
     // Now make the actual point logical region, get the partitions, and copy over data
-#ifdef PRECOMPACTED_RECT_POINTS
-    // This is a very special case where we can just using the existing region
-    // without needing to ever copy anything
-    lrp = lr_temp_points;
-    runtime->attach_name(lrp, "lrp");
-    lppprv = runtime->get_logical_partition_by_tree(ip_prv, fsp, lrp.get_tree_id());
-    runtime->attach_name(lppprv, "lppprv");
-    lppmstr = runtime->get_logical_partition_by_tree(ip_mstr, fsp, lrp.get_tree_id());
-    runtime->attach_name(lppmstr, "lppmstr");
-#else
-    lrp = runtime->create_logical_region(ctx, isp, fsp);
-    runtime->attach_name(lrp, "lrp");
+    if (!compact) {
+      // This is a very special case where we can just using the existing region
+      // without needing to ever copy anything
+      if (lrp != lr_temp_points) {
+        lrp = lr_temp_points;
+        runtime->attach_name(lrp, "lrp");
+      }
+    } else {
+      lrp = runtime->create_logical_region(ctx, isp, fsp);
+      runtime->attach_name(lrp, "lrp");
+    }
     lppprv = runtime->get_logical_partition_by_tree(ip_prv, fsp, lrp.get_tree_id());
     runtime->attach_name(lppprv, "lppprv");
     lppmstr = runtime->get_logical_partition_by_tree(ip_mstr, fsp, lrp.get_tree_id());
     runtime->attach_name(lppmstr, "lppmstr");
 
-    // Compact the points
-    compactPointsParallel(numpcs, runtime, ctx, lr_temp_points, 
-        runtime->get_logical_partition_by_tree(ip_temp_private, fsp, 
-          lr_temp_points.get_tree_id()), lrp, lppprv, is_piece);
-    compactPointsParallel(numpcs, runtime, ctx, lr_temp_points,
-        runtime->get_logical_partition_by_tree(ip_temp_master, fsp, 
-          lr_temp_points.get_tree_id()), lrp, lppmstr, is_piece);
-
-    // Update the side pointers to points with a gather copy
-    // Gather copies aren't quite ready yet so we'll do this with
-    // a very simple gather copy task for now, but we will switch
-    // this over to proper gather copies once the runtime supports them
+    if (compact) {
+      // Compact the points
+      compactPointsParallel(numpcs, runtime, ctx, lr_temp_points, 
+          runtime->get_logical_partition_by_tree(ip_temp_private, fsp, 
+            lr_temp_points.get_tree_id()), lrp, lppprv, is_piece);
+      compactPointsParallel(numpcs, runtime, ctx, lr_temp_points,
+          runtime->get_logical_partition_by_tree(ip_temp_master, fsp, 
+            lr_temp_points.get_tree_id()), lrp, lppmstr, is_piece);
+
+      // Update the side pointers to points with a gather copy
+      // Gather copies aren't quite ready yet so we'll do this with
+      // a very simple gather copy task for now, but we will switch
+      // this over to proper gather copies once the runtime supports them
 #ifdef ENABLE_GATHER_COPIES
-    {
-      IndexCopyLauncher update_launcher(is_piece);
-      update_launcher.add_copy_requirements(
-          RegionRequirement(lp_points_equal, 0/*identity projection*/, 
-                            LEGION_READ_ONLY, LEGION_EXCLUSIVE, lr_temp_points),
-          RegionRequirement(lps, 0/*identity projection*/, LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, lrs));
-      update_launcher.add_src_field(0/*index*/, FID_MAPLOAD2DENSE);
-      update_launcher.add_dst_field(0/*index*/, FID_MAPSP1);
-      update_launcher.add_src_indirect_field(FID_MAPSP1TEMP,
-          RegionRequirement(lps, 0/*identity projection*/, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrs)); 
-      update_launcher.possible_src_indirect_out_of_range = false;
-      runtime->issue_copy_operation(ctx, update_launcher);
-    }
-    {
-      IndexCopyLauncher update_launcher(is_piece);
-      update_launcher.add_copy_requirements(
-          RegionRequirement(lp_points_equal, 0/*identity projection*/, 
-                            LEGION_READ_ONLY, LEGION_EXCLUSIVE, lr_temp_points),
-          RegionRequirement(lps, 0/*identity projection*/, LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, lrs));
-      update_launcher.add_src_field(0/*index*/, FID_MAPLOAD2DENSE);
-      update_launcher.add_dst_field(0/*index*/, FID_MAPSP2);
-      update_launcher.add_src_indirect_field(FID_MAPSP2TEMP,
-          RegionRequirement(lps, 0/*identity projection*/, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrs));
-      update_launcher.possible_src_indirect_out_of_range = false;
-      runtime->issue_copy_operation(ctx, update_launcher);
-    }
+      {
+        IndexCopyLauncher update_launcher(is_piece);
+        update_launcher.add_copy_requirements(
+            RegionRequirement(lp_points_equal, 0/*identity projection*/, 
+                              LEGION_READ_ONLY, LEGION_EXCLUSIVE, lr_temp_points),
+            RegionRequirement(lps, 0/*identity projection*/, LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, lrs));
+        update_launcher.add_src_field(0/*index*/, FID_MAPLOAD2DENSE);
+        update_launcher.add_dst_field(0/*index*/, FID_MAPSP1);
+        update_launcher.add_src_indirect_field(FID_MAPSP1TEMP,
+            RegionRequirement(lps, 0/*identity projection*/, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrs)); 
+        update_launcher.possible_src_indirect_out_of_range = false;
+        runtime->issue_copy_operation(ctx, update_launcher);
+      }
+      {
+        IndexCopyLauncher update_launcher(is_piece);
+        update_launcher.add_copy_requirements(
+            RegionRequirement(lp_points_equal, 0/*identity projection*/, 
+                              LEGION_READ_ONLY, LEGION_EXCLUSIVE, lr_temp_points),
+            RegionRequirement(lps, 0/*identity projection*/, LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, lrs));
+        update_launcher.add_src_field(0/*index*/, FID_MAPLOAD2DENSE);
+        update_launcher.add_dst_field(0/*index*/, FID_MAPSP2);
+        update_launcher.add_src_indirect_field(FID_MAPSP2TEMP,
+            RegionRequirement(lps, 0/*identity projection*/, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrs));
+        update_launcher.possible_src_indirect_out_of_range = false;
+        runtime->issue_copy_operation(ctx, update_launcher);
+      }
 #else
-    {
-      TaskLauncher update_launcher(TID_TEMPGATHER, TaskArgument());
-      update_launcher.add_region_requirement(
-          RegionRequirement(lr_temp_points, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lr_temp_points));
-      update_launcher.add_field(0/*index*/, FID_MAPLOAD2DENSE);
-      update_launcher.add_region_requirement(
-          RegionRequirement(lrs, LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, lrs));
-      update_launcher.add_field(1/*index*/, FID_MAPSP1);
-      update_launcher.add_region_requirement(
-          RegionRequirement(lrs, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrs));
-      update_launcher.add_field(2/*index*/, FID_MAPSP1TEMP);
-      runtime->execute_task(ctx, update_launcher);
-    }
-    {
-      TaskLauncher update_launcher(TID_TEMPGATHER, TaskArgument());
-      update_launcher.add_region_requirement(
-          RegionRequirement(lr_temp_points, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lr_temp_points));
-      update_launcher.add_field(0/*index*/, FID_MAPLOAD2DENSE);
-      update_launcher.add_region_requirement(
-          RegionRequirement(lrs, LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, lrs));
-      update_launcher.add_field(1/*index*/, FID_MAPSP2);
-      update_launcher.add_region_requirement(
-          RegionRequirement(lrs, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrs));
-      update_launcher.add_field(2/*index*/, FID_MAPSP2TEMP);
-      runtime->execute_task(ctx, update_launcher);
-    }
-#endif
+      {
+        TaskLauncher update_launcher(TID_TEMPGATHER, TaskArgument());
+        update_launcher.add_region_requirement(
+            RegionRequirement(lr_temp_points, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lr_temp_points));
+        update_launcher.add_field(0/*index*/, FID_MAPLOAD2DENSE);
+        update_launcher.add_region_requirement(
+            RegionRequirement(lrs, LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, lrs));
+        update_launcher.add_field(1/*index*/, FID_MAPSP1);
+        update_launcher.add_region_requirement(
+            RegionRequirement(lrs, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrs));
+        update_launcher.add_field(2/*index*/, FID_MAPSP1TEMP);
+        runtime->execute_task(ctx, update_launcher);
+      }
+      {
+        TaskLauncher update_launcher(TID_TEMPGATHER, TaskArgument());
+        update_launcher.add_region_requirement(
+            RegionRequirement(lr_temp_points, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lr_temp_points));
+        update_launcher.add_field(0/*index*/, FID_MAPLOAD2DENSE);
+        update_launcher.add_region_requirement(
+            RegionRequirement(lrs, LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, lrs));
+        update_launcher.add_field(1/*index*/, FID_MAPSP2);
+        update_launcher.add_region_requirement(
+            RegionRequirement(lrs, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrs));
+        update_launcher.add_field(2/*index*/, FID_MAPSP2TEMP);
+        runtime->execute_task(ctx, update_launcher);
+      }
 #endif
+    }
 
     // Lastly we need to get the shared partition by performing an image
     // through one of the point mappings to get the set of shared points
@@ -612,43 +748,426 @@ void Mesh::init() {
     lppshr = runtime->get_logical_partition_by_tree(ip_shr, fsp, lrp.get_tree_id());
     runtime->attach_name(lppshr, "lppshr");
 
+    // Then split those again at the node level so only the points shared
+    // between nodes need reduction instances, the mappers can sum the rest
+    // straight into the one instance of them on the node
+    IndexPartition ip_nshr, ip_xshr;
+    initNodePoints(is_shr, ip_mstr, ip_shr, ip_nshr, ip_xshr);
+    lppnshr = runtime->get_logical_partition_by_tree(ip_nshr, fsp, lrp.get_tree_id());
+    runtime->attach_name(lppnshr, "lppnshr");
+    lppxshr = runtime->get_logical_partition_by_tree(ip_xshr, fsp, lrp.get_tree_id());
+    runtime->attach_name(lppxshr, "lppxshr");
+
+    // With ENABLE_NODE_INSTANCES the mappers give all the pieces on a node
+    // one instance for each of these, so private, master and ghost points
+    // of pieces on the same node all live in the same instance
+    {
+      std::vector<IndexPartition> point_partitions(5);
+      point_partitions[0] = ip_prv;
+      point_partitions[1] = ip_mstr;
+      point_partitions[2] = ip_shr;
+      point_partitions[3] = ip_nshr;
+      point_partitions[4] = ip_xshr;
+      const std::vector<IndexPartition> zone_partitions(1, zone_pieces);
+      const std::vector<IndexPartition> side_partitions(1, side_pieces);
+      for (std::vector<PennantMapper*>::const_iterator it = 
+            local_mappers.begin(); it != local_mappers.end(); it++) {
+        (*it)->add_node_instance_group(point_partitions);
+        (*it)->add_node_instance_group(zone_partitions);
+        (*it)->add_node_instance_group(side_partitions);
+      }
+    }
+
     // Figure out which points are private and shared for our sides
-    calcOwnershipParallel(runtime, ctx, lrs, lps, ip_prv, ip_shr, is_piece);
+    calcOwnershipParallel(runtime, ctx, lrs, lps, ip_prv, ip_shr, ip_nshr, is_piece);
+    // and where the sides of each zone start, now that they're numbered
+    calcZoneSidesParallel(runtime, ctx, lrs, lps, lrz, lpz, is_piece);
+#ifdef COLOR_SIDE_SCATTERS
+    // and which sides can scatter to their points at the same time
+    calcSideColorsParallel(runtime, ctx, lrs, lps, is_piece);
+#endif
 
-    // Calculate centers, volumes, and side fractions
-    calcCtrsParallel(runtime, ctx, lrs, lps, lrz, lpz, lrp, lppprv, lppshr, is_piece);
-    Future numsbad = 
-      calcVolsParallel(runtime, ctx, lrs, lps, lrz, lpz, lrp, lppprv, lppshr, is_piece);
-    checkBadSides(-1/*init cycle*/, numsbad, Predicate::TRUE_PRED);
-    calcSideFracsParallel(runtime, ctx, lrs, lps, lrz, lpz, is_piece);
+#ifdef PULL_GHOST_POINTS
+    initGhostPoints(is_shr, ip_mstr, ip_shr);
+    {
+      std::vector<IndexPartition> ghost_partitions(2);
+      ghost_partitions[0] = lpgh.get_index_partition();
+      ghost_partitions[1] = lpghown.get_index_partition();
+      for (std::vector<PennantMapper*>::const_iterator it = 
+            local_mappers.begin(); it != local_mappers.end(); it++)
+        (*it)->add_node_instance_group(ghost_partitions);
+    }
+#endif
 
-    // create index spaces and fields for global vars
-    IndexSpace isglb = runtime->create_index_space(ctx, Rect<1>(Point<1>(0),Point<1>(0)));
-    FieldSpace fsglb = runtime->create_field_space(ctx);
+    // Delete the temporary partitions and regions
+    runtime->destroy_index_partition(ctx, ip_reachable_points);
+    runtime->destroy_index_partition(ctx, ip_owned_points);
+    runtime->destroy_index_partition(ctx, ip_temp_ghost_points);
+    runtime->destroy_index_partition(ctx, ip_private_shared);
+    runtime->destroy_logical_region(ctx, lr_all_range);
+    runtime->destroy_logical_region(ctx, lr_private_range);
+    runtime->destroy_logical_region(ctx, lr_shared_range);
+    runtime->destroy_field_space(ctx, fsc);
+}
+
+
+void Mesh::initNodePoints(
+        IndexSpace is_shr,
+        IndexPartition ip_mstr,
+        IndexPartition ip_shr,
+        IndexPartition& ip_nshr,
+        IndexPartition& ip_xshr) {
+    // Group the pieces by the node (shard) they run on, which makes
+    // the first level of the point hierarchy with one super-piece per node
+#ifdef PENNANT_DISABLE_CONTROL_REPLICATION
+    // Without shards we can't tell, so every piece is its own node
+    const size_t numshards = numpcs;
+#else
+    const size_t numshards = runtime->get_num_shards(ctx, true/*I know what I am doing*/);
+    PennantShardingFunctor sharding(gmesh->numpcx, gmesh->numpcy);
+#endif
+    std::vector<std::vector<IndexSpace> > shard_mstr(numshards), shard_shr(numshards);
+    for (coord_t pc = 0; pc < numpcs; ++pc) {
+#ifdef PENNANT_DISABLE_CONTROL_REPLICATION
+      const ShardID shard = pc;
+#else
+      const ShardID shard = sharding.shard(DomainPoint(pc), dompc, numshards);
+#endif
+      shard_mstr[shard].push_back(runtime->get_index_subspace(ip_mstr, DomainPoint(pc)));
+      shard_shr[shard].push_back(runtime->get_index_subspace(ip_shr, DomainPoint(pc)));
+    }
+    // Shards without any pieces don't get a node
+    std::vector<std::vector<IndexSpace> > node_mstr, node_shr;
+    for (size_t shard = 0; shard < numshards; ++shard) {
+      if (shard_mstr[shard].empty())
+        continue;
+      node_mstr.push_back(shard_mstr[shard]);
+      node_shr.push_back(shard_shr[shard]);
+    }
+    const coord_t numnodes = node_mstr.size();
+    IndexSpace is_node = runtime->create_index_space(ctx, Rect<1>(0, numnodes-1));
+    IndexPartition ip_node_mstr = runtime->create_pending_partition(ctx, is_shr, is_node);
+    IndexPartition ip_node_shr = runtime->create_pending_partition(ctx, is_shr, is_node);
+    for (coord_t node = 0; node < numnodes; ++node) {
+      runtime->create_index_space_union(ctx, ip_node_mstr, Point<1>(node), node_mstr[node]);
+      runtime->create_index_space_union(ctx, ip_node_shr, Point<1>(node), node_shr[node]);
+    }
+
+    // Points a node touches but doesn't own are shared with another node
+    IndexPartition ip_node_ghost = runtime->create_partition_by_difference(ctx,
+                                is_shr, ip_node_shr, ip_node_mstr, is_node);
+    IndexSpace is_two = runtime->create_index_space(ctx, Rect<1>(0, 1));
+    IndexPartition ip_node_cross = runtime->create_pending_partition(ctx, is_shr, is_two);
+    IndexSpace is_xshr = runtime->create_index_space_union(ctx,
+        ip_node_cross, Point<1>(1)/*color*/, ip_node_ghost);
+    std::vector<IndexSpace> diff_spaces(1, is_xshr);
+    IndexSpace is_nshr = runtime->create_index_space_difference(ctx,
+        ip_node_cross, Point<1>(0)/*color*/, is_shr, diff_spaces);
+    runtime->attach_name(ip_node_cross, "node-cross shared");
+
+    // Second level, the shared points of each piece on either side
+    ip_nshr = runtime->create_partition_by_intersection(ctx, is_nshr, ip_shr);
+    ip_xshr = runtime->create_partition_by_intersection(ctx, is_xshr, ip_shr);
+
+    runtime->destroy_index_partition(ctx, ip_node_mstr);
+    runtime->destroy_index_partition(ctx, ip_node_shr);
+    runtime->destroy_index_partition(ctx, ip_node_ghost);
+}
+
+
+void Mesh::initGhostPoints(
+        IndexSpace is_shr,
+        IndexPartition ip_mstr,
+        IndexPartition ip_shr) {
+    const IndexSpace is_piece = ispc;
+    const IndexPartition ip_piece = ippc;
+    // The ghost points of a piece are the shared points it doesn't own
+    IndexPartition ip_ghost = runtime->create_partition_by_difference(ctx,
+                                is_shr, ip_shr, ip_mstr, is_piece);
+    // Count them to give each piece one slot for each of its ghost points
+    FieldSpace fsc = runtime->create_field_space(ctx);
     {
-      FieldAllocator faglb = runtime->create_field_allocator(ctx, fsglb);
-      faglb.allocate_field(sizeof(int), FID_NUMSBAD);
-      faglb.allocate_field(sizeof(double), FID_DTREC);
+      FieldAllocator fac = runtime->create_field_allocator(ctx, fsc); 
+      fac.allocate_field(sizeof(coord_t), FID_COUNT);
+      fac.allocate_field(sizeof(Rect<1>), FID_RANGE);
     }
-    lrglb = runtime->create_logical_region(ctx, isglb, fsglb);
-    runtime->attach_name(lrglb, "lrglb");
+    LogicalRegion lrc = runtime->create_logical_region(ctx, is_piece, fsc);
+    LogicalPartition lpc = runtime->get_logical_partition(lrc, ip_piece);
     {
-      FillLauncher fill(lrglb, lrglb, numsbad);
-      fill.add_field(FID_NUMSBAD);
-      runtime->fill_fields(ctx, fill);
+      IndexTaskLauncher launcher(TID_COUNTPOINTS, is_piece,
+          TaskArgument(&ip_ghost, sizeof(ip_ghost)), ArgumentMap());
+      launcher.add_region_requirement(RegionRequirement(lpc,
+            0/*identity projection*/, LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, lrc));
+      launcher.add_field(0/*index*/, FID_COUNT);
+      runtime->execute_index_space(ctx, launcher);
+    }
+    coord_t numghosts;
+    {
+      TaskLauncher launcher(TID_CALCGHOSTRANGES, TaskArgument());
+      launcher.add_region_requirement(
+          RegionRequirement(lrc, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrc));
+      launcher.add_field(0/*index*/, FID_COUNT);
+      launcher.add_region_requirement(
+          RegionRequirement(lrc, LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, lrc));
+      launcher.add_field(1/*index*/, FID_RANGE);
+      Future f = runtime->execute_task(ctx, launcher);
+      numghosts = f.get_result<coord_t>(true/*silence warnings*/);
     }
 
-    // Delete our temporary regions
+    // Slots from before a rebalance are no use anymore
+    if (lrgh.exists()) {
+      runtime->destroy_logical_region(ctx, lrgh);
+      runtime->destroy_index_space(ctx, lrgh.get_index_space());
+      runtime->destroy_field_space(ctx, lrgh.get_field_space());
+    }
+    IndexSpace isgh = runtime->create_index_space(ctx, Rect<1>(0, numghosts-1));
+    FieldSpace fsgh = runtime->create_field_space(ctx);
+    {
+      FieldAllocator fagh = runtime->create_field_allocator(ctx, fsgh);
+      fagh.allocate_field(sizeof(Pointer), FID_GHOSTP);
+      runtime->attach_name(fsgh, FID_GHOSTP, "GHOSTP");
+      fagh.allocate_field(sizeof(double), FID_GHOSTMASWT);
+      runtime->attach_name(fsgh, FID_GHOSTMASWT, "GHOSTMASWT");
+      fagh.allocate_field(sizeof(double2), FID_GHOSTF);
+      runtime->attach_name(fsgh, FID_GHOSTF, "GHOSTF");
+    }
+    lrgh = runtime->create_logical_region(ctx, isgh, fsgh);
+    runtime->attach_name(lrgh, "lrgh");
+    IndexPartition ip_gh = runtime->create_partition_by_image_range(ctx, isgh,
+                                            lpc, lrc, FID_RANGE, is_piece);
+    lpgh = runtime->get_logical_partition(lrgh, ip_gh);
+    runtime->attach_name(lpgh, "lpgh");
+
+    // Fill in the ghost point of each slot and the slot of each side
+    {
+      IndexTaskLauncher launcher(TID_INITGHOSTS, is_piece,
+          TaskArgument(&ip_ghost, sizeof(ip_ghost)), ArgumentMap());
+      launcher.add_region_requirement(RegionRequirement(lpgh,
+            0/*identity projection*/, LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, lrgh));
+      launcher.add_field(0/*index*/, FID_GHOSTP);
+      launcher.add_region_requirement(RegionRequirement(lps,
+            0/*identity projection*/, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrs));
+      launcher.add_field(1/*index*/, FID_MAPSP1);
+      launcher.add_region_requirement(RegionRequirement(lps,
+            0/*identity projection*/, LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, lrs));
+      launcher.add_field(2/*index*/, FID_MAPSP1GHOST);
+      runtime->execute_index_space(ctx, launcher);
+    }
+
+    // The owner of each point pulls all the slots for it
+    IndexPartition ip_ghown = runtime->create_partition_by_preimage(ctx,
+                                ip_mstr, lrgh, lrgh, FID_GHOSTP, is_piece);
+    lpghown = runtime->get_logical_partition(lrgh, ip_ghown);
+    runtime->attach_name(lpghown, "lpghown");
+
+    runtime->destroy_index_partition(ctx, ip_ghost);
+    runtime->destroy_logical_region(ctx, lrc);
+    runtime->destroy_field_space(ctx, fsc);
+}
+
+
+void Mesh::releaseSetupFields() {
+    // Everything is allocated at this point, so this is the high-water mark
+    setupbytes += calcRegionBytes(lrp) + calcRegionBytes(lrz) + calcRegionBytes(lrs);
+#ifdef CACHE_INVARIANTS
+    setupbytes += calcRegionBytes(lrzc);
+#endif
+
+    // The load-order side maps and the map to the compacted points were
+    // only needed to build lrp, and FID_PIECE is only needed again if
+    // the partitions get rebuilt when rebalancing
+    {
+      FieldAllocator fap = runtime->create_field_allocator(ctx, lrp.get_field_space());
+      fap.free_field(FID_MAPLOAD2DENSE);
+      if (!keeppieces)
+        fap.free_field(FID_PIECE);
+    }
 #ifndef PRECOMPACTED_RECT_POINTS
-    runtime->destroy_logical_region(ctx, lr_temp_points);
+    {
+      FieldAllocator fas = runtime->create_field_allocator(ctx, lrs.get_field_space());
+      fas.free_field(FID_MAPSP1TEMP);
+      fas.free_field(FID_MAPSP2TEMP);
+    }
 #endif
-    runtime->destroy_logical_region(ctx, lr_all_range);
-    runtime->destroy_logical_region(ctx, lr_private_range);
-    runtime->destroy_logical_region(ctx, lr_shared_range);
+    if (!keeppieces) {
+      FieldAllocator faz = runtime->create_field_allocator(ctx, lrz.get_field_space());
+      faz.free_field(FID_PIECE);
+    }
 
-    // Ignore chunking for now
+    // The mappers' instances all still have room for the freed fields
+    for (std::vector<PennantMapper*>::const_iterator it = 
+          local_mappers.begin(); it != local_mappers.end(); it++)
+      (*it)->forget_setup_instances();
 
-    writeStats();
+    runbytes = calcRegionBytes(lrp) + calcRegionBytes(lrz) + calcRegionBytes(lrs);
+#ifdef CACHE_INVARIANTS
+    runbytes += calcRegionBytes(lrzc);
+#endif
+}
+
+
+void Mesh::releaseForceFields(const bool freetts, const bool freeqcs) {
+    if (!freetts && !freeqcs) return;
+
+    {
+      FieldAllocator fas = runtime->create_field_allocator(ctx, lrs.get_field_space());
+      if (freetts)
+        fas.free_field(FID_SFT);
+      if (freeqcs) {
+        fas.free_field(FID_SFQ);
+#ifndef FUSED_QCS
+        fas.free_field(FID_CEVOL);
+        fas.free_field(FID_CDU);
+        fas.free_field(FID_CDIV);
+        fas.free_field(FID_CRMU);
+#endif
+#if !defined(ALIAS_SCRATCH_FIELDS) && !defined(FUSED_QCS)
+        fas.free_field(FID_CAREA);
+        fas.free_field(FID_CCOS);
+        fas.free_field(FID_CQE1);
+        fas.free_field(FID_CQE2);
+        fas.free_field(FID_CW);
+#endif
+      }
+    }
+#if !defined(ALIAS_SCRATCH_FIELDS) && !defined(FUSED_QCS)
+    if (freeqcs) {
+      FieldAllocator faz = runtime->create_field_allocator(ctx, lrz.get_field_space());
+      faz.free_field(FID_ZUC);
+    }
+#endif
+
+    // Same as after setup: the cached instances still have the fields
+    for (std::vector<PennantMapper*>::const_iterator it = 
+          local_mappers.begin(); it != local_mappers.end(); it++)
+      (*it)->forget_setup_instances();
+
+    runbytes = calcRegionBytes(lrp) + calcRegionBytes(lrz) + calcRegionBytes(lrs);
+#ifdef CACHE_INVARIANTS
+    runbytes += calcRegionBytes(lrzc);
+#endif
+    LEGION_PRINT_ONCE(runtime, ctx, stdout, "Field memory: %.1f MB without "
+        "the fields of the disabled force packages\n", runbytes / 1048576.0);
+}
+
+
+size_t Mesh::calcFieldBytes(FieldSpace fs) {
+    std::vector<FieldID> fields;
+    runtime->get_field_space_fields(ctx, fs, fields);
+    size_t bytes = 0;
+    for (std::vector<FieldID>::const_iterator it = fields.begin();
+          it != fields.end(); it++)
+      bytes += runtime->get_field_size(ctx, fs, *it);
+    return bytes;
+}
+
+
+size_t Mesh::calcRegionBytes(LogicalRegion lr) {
+    return calcFieldBytes(lr.get_field_space()) *
+      runtime->get_index_space_domain(ctx, lr.get_index_space()).get_volume();
+}
+
+
+void Mesh::checkMemory(FieldSpace fsp, FieldSpace fsz, FieldSpace fss) {
+    // Every field is allocated for every point, zone and side, and the
+    // points are in both lr_temp_points and lrp while being compacted
+#ifdef PRECOMPACTED_RECT_POINTS
+    const coord_t numpts = nump;
+#else
+    const coord_t numpts = 2 * nump;
+#endif
+    const FieldSpace fs[3] = { fsp, fsz, fss };
+    const coord_t num[3] = { numpts, numz, nums };
+    const char *const kind[3] = { "point", "zone", "side" };
+    size_t total = 0;
+    for (int i = 0; i < 3; ++i)
+      total += num[i] * calcFieldBytes(fs[i]);
+
+    // The pieces get spread evenly over the memories, so the fullest one
+    // has the bytes of ceil(numpcs / memories) pieces, unless the mapper
+    // gives every memory an instance of the whole mesh
+    std::vector<Legion::Memory> memories;
+    PennantMapper::get_array_memories(Machine::get_machine(), memories);
+    if (memories.empty()) return;
+    size_t capacity = memories[0].capacity();
+    for (std::vector<Legion::Memory>::const_iterator it = memories.begin();
+          it != memories.end(); it++)
+      capacity = std::min(capacity, it->capacity());
+    const bool wholemesh =
+        PennantMapper::has_whole_region_arrays(Machine::get_machine());
+    const coord_t nummems = std::min<coord_t>(memories.size(), numpcs);
+    const coord_t pcspermem = (numpcs + nummems - 1) / nummems;
+    const size_t permem = wholemesh ? total : total / numpcs * pcspermem;
+    const bool fits = (permem <= capacity);
+
+    LEGION_PRINT_ONCE(runtime, ctx, stdout, "Memory estimate: %.1f MB per piece, "
+        "%.1f MB of %.1f MB in the fullest of %lld memories\n",
+        total / numpcs / 1048576.0, permem / 1048576.0, capacity / 1048576.0, nummems);
+    if (memreport || !fits) {
+      for (int i = 0; i < 3; ++i) {
+        std::vector<FieldID> fields;
+        runtime->get_field_space_fields(ctx, fs[i], fields);
+        for (std::vector<FieldID>::const_iterator it = fields.begin();
+              it != fields.end(); it++) {
+          const char *name;
+          runtime->retrieve_name(fs[i], *it, name);
+          LEGION_PRINT_ONCE(runtime, ctx, stdout, "  %-5s %-14s %10.1f MB\n", kind[i],
+              name, num[i] * runtime->get_field_size(ctx, fs[i], *it) / 1048576.0);
+        }
+      }
+    }
+    if (fits) return;
+
+    // Bail out before any of the setup gets mapped; if it would fit with
+    // the pieces spread evenly over all the memories say how many to use
+    const coord_t needed = (total + capacity - 1) / capacity;
+    const coord_t allmems = memories.size();
+    if (wholemesh) {
+      LEGION_PRINT_ONCE(runtime, ctx, stderr, "Error: the mesh doesn't fit in "
+          "memory, each memory holds all of it on a single node\n");
+    } else if (needed <= allmems) {
+      LEGION_PRINT_ONCE(runtime, ctx, stderr, "Error: the mesh doesn't fit in "
+          "memory with %d pieces, use %lld pieces instead\n", numpcs,
+          (numpcs + allmems - 1) / allmems * allmems);
+    } else {
+      LEGION_PRINT_ONCE(runtime, ctx, stderr, "Error: the mesh doesn't fit in "
+          "memory, it needs at least %lld memories but there are only %lld\n",
+          needed, allmems);
+    }
+    exit(1);
+}
+
+
+void Mesh::rebalance() {
+    // Remember the old piece partitions, everything below them goes too
+    const IndexPartition old_zone_pieces = lpz.get_index_partition();
+    const IndexPartition old_side_pieces = lps.get_index_partition();
+    const IndexPartition old_point_pieces = runtime->get_parent_index_partition(
+        runtime->get_parent_index_space(lppprv.get_index_partition()));
+
+    // Move zones, sides and points to their new pieces
+    Future f_imbalance = partitioner->rebalance(gmesh->numpcx, gmesh->numpcy,
+        runtime, ctx, lrz, lrs, lrp, lpz, lps, lppprv, lppmstr, lppshr, ispc);
+
+    // Once nothing uses the old pieces the mappers in every process
+    // can drop their instances
+    runtime->issue_execution_fence(ctx);
+    runtime->select_tunable_value(ctx, PennantMapper::FORGET_PIECES_TUNABLE);
+
+    // The points are already in compacted order so we can use them in place
+    initPieces(lrp, LogicalPartition::NO_PART, false/*compact*/);
+
+    runtime->destroy_index_partition(ctx, old_zone_pieces);
+    runtime->destroy_index_partition(ctx, old_side_pieces);
+    runtime->destroy_index_partition(ctx, old_point_pieces);
+
+    const double imbalance = f_imbalance.get_result<double>(true/*silence warnings*/);
+    if (imbalance == 0.)
+      LEGION_PRINT_ONCE(runtime, ctx, stderr, "Warning: some pieces weren't "
+          "timed, rebalanced them into even cuts of the zones\n");
+    else
+      LEGION_PRINT_ONCE(runtime, ctx, stdout,
+          "Rebalanced pieces, slowest piece was %.3f times the mean\n", imbalance);
 }
 
 
@@ -663,6 +1182,8 @@ void Mesh::writeStats() {
     LEGION_PRINT_ONCE(runtime, ctx, stdout, "Zones:   %lld\n", gnumz);
     LEGION_PRINT_ONCE(runtime, ctx, stdout, "Sides:   %lld\n", gnums);
     LEGION_PRINT_ONCE(runtime, ctx, stdout, "Chunk size:   %d\n", chunksize);
+    LEGION_PRINT_ONCE(runtime, ctx, stdout, "Field memory: %.1f MB in setup, "
+        "%.1f MB after\n", setupbytes / 1048576.0, runbytes / 1048576.0);
     LEGION_PRINT_ONCE(runtime, ctx, stdout, "------------------------\n");
 }
 
@@ -698,8 +1219,9 @@ void Mesh::calcOwnershipParallel(
             LogicalPartition lp_sides,
             IndexPartition ip_private,
             IndexPartition ip_shared,
+            IndexPartition ip_node_shared,
             IndexSpace is_piece) {
-  const CalcOwnersArgs args(ip_private, ip_shared);
+  const CalcOwnersArgs args(ip_private, ip_shared, ip_node_shared);
   IndexTaskLauncher launcher(TID_CALCOWNERS, is_piece, 
                             TaskArgument(&args, sizeof(args)), ArgumentMap());
   launcher.add_region_requirement(
@@ -710,6 +1232,7 @@ void Mesh::calcOwnershipParallel(
       RegionRequirement(lp_sides, 0/*identity projection*/, LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, lr_sides));
   launcher.add_field(1/*index*/, FID_MAPSP1REG);
   launcher.add_field(1/*index*/, FID_MAPSP2REG);
+  launcher.add_field(1/*index*/, FID_MAPSP1NODE);
   runtime->execute_index_space(ctx, launcher);
 }
 
@@ -723,6 +1246,7 @@ void Mesh::calcOwnersTask(
     const AccessorRO<Pointer> acc_mapsp2(regions[0], FID_MAPSP2);
     const AccessorWD<int> acc_mapsp1reg(regions[1], FID_MAPSP1REG);
     const AccessorWD<int> acc_mapsp2reg(regions[1], FID_MAPSP2REG);
+    const AccessorWD<int> acc_mapsp1node(regions[1], FID_MAPSP1NODE);
 
     const CalcOwnersArgs *args = reinterpret_cast<const CalcOwnersArgs*>(task->args);
     const Domain private_domain = 
@@ -731,6 +1255,9 @@ void Mesh::calcOwnersTask(
     const Domain shared_domain = 
       runtime->get_index_space_domain(
           runtime->get_index_subspace(args->ip_shared, task->index_point));
+    const Domain node_shared_domain = 
+      runtime->get_index_space_domain(
+          runtime->get_index_subspace(args->ip_node_shared, task->index_point));
 
     const IndexSpace& iss = task->regions[0].region.get_index_space();
     for (PointIterator itr(runtime, iss); itr(); itr++)
@@ -740,9 +1267,13 @@ void Mesh::calcOwnersTask(
       {
         assert(shared_domain.contains(p1));
         acc_mapsp1reg[*itr] = 1;
+        acc_mapsp1node[*itr] = node_shared_domain.contains(p1) ? 1 : 0;
       }
       else
+      {
         acc_mapsp1reg[*itr] = 0;
+        acc_mapsp1node[*itr] = 0;
+      }
 
       const Pointer p2 = acc_mapsp2[*itr];
       if (!private_domain.contains(p2))
@@ -756,6 +1287,106 @@ void Mesh::calcOwnersTask(
 }
 
 
+void Mesh::calcZoneSidesParallel(
+            Runtime *runtime,
+            Context ctx,
+            LogicalRegion lr_sides,
+            LogicalPartition lp_sides,
+            LogicalRegion lr_zones,
+            LogicalPartition lp_zones,
+            IndexSpace is_piece) {
+  IndexTaskLauncher launcher(TID_CALCZONESIDES, is_piece, TaskArgument(), ArgumentMap());
+  launcher.add_region_requirement(
+      RegionRequirement(lp_sides, 0/*identity projection*/, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lr_sides));
+  launcher.add_field(0/*index*/, FID_MAPSZ);
+  launcher.add_region_requirement(
+      RegionRequirement(lp_zones, 0/*identity projection*/, LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, lr_zones));
+  launcher.add_field(1/*index*/, FID_MAPZS1);
+  runtime->execute_index_space(ctx, launcher);
+}
+
+
+void Mesh::calcZoneSidesTask(
+        const Task *task,
+        const std::vector<PhysicalRegion> &regions,
+        Context ctx,
+        Runtime *runtime) {
+    const AccessorRO<Pointer> acc_mapsz(regions[0], FID_MAPSZ);
+    const AccessorWD<Pointer> acc_mapzs1(regions[1], FID_MAPZS1);
+
+    // GenMesh and the partitioner both keep the sides of a zone
+    // contiguous, so a zone starts wherever the side before has
+    // a different zone
+    const IndexSpace& iss = task->regions[0].region.get_index_space();
+    // This will assert if it is not dense
+    const Rect<1> rects = runtime->get_index_space_domain(iss);
+    for (coord_t s = rects.lo[0]; s <= rects.hi[0]; s++)
+    {
+      const Pointer z = acc_mapsz[s];
+      if ((s == rects.lo[0]) || (acc_mapsz[s - 1] != z))
+        acc_mapzs1[z] = Pointer(s);
+    }
+}
+
+
+void Mesh::calcSideColorsParallel(
+            Runtime *runtime,
+            Context ctx,
+            LogicalRegion lr_sides,
+            LogicalPartition lp_sides,
+            IndexSpace is_piece) {
+  IndexTaskLauncher launcher(TID_CALCSIDECOLORS, is_piece, TaskArgument(), ArgumentMap());
+  launcher.add_region_requirement(
+      RegionRequirement(lp_sides, 0/*identity projection*/, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lr_sides));
+  launcher.add_field(0/*index*/, FID_MAPSP1);
+  launcher.add_region_requirement(
+      RegionRequirement(lp_sides, 0/*identity projection*/, LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, lr_sides));
+  launcher.add_field(1/*index*/, FID_COLORSIDE);
+  launcher.add_field(1/*index*/, FID_SIDECOLOR);
+  runtime->execute_index_space(ctx, launcher);
+}
+
+
+void Mesh::calcSideColorsTask(
+        const Task *task,
+        const std::vector<PhysicalRegion> &regions,
+        Context ctx,
+        Runtime *runtime) {
+    const AccessorRO<Pointer> acc_mapsp1(regions[0], FID_MAPSP1);
+    const AccessorWD<Pointer> acc_colorside(regions[1], FID_COLORSIDE);
+    const AccessorWD<int> acc_sidecolor(regions[1], FID_SIDECOLOR);
+
+    const IndexSpace& iss = task->regions[0].region.get_index_space();
+    // This will assert if it is not dense
+    const Rect<1> rects = runtime->get_index_space_domain(iss);
+    const coord_t nums = rects.volume();
+
+    // A side's color is the number of sides before it with the same
+    // point 1, so the sides around a point all get different colors,
+    // until there are more of them than colors
+    std::map<coord_t, int> pointsides;
+    std::vector<int> color(nums);
+    std::vector<coord_t> colorstart(NUMSIDECOLORS + 1, 0);
+    for (coord_t i = 0; i < nums; i++)
+    {
+      const Pointer p = acc_mapsp1[rects.lo[0] + i];
+      const int c = std::min(pointsides[p[0]]++, NUMSIDECOLORS - 1);
+      color[i] = c;
+      colorstart[c + 1]++;
+    }
+    for (int c = 0; c < NUMSIDECOLORS; c++)
+      colorstart[c + 1] += colorstart[c];
+
+    // Keep side order within each color so the reads stay streaming
+    for (coord_t i = 0; i < nums; i++)
+    {
+      const coord_t slot = rects.lo[0] + colorstart[color[i]]++;
+      acc_colorside[slot] = Pointer(rects.lo[0] + i);
+      acc_sidecolor[slot] = color[i];
+    }
+}
+
+
 void Mesh::calcCtrsParallel(
             Runtime *runtime,
             Context ctx,
@@ -778,18 +1409,21 @@ void Mesh::calcCtrsParallel(
   launcher.add_region_requirement(
       RegionRequirement(lp_zones, 0/*identity projection*/, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lr_zones));
   launcher.add_field(1/*index*/, FID_ZNUMP);
+  launcher.add_field(1/*index*/, FID_MAPZS1);
   launcher.add_region_requirement(
       RegionRequirement(lp_points_private, 0/*identity*/, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lr_points));
   launcher.add_field(2/*index*/, FID_PX);
   launcher.add_region_requirement(
       RegionRequirement(lp_points_shared, 0/*identity*/, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lr_points));
   launcher.add_field(3/*index*/, FID_PX);
-  launcher.add_region_requirement(
-      RegionRequirement(lp_sides, 0/*identity*/, LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, lr_sides));
-  launcher.add_field(4/*index*/, FID_EX);
   launcher.add_region_requirement(
       RegionRequirement(lp_zones, 0/*identity*/, LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, lr_zones));
-  launcher.add_field(5/*index*/, FID_ZX);
+  launcher.add_field(4/*index*/, FID_ZX);
+#ifndef RECOMPUTE_EDGE_GEOMETRY
+  launcher.add_region_requirement(
+      RegionRequirement(lp_sides, 0/*identity*/, LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, lr_sides));
+  launcher.add_field(5/*index*/, FID_EX);
+#endif
   runtime->execute_index_space(ctx, launcher);
 }
 
@@ -810,10 +1444,21 @@ void Mesh::calcCtrsTask(
         AccessorRO<double2>(regions[2], fid_px),
         AccessorRO<double2>(regions[3], fid_px)
     };
-    FieldID fid_ex = task->regions[4].instance_fields[0];
-    const AccessorWD<double2> acc_ex(regions[4], fid_ex);
-    FieldID fid_zx = task->regions[5].instance_fields[0];
-    const AccessorWD<double2> acc_zx(regions[5], fid_zx);
+    FieldID fid_zx = task->regions[4].instance_fields[0];
+    const AccessorWD<double2> acc_zx(regions[4], fid_zx);
+#ifndef RECOMPUTE_EDGE_GEOMETRY
+    FieldID fid_ex = task->regions[5].instance_fields[0];
+    const AccessorWD<double2> acc_ex(regions[5], fid_ex);
+#endif
+#ifdef CACHE_INVARIANTS
+    // Hydro's launches add 1/znump as the last region, the ones during
+    // Mesh init come before it is computed
+    const bool hasinv =
+        (task->regions.back().privilege_fields.count(FID_ZNUMPINV) > 0);
+    AccessorRO<double> acc_znumpinv;
+    if (hasinv)
+        acc_znumpinv = AccessorRO<double>(regions.back(), FID_ZNUMPINV);
+#endif
 
     const IndexSpace& isz = task->regions[1].region.get_index_space();
     for (PointIterator itr(runtime, isz); itr(); itr++)
@@ -829,10 +1474,16 @@ void Mesh::calcCtrsTask(
         const Pointer z = acc_mapsz[*itr];
         const double2 px1 = acc_px[p1reg][p1];
         const double2 px2 = acc_px[p2reg][p2];
+#ifndef RECOMPUTE_EDGE_GEOMETRY
         const double2 ex  = 0.5 * (px1 + px2);
         acc_ex[*itr] = ex;
+#endif
         const int n = acc_znump[z];
+#ifdef CACHE_INVARIANTS
+        acc_zx[z] += (hasinv ? px1 * acc_znumpinv[z] : px1 / n);
+#else
         acc_zx[z] += px1 / n;
+#endif
     }
 }
 
@@ -844,44 +1495,61 @@ void Mesh::calcCtrsOMPTask(
         Runtime *runtime) {
     const AccessorRO<Pointer> acc_mapsp1(regions[0], FID_MAPSP1);
     const AccessorRO<Pointer> acc_mapsp2(regions[0], FID_MAPSP2);
-    const AccessorRO<Pointer> acc_mapsz(regions[0], FID_MAPSZ);
     const AccessorRO<int> acc_mapsp1reg(regions[0], FID_MAPSP1REG);
     const AccessorRO<int> acc_mapsp2reg(regions[0], FID_MAPSP2REG);
     const AccessorRO<int> acc_znump(regions[1], FID_ZNUMP);
+    const AccessorRO<Pointer> acc_mapzs1(regions[1], FID_MAPZS1);
     FieldID fid_px = task->regions[2].instance_fields[0];
     const AccessorRO<double2> acc_px[2] = {
         AccessorRO<double2>(regions[2], fid_px),
         AccessorRO<double2>(regions[3], fid_px)
     };
-    FieldID fid_ex = task->regions[4].instance_fields[0];
-    const AccessorWD<double2> acc_ex(regions[4], fid_ex);
-    FieldID fid_zx = task->regions[5].instance_fields[0];
-    const AccessorWD<double2> acc_zx(regions[5], fid_zx);
+    FieldID fid_zx = task->regions[4].instance_fields[0];
+    const AccessorWD<double2> acc_zx(regions[4], fid_zx);
+#ifndef RECOMPUTE_EDGE_GEOMETRY
+    FieldID fid_ex = task->regions[5].instance_fields[0];
+    const AccessorWD<double2> acc_ex(regions[5], fid_ex);
+#endif
+#ifdef CACHE_INVARIANTS
+    // Hydro's launches add 1/znump as the last region, the ones during
+    // Mesh init come before it is computed
+    const bool hasinv =
+        (task->regions.back().privilege_fields.count(FID_ZNUMPINV) > 0);
+    AccessorRO<double> acc_znumpinv;
+    if (hasinv)
+        acc_znumpinv = AccessorRO<double>(regions.back(), FID_ZNUMPINV);
+#endif
 
+    // Each thread takes whole zones and walks their sides itself, so
+    // nothing needs an atomic to sum into the zone
     const IndexSpace& isz = task->regions[1].region.get_index_space();
     // This will assert if it is not dense
     const Rect<1> rectz = runtime->get_index_space_domain(isz);
     #pragma omp parallel for
     for (coord_t z = rectz.lo[0]; z <= rectz.hi[0]; z++)
-      acc_zx[z] = double2(0., 0.);
-
-    const IndexSpace& iss = task->regions[0].region.get_index_space();
-    // This will assert if it is not dense
-    const Rect<1> rects = runtime->get_index_space_domain(iss);
-    #pragma omp parallel for
-    for (coord_t s = rects.lo[0]; s <= rects.hi[0]; s++)
     {
-        const Pointer p1 = acc_mapsp1[s];
-        const int p1reg = acc_mapsp1reg[s];
-        const Pointer p2 = acc_mapsp2[s];
-        const int p2reg = acc_mapsp2reg[s];
-        const Pointer z = acc_mapsz[s];
-        const double2 px1 = acc_px[p1reg][p1];
-        const double2 px2 = acc_px[p2reg][p2];
-        const double2 ex  = 0.5 * (px1 + px2);
-        acc_ex[s] = ex;
         const int n = acc_znump[z];
-        SumOp<double2>::apply<false/*exclusive*/>(acc_zx[z], px1 / n);
+        const coord_t sfirst = acc_mapzs1[z][0];
+        double2 zx(0., 0.);
+        for (coord_t s = sfirst; s < sfirst + n; s++)
+        {
+            const Pointer p1 = acc_mapsp1[s];
+            const int p1reg = acc_mapsp1reg[s];
+            const Pointer p2 = acc_mapsp2[s];
+            const int p2reg = acc_mapsp2reg[s];
+            const double2 px1 = acc_px[p1reg][p1];
+            const double2 px2 = acc_px[p2reg][p2];
+#ifndef RECOMPUTE_EDGE_GEOMETRY
+            const double2 ex  = 0.5 * (px1 + px2);
+            acc_ex[s] = ex;
+#endif
+#ifdef CACHE_INVARIANTS
+            zx += (hasinv ? px1 * acc_znumpinv[z] : px1 / n);
+#else
+            zx += px1 / n;
+#endif
+        }
+        acc_zx[z] = zx;
     }
 }
 
@@ -922,6 +1590,10 @@ Future Mesh::calcVolsParallel(
       RegionRequirement(lp_zones, 0/*identity*/, LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, lr_zones));
   launcher.add_field(5/*index*/, FID_ZAREA);
   launcher.add_field(5/*index*/, FID_ZVOL);
+  launcher.add_region_requirement(
+      RegionRequirement(lp_zones, 0/*identity*/, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lr_zones));
+  launcher.add_field(6/*index*/, FID_ZNUMP);
+  launcher.add_field(6/*index*/, FID_MAPZS1);
   return runtime->execute_index_space(ctx, launcher, OPID_SUMINT);
 }
 
@@ -942,10 +1614,12 @@ int Mesh::calcVolsTask(
     };
     FieldID fid_zx = task->regions[3].instance_fields[0];
     const AccessorRO<double2> acc_zx(regions[3], fid_zx);
-    FieldID fid_sarea = task->regions[4].instance_fields[0];
-    FieldID fid_svol  = task->regions[4].instance_fields[1];
-    const AccessorWD<double> acc_sarea(regions[4], fid_sarea);
-    const AccessorWD<double> acc_svol(regions[4], fid_svol);
+    // The volumes are always last; with RECOMPUTE_EDGE_GEOMETRY the
+    // predictor step asks for them alone and the areas aren't stored
+    const std::vector<FieldID>& fids_s = task->regions[4].instance_fields;
+    const bool storesarea = (fids_s.size() > 1);
+    const AccessorWD<double> acc_sarea(regions[4], fids_s.front());
+    const AccessorWD<double> acc_svol(regions[4], fids_s.back());
     FieldID fid_zarea = task->regions[5].instance_fields[0];
     FieldID fid_zvol  = task->regions[5].instance_fields[1];
     const AccessorWD<double> acc_zarea(regions[5], fid_zarea);
@@ -975,7 +1649,8 @@ int Mesh::calcVolsTask(
         // compute side volumes, sum to zone
         const double sa = 0.5 * cross(px2 - px1, zx - px1);
         const double sv = third * sa * (px1.x + px2.x + zx.x);
-        acc_sarea[*itr] = sa;
+        if (storesarea)
+          acc_sarea[*itr] = sa;
         acc_svol[*itr] = sv;
         acc_zarea[z] += sa;
         acc_zvol[z] += sv;
@@ -996,7 +1671,6 @@ int Mesh::calcVolsOMPTask(
         Runtime *runtime) {
     const AccessorRO<Pointer> acc_mapsp1(regions[0], FID_MAPSP1);
     const AccessorRO<Pointer> acc_mapsp2(regions[0], FID_MAPSP2);
-    const AccessorRO<Pointer> acc_mapsz(regions[0], FID_MAPSZ);
     const AccessorRO<int> acc_mapsp1reg(regions[0], FID_MAPSP1REG);
     const AccessorRO<int> acc_mapsp2reg(regions[0], FID_MAPSP2REG);
     FieldID fid_px = task->regions[1].instance_fields[0];
@@ -1006,53 +1680,57 @@ int Mesh::calcVolsOMPTask(
     };
     FieldID fid_zx = task->regions[3].instance_fields[0];
     const AccessorRO<double2> acc_zx(regions[3], fid_zx);
-    FieldID fid_sarea = task->regions[4].instance_fields[0];
-    FieldID fid_svol  = task->regions[4].instance_fields[1];
-    const AccessorWD<double> acc_sarea(regions[4], fid_sarea);
-    const AccessorWD<double> acc_svol(regions[4], fid_svol);
+    // The volumes are always last; with RECOMPUTE_EDGE_GEOMETRY the
+    // predictor step asks for them alone and the areas aren't stored
+    const std::vector<FieldID>& fids_s = task->regions[4].instance_fields;
+    const bool storesarea = (fids_s.size() > 1);
+    const AccessorWD<double> acc_sarea(regions[4], fids_s.front());
+    const AccessorWD<double> acc_svol(regions[4], fids_s.back());
     FieldID fid_zarea = task->regions[5].instance_fields[0];
     FieldID fid_zvol  = task->regions[5].instance_fields[1];
     const AccessorWD<double> acc_zarea(regions[5], fid_zarea);
     const AccessorWD<double> acc_zvol(regions[5], fid_zvol);
+    const AccessorRO<int> acc_znump(regions[6], FID_ZNUMP);
+    const AccessorRO<Pointer> acc_mapzs1(regions[6], FID_MAPZS1);
 
+    const double third = 1. / 3.;
+    int count = 0;
+    // Threads take whole zones, as in calcCtrsOMPTask
     const IndexSpace& isz = task->regions[3].region.get_index_space();
     // This will assert if it isn't dense
     const Rect<1> rectz = runtime->get_index_space_domain(isz);
-    #pragma omp parallel for
+    #pragma omp parallel for reduction(+:count)
     for (coord_t z = rectz.lo[0]; z <= rectz.hi[0]; z++)
     {
-        acc_zarea[z] = 0.;
-        acc_zvol[z] = 0.;
-    }
-
-    const double third = 1. / 3.;
-    int count = 0;
-    const IndexSpace& iss = task->regions[0].region.get_index_space();
-    // This will assert if it isn't dense
-    const Rect<1> rects = runtime->get_index_space_domain(iss);
-    #pragma omp parallel for
-    for (coord_t s = rects.lo[0]; s <= rects.hi[0]; s++)
-    {
-        const Pointer p1 = acc_mapsp1[s];
-        const int p1reg = acc_mapsp1reg[s];
-        const Pointer p2 = acc_mapsp2[s];
-        const int p2reg = acc_mapsp2reg[s];
-        const Pointer z = acc_mapsz[s];
-        const double2 px1 = acc_px[p1reg][p1];
-        const double2 px2 = acc_px[p2reg][p2];
+        const int n = acc_znump[z];
+        const coord_t sfirst = acc_mapzs1[z][0];
         const double2 zx  = acc_zx[z];
-
-        // compute side volumes, sum to zone
-        const double sa = 0.5 * cross(px2 - px1, zx - px1);
-        const double sv = third * sa * (px1.x + px2.x + zx.x);
-        acc_sarea[s] = sa;
-        acc_svol[s] = sv;
-        SumOp<double>::apply<false/*exclusive*/>(acc_zarea[z], sa);
-        SumOp<double>::apply<false/*exclusive*/>(acc_zvol[z], sv);
-
-        // check for negative side volumes
-        if (sv <= 0.) 
-          SumOp<int>::apply<false/*exclusive*/>(count, 1);
+        double zarea = 0.;
+        double zvol = 0.;
+        for (coord_t s = sfirst; s < sfirst + n; s++)
+        {
+            const Pointer p1 = acc_mapsp1[s];
+            const int p1reg = acc_mapsp1reg[s];
+            const Pointer p2 = acc_mapsp2[s];
+            const int p2reg = acc_mapsp2reg[s];
+            const double2 px1 = acc_px[p1reg][p1];
+            const double2 px2 = acc_px[p2reg][p2];
+
+            // compute side volumes, sum to zone
+            const double sa = 0.5 * cross(px2 - px1, zx - px1);
+            const double sv = third * sa * (px1.x + px2.x + zx.x);
+            if (storesarea)
+              acc_sarea[s] = sa;
+            acc_svol[s] = sv;
+            zarea += sa;
+            zvol += sv;
+
+            // check for negative side volumes
+            if (sv <= 0.) 
+              count += 1;
+        }
+        acc_zarea[z] = zarea;
+        acc_zvol[z] = zvol;
     }
 
     return count;
@@ -1219,8 +1897,12 @@ void Mesh::calcCharLenTask(
         Context ctx,
         Runtime *runtime) {
     const AccessorRO<Pointer> acc_mapsz(regions[0], FID_MAPSZ);
+#ifdef RECOMPUTE_EDGE_GEOMETRY
+    const SideGeometry geom(regions, 0, 1, 3);
+#else
     const AccessorRO<double> acc_elen(regions[0], FID_ELEN);
     const AccessorRO<double> acc_sarea(regions[0], FID_SAREAP);
+#endif
     const AccessorRO<int> acc_znump(regions[1], FID_ZNUMP);
     const AccessorWD<double> acc_zdl(regions[2], FID_ZDL);
 
@@ -1232,8 +1914,13 @@ void Mesh::calcCharLenTask(
     for (PointIterator itr(runtime, iss); itr(); itr++)
     {
         const Pointer z = acc_mapsz[*itr];
+#ifdef RECOMPUTE_EDGE_GEOMETRY
+        const double area = geom.sarea(*itr, z);
+        const double base = geom.elen(*itr);
+#else
         const double area = acc_sarea[*itr];
         const double base = acc_elen[*itr];
+#endif
         const double zdl = acc_zdl[z];
         const int np = acc_znump[z];
         const double fac = (np == 3 ? 3. : 4.);
@@ -1250,8 +1937,12 @@ void Mesh::calcCharLenOMPTask(
         Context ctx,
         Runtime *runtime) {
     const AccessorRO<Pointer> acc_mapsz(regions[0], FID_MAPSZ);
+#ifdef RECOMPUTE_EDGE_GEOMETRY
+    const SideGeometry geom(regions, 0, 1, 3);
+#else
     const AccessorRO<double> acc_elen(regions[0], FID_ELEN);
     const AccessorRO<double> acc_sarea(regions[0], FID_SAREAP);
+#endif
     const AccessorRO<int> acc_znump(regions[1], FID_ZNUMP);
     const AccessorWD<double> acc_zdl(regions[2], FID_ZDL);
 
@@ -1268,8 +1959,13 @@ void Mesh::calcCharLenOMPTask(
     for (coord_t s = rects.lo[0]; s <= rects.hi[0]; s++)
     {
         const Pointer z = acc_mapsz[s];
+#ifdef RECOMPUTE_EDGE_GEOMETRY
+        const double area = geom.sarea(s, z);
+        const double base = geom.elen(s);
+#else
         const double area = acc_sarea[s];
         const double base = acc_elen[s];
+#endif
         const int np = acc_znump[z];
         const double fac = (np == 3 ? 3. : 4.);
         const double sdl = fac * area / base;
@@ -1604,3 +2300,60 @@ void Mesh::writeTask(
       zr, ze, zp, znump, zone_bounds.volume(), 
       px, point_bounds.volume(), mapsp1);
 }
+
+
+coord_t Mesh::calcGhostRangesTask(
+        const Task *task,
+        const std::vector<PhysicalRegion> &regions,
+        Context ctx,
+        Runtime *runtime) {
+    const AccessorRO<coord_t>  acc_count(regions[0], FID_COUNT);
+    const AccessorWD<Rect<1> > acc_range(regions[1], FID_RANGE);
+
+    IndexSpace is_piece = task->regions[0].region.get_index_space();
+    coord_t current = 0;
+    for (PointIterator itr(runtime, is_piece); itr(); itr++)
+    {
+      const coord_t count = acc_count[*itr];
+      acc_range[*itr] = Rect<1>(current, current + count - 1);
+      current += count;
+    }
+    return current;
+}
+
+
+void Mesh::initGhostsTask(
+        const Task *task,
+        const std::vector<PhysicalRegion> &regions,
+        Context ctx,
+        Runtime *runtime) {
+    IndexPartition ip_ghost = *(const IndexPartition*)task->args;
+    const AccessorWD<Pointer> acc_ghostp(regions[0], FID_GHOSTP);
+    const AccessorRO<Pointer> acc_mapsp1(regions[1], FID_MAPSP1);
+    const AccessorWD<Pointer> acc_mapsp1ghost(regions[2], FID_MAPSP1GHOST);
+
+    // Hand out our slots to our ghost points in order
+    IndexSpace is_ghost = runtime->get_index_subspace(ip_ghost, task->index_point);
+    IndexSpace is_slot = task->regions[0].region.get_index_space();
+    std::map<coord_t,Pointer> slots;
+    PointIterator slot_itr(runtime, is_slot);
+    for (PointIterator itr(runtime, is_ghost); itr(); itr++, slot_itr++)
+    {
+      assert(slot_itr());
+      acc_ghostp[*slot_itr] = *itr;
+      slots[(*itr)[0]] = *slot_itr;
+    }
+    assert(!slot_itr());
+
+    const IndexSpace& iss = task->regions[1].region.get_index_space();
+    for (PointIterator itr(runtime, iss); itr(); itr++)
+    {
+      const Pointer p1 = acc_mapsp1[*itr];
+      std::map<coord_t,Pointer>::const_iterator finder = slots.find(p1[0]);
+      // private points and our masters don't have a slot
+      if (finder != slots.end())
+        acc_mapsp1ghost[*itr] = finder->second;
+      else
+        acc_mapsp1ghost[*itr] = Pointer(-1);
+    }
+}
@@ -50,9 +50,14 @@ gpu_calc_ctrs(const AccessorRO<Pointer> acc_mapsp1,
               const AccessorRO<int> acc_mapsp1reg,
               const AccessorRO<int> acc_mapsp2reg,
               const AccessorRO<int> acc_znump,
+#ifdef CACHE_INVARIANTS
+              const AccessorRO<double> acc_znumpinv, const bool hasinv,
+#endif
               const AccessorRO<double2> acc_px0,
               const AccessorRO<double2> acc_px1,
+#ifndef RECOMPUTE_EDGE_GEOMETRY
               const AccessorWD<double2> acc_ex,
+#endif
               const AccessorWD<double2> acc_zx,
               const Point<1> origin, const size_t max)
 {
@@ -67,10 +72,17 @@ gpu_calc_ctrs(const AccessorRO<Pointer> acc_mapsp1,
   const Pointer z = acc_mapsz[s];
   const double2 px1 = (p1reg == 0) ? acc_px0[p1] : acc_px1[p1];
   const double2 px2 = (p2reg == 0) ? acc_px0[p2] : acc_px1[p2];
+#ifndef RECOMPUTE_EDGE_GEOMETRY
   const double2 ex  = 0.5 * (px1 + px2);
   acc_ex[s] = ex;
+#endif
   const int n = acc_znump[z];
+#ifdef CACHE_INVARIANTS
+  const double2 zx = hasinv ? px1 * acc_znumpinv[z] : px1 / n;
+  SumOp<double2>::apply<false/*exclusive*/>(acc_zx[z], zx);
+#else
   SumOp<double2>::apply<false/*exclusive*/>(acc_zx[z], px1 / n);
+#endif
 }
 
 __host__
@@ -90,10 +102,21 @@ void Mesh::calcCtrsGPUTask(
         AccessorRO<double2>(regions[2], fid_px),
         AccessorRO<double2>(regions[3], fid_px)
     };
-    FieldID fid_ex = task->regions[4].instance_fields[0];
-    const AccessorWD<double2> acc_ex(regions[4], fid_ex);
-    FieldID fid_zx = task->regions[5].instance_fields[0];
-    const AccessorWD<double2> acc_zx(regions[5], fid_zx);
+    FieldID fid_zx = task->regions[4].instance_fields[0];
+    const AccessorWD<double2> acc_zx(regions[4], fid_zx);
+#ifndef RECOMPUTE_EDGE_GEOMETRY
+    FieldID fid_ex = task->regions[5].instance_fields[0];
+    const AccessorWD<double2> acc_ex(regions[5], fid_ex);
+#endif
+#ifdef CACHE_INVARIANTS
+    // Hydro's launches add 1/znump as the last region, the ones during
+    // Mesh init come before it is computed
+    const bool hasinv =
+        (task->regions.back().privilege_fields.count(FID_ZNUMPINV) > 0);
+    AccessorRO<double> acc_znumpinv;
+    if (hasinv)
+        acc_znumpinv = AccessorRO<double>(regions.back(), FID_ZNUMPINV);
+#endif
 
     const IndexSpace& isz = task->regions[1].region.get_index_space();
     // This will assert if it is not dense
@@ -110,8 +133,15 @@ void Mesh::calcCtrsGPUTask(
       return;
     const size_t blocks = (volume + THREADS_PER_BLOCK - 1) / THREADS_PER_BLOCK;
     gpu_calc_ctrs<<<blocks,THREADS_PER_BLOCK>>>(acc_mapsp1, acc_mapsp2, acc_mapsz,
-        acc_mapsp1reg, acc_mapsp2reg, acc_znump, acc_px[0], acc_px[1],
-        acc_ex, acc_zx, rects.lo, volume);
+        acc_mapsp1reg, acc_mapsp2reg, acc_znump,
+#ifdef CACHE_INVARIANTS
+        acc_znumpinv, hasinv,
+#endif
+        acc_px[0], acc_px[1],
+#ifndef RECOMPUTE_EDGE_GEOMETRY
+        acc_ex,
+#endif
+        acc_zx, rects.lo, volume);
 }
 
 __global__ void
@@ -125,6 +155,7 @@ gpu_calc_vols(const AccessorRO<Pointer> acc_mapsp1,
               const AccessorRO<double2> acc_px1,
               const AccessorRO<double2> acc_zx,
               const AccessorWD<double> acc_sarea,
+              const bool storesarea,
               const AccessorWD<double> acc_svol,
               const AccessorWD<double> acc_zarea,
               const AccessorWD<double> acc_zvol,
@@ -148,7 +179,8 @@ gpu_calc_vols(const AccessorRO<Pointer> acc_mapsp1,
   // compute side volumes, sum to zone
   const double sa = 0.5 * cross(px2 - px1, zx - px1);
   const double sv = third * sa * (px1.x + px2.x + zx.x);
-  acc_sarea[s] = sa;
+  if (storesarea)
+    acc_sarea[s] = sa;
   acc_svol[s] = sv;
   SumOp<double>::apply<false/*exclusive*/>(acc_zarea[z], sa);
   SumOp<double>::apply<false/*exclusive*/>(acc_zvol[z], sv);
@@ -176,10 +208,12 @@ DeferredReduction<SumOp<int> > Mesh::calcVolsGPUTask(
     };
     FieldID fid_zx = task->regions[3].instance_fields[0];
     const AccessorRO<double2> acc_zx(regions[3], fid_zx);
-    FieldID fid_sarea = task->regions[4].instance_fields[0];
-    FieldID fid_svol  = task->regions[4].instance_fields[1];
-    const AccessorWD<double> acc_sarea(regions[4], fid_sarea);
-    const AccessorWD<double> acc_svol(regions[4], fid_svol);
+    // The volumes are always last; with RECOMPUTE_EDGE_GEOMETRY the
+    // predictor step asks for them alone and the areas aren't stored
+    const std::vector<FieldID>& fids_s = task->regions[4].instance_fields;
+    const bool storesarea = (fids_s.size() > 1);
+    const AccessorWD<double> acc_sarea(regions[4], fids_s.front());
+    const AccessorWD<double> acc_svol(regions[4], fids_s.back());
     FieldID fid_zarea = task->regions[5].instance_fields[0];
     FieldID fid_zvol  = task->regions[5].instance_fields[1];
     const AccessorWD<double> acc_zarea(regions[5], fid_zarea);
@@ -204,8 +238,8 @@ DeferredReduction<SumOp<int> > Mesh::calcVolsGPUTask(
     const size_t blocks = (volume + THREADS_PER_BLOCK - 1) / THREADS_PER_BLOCK;
     gpu_calc_vols<<<blocks,THREADS_PER_BLOCK>>>(acc_mapsp1, acc_mapsp2,
         acc_mapsz, acc_mapsp1reg, acc_mapsp2reg, acc_px[0], acc_px[1],
-        acc_zx, acc_sarea, acc_svol, acc_zarea, acc_zvol, result,
-        rects.lo, volume);
+        acc_zx, acc_sarea, storesarea, acc_svol, acc_zarea, acc_zvol,
+        result, rects.lo, volume);
     return result;
 }
 
@@ -319,8 +353,12 @@ gpu_calc_char_len_init(const AccessorWD<double> acc_zdl, const double value,
 __global__ void
 __launch_bounds__(THREADS_PER_BLOCK,MIN_CTAS_PER_SM)
 gpu_calc_char_len(const AccessorRO<Pointer> acc_mapsz,
+#ifdef RECOMPUTE_EDGE_GEOMETRY
+                  const SideGeometry geom,
+#else
                   const AccessorRO<double> acc_elen,
                   const AccessorRO<double> acc_sarea,
+#endif
                   const AccessorRO<int> acc_znump,
                   const AccessorWD<double> acc_zdl,
                   const Point<1> origin, const size_t max)
@@ -330,8 +368,13 @@ gpu_calc_char_len(const AccessorRO<Pointer> acc_mapsz,
     return;
   const coord_t s = origin[0] + offset;
   const Pointer z = acc_mapsz[s];
+#ifdef RECOMPUTE_EDGE_GEOMETRY
+  const double area = geom.sarea(s, z);
+  const double base = geom.elen(s);
+#else
   const double area = acc_sarea[s];
   const double base = acc_elen[s];
+#endif
   const int np = acc_znump[z];
   const double fac = (np == 3 ? 3. : 4.);
   const double sdl = fac * area / base;
@@ -345,8 +388,12 @@ void Mesh::calcCharLenGPUTask(
         Context ctx,
         Runtime *runtime) {
     const AccessorRO<Pointer> acc_mapsz(regions[0], FID_MAPSZ);
+#ifdef RECOMPUTE_EDGE_GEOMETRY
+    const SideGeometry geom(regions, 0, 1, 3);
+#else
     const AccessorRO<double> acc_elen(regions[0], FID_ELEN);
     const AccessorRO<double> acc_sarea(regions[0], FID_SAREAP);
+#endif
     const AccessorRO<int> acc_znump(regions[1], FID_ZNUMP);
     const AccessorWD<double> acc_zdl(regions[2], FID_ZDL);
 
@@ -367,6 +414,11 @@ void Mesh::calcCharLenGPUTask(
     if (volume == 0)
       return;
     const size_t blocks = (volume + THREADS_PER_BLOCK - 1) / THREADS_PER_BLOCK;
+#ifdef RECOMPUTE_EDGE_GEOMETRY
+    gpu_calc_char_len<<<blocks,THREADS_PER_BLOCK>>>(acc_mapsz, geom,
+        acc_znump, acc_zdl, rects.lo, volume);
+#else
     gpu_calc_char_len<<<blocks,THREADS_PER_BLOCK>>>(acc_mapsz, acc_elen,
         acc_sarea, acc_znump, acc_zdl, rects.lo, volume);
+#endif
 }
@@ -20,6 +20,7 @@
 
 #include "legion.h"
 
+#include "MyLegion.hh"
 #include "Vec2.hh"
 #include "GenMesh.hh"
 #include "CudaHelp.hh"
@@ -29,6 +30,7 @@ class InputFile;
 class WriteXY;
 class ExportGold;
 class PennantMapper;
+class Partitioner;
 
 enum MeshFieldID {
     FID_NUMSBAD = 'M' * 100,
@@ -41,17 +43,26 @@ enum MeshFieldID {
     FID_MAPSS4,
     FID_MAPSP1REG,
     FID_MAPSP2REG,
+    FID_MAPSP1NODE,    // 1 if point 1 is shared only by pieces on this node
+    FID_MAPSP1GHOST,   // slot in lrgh if point 1 is a ghost point, else -1
+    FID_MAPZS1,        // first side of each zone, the rest follow it
+    FID_COLORSIDE,     // piece's sides in color order (COLOR_SIDE_SCATTERS)
+    FID_SIDECOLOR,     // color of the side in the same slot of COLORSIDE
     FID_MAPLOAD2DENSE, // map from load points to dense points
     FID_ZNUMP,
     FID_PX,
+#ifndef ALIAS_SCRATCH_FIELDS
     FID_EX,
+#endif
     FID_ZX,
     FID_PXP,
     FID_EXP,
     FID_ZXP,
     FID_PX0,
+#ifndef ALIAS_SCRATCH_FIELDS
     FID_SAREA,
     FID_SVOL,
+#endif
     FID_ZAREA,
     FID_ZVOL,
     FID_SAREAP,
@@ -65,7 +76,14 @@ enum MeshFieldID {
     FID_ZDL,
     FID_PIECE,
     FID_COUNT,
-    FID_RANGE
+    FID_RANGE,
+    FID_NEWPTR,        // where rebalancing moves a zone, side or point
+    FID_NEWMAPZS1,     // first side of each zone after rebalancing
+    FID_NEWPIECE,      // piece of a zone, or the lowest of a point's zones,
+    FID_MAXPIECE,      // and the highest, after rebalancing
+    FID_GHOSTP,        // ghost point that a slot of lrgh holds a partial for
+    FID_GHOSTMASWT,
+    FID_GHOSTF
 };
 
 enum HydroFieldID {
@@ -80,7 +98,9 @@ enum HydroFieldID {
     FID_ZRP,
     FID_ZE,
     FID_ZETOT,
+#ifndef ALIAS_SCRATCH_FIELDS
     FID_ZW,
+#endif
     FID_ZWRATE,
     FID_ZP,
     FID_ZSS,
@@ -91,19 +111,92 @@ enum HydroFieldID {
 };
 
 enum QCSFieldID {
-    FID_CAREA = 'Q' * 100,
-    FID_CEVOL,
+    FID_CEVOL = 'Q' * 100,
     FID_CDU,
     FID_CDIV,
+    FID_CRMU,
+#ifndef ALIAS_SCRATCH_FIELDS
+    FID_CAREA,
     FID_CCOS,
     FID_CQE1,
     FID_CQE2,
     FID_ZUC,
-    FID_CRMU,
-    FID_CW,
-    FID_ZTMP
+    FID_CW
+#endif
+};
+
+// Zone quantities that don't change once Hydro is set up, kept as
+// reciprocals so the cycle multiplies instead of dividing.  With
+// CACHE_INVARIANTS they are computed at the end of Hydro::init (and
+// again after a rebalance) into lrzc, a region of their own over the
+// zones, which the mapper then keeps in a small instance of its own
+// instead of in the one with all the zone fields.
+enum ConstFieldID {
+    FID_ZNUMPINV = 'C' * 100,  // 1 / znump
+    FID_ZMINV                  // 1 / zm
 };
 
+#ifdef ALIAS_SCRATCH_FIELDS
+// Per-cycle temporaries that are never live at the same time share
+// one field.  The phases are the launches of Hydro::doCycle in order,
+// and a quantity is live from the launch that writes it through the
+// last launch that reads it:
+//
+//   phase  launch               writes           last reads
+//    3     calcctrs (pred)      EXP ZXP
+//    4     calcvols (pred)      SAREAP SVOLP     SVOLP
+//                               ZAREAP ZVOLP
+//    5     calcsurfvecs         SSURFP
+//    6     calcedgelen          ELEN
+//   10     calcstatehalf                         ZVOLP
+//   11     calcforcepgas        SFP
+//   12     calcforcetts         SFT              SAREAP SSURFP ZAREAP
+//   13     setcornerdiv         ZUC CAREA CCOS   EXP ZXP ZUC
+//                               CDIV CEVOL CDU
+//   14     setqcnforce          CRMU CQE1 CQE2   CDIV CEVOL CDU CRMU
+//   15     setforceqcs          CW SFQ           CAREA CCOS CQE1 CQE2 CW
+//   16     setveldiff                            ELEN
+//   17     sumcrnrforce                          SFT
+//   21     calcctrs/vols (full) EX ZX SAREA SVOL EX ZX SAREA SVOL
+//   22     calcwork             ZW               SFP SFQ
+//   23     calcworkrate                          ZW
+//
+// Two quantities share a field only if one is dead before the other
+// is written, so no launch ever names the same field twice, and
+// Legion orders the reuse like any other write-after-read.  EX, ZX,
+// SAREA and SVOL are also read during Mesh and Hydro init, which
+// finishes before the first cycle writes anything aliased to them.
+enum ScratchFieldAlias {
+    FID_CAREA = FID_SAREAP,  // 13-15 after 4-12
+    FID_SAREA = FID_SAREAP,  // 21 after 13-15
+    FID_CCOS = FID_SVOLP,    // 13-15 after 4
+    FID_SVOL = FID_SVOLP,    // 21 after 13-15
+    FID_CW = FID_CDIV,       // 15 after 13-14
+    FID_CQE1 = FID_EXP,      // 14-15 after 3-13
+    FID_EX = FID_EXP,        // 21 after 14-15
+    FID_CQE2 = FID_SSURFP,   // 14-15 after 5-12
+    FID_ZUC = FID_ZX,        // 13 after 21 of the previous cycle
+    FID_ZW = FID_ZVOLP       // 22-23 after 4-10
+};
+#endif
+
+// Storage types of the QCS corner temporaries and the side forces.
+// Each one is written by one launch and read by a later launch of the
+// same cycle, so with FLOAT_TEMPORARIES they are kept in single
+// precision to cut their memory traffic in half.  Reads widen them
+// back to double and every sum they feed (point forces, zone work,
+// zone energy) stays double.
+#ifdef FLOAT_TEMPORARIES
+#ifdef ALIAS_SCRATCH_FIELDS
+#error FLOAT_TEMPORARIES cannot be used with ALIAS_SCRATCH_FIELDS
+#endif
+typedef float TempReal;
+typedef single2 TempReal2;
+#else
+typedef double TempReal;
+typedef double2 TempReal2;
+#endif
+
 enum MeshTaskID {
     TID_SUMTOPTSDBL = 'M' * 100,
     TID_CALCCTRS,
@@ -118,7 +211,11 @@ enum MeshTaskID {
     TID_CALCOWNERS,
     TID_CHECKBADSIDES,
     TID_TEMPGATHER,
-    TID_WRITE
+    TID_WRITE,
+    TID_CALCGHOSTRANGES,
+    TID_INITGHOSTS,
+    TID_CALCZONESIDES,
+    TID_CALCSIDECOLORS
 };
 
 enum MeshOpID {
@@ -133,6 +230,79 @@ enum ShardingID {
     PENNANT_SHARD_ID = 1,
 };
 
+// With COLOR_SIDE_SCATTERS each piece also lists its sides by color.
+// No two sides of one color have the same point 1, except in the last
+// color, which gets every side left over once a point has used up the
+// others, so the point scatters can run color by color with plain adds
+// and only the last color (normally empty) has to run serially.
+const int NUMSIDECOLORS = 8;
+
+// With RECOMPUTE_EDGE_GEOMETRY the predictor edge centers, edge
+// lengths, side areas and side surface vectors (EXP, ELEN, SAREAP,
+// SSURFP) aren't stored.  The tasks that used them recompute them
+// from the side's two points and its zone center, which costs less
+// than reading them back when a cycle is limited by memory bandwidth.
+// The side maps are read from regions[rs], ZXP from regions[rz], and
+// the private and shared PXP from regions[rp] and regions[rp + 1].
+#ifdef RECOMPUTE_EDGE_GEOMETRY
+#ifndef FUSED_QCS
+#error RECOMPUTE_EDGE_GEOMETRY needs FUSED_QCS
+#endif
+#ifdef ALIAS_SCRATCH_FIELDS
+#error RECOMPUTE_EDGE_GEOMETRY cannot be used with ALIAS_SCRATCH_FIELDS
+#endif
+#endif
+struct SideGeometry {
+    AccessorRO<Pointer> acc_mapsp1;
+    AccessorRO<Pointer> acc_mapsp2;
+    AccessorRO<int> acc_mapsp1reg;
+    AccessorRO<int> acc_mapsp2reg;
+    AccessorRO<double2> acc_zx;
+    AccessorRO<double2> acc_px0;
+    AccessorRO<double2> acc_px1;
+
+    SideGeometry(const std::vector<Legion::PhysicalRegion> &regions,
+            const int rs, const int rz, const int rp)
+        : acc_mapsp1(regions[rs], FID_MAPSP1),
+          acc_mapsp2(regions[rs], FID_MAPSP2),
+          acc_mapsp1reg(regions[rs], FID_MAPSP1REG),
+          acc_mapsp2reg(regions[rs], FID_MAPSP2REG),
+          acc_zx(regions[rz], FID_ZXP),
+          acc_px0(regions[rp], FID_PXP),
+          acc_px1(regions[rp + 1], FID_PXP) {}
+
+    __CUDA_HD__
+    inline double2 px1(const Pointer s) const {
+        const Pointer p = acc_mapsp1[s];
+        return (acc_mapsp1reg[s] == 0) ? acc_px0[p] : acc_px1[p];
+    }
+
+    __CUDA_HD__
+    inline double2 px2(const Pointer s) const {
+        const Pointer p = acc_mapsp2[s];
+        return (acc_mapsp2reg[s] == 0) ? acc_px0[p] : acc_px1[p];
+    }
+
+    // same as Mesh::calcEdgeLen
+    __CUDA_HD__
+    inline double elen(const Pointer s) const {
+        return length(px2(s) - px1(s));
+    }
+
+    // same as Mesh::calcVols
+    __CUDA_HD__
+    inline double sarea(const Pointer s, const Pointer z) const {
+        const double2 x1 = px1(s);
+        return 0.5 * cross(px2(s) - x1, acc_zx[z] - x1);
+    }
+
+    // same as Mesh::calcCtrs followed by Mesh::calcSurfVecs
+    __CUDA_HD__
+    inline double2 ssurf(const Pointer s, const Pointer z) const {
+        return rotateCCW(0.5 * (px1(s) + px2(s)) - acc_zx[z]);
+    }
+};
+
 // atomic versions of lhs += rhs
 template <typename T> __CUDA_HD__
 inline void atomic_add(T& lhs, const T& rhs);
@@ -349,19 +519,24 @@ public:
     struct CalcOwnersArgs {
     public:
         CalcOwnersArgs(Legion::IndexPartition priv, 
-                       Legion::IndexPartition shared)
-          : ip_private(priv), ip_shared(shared) { }
+                       Legion::IndexPartition shared,
+                       Legion::IndexPartition node_shared)
+          : ip_private(priv), ip_shared(shared), ip_node_shared(node_shared) { }
     public:
         Legion::IndexPartition ip_private;
         Legion::IndexPartition ip_shared;
+        Legion::IndexPartition ip_node_shared;
     };
 public:
 
     // children
     GenMesh* gmesh;
+    Partitioner* partitioner;
 
     // parameters
     int chunksize;                 // max size for processing chunks
+    bool keeppieces;               // keep FID_PIECE for rebalancing
+    bool memreport;                // print the bytes of every field
     std::vector<double> subregion; // bounding box for a subregion
                                    // if nonempty, should have 4 entries:
                                    // xmin, xmax, ymin, ymax
@@ -373,6 +548,9 @@ public:
                        // number of points, edges, zones,
                        // sides, corners, resp.
     int numpcs;        // number of pieces in Legion partition
+    size_t setupbytes, runbytes;
+                       // bytes of all the mesh fields at the end
+                       // of setup and once the setup ones are freed
 #if 0
     int* mapsp1;       // maps: side -> points 1 and 2
     int* mapsp2;
@@ -414,6 +592,17 @@ public:
     Legion::LogicalRegion lrglb;
     Legion::LogicalPartition lppall, lpz, lps;
     Legion::LogicalPartition lppprv, lppmstr, lppshr;
+    // shared points of each piece split by whether any piece on
+    // another node touches them (lppxshr) or not (lppnshr)
+    Legion::LogicalPartition lppnshr, lppxshr;
+    // with PULL_GHOST_POINTS each piece sums its corners into its own
+    // slots for the shared points it doesn't own (lpgh), and the owners
+    // then pull the slots of their points (lpghown) and add them up
+    Legion::LogicalRegion lrgh;
+    Legion::LogicalPartition lpgh, lpghown;
+    // with CACHE_INVARIANTS the zone constants, partitioned like lpz
+    Legion::LogicalRegion lrzc;
+    Legion::LogicalPartition lpzc;
     Legion::IndexSpace ispc;
     Legion::IndexPartition ippc;
     Legion::Domain dompc;
@@ -443,7 +632,54 @@ public:
             const int n);
 
     void init();
-    
+
+    // build the zone, side and point partitions of the pieces from
+    // FID_PIECE; with compact the points of lr_temp_points are first
+    // copied to a new lrp where each piece's points are dense
+    void initPieces(
+            Legion::LogicalRegion lr_temp_points,
+            Legion::LogicalPartition lp_points_equal,
+            const bool compact);
+
+    // split the shared points of the pieces into the ones shared only
+    // between pieces on the same node and the ones shared across nodes
+    void initNodePoints(
+            Legion::IndexSpace is_shr,
+            Legion::IndexPartition ip_mstr,
+            Legion::IndexPartition ip_shr,
+            Legion::IndexPartition& ip_nshr,
+            Legion::IndexPartition& ip_xshr);
+
+    // make the slots of lrgh and point the sides at them
+    void initGhostPoints(
+            Legion::IndexSpace is_shr,
+            Legion::IndexPartition ip_mstr,
+            Legion::IndexPartition ip_shr);
+
+    // move zones, sides and points between pieces so the measured
+    // piece times even out, then rebuild the piece partitions
+    void rebalance();
+
+    // free the fields that are only used while building the pieces
+    void releaseSetupFields();
+
+    // free the side forces and QCS temporaries of the force packages
+    // that Hydro has turned off
+    void releaseForceFields(const bool freetts, const bool freeqcs);
+
+    // bytes of all the fields of one element of fs
+    size_t calcFieldBytes(Legion::FieldSpace fs);
+
+    // bytes of all the fields of lr
+    size_t calcRegionBytes(Legion::LogicalRegion lr);
+
+    // estimate the bytes of the mesh fields in each memory and exit
+    // if they won't fit (call before anything is mapped)
+    void checkMemory(
+            Legion::FieldSpace fsp,
+            Legion::FieldSpace fsz,
+            Legion::FieldSpace fss);
+
     // write mesh statistics
     void writeStats();
 
@@ -627,6 +863,23 @@ public:
             Legion::LogicalPartition lp_sides,
             Legion::IndexPartition ip_private,
             Legion::IndexPartition ip_shared,
+            Legion::IndexPartition ip_node_shared,
+            Legion::IndexSpace is_piece);
+
+    void calcZoneSidesParallel(
+            Legion::Runtime *runtime,
+            Legion::Context ctx,
+            Legion::LogicalRegion lr_sides,
+            Legion::LogicalPartition lp_sides,
+            Legion::LogicalRegion lr_zones,
+            Legion::LogicalPartition lp_zones,
+            Legion::IndexSpace is_piece);
+
+    void calcSideColorsParallel(
+            Legion::Runtime *runtime,
+            Legion::Context ctx,
+            Legion::LogicalRegion lr_sides,
+            Legion::LogicalPartition lp_sides,
             Legion::IndexSpace is_piece);
 
     void calcCtrsParallel(
@@ -686,6 +939,18 @@ public:
             Legion::Context ctx,
             Legion::Runtime *runtime);
 
+    static void calcZoneSidesTask(
+            const Legion::Task *task,
+            const std::vector<Legion::PhysicalRegion> &regions,
+            Legion::Context ctx,
+            Legion::Runtime *runtime);
+
+    static void calcSideColorsTask(
+            const Legion::Task *task,
+            const std::vector<Legion::PhysicalRegion> &regions,
+            Legion::Context ctx,
+            Legion::Runtime *runtime);
+
     static void checkBadSidesTask(
             const Legion::Task *task,
             const std::vector<Legion::PhysicalRegion> &regions,
@@ -704,6 +969,18 @@ public:
             Legion::Context ctx,
             Legion::Runtime *runtime);
 
+    static Legion::coord_t calcGhostRangesTask(
+            const Legion::Task *task,
+            const std::vector<Legion::PhysicalRegion> &regions,
+            Legion::Context ctx,
+            Legion::Runtime *runtime);
+
+    static void initGhostsTask(
+            const Legion::Task *task,
+            const std::vector<Legion::PhysicalRegion> &regions,
+            Legion::Context ctx,
+            Legion::Runtime *runtime);
+
 }; // class Mesh
 
 
@@ -59,12 +59,14 @@ inline void check_double2_nan(const ACC &acc, const Legion::PhysicalRegion &regi
 
 // We provide specialized accessors here for double and double2 that check
 // for NaN values on creation for read privileges and on destruction for
-// write privileges
+// write privileges.  The read-only ones can also be made unbound, for
+// optional fields that a task only reads if its launcher asked for them.
 template<typename T>
 class AccessorRO : public Legion::FieldAccessor<LEGION_READ_ONLY,T,1,Legion::coord_t,
                                 Realm::AffineAccessor<T,1,Legion::coord_t> >
 {
 public:
+  AccessorRO(void) { }
   AccessorRO(const Legion::PhysicalRegion &region, Legion::FieldID fid)
     : Legion::FieldAccessor<LEGION_READ_ONLY,T,1,Legion::coord_t,
         Realm::AffineAccessor<T,1,Legion::coord_t> >(region, fid) { }
@@ -76,6 +78,7 @@ class AccessorRO<double> : public Legion::FieldAccessor<LEGION_READ_ONLY,double,
                                 Realm::AffineAccessor<double,1,Legion::coord_t> >
 {
 public:
+  AccessorRO(void) { }
   AccessorRO(const Legion::PhysicalRegion &region, Legion::FieldID fid)
     : Legion::FieldAccessor<LEGION_READ_ONLY,double,1,Legion::coord_t,
         Realm::AffineAccessor<double,1,Legion::coord_t> >(region, fid) 
@@ -88,6 +91,7 @@ class AccessorRO<double2> : public Legion::FieldAccessor<LEGION_READ_ONLY,double
                                 Realm::AffineAccessor<double2,1,Legion::coord_t> >
 {
 public:
+  AccessorRO(void) { }
   AccessorRO(const Legion::PhysicalRegion &region, Legion::FieldID fid)
     : Legion::FieldAccessor<LEGION_READ_ONLY,double2,1,Legion::coord_t,
         Realm::AffineAccessor<double2,1,Legion::coord_t> >(region, fid)
@@ -156,6 +160,7 @@ class AccessorRW : public Legion::FieldAccessor<LEGION_READ_WRITE,T,1,Legion::co
                                 Realm::AffineAccessor<T,1,Legion::coord_t> >
 {
 public:
+  AccessorRW(void) { }
   AccessorRW(const Legion::PhysicalRegion &reg, Legion::FieldID fid)
     : Legion::FieldAccessor<LEGION_READ_WRITE,T,1,Legion::coord_t,
         Realm::AffineAccessor<T,1,Legion::coord_t> >(reg, fid) { }
@@ -0,0 +1,946 @@
+/*
+ * Partitioner.cc
+ *
+ * Copyright (c) 2012, Los Alamos National Security, LLC.
+ * All rights reserved.
+ * Use of this source code is governed by a BSD-style open-source
+ * license; see top-level LICENSE file for full license text.
+ */
+
+#include "Partitioner.hh"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <algorithm>
+
+#include "legion.h"
+
+#include "MyLegion.hh"
+#include "Vec2.hh"
+#include "InputFile.hh"
+#include "Mesh.hh"
+#include "PennantMapper.hh"
+
+using namespace std;
+using namespace Legion;
+
+
+namespace {  // unnamed
+static void __attribute__ ((constructor)) registerTasks() {
+    {
+      TaskVariantRegistrar registrar(TID_PARTITIONZONESRCB, "CPU partition zones rcb");
+      registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+      registrar.set_leaf();
+      Runtime::preregister_task_variant<Partitioner::partitionZonesRCBTask>(
+          registrar, "partition zones rcb");
+    }
+    {
+      TaskVariantRegistrar registrar(TID_CALCPOINTPIECES, "CPU calc point pieces");
+      registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+      registrar.set_leaf();
+      Runtime::preregister_task_variant<Partitioner::calcPointPiecesTask>(
+          registrar, "calc point pieces");
+    }
+    {
+      TaskVariantRegistrar registrar(TID_CALCZONECTRS, "CPU calc zone ctrs");
+      registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+      registrar.set_leaf();
+      Runtime::preregister_task_variant<Partitioner::calcZoneCtrsTask>(
+          registrar, "calc zone ctrs");
+    }
+    {
+      TaskVariantRegistrar registrar(TID_REBALANCERCB, "CPU rebalance rcb");
+      registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+      registrar.set_leaf();
+      Runtime::preregister_task_variant<double, Partitioner::rebalanceRCBTask>(
+          registrar, "rebalance rcb");
+    }
+    {
+      TaskVariantRegistrar registrar(TID_CALCNEWPOINTPIECES, "CPU calc new point pieces");
+      registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+      registrar.set_leaf();
+      Runtime::preregister_task_variant<Partitioner::calcNewPointPiecesTask>(
+          registrar, "calc new point pieces");
+    }
+    {
+      TaskVariantRegistrar registrar(TID_CALCNEWPOINTS, "CPU calc new points");
+      registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+      registrar.set_leaf();
+      Runtime::preregister_task_variant<Partitioner::calcNewPointsTask>(
+          registrar, "calc new points");
+    }
+    {
+      TaskVariantRegistrar registrar(TID_REMAPMESH, "CPU remap mesh");
+      registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+      registrar.set_leaf();
+      Runtime::preregister_task_variant<Partitioner::remapMeshTask>(
+          registrar, "remap mesh");
+    }
+}
+
+struct ZoneCenter {
+    double2 x;
+    double w;           // weight, the zone's share of its piece's time
+    coord_t zone;       // offset from the first zone
+};
+
+bool lessX(const ZoneCenter& a, const ZoneCenter& b) { return a.x.x < b.x.x; }
+bool lessY(const ZoneCenter& a, const ZoneCenter& b) { return a.x.y < b.x.y; }
+
+// Recursively cut the zones in [first, last) in two at the weighted
+// median until each part is one piece of the block of pieces
+// [pcx0, pcx1) x [pcy0, pcy1).  Pieces keep their (x, y) numbering so
+// that neighboring pieces still end up on the same shard.
+void bisectZones(
+        vector<ZoneCenter>::iterator first,
+        vector<ZoneCenter>::iterator last,
+        const coord_t pcx0, const coord_t pcx1,
+        const coord_t pcy0, const coord_t pcy1,
+        const coord_t numpcx,
+        vector<coord_t>& zonepiece) {
+    if (first == last) return;
+    const coord_t npx = pcx1 - pcx0;
+    const coord_t npy = pcy1 - pcy0;
+    if (npx * npy == 1) {
+        const coord_t piece = pcy0 * numpcx + pcx0;
+        for (vector<ZoneCenter>::iterator it = first; it != last; ++it)
+            zonepiece[it->zone] = piece;
+        return;
+    }
+
+    double2 lo = first->x, hi = first->x;
+    for (vector<ZoneCenter>::iterator it = first; it != last; ++it) {
+        lo.x = min(lo.x, it->x.x);
+        lo.y = min(lo.y, it->x.y);
+        hi.x = max(hi.x, it->x.x);
+        hi.y = max(hi.y, it->x.y);
+    }
+    // cut across whichever direction gives the longest side per piece,
+    // so pieces come out close to square and have the fewest shared points
+    const bool cutx = (npy == 1) ||
+        (npx > 1 && (hi.x - lo.x) * npy >= (hi.y - lo.y) * npx);
+    const coord_t np = (cutx ? npx : npy);
+    const coord_t nplo = np / 2;
+    sort(first, last, (cutx ? lessX : lessY));
+    double wtot = 0.;
+    for (vector<ZoneCenter>::iterator it = first; it != last; ++it)
+        wtot += it->w;
+    // give each side weight in proportion to its number of pieces,
+    // but never fewer zones than pieces
+    const double wlo = wtot * nplo / np;
+    double wsum = 0.;
+    vector<ZoneCenter>::iterator mid = first;
+    while (mid != last && wsum + 0.5 * mid->w < wlo) {
+        wsum += mid->w;
+        ++mid;
+    }
+    if (last - first >= np) {
+        mid = max(mid, first + nplo);
+        mid = min(mid, last - (np - nplo));
+    }
+    if (cutx) {
+        bisectZones(first, mid, pcx0, pcx0 + nplo, pcy0, pcy1, numpcx, zonepiece);
+        bisectZones(mid, last, pcx0 + nplo, pcx1, pcy0, pcy1, numpcx, zonepiece);
+    } else {
+        bisectZones(first, mid, pcx0, pcx1, pcy0, pcy0 + nplo, numpcx, zonepiece);
+        bisectZones(mid, last, pcx0, pcx1, pcy0 + nplo, pcy1, numpcx, zonepiece);
+    }
+}
+
+// Zone centers, as the average of the zone's points, all with weight one
+void calcZoneCenters(
+        Runtime *runtime,
+        const PhysicalRegion& rs,
+        const RegionRequirement& reqs,
+        const FieldID fid_mapsp1,
+        const PhysicalRegion& rp,
+        const Rect<1>& rectz,
+        vector<ZoneCenter>& zones) {
+    const AccessorRO<Pointer> acc_mapsz(rs, FID_MAPSZ);
+    const AccessorRO<Pointer> acc_mapsp1(rs, fid_mapsp1);
+    const AccessorRO<double2> acc_px(rp, FID_PX);
+
+    const coord_t numz = rectz.volume();
+    zones.resize(numz);
+    vector<int> zonesides(numz, 0);
+    for (coord_t z = 0; z < numz; ++z) {
+        zones[z].x = make_double2(0., 0.);
+        zones[z].w = 1.;
+        zones[z].zone = z;
+    }
+    for (PointIterator its(runtime, reqs.region.get_index_space()); its(); its++) {
+        const coord_t z = acc_mapsz[*its][0] - rectz.lo[0];
+        zones[z].x += acc_px[acc_mapsp1[*its]];
+        zonesides[z] += 1;
+    }
+    for (coord_t z = 0; z < numz; ++z)
+        zones[z].x /= (double) zonesides[z];
+}
+
+// Reorder every field of a whole region in place, so that element i
+// ends up holding what was element perm[i]
+void permuteFields(
+        Runtime *runtime,
+        const PhysicalRegion& region,
+        const RegionRequirement& req,
+        const vector<coord_t>& perm) {
+    typedef FieldAccessor<LEGION_READ_WRITE,char,1,coord_t,
+            Realm::AffineAccessor<char,1,coord_t> > ByteAccessor;
+    const FieldSpace fs = req.region.get_field_space();
+    const coord_t lo = runtime->get_index_space_domain(
+            IndexSpaceT<1,coord_t>(req.region.get_index_space())).bounds.lo[0];
+    const coord_t n = perm.size();
+    vector<char> buffer;
+    for (set<FieldID>::const_iterator it = req.privilege_fields.begin();
+            it != req.privilege_fields.end(); ++it) {
+        const size_t size = runtime->get_field_size(fs, *it);
+        const ByteAccessor acc(region, *it, size);
+        buffer.resize(n * size);
+        for (coord_t i = 0; i < n; ++i)
+            memcpy(&buffer[i * size], acc.ptr(Pointer(lo + perm[i])), size);
+        for (coord_t i = 0; i < n; ++i)
+            memcpy(acc.ptr(Pointer(lo + i)), &buffer[i * size], size);
+    }
+}
+
+// Renumber pointers after a permutation, given its inverse
+void remapPointers(
+        const PhysicalRegion& region,
+        const FieldID fid,
+        const coord_t lo,
+        const coord_t n,
+        const coord_t targetlo,
+        const vector<coord_t>& inv) {
+    const AccessorRW<Pointer> acc(region, fid);
+    for (coord_t i = 0; i < n; ++i) {
+        const Pointer p = acc[Pointer(lo + i)];
+        acc[Pointer(lo + i)] = Pointer(targetlo + inv[p[0] - targetlo]);
+    }
+}
+
+// Put the zones of each piece next to each other, in piece order, and
+// then the sides in the order of their zones, so every piece's zones
+// and sides are dense like they are with the generated block pieces
+void renumberZones(
+        Runtime *runtime,
+        const PhysicalRegion& rz,
+        const RegionRequirement& reqz,
+        const PhysicalRegion& rs,
+        const RegionRequirement& reqs,
+        const vector<coord_t>& zonepiece) {
+    const Rect<1> rectz = runtime->get_index_space_domain(
+            IndexSpaceT<1,coord_t>(reqz.region.get_index_space())).bounds;
+    const Rect<1> rects = runtime->get_index_space_domain(
+            IndexSpaceT<1,coord_t>(reqs.region.get_index_space())).bounds;
+    const coord_t numz = rectz.volume();
+    const coord_t nums = rects.volume();
+
+    // the sides of each zone are already contiguous
+    vector<coord_t> zonefirst(numz, -1), zonesides(numz, 0);
+    {
+        const AccessorRW<Pointer> acc_mapsz(rs, FID_MAPSZ);
+        for (coord_t s = 0; s < nums; ++s) {
+            const coord_t z = acc_mapsz[Pointer(rects.lo[0] + s)][0] - rectz.lo[0];
+            if (zonefirst[z] < 0) zonefirst[z] = s;
+            assert(zonefirst[z] + zonesides[z] == s);
+            zonesides[z] += 1;
+        }
+    }
+
+    vector<coord_t> zperm(numz);
+    for (coord_t z = 0; z < numz; ++z)
+        zperm[z] = z;
+    stable_sort(zperm.begin(), zperm.end(),
+            [&zonepiece](coord_t z1, coord_t z2)
+            { return zonepiece[z1] < zonepiece[z2]; });
+    vector<coord_t> zinv(numz);
+    for (coord_t z = 0; z < numz; ++z)
+        zinv[zperm[z]] = z;
+
+    vector<coord_t> sperm;
+    sperm.reserve(nums);
+    for (coord_t z = 0; z < numz; ++z)
+        for (coord_t i = 0; i < zonesides[zperm[z]]; ++i)
+            sperm.push_back(zonefirst[zperm[z]] + i);
+    vector<coord_t> sinv(nums);
+    for (coord_t s = 0; s < nums; ++s)
+        sinv[sperm[s]] = s;
+
+    permuteFields(runtime, rz, reqz, zperm);
+    permuteFields(runtime, rs, reqs, sperm);
+    remapPointers(rs, FID_MAPSZ, rects.lo[0], nums, rectz.lo[0], zinv);
+    remapPointers(rs, FID_MAPSS3, rects.lo[0], nums, rects.lo[0], sinv);
+    remapPointers(rs, FID_MAPSS4, rects.lo[0], nums, rects.lo[0], sinv);
+
+    const AccessorRW<Pointer> acc_piece(rz, FID_PIECE);
+    for (coord_t z = 0; z < numz; ++z)
+        acc_piece[Pointer(rectz.lo[0] + z)] = Pointer(zonepiece[zperm[z]]);
+}
+
+// Scatter every field of the elements in each piece of lp into lrtmp,
+// at the place the FID_NEWPTR field of the same piece of lpnew says
+// (lrtmp is read-write since the points go in two scatters)
+void scatterFields(
+        Runtime *runtime,
+        Context ctx,
+        IndexSpace is_piece,
+        LogicalRegion lr,
+        LogicalPartition lp,
+        LogicalRegion lrtmp,
+        LogicalRegion lrnew,
+        LogicalPartition lpnew) {
+    vector<FieldID> fields;
+    runtime->get_field_space_fields(ctx, lr.get_field_space(), fields);
+    IndexCopyLauncher launcher(is_piece);
+    launcher.add_copy_requirements(
+        RegionRequirement(lp, 0/*identity projection*/,
+            LEGION_READ_ONLY, LEGION_EXCLUSIVE, lr),
+        RegionRequirement(lrtmp, 0/*identity projection*/,
+            LEGION_READ_WRITE, LEGION_EXCLUSIVE, lrtmp));
+    for (vector<FieldID>::const_iterator it = fields.begin();
+          it != fields.end(); it++) {
+        launcher.add_src_field(0/*index*/, *it);
+        launcher.add_dst_field(0/*index*/, *it);
+    }
+    launcher.add_dst_indirect_field(FID_NEWPTR,
+        RegionRequirement(lpnew, 0/*identity projection*/,
+            LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrnew));
+    launcher.possible_dst_indirect_out_of_range = false;
+    launcher.possible_dst_indirect_aliasing = false;
+    runtime->issue_copy_operation(ctx, launcher);
+}
+
+// Copy every field of lrtmp back into lr, a piece of lp at a time
+void copyFieldsBack(
+        Runtime *runtime,
+        Context ctx,
+        IndexSpace is_piece,
+        LogicalRegion lr,
+        LogicalPartition lp,
+        LogicalRegion lrtmp) {
+    vector<FieldID> fields;
+    runtime->get_field_space_fields(ctx, lr.get_field_space(), fields);
+    const LogicalPartition lptmp = runtime->get_logical_partition_by_tree(
+        lp.get_index_partition(), lrtmp.get_field_space(), lrtmp.get_tree_id());
+    IndexCopyLauncher launcher(is_piece);
+    launcher.add_copy_requirements(
+        RegionRequirement(lptmp, 0/*identity projection*/,
+            LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrtmp),
+        RegionRequirement(lp, 0/*identity projection*/,
+            LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, lr));
+    for (vector<FieldID>::const_iterator it = fields.begin();
+          it != fields.end(); it++) {
+        launcher.add_src_field(0/*index*/, *it);
+        launcher.add_dst_field(0/*index*/, *it);
+    }
+    runtime->issue_copy_operation(ctx, launcher);
+}
+}; // namespace
+
+
+Partitioner::Partitioner(const InputFile* inp) {
+    method = inp->getString("partitioner", "grid");
+    if (method != "grid" && method != "rcb") {
+        cerr << "Error:  invalid partitioner " << method << endl;
+        exit(1);
+    }
+#ifdef PRECOMPACTED_RECT_POINTS
+    // the precompacted point numbering assumes block pieces
+    if (method != "grid") {
+        cerr << "Error:  partitioner " << method <<
+                " needs a build without PRECOMPACTED_RECT_POINTS" << endl;
+        exit(1);
+    }
+#endif
+}
+
+
+Partitioner::~Partitioner() {}
+
+
+void Partitioner::partitionZones(
+        const coord_t numpcx,
+        const coord_t numpcy,
+        Runtime *runtime,
+        Context ctx,
+        LogicalRegion lrz,
+        LogicalRegion lrs,
+        LogicalRegion lr_temp_points) {
+    if (isGrid()) return;
+
+    // this needs the whole mesh at once, but only runs during setup;
+    // it reorders everything GenMesh has written so far for zones and sides
+    const RCBArgs args(numpcx, numpcy);
+    TaskLauncher launcher(TID_PARTITIONZONESRCB, TaskArgument(&args, sizeof(args)));
+    launcher.add_region_requirement(
+        RegionRequirement(lrs, LEGION_READ_WRITE, LEGION_EXCLUSIVE, lrs));
+    launcher.add_field(0/*index*/, FID_MAPSZ);
+    launcher.add_field(0/*index*/, FID_MAPSP1TEMP);
+    launcher.add_field(0/*index*/, FID_MAPSP2TEMP);
+    launcher.add_field(0/*index*/, FID_MAPSS3);
+    launcher.add_field(0/*index*/, FID_MAPSS4);
+    launcher.add_region_requirement(
+        RegionRequirement(lr_temp_points, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lr_temp_points));
+    launcher.add_field(1/*index*/, FID_PX);
+    launcher.add_region_requirement(
+        RegionRequirement(lrz, LEGION_READ_WRITE, LEGION_EXCLUSIVE, lrz));
+    launcher.add_field(2/*index*/, FID_ZNUMP);
+    launcher.add_field(2/*index*/, FID_PIECE);
+    runtime->execute_task(ctx, launcher);
+}
+
+
+void Partitioner::partitionPoints(
+        const coord_t numpcs,
+        Runtime *runtime,
+        Context ctx,
+        LogicalRegion lr_temp_points,
+        LogicalPartition lp_reachable_points,
+        IndexSpace is_piece) {
+    if (isGrid()) return;
+
+    FillLauncher fill(lr_temp_points, lr_temp_points,
+        TaskArgument(&numpcs, sizeof(numpcs)));
+    fill.add_field(FID_PIECE);
+    runtime->fill_fields(ctx, fill);
+
+    IndexTaskLauncher launcher(TID_CALCPOINTPIECES, is_piece,
+        TaskArgument(), ArgumentMap());
+    launcher.add_region_requirement(
+        RegionRequirement(lp_reachable_points, 0/*identity projection*/,
+            LEGION_REDOP_MIN_INT64, LEGION_SIMULTANEOUS, lr_temp_points));
+    launcher.add_field(0/*index*/, FID_PIECE);
+    runtime->execute_index_space(ctx, launcher);
+}
+
+
+Future Partitioner::rebalance(
+        const coord_t numpcx,
+        const coord_t numpcy,
+        Runtime *runtime,
+        Context ctx,
+        LogicalRegion lrz,
+        LogicalRegion lrs,
+        LogicalRegion lrp,
+        LogicalPartition lpz,
+        LogicalPartition lps,
+        LogicalPartition lppprv,
+        LogicalPartition lppmstr,
+        LogicalPartition lppshr,
+        IndexSpace is_piece) {
+    const coord_t numpcs = numpcx * numpcy;
+
+    // regions of their own for where everything goes, which only
+    // live for this, partitioned into the same pieces as the mesh
+    FieldSpace fszt = runtime->create_field_space(ctx);
+    {
+      FieldAllocator fa = runtime->create_field_allocator(ctx, fszt);
+      fa.allocate_field(sizeof(double2), FID_ZX);
+      fa.allocate_field(sizeof(Pointer), FID_NEWPTR);
+      fa.allocate_field(sizeof(Pointer), FID_NEWMAPZS1);
+      fa.allocate_field(sizeof(coord_t), FID_NEWPIECE);
+    }
+    FieldSpace fsst = runtime->create_field_space(ctx);
+    {
+      FieldAllocator fa = runtime->create_field_allocator(ctx, fsst);
+      fa.allocate_field(sizeof(Pointer), FID_NEWPTR);
+    }
+    FieldSpace fspt = runtime->create_field_space(ctx);
+    {
+      FieldAllocator fa = runtime->create_field_allocator(ctx, fspt);
+      fa.allocate_field(sizeof(Pointer), FID_NEWPTR);
+      fa.allocate_field(sizeof(coord_t), FID_NEWPIECE);
+      fa.allocate_field(sizeof(coord_t), FID_MAXPIECE);
+    }
+    LogicalRegion lrzt = runtime->create_logical_region(ctx, lrz.get_index_space(), fszt);
+    LogicalRegion lrst = runtime->create_logical_region(ctx, lrs.get_index_space(), fsst);
+    LogicalRegion lrpt = runtime->create_logical_region(ctx, lrp.get_index_space(), fspt);
+    const LogicalPartition lpzt = runtime->get_logical_partition_by_tree(
+        lpz.get_index_partition(), fszt, lrzt.get_tree_id());
+    const LogicalPartition lpst = runtime->get_logical_partition_by_tree(
+        lps.get_index_partition(), fsst, lrst.get_tree_id());
+    const LogicalPartition lpptprv = runtime->get_logical_partition_by_tree(
+        lppprv.get_index_partition(), fspt, lrpt.get_tree_id());
+    const LogicalPartition lpptmstr = runtime->get_logical_partition_by_tree(
+        lppmstr.get_index_partition(), fspt, lrpt.get_tree_id());
+    const LogicalPartition lpptshr = runtime->get_logical_partition_by_tree(
+        lppshr.get_index_partition(), fspt, lrpt.get_tree_id());
+
+    // each piece finds the centers of its own zones
+    {
+      IndexTaskLauncher launcher(TID_CALCZONECTRS, is_piece,
+          TaskArgument(), ArgumentMap());
+      launcher.add_region_requirement(
+          RegionRequirement(lps, 0/*identity projection*/,
+            LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrs));
+      launcher.add_field(0/*index*/, FID_MAPSZ);
+      launcher.add_field(0/*index*/, FID_MAPSP1);
+      launcher.add_field(0/*index*/, FID_MAPSP1REG);
+      launcher.add_region_requirement(
+          RegionRequirement(lppprv, 0/*identity projection*/,
+            LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrp));
+      launcher.add_field(1/*index*/, FID_PX);
+      launcher.add_region_requirement(
+          RegionRequirement(lppshr, 0/*identity projection*/,
+            LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrp));
+      launcher.add_field(2/*index*/, FID_PX);
+      launcher.add_region_requirement(
+          RegionRequirement(lpzt, 0/*identity projection*/,
+            LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, lrzt));
+      launcher.add_field(3/*index*/, FID_ZX);
+      runtime->execute_index_space(ctx, launcher);
+    }
+
+    // the rcb only needs the zone centers, pieces and side counts, and
+    // the times the mappers measured for each piece in every process
+    Future f_times = runtime->select_tunable_value(ctx,
+        PennantMapper::PIECE_TIMES_TUNABLE);
+    Future f_imbalance;
+    {
+      const RCBArgs args(numpcx, numpcy);
+      TaskLauncher launcher(TID_REBALANCERCB, TaskArgument(&args, sizeof(args)));
+      launcher.add_region_requirement(
+          RegionRequirement(lrz, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrz));
+      launcher.add_field(0/*index*/, FID_PIECE);
+      launcher.add_field(0/*index*/, FID_ZNUMP);
+      launcher.add_field(0/*index*/, FID_MAPZS1);
+      launcher.add_region_requirement(
+          RegionRequirement(lrzt, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrzt));
+      launcher.add_field(1/*index*/, FID_ZX);
+      launcher.add_region_requirement(
+          RegionRequirement(lrzt, LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, lrzt));
+      launcher.add_field(2/*index*/, FID_NEWPTR);
+      launcher.add_field(2/*index*/, FID_NEWMAPZS1);
+      launcher.add_field(2/*index*/, FID_NEWPIECE);
+      launcher.add_future(f_times);
+      f_imbalance = runtime->execute_task(ctx, launcher);
+    }
+
+    // each piece marks its points with the lowest and highest of the
+    // new pieces of their zones, which only takes the point numbers
+    // to put in order afterwards
+    {
+      FillLauncher fill(lrpt, lrpt, TaskArgument(&numpcs, sizeof(numpcs)));
+      fill.add_field(FID_NEWPIECE);
+      runtime->fill_fields(ctx, fill);
+    }
+    {
+      const coord_t none = -1;
+      FillLauncher fill(lrpt, lrpt, TaskArgument(&none, sizeof(none)));
+      fill.add_field(FID_MAXPIECE);
+      runtime->fill_fields(ctx, fill);
+    }
+    {
+      IndexTaskLauncher launcher(TID_CALCNEWPOINTPIECES, is_piece,
+          TaskArgument(), ArgumentMap());
+      launcher.add_region_requirement(
+          RegionRequirement(lps, 0/*identity projection*/,
+            LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrs));
+      launcher.add_field(0/*index*/, FID_MAPSZ);
+      launcher.add_field(0/*index*/, FID_MAPSP1);
+      launcher.add_field(0/*index*/, FID_MAPSP1REG);
+      launcher.add_region_requirement(
+          RegionRequirement(lpzt, 0/*identity projection*/,
+            LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrzt));
+      launcher.add_field(1/*index*/, FID_NEWPIECE);
+      launcher.add_region_requirement(
+          RegionRequirement(lpptprv, 0/*identity projection*/,
+            LEGION_READ_WRITE, LEGION_EXCLUSIVE, lrpt));
+      launcher.add_field(2/*index*/, FID_NEWPIECE);
+      launcher.add_field(2/*index*/, FID_MAXPIECE);
+      launcher.add_region_requirement(
+          RegionRequirement(lpptshr, 0/*identity projection*/,
+            LEGION_REDOP_MIN_INT64, LEGION_SIMULTANEOUS, lrpt));
+      launcher.add_field(3/*index*/, FID_NEWPIECE);
+      launcher.add_region_requirement(
+          RegionRequirement(lpptshr, 0/*identity projection*/,
+            LEGION_REDOP_MAX_INT64, LEGION_SIMULTANEOUS, lrpt));
+      launcher.add_field(4/*index*/, FID_MAXPIECE);
+      runtime->execute_index_space(ctx, launcher);
+    }
+    {
+      TaskLauncher launcher(TID_CALCNEWPOINTS, TaskArgument(&numpcs, sizeof(numpcs)));
+      launcher.add_region_requirement(
+          RegionRequirement(lrpt, LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrpt));
+      launcher.add_field(0/*index*/, FID_NEWPIECE);
+      launcher.add_field(0/*index*/, FID_MAXPIECE);
+      launcher.add_region_requirement(
+          RegionRequirement(lrpt, LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, lrpt));
+      launcher.add_field(1/*index*/, FID_NEWPTR);
+      runtime->execute_task(ctx, launcher);
+    }
+
+    // each piece renumbers the pointers and pieces of its own zones,
+    // sides and points, and finds where its sides go
+    {
+      IndexTaskLauncher launcher(TID_REMAPMESH, is_piece,
+          TaskArgument(), ArgumentMap());
+      launcher.add_region_requirement(
+          RegionRequirement(lps, 0/*identity projection*/,
+            LEGION_READ_WRITE, LEGION_EXCLUSIVE, lrs));
+      launcher.add_field(0/*index*/, FID_MAPSZ);
+      launcher.add_field(0/*index*/, FID_MAPSP1);
+      launcher.add_field(0/*index*/, FID_MAPSP2);
+      launcher.add_field(0/*index*/, FID_MAPSS3);
+      launcher.add_field(0/*index*/, FID_MAPSS4);
+      launcher.add_region_requirement(
+          RegionRequirement(lps, 0/*identity projection*/,
+            LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrs));
+      launcher.add_field(1/*index*/, FID_MAPSP1REG);
+      launcher.add_field(1/*index*/, FID_MAPSP2REG);
+      launcher.add_region_requirement(
+          RegionRequirement(lpz, 0/*identity projection*/,
+            LEGION_READ_WRITE, LEGION_EXCLUSIVE, lrz));
+      launcher.add_field(2/*index*/, FID_PIECE);
+      launcher.add_field(2/*index*/, FID_MAPZS1);
+      launcher.add_region_requirement(
+          RegionRequirement(lpzt, 0/*identity projection*/,
+            LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrzt));
+      launcher.add_field(3/*index*/, FID_NEWPTR);
+      launcher.add_field(3/*index*/, FID_NEWMAPZS1);
+      launcher.add_field(3/*index*/, FID_NEWPIECE);
+      launcher.add_region_requirement(
+          RegionRequirement(lpst, 0/*identity projection*/,
+            LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, lrst));
+      launcher.add_field(4/*index*/, FID_NEWPTR);
+      launcher.add_region_requirement(
+          RegionRequirement(lpptprv, 0/*identity projection*/,
+            LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrpt));
+      launcher.add_field(5/*index*/, FID_NEWPTR);
+      launcher.add_field(5/*index*/, FID_NEWPIECE);
+      launcher.add_region_requirement(
+          RegionRequirement(lpptshr, 0/*identity projection*/,
+            LEGION_READ_ONLY, LEGION_EXCLUSIVE, lrpt));
+      launcher.add_field(6/*index*/, FID_NEWPTR);
+      launcher.add_field(6/*index*/, FID_NEWPIECE);
+      launcher.add_region_requirement(
+          RegionRequirement(lppprv, 0/*identity projection*/,
+            LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, lrp));
+      launcher.add_field(7/*index*/, FID_PIECE);
+      launcher.add_region_requirement(
+          RegionRequirement(lppmstr, 0/*identity projection*/,
+            LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, lrp));
+      launcher.add_field(8/*index*/, FID_PIECE);
+      runtime->execute_index_space(ctx, launcher);
+    }
+
+    // then every field moves with copies between the pieces, scattered
+    // into a second copy of each region and copied back from there
+    LogicalRegion lrztmp = runtime->create_logical_region(ctx,
+        lrz.get_index_space(), lrz.get_field_space());
+    LogicalRegion lrstmp = runtime->create_logical_region(ctx,
+        lrs.get_index_space(), lrs.get_field_space());
+    LogicalRegion lrptmp = runtime->create_logical_region(ctx,
+        lrp.get_index_space(), lrp.get_field_space());
+    scatterFields(runtime, ctx, is_piece, lrz, lpz, lrztmp, lrzt, lpzt);
+    scatterFields(runtime, ctx, is_piece, lrs, lps, lrstmp, lrst, lpst);
+    scatterFields(runtime, ctx, is_piece, lrp, lppprv, lrptmp, lrpt, lpptprv);
+    scatterFields(runtime, ctx, is_piece, lrp, lppmstr, lrptmp, lrpt, lpptmstr);
+    copyFieldsBack(runtime, ctx, is_piece, lrz, lpz, lrztmp);
+    copyFieldsBack(runtime, ctx, is_piece, lrs, lps, lrstmp);
+    copyFieldsBack(runtime, ctx, is_piece, lrp, lppprv, lrptmp);
+    copyFieldsBack(runtime, ctx, is_piece, lrp, lppmstr, lrptmp);
+
+    runtime->destroy_logical_region(ctx, lrztmp);
+    runtime->destroy_logical_region(ctx, lrstmp);
+    runtime->destroy_logical_region(ctx, lrptmp);
+    runtime->destroy_logical_region(ctx, lrzt);
+    runtime->destroy_logical_region(ctx, lrst);
+    runtime->destroy_logical_region(ctx, lrpt);
+    runtime->destroy_field_space(ctx, fszt);
+    runtime->destroy_field_space(ctx, fsst);
+    runtime->destroy_field_space(ctx, fspt);
+    return f_imbalance;
+}
+
+
+void Partitioner::partitionZonesRCBTask(
+        const Task *task,
+        const std::vector<PhysicalRegion> &regions,
+        Context ctx,
+        Runtime *runtime) {
+    const RCBArgs *args = reinterpret_cast<const RCBArgs*>(task->args);
+
+    const IndexSpace& isz = task->regions[2].region.get_index_space();
+    const Rect<1> rectz = runtime->get_index_space_domain(
+            IndexSpaceT<1,coord_t>(isz)).bounds;
+    const coord_t numz = rectz.volume();
+
+    vector<ZoneCenter> zones;
+    calcZoneCenters(runtime, regions[0], task->regions[0], FID_MAPSP1TEMP,
+            regions[1], rectz, zones);
+
+    vector<coord_t> zonepiece(numz);
+    bisectZones(zones.begin(), zones.end(), 0, args->numpcx, 0, args->numpcy,
+            args->numpcx, zonepiece);
+
+    renumberZones(runtime, regions[2], task->regions[2],
+            regions[0], task->regions[0], zonepiece);
+}
+
+
+void Partitioner::calcPointPiecesTask(
+        const Task *task,
+        const std::vector<PhysicalRegion> &regions,
+        Context ctx,
+        Runtime *runtime) {
+    const AccessorRD<MinReduction<int64_t>,false/*exclusive*/>
+        acc_piece(regions[0], FID_PIECE, LEGION_REDOP_MIN_INT64);
+    const int64_t piece = task->index_point[0];
+
+    const IndexSpace& isp = task->regions[0].region.get_index_space();
+    for (PointIterator itp(runtime, isp); itp(); itp++)
+        acc_piece[*itp] <<= piece;
+}
+
+
+void Partitioner::calcZoneCtrsTask(
+        const Task *task,
+        const std::vector<PhysicalRegion> &regions,
+        Context ctx,
+        Runtime *runtime) {
+    const AccessorRO<Pointer> acc_mapsz(regions[0], FID_MAPSZ);
+    const AccessorRO<Pointer> acc_mapsp1(regions[0], FID_MAPSP1);
+    const AccessorRO<int> acc_mapsp1reg(regions[0], FID_MAPSP1REG);
+    const AccessorRO<double2> acc_px[2] = {
+        AccessorRO<double2>(regions[1], FID_PX),
+        AccessorRO<double2>(regions[2], FID_PX)
+    };
+    const AccessorWD<double2> acc_zx(regions[3], FID_ZX);
+
+    const IndexSpace& isz = task->regions[3].region.get_index_space();
+    const Rect<1> rectz = runtime->get_index_space_domain(
+            IndexSpaceT<1,coord_t>(isz)).bounds;
+    const coord_t numz = rectz.volume();
+    if (numz <= 0) return;
+
+    // the average of the zone's points, like calcZoneCenters
+    vector<double2> zx(numz, make_double2(0., 0.));
+    vector<int> zonesides(numz, 0);
+    const IndexSpace& iss = task->regions[0].region.get_index_space();
+    for (PointIterator its(runtime, iss); its(); its++) {
+        const coord_t z = acc_mapsz[*its][0] - rectz.lo[0];
+        zx[z] += acc_px[acc_mapsp1reg[*its]][acc_mapsp1[*its]];
+        zonesides[z] += 1;
+    }
+    for (coord_t z = 0; z < numz; ++z)
+        acc_zx[Pointer(rectz.lo[0] + z)] = zx[z] / (double) zonesides[z];
+}
+
+
+double Partitioner::rebalanceRCBTask(
+        const Task *task,
+        const std::vector<PhysicalRegion> &regions,
+        Context ctx,
+        Runtime *runtime) {
+    const RCBArgs *args = reinterpret_cast<const RCBArgs*>(task->args);
+    const coord_t numpcs = args->numpcx * args->numpcy;
+
+    const AccessorRO<Pointer> acc_zpiece(regions[0], FID_PIECE);
+    const AccessorRO<int> acc_znump(regions[0], FID_ZNUMP);
+    const AccessorRO<Pointer> acc_mapzs1(regions[0], FID_MAPZS1);
+    const AccessorRO<double2> acc_zx(regions[1], FID_ZX);
+    const AccessorWD<Pointer> acc_znew(regions[2], FID_NEWPTR);
+    const AccessorWD<Pointer> acc_mapzs1new(regions[2], FID_NEWMAPZS1);
+    const AccessorWD<coord_t> acc_zpiecenew(regions[2], FID_NEWPIECE);
+
+    const IndexSpace& isz = task->regions[0].region.get_index_space();
+    const Rect<1> rectz = runtime->get_index_space_domain(
+            IndexSpaceT<1,coord_t>(isz)).bounds;
+    const coord_t numz = rectz.volume();
+
+    // the mappers' PIECE_TIMES_TUNABLE, one time for every piece
+    assert(task->futures[0].get_untyped_size() == numpcs * sizeof(double));
+    const double *piecetime =
+        (const double*) task->futures[0].get_untyped_pointer();
+    double timetot = 0., timemax = 0.;
+    bool timed = true;
+    for (coord_t pc = 0; pc < numpcs; ++pc) {
+        timetot += piecetime[pc];
+        timemax = max(timemax, piecetime[pc]);
+        timed = timed && (piecetime[pc] > 0.);
+    }
+
+    vector<ZoneCenter> zones(numz);
+    for (coord_t z = 0; z < numz; ++z) {
+        zones[z].x = acc_zx[Pointer(rectz.lo[0] + z)];
+        zones[z].w = 1.;
+        zones[z].zone = z;
+    }
+    // spread each piece's time evenly over its zones; if some piece
+    // wasn't timed just cut the zones evenly again, and say so
+    if (timed) {
+        vector<coord_t> piecezones(numpcs, 0);
+        for (coord_t z = 0; z < numz; ++z)
+            piecezones[acc_zpiece[Pointer(rectz.lo[0] + z)][0]] += 1;
+        for (coord_t z = 0; z < numz; ++z) {
+            const coord_t pc = acc_zpiece[Pointer(rectz.lo[0] + z)][0];
+            zones[z].w = piecetime[pc] / piecezones[pc];
+        }
+    }
+
+    vector<coord_t> zonepiece(numz);
+    bisectZones(zones.begin(), zones.end(), 0, args->numpcx, 0, args->numpcy,
+            args->numpcx, zonepiece);
+
+    // put the zones of each piece next to each other, in piece order,
+    // and give each zone's sides the same order, so every piece's zones
+    // and sides are dense like they are with the generated block pieces
+    vector<coord_t> piecefirst(numpcs, 0);
+    for (coord_t z = 0; z < numz; ++z)
+        if (zonepiece[z] + 1 < numpcs)
+            piecefirst[zonepiece[z] + 1] += 1;
+    for (coord_t pc = 1; pc < numpcs; ++pc)
+        piecefirst[pc] += piecefirst[pc - 1];
+    vector<coord_t> znew(numz), newznump(numz);
+    coord_t s1 = numeric_limits<coord_t>::max();
+    for (coord_t z = 0; z < numz; ++z) {
+        const Pointer pz(rectz.lo[0] + z);
+        znew[z] = piecefirst[zonepiece[z]]++;
+        newznump[znew[z]] = acc_znump[pz];
+        s1 = min(s1, acc_mapzs1[pz][0]);
+    }
+    vector<coord_t> newmapzs1(numz);
+    for (coord_t zn = 0; zn < numz; ++zn) {
+        newmapzs1[zn] = s1;
+        s1 += newznump[zn];
+    }
+    for (coord_t z = 0; z < numz; ++z) {
+        const Pointer pz(rectz.lo[0] + z);
+        acc_znew[pz] = Pointer(rectz.lo[0] + znew[z]);
+        acc_mapzs1new[pz] = Pointer(newmapzs1[znew[z]]);
+        acc_zpiecenew[pz] = zonepiece[z];
+    }
+
+    if (!timed) return 0.;
+    return timemax * numpcs / timetot;
+}
+
+
+void Partitioner::calcNewPointPiecesTask(
+        const Task *task,
+        const std::vector<PhysicalRegion> &regions,
+        Context ctx,
+        Runtime *runtime) {
+    const AccessorRO<Pointer> acc_mapsz(regions[0], FID_MAPSZ);
+    const AccessorRO<Pointer> acc_mapsp1(regions[0], FID_MAPSP1);
+    const AccessorRO<int> acc_mapsp1reg(regions[0], FID_MAPSP1REG);
+    const AccessorRO<coord_t> acc_zpiece(regions[1], FID_NEWPIECE);
+    const AccessorRW<coord_t> acc_pmin(regions[2], FID_NEWPIECE);
+    const AccessorRW<coord_t> acc_pmax(regions[2], FID_MAXPIECE);
+    const AccessorRD<MinReduction<int64_t>,false/*exclusive*/>
+        acc_shrmin(regions[3], FID_NEWPIECE, LEGION_REDOP_MIN_INT64);
+    const AccessorRD<MaxReduction<int64_t>,false/*exclusive*/>
+        acc_shrmax(regions[4], FID_MAXPIECE, LEGION_REDOP_MAX_INT64);
+
+    const IndexSpace& iss = task->regions[0].region.get_index_space();
+    for (PointIterator its(runtime, iss); its(); its++) {
+        const coord_t piece = acc_zpiece[acc_mapsz[*its]];
+        const Pointer p = acc_mapsp1[*its];
+        if (acc_mapsp1reg[*its] == 0) {
+            acc_pmin[p] = min(acc_pmin[p], piece);
+            acc_pmax[p] = max(acc_pmax[p], piece);
+        } else {
+            acc_shrmin[p] <<= piece;
+            acc_shrmax[p] <<= piece;
+        }
+    }
+}
+
+
+void Partitioner::calcNewPointsTask(
+        const Task *task,
+        const std::vector<PhysicalRegion> &regions,
+        Context ctx,
+        Runtime *runtime) {
+    const coord_t numpcs = *reinterpret_cast<const coord_t*>(task->args);
+    const AccessorRO<coord_t> acc_pmin(regions[0], FID_NEWPIECE);
+    const AccessorRO<coord_t> acc_pmax(regions[0], FID_MAXPIECE);
+    const AccessorWD<Pointer> acc_pnew(regions[1], FID_NEWPTR);
+
+    const IndexSpace& isp = task->regions[0].region.get_index_space();
+    const Rect<1> rectp = runtime->get_index_space_domain(
+            IndexSpaceT<1,coord_t>(isp)).bounds;
+    const coord_t nump = rectp.volume();
+
+    // every point goes to the lowest numbered piece with a zone touching
+    // it; put the private points of each piece first, in piece order,
+    // followed by the shared points in the order of their owners, which
+    // is what compacting the points would have done
+    vector<coord_t> pkey(nump);
+    vector<coord_t> keyfirst(2 * numpcs, 0);
+    for (coord_t p = 0; p < nump; ++p) {
+        const Pointer pp(rectp.lo[0] + p);
+        assert(acc_pmax[pp] >= 0);
+        const bool shared = (acc_pmin[pp] != acc_pmax[pp]);
+        pkey[p] = (shared ? numpcs : 0) + acc_pmin[pp];
+        if (pkey[p] + 1 < 2 * numpcs)
+            keyfirst[pkey[p] + 1] += 1;
+    }
+    for (coord_t k = 1; k < 2 * numpcs; ++k)
+        keyfirst[k] += keyfirst[k - 1];
+    for (coord_t p = 0; p < nump; ++p)
+        acc_pnew[Pointer(rectp.lo[0] + p)] =
+            Pointer(rectp.lo[0] + keyfirst[pkey[p]]++);
+}
+
+
+void Partitioner::remapMeshTask(
+        const Task *task,
+        const std::vector<PhysicalRegion> &regions,
+        Context ctx,
+        Runtime *runtime) {
+    const AccessorRW<Pointer> acc_mapsz(regions[0], FID_MAPSZ);
+    const AccessorRW<Pointer> acc_mapsp1(regions[0], FID_MAPSP1);
+    const AccessorRW<Pointer> acc_mapsp2(regions[0], FID_MAPSP2);
+    const AccessorRW<Pointer> acc_mapss3(regions[0], FID_MAPSS3);
+    const AccessorRW<Pointer> acc_mapss4(regions[0], FID_MAPSS4);
+    const AccessorRO<int> acc_mapsp1reg(regions[1], FID_MAPSP1REG);
+    const AccessorRO<int> acc_mapsp2reg(regions[1], FID_MAPSP2REG);
+    const AccessorRW<Pointer> acc_zpiece(regions[2], FID_PIECE);
+    const AccessorRW<Pointer> acc_mapzs1(regions[2], FID_MAPZS1);
+    const AccessorRO<Pointer> acc_znew(regions[3], FID_NEWPTR);
+    const AccessorRO<Pointer> acc_mapzs1new(regions[3], FID_NEWMAPZS1);
+    const AccessorRO<coord_t> acc_zpiecenew(regions[3], FID_NEWPIECE);
+    const AccessorWD<Pointer> acc_snew(regions[4], FID_NEWPTR);
+    const AccessorRO<Pointer> acc_pnew[2] = {
+        AccessorRO<Pointer>(regions[5], FID_NEWPTR),
+        AccessorRO<Pointer>(regions[6], FID_NEWPTR)
+    };
+    const AccessorRO<coord_t> acc_ppiecenew[2] = {
+        AccessorRO<coord_t>(regions[5], FID_NEWPIECE),
+        AccessorRO<coord_t>(regions[6], FID_NEWPIECE)
+    };
+    const AccessorWD<coord_t> acc_ppiece[2] = {
+        AccessorWD<coord_t>(regions[7], FID_PIECE),
+        AccessorWD<coord_t>(regions[8], FID_PIECE)
+    };
+
+    // a zone's sides keep their order after its new first side, and
+    // the sides each side points to are in the same zone
+    const IndexSpace& iss = task->regions[0].region.get_index_space();
+    for (PointIterator its(runtime, iss); its(); its++) {
+        const Pointer z = acc_mapsz[*its];
+        const coord_t offset = acc_mapzs1new[z][0] - acc_mapzs1[z][0];
+        acc_snew[*its] = Pointer((*its)[0] + offset);
+        acc_mapss3[*its] = Pointer(acc_mapss3[*its][0] + offset);
+        acc_mapss4[*its] = Pointer(acc_mapss4[*its][0] + offset);
+        acc_mapsp1[*its] = acc_pnew[acc_mapsp1reg[*its]][acc_mapsp1[*its]];
+        acc_mapsp2[*its] = acc_pnew[acc_mapsp2reg[*its]][acc_mapsp2[*its]];
+        acc_mapsz[*its] = acc_znew[z];
+    }
+    const IndexSpace& isz = task->regions[2].region.get_index_space();
+    for (PointIterator itz(runtime, isz); itz(); itz++) {
+        acc_zpiece[*itz] = Pointer(acc_zpiecenew[*itz]);
+        acc_mapzs1[*itz] = acc_mapzs1new[*itz];
+    }
+    // the private points are in the first region and the masters are
+    // among the shared points in the second
+    for (int r = 0; r < 2; ++r) {
+        const IndexSpace& isp = task->regions[7 + r].region.get_index_space();
+        for (PointIterator itp(runtime, isp); itp(); itp++)
+            acc_ppiece[r][*itp] = acc_ppiecenew[r][*itp];
+    }
+}
@@ -0,0 +1,150 @@
+/*
+ * Partitioner.hh
+ *
+ * Copyright (c) 2012, Los Alamos National Security, LLC.
+ * All rights reserved.
+ * Use of this source code is governed by a BSD-style open-source
+ * license; see top-level LICENSE file for full license text.
+ */
+
+#ifndef PARTITIONER_HH_
+#define PARTITIONER_HH_
+
+#include <string>
+#include <vector>
+
+#include "legion.h"
+
+#include "Vec2.hh"
+
+// forward declarations
+class InputFile;
+
+
+enum PartitionerTaskID {
+    TID_PARTITIONZONESRCB = 'R' * 100,
+    TID_CALCPOINTPIECES,
+    TID_CALCZONECTRS,
+    TID_REBALANCERCB,
+    TID_CALCNEWPOINTPIECES,
+    TID_CALCNEWPOINTS,
+    TID_REMAPMESH
+};
+
+
+// Chooses the piece (FID_PIECE) for every zone and point of the mesh.
+// The default "grid" partitioner keeps the numpcx x numpcy block
+// decomposition that GenMesh writes when it generates the mesh.
+// Anything else overwrites it before Mesh::init builds its dependent
+// partitions, which only ever look at FID_PIECE.
+// Either way the pieces can be rebalanced during the run, which cuts
+// the mesh again with each zone weighted by its piece's measured time.
+// Only the zone centers and weights come together in one task for
+// that; each piece renumbers its own part of the mesh, and the fields
+// move to their new pieces with copies.
+class Partitioner {
+public:
+    struct RCBArgs {
+    public:
+      RCBArgs(Legion::coord_t npcx, Legion::coord_t npcy)
+        : numpcx(npcx), numpcy(npcy) { }
+    public:
+      const Legion::coord_t numpcx, numpcy;
+    };
+public:
+
+    std::string method;         // "grid" or "rcb"
+
+    Partitioner(const InputFile* inp);
+    ~Partitioner();
+
+    // true if GenMesh's block pieces are used unchanged
+    bool isGrid() const { return method == "grid"; }
+
+    // overwrite the zone pieces, renumbering the zones and sides so
+    // each piece stays dense (call after the sides are generated)
+    void partitionZones(
+            const Legion::coord_t numpcx,
+            const Legion::coord_t numpcy,
+            Legion::Runtime *runtime,
+            Legion::Context ctx,
+            Legion::LogicalRegion lrz,
+            Legion::LogicalRegion lrs,
+            Legion::LogicalRegion lr_temp_points);
+
+    // give every point to the lowest numbered piece with a zone
+    // touching it (call with the reachable points of each piece)
+    void partitionPoints(
+            const Legion::coord_t numpcs,
+            Legion::Runtime *runtime,
+            Legion::Context ctx,
+            Legion::LogicalRegion lr_temp_points,
+            Legion::LogicalPartition lp_reachable_points,
+            Legion::IndexSpace is_piece);
+
+    // weighted rcb of the whole mesh using the piece times from the
+    // mappers, renumbering the zones, sides and points so every piece
+    // is dense again (call with the current pieces, which the new
+    // ones are built from after); returns the slowest piece time over
+    // the mean
+    Legion::Future rebalance(
+            const Legion::coord_t numpcx,
+            const Legion::coord_t numpcy,
+            Legion::Runtime *runtime,
+            Legion::Context ctx,
+            Legion::LogicalRegion lrz,
+            Legion::LogicalRegion lrs,
+            Legion::LogicalRegion lrp,
+            Legion::LogicalPartition lpz,
+            Legion::LogicalPartition lps,
+            Legion::LogicalPartition lppprv,
+            Legion::LogicalPartition lppmstr,
+            Legion::LogicalPartition lppshr,
+            Legion::IndexSpace is_piece);
+
+    static void partitionZonesRCBTask(
+            const Legion::Task *task,
+            const std::vector<Legion::PhysicalRegion> &regions,
+            Legion::Context ctx,
+            Legion::Runtime *runtime);
+
+    static void calcPointPiecesTask(
+            const Legion::Task *task,
+            const std::vector<Legion::PhysicalRegion> &regions,
+            Legion::Context ctx,
+            Legion::Runtime *runtime);
+
+    static void calcZoneCtrsTask(
+            const Legion::Task *task,
+            const std::vector<Legion::PhysicalRegion> &regions,
+            Legion::Context ctx,
+            Legion::Runtime *runtime);
+
+    static double rebalanceRCBTask(
+            const Legion::Task *task,
+            const std::vector<Legion::PhysicalRegion> &regions,
+            Legion::Context ctx,
+            Legion::Runtime *runtime);
+
+    static void calcNewPointPiecesTask(
+            const Legion::Task *task,
+            const std::vector<Legion::PhysicalRegion> &regions,
+            Legion::Context ctx,
+            Legion::Runtime *runtime);
+
+    static void calcNewPointsTask(
+            const Legion::Task *task,
+            const std::vector<Legion::PhysicalRegion> &regions,
+            Legion::Context ctx,
+            Legion::Runtime *runtime);
+
+    static void remapMeshTask(
+            const Legion::Task *task,
+            const std::vector<Legion::PhysicalRegion> &regions,
+            Legion::Context ctx,
+            Legion::Runtime *runtime);
+
+}; // class Partitioner
+
+
+#endif /* PARTITIONER_HH_ */
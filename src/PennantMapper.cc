@@ -14,8 +14,11 @@
 #include "PennantMapper.hh"
 
 #include <cstdlib>
+#include <cstring>
 #include <string>
+#include <algorithm>
 #include <iostream>
+#include <sstream>
 
 #include "legion.h"
 #include "default_mapper.h"
@@ -24,13 +27,58 @@ using namespace std;
 using namespace Legion;
 using namespace Legion::Mapping;
 
+namespace {  // unnamed
+// Scoped locks for the mapper state shared between mapper calls,
+// which can run in parallel with the concurrent mapper model
+class AutoLock {
+public:
+  AutoLock(pthread_mutex_t *l) : lock(l) { pthread_mutex_lock(lock); }
+  ~AutoLock(void) { pthread_mutex_unlock(lock); }
+private:
+  pthread_mutex_t *const lock;
+};
+class AutoRWLock {
+public:
+  AutoRWLock(pthread_rwlock_t *l, bool exclusive) : lock(l)
+  {
+    if (exclusive)
+      pthread_rwlock_wrlock(lock);
+    else
+      pthread_rwlock_rdlock(lock);
+  }
+  ~AutoRWLock(void) { pthread_rwlock_unlock(lock); }
+private:
+  pthread_rwlock_t *const lock;
+};
+}; // namespace
+
+std::map<PennantMapper::VariantTuningKey,PennantMapper::VariantTiming>
+  PennantMapper::variant_timings;
+pthread_mutex_t PennantMapper::variant_timing_lock = PTHREAD_MUTEX_INITIALIZER;
+unsigned PennantMapper::variant_timings_requests = 0;
+unsigned PennantMapper::variant_choices_requests = 0;
+std::map<coord_t,long long> PennantMapper::piece_times;
+unsigned PennantMapper::piece_times_requests = 0;
+unsigned long long PennantMapper::mapping_calls = 0;
+unsigned long long PennantMapper::mapping_time = 0;
+std::set<PhysicalInstance> PennantMapper::tracked_instances;
+std::map<Memory,PennantMapper::MemoryUsage> PennantMapper::memory_usage;
+std::map<FieldSpace,PennantMapper::MemoryUsage> PennantMapper::field_space_usage;
+pthread_mutex_t PennantMapper::memory_usage_lock = PTHREAD_MUTEX_INITIALIZER;
+
 PennantMapper::PennantMapper(
         Machine m,
         Runtime *rt,
         Processor p)
   : DefaultMapper(rt->get_mapper_runtime(), m, p), 
-    pennant_mapper_name(get_name(p)), numpcx(0), numpcy(0), sharded(false)
+    pennant_mapper_name(get_name(p)), variant_replies(0), piece_time_replies(0),
+    has_forgotten_instances(false), numpcx(0), numpcy(0), sharded(false)
 {
+  pthread_mutex_init(&variant_lock, NULL);
+  pthread_mutex_init(&reduction_lock, NULL);
+  pthread_mutex_init(&sharding_lock, NULL);
+  pthread_mutex_init(&default_lock, NULL);
+  pthread_rwlock_init(&instance_lock, NULL);
   // Get our local memories
   {
     Machine::MemoryQuery sysmem_query(machine);
@@ -73,6 +121,11 @@ PennantMapper::PennantMapper(
 PennantMapper::~PennantMapper(void)
 {
   free(const_cast<char*>(pennant_mapper_name));
+  pthread_mutex_destroy(&variant_lock);
+  pthread_mutex_destroy(&reduction_lock);
+  pthread_mutex_destroy(&sharding_lock);
+  pthread_mutex_destroy(&default_lock);
+  pthread_rwlock_destroy(&instance_lock);
 }
 
 const char* PennantMapper::get_mapper_name(void) const
@@ -82,7 +135,13 @@ const char* PennantMapper::get_mapper_name(void) const
 
 Mapper::MapperSyncModel PennantMapper::get_mapper_sync_model(void) const
 {
+#ifdef ENABLE_CONCURRENT_MAPPER
+  // All our state is protected by locks, and every call that goes into
+  // the default mapper holds the default_lock, so calls can run in parallel
+  return CONCURRENT_MAPPER_MODEL;
+#else
   return SERIALIZED_REENTRANT_MAPPER_MODEL;
+#endif
 }
 
 bool PennantMapper::request_valid_instances(void) const
@@ -96,7 +155,21 @@ void PennantMapper::select_tunable_value(const MapperContext ctx,
                                          const SelectTunableInput& input,
                                                SelectTunableOutput& output)
 {
-  // No custom penant tunable values yet
+  if (input.tunable_id == PIECE_TIMES_TUNABLE) {
+    select_piece_times(ctx, output);
+    return;
+  }
+  if (input.tunable_id == FORGET_PIECES_TUNABLE) {
+    forget_piece_instances();
+    runtime->broadcast(ctx, NULL, 0, FORGET_PIECES_MESSAGE);
+    pack_tunable<int>(0, output);
+    return;
+  }
+  if (input.tunable_id == VARIANT_CHOICES_TUNABLE) {
+    select_variant_choices(ctx, output);
+    return;
+  }
+  AutoLock guard(&default_lock);
   DefaultMapper::select_tunable_value(ctx, task, input, output);
 }
 
@@ -105,7 +178,11 @@ void PennantMapper::select_task_options(const MapperContext ctx,
                                               TaskOptions& output)
 {
   // The default mapper mostly does the right thing
-  DefaultMapper::select_task_options(ctx, task, output);
+  {
+    // The default mapper isn't safe to call concurrently
+    AutoLock guard(&default_lock);
+    DefaultMapper::select_task_options(ctx, task, output);
+  }
   // But we don't need the valid instances
   output.valid_instances = false;
 #ifdef PENNANT_DISABLE_CONTROL_REPLICATION
@@ -127,13 +204,26 @@ void PennantMapper::slice_task(const MapperContext ctx,
                                const SliceTaskInput &input,
                                      SliceTaskOutput &output)
 {
+  MappingCallTimer timer;
 #ifdef PENNANT_DISABLE_CONTROL_REPLICATION
   // If this is the first slice_task call with no control replication
   // then we need to emulate the effect of the sharding here
   if ((task.index_domain == input.domain) && (total_nodes > 1)) {
     // Do this computation so we can get per shard rectangles on the remote node
-    if (!sharded)
+    if (!sharded.load(std::memory_order_acquire))
       compute_fake_sharding(ctx);
+    // Launches over only the active pieces don't cover whole shards,
+    // so send each of their points to the node that owns it
+    if (input.domain.get_volume() < size_t(numpcx * numpcy)) {
+      for (Domain::DomainPointIterator itr(input.domain); itr; itr++) {
+        const Point<1> key(itr.p);
+        const AddressSpaceID space =
+          sharding_sys_memories.at(key).address_space();
+        output.slices.push_back(TaskSlice(Domain(itr.p, itr.p),
+              sharding_spaces[space].first, true/*recurse*/, false/*stealable*/));
+      }
+      return;
+    }
     output.slices.resize(sharding_spaces.size());
     unsigned index = 0;
     for (std::vector<std::pair<Processor,IndexSpace> >::const_iterator it = 
@@ -158,29 +248,23 @@ void PennantMapper::slice_task(const MapperContext ctx,
       slice.stealable = false;
       output.slices.push_back(slice);
     }
-  } else if ((task.tag & PREFER_OMP) && !local_omps.empty()) {
-    unsigned local_omp_index = 0;
-    for (Domain::DomainPointIterator itr(input.domain); itr; itr++)
-    {
-      TaskSlice slice;
-      slice.domain = Domain(itr.p, itr.p);
-      slice.proc = local_omps[local_omp_index++];
-      if (local_omp_index == local_omps.size())
-        local_omp_index = 0;
-      slice.recurse = false;
-      slice.stealable = false;
-      output.slices.push_back(slice);
-    }
   } else {
-    // Opt for our cpus instead of our openmap processors
-    unsigned local_cpu_index = 0;
+    bool use_omp = (task.tag & PREFER_OMP) && !local_omps.empty();
+    // If we are autotuning then the timings pick the kind of processor,
+    // the launch tags tell every node's mapper which phase we are in
+    if ((task.tag & (TUNE_VARIANT | TUNED_VARIANT)) &&
+        !local_omps.empty() && !local_cpus.empty())
+      use_omp = select_tuned_variant(ctx, task, input.domain, use_omp);
+    // Opt for our cpus unless we want our openmp processors
+    const std::vector<Processor> &local_procs = use_omp ? local_omps : local_cpus;
+    unsigned local_proc_index = 0;
     for (Domain::DomainPointIterator itr(input.domain); itr; itr++)
     {
       TaskSlice slice;
       slice.domain = Domain(itr.p, itr.p);
-      slice.proc = local_cpus[local_cpu_index++];
-      if (local_cpu_index == local_cpus.size())
-        local_cpu_index = 0;
+      slice.proc = local_procs[local_proc_index++];
+      if (local_proc_index == local_procs.size())
+        local_proc_index = 0;
       slice.recurse = false;
       slice.stealable = false;
       output.slices.push_back(slice);
@@ -193,6 +277,9 @@ void PennantMapper::map_task(const MapperContext ctx,
                              const MapTaskInput &input,
                                    MapTaskOutput &output)
 {
+  MappingCallTimer timer;
+  if (has_forgotten_instances.load(std::memory_order_acquire))
+    release_forgotten_instances(ctx);
   if (input.shard_processor.exists()) {
     // Always place replicated task on designated processor
     output.target_procs.clear();
@@ -209,13 +296,20 @@ void PennantMapper::map_task(const MapperContext ctx,
   } else if ((task.tag & PREFER_GPU) && !local_gpus.empty()) {
     output.chosen_variant = find_gpu_variant(ctx, task.task_id);
     output.target_procs.push_back(task.target_proc);
-  } else if ((task.tag & PREFER_OMP) && !local_omps.empty()) {
+  } else if (task.target_proc.kind() == Processor::OMP_PROC) {
+    // slice_task already picked an openmp processor for us
     output.chosen_variant = find_omp_variant(ctx, task.task_id);
     output.target_procs.push_back(task.target_proc);
   } else {
     output.chosen_variant = find_cpu_variant(ctx, task.task_id);
     output.target_procs = local_cpus;
   }
+  // Time the trial runs of each variant while we are autotuning
+  // and the pieces when we are going to rebalance them
+  if (task.is_index_space && 
+      (task.tag & (TUNE_VARIANT | TIME_PIECES)))
+    output.task_prof_requests.add_measurement<
+      ProfilingMeasurements::OperationTimeline>();
   output.chosen_instances.resize(task.regions.size());  
   if ((task.tag & PREFER_GPU) && !local_gpus.empty()) {
     for (unsigned idx = 0; idx < task.regions.size(); idx++)
@@ -250,7 +344,16 @@ void PennantMapper::map_task(const MapperContext ctx,
     for (unsigned idx = 0; idx < task.regions.size(); idx++)
     {
       // See if it is a reduction region requirement or not
-      if (task.regions[idx].privilege == LEGION_REDUCE)
+      if ((task.regions[idx].privilege == LEGION_REDUCE) &&
+          (task.regions[idx].tag & NODE_REDUCE) &&
+          node_shared_instances(ctx, task.regions[idx].region,
+            local_numa.exists() ? local_numa : local_sysmem))
+        // Points shared only by pieces on this node, sum them straight
+        // into the one instance of them that all those pieces use
+        map_pennant_array(ctx, task, idx, task.regions[idx].region, 
+            local_numa.exists() ? local_numa : local_sysmem, 
+                          output.chosen_instances[idx]);
+      else if (task.regions[idx].privilege == LEGION_REDUCE)
         create_reduction_instances(ctx, task, idx, 
             local_numa.exists() ? local_numa : local_sysmem,
                                    output.chosen_instances[idx]);
@@ -297,24 +400,30 @@ void PennantMapper::map_copy(const MapperContext ctx,
                              const MapCopyInput &input,
                                    MapCopyOutput &output)
 {
+  MappingCallTimer timer;
   output.src_instances.resize(copy.src_requirements.size());
   output.dst_instances.resize(copy.dst_requirements.size());
   output.src_indirect_instances.resize(copy.src_indirect_requirements.size());
-  // There should be no scatter copies
-  assert(copy.dst_indirect_requirements.empty());
-  // Keep the gather copies on the host side
-  if (!local_gpus.empty() && copy.src_indirect_requirements.empty()) {
+  output.dst_indirect_instances.resize(copy.dst_indirect_requirements.size());
+  // Keep the gather and scatter copies on the host side
+  const bool indirect = !copy.src_indirect_requirements.empty() ||
+                        !copy.dst_indirect_requirements.empty();
+  if (!local_gpus.empty() && !indirect) {
     assert(copy.is_index_space);
     const Point<1> point = copy.index_point;
 #ifdef PENNANT_DISABLE_CONTROL_REPLICATION
-    if (!sharded)
+    if (!sharded.load(std::memory_order_acquire))
       compute_fake_sharding(ctx);
-    const Memory fbmem = sharding_memories[point];
+    const Memory fbmem = sharding_memories.at(point);
 #else
     const coord_t index = compute_shard_index(point);
     const Processor gpu = local_gpus[index % local_gpus.size()];
-    const Memory fbmem = default_policy_select_target_memory(ctx, gpu,
+    Memory fbmem;
+    {
+      AutoLock guard(&default_lock);
+      fbmem = default_policy_select_target_memory(ctx, gpu,
                                         copy.src_requirements.front());
+    }
 #endif
     assert(fbmem.kind() == Memory::GPU_FB_MEM);
     for (unsigned idx = 0; idx < copy.src_requirements.size(); idx++)
@@ -324,18 +433,22 @@ void PennantMapper::map_copy(const MapperContext ctx,
       map_pennant_array(ctx, copy, idx + copy.src_requirements.size(), 
                         copy.dst_requirements[idx].region, fbmem,
                         output.dst_instances[idx]);
-  } else if (!local_omps.empty() && copy.src_indirect_requirements.empty()) {
+  } else if (!local_omps.empty() && !indirect) {
     assert(copy.is_index_space);
     const Point<1> point = copy.index_point;
 #ifdef PENNANT_DISABLE_CONTROL_REPLICATION
-    if (!sharded)
+    if (!sharded.load(std::memory_order_acquire))
       compute_fake_sharding(ctx);
-    const Memory numa = sharding_memories[point];
+    const Memory numa = sharding_memories.at(point);
 #else
     const coord_t index = compute_shard_index(point);
     const Processor omp = local_omps[index % local_omps.size()];
-    const Memory numa = default_policy_select_target_memory(ctx, omp,
+    Memory numa;
+    {
+      AutoLock guard(&default_lock);
+      numa = default_policy_select_target_memory(ctx, omp,
                                         copy.src_requirements.front());
+    }
 #endif
     assert(numa.kind() == Memory::SOCKET_MEM);
     for (unsigned idx = 0; idx < copy.src_requirements.size(); idx++)
@@ -349,9 +462,9 @@ void PennantMapper::map_copy(const MapperContext ctx,
 #ifdef PENNANT_DISABLE_CONTROL_REPLICATION
     assert(copy.is_index_space);
     const Point<1> point = copy.index_point;
-    if (!sharded)
+    if (!sharded.load(std::memory_order_acquire))
       compute_fake_sharding(ctx);
-    const Memory sysmem = sharding_sys_memories[point];
+    const Memory sysmem = sharding_sys_memories.at(point);
 #else
     const Memory sysmem = local_sysmem;
 #endif
@@ -374,6 +487,19 @@ void PennantMapper::map_copy(const MapperContext ctx,
         output.src_indirect_instances[idx] = insts[0];
       }
     }
+    if (!copy.dst_indirect_requirements.empty())
+    {
+      const size_t offset = copy.src_requirements.size() + 
+        copy.dst_requirements.size() + copy.src_indirect_requirements.size();
+      for (unsigned idx = 0; idx < copy.dst_indirect_requirements.size(); idx++)
+      {
+        std::vector<PhysicalInstance> insts;
+        map_pennant_array(ctx, copy, idx + offset, 
+                          copy.dst_indirect_requirements[idx].region, sysmem, insts);
+        assert(insts.size() == 1);
+        output.dst_indirect_instances[idx] = insts[0];
+      }
+    }
   }
   runtime->acquire_instances(ctx, output.src_instances);
   runtime->acquire_instances(ctx, output.dst_instances);
@@ -405,6 +531,11 @@ void PennantMapper::select_partition_projection(const MapperContext  ctx,
                                                 const SelectPartitionProjectionInput& input,
                                                       SelectPartitionProjectionOutput& output)
 {
+#ifdef PENNANT_DISABLE_CONTROL_REPLICATION
+  // The sharding memories only hold still once the sharding is computed
+  if (!sharded.load(std::memory_order_acquire))
+    compute_fake_sharding(ctx);
+#endif
   if (!input.open_complete_partitions.empty()) {
 #ifdef PENNANT_DISABLE_CONTROL_REPLICATION
     const Domain color_space = 
@@ -447,9 +578,9 @@ void PennantMapper::map_partition(const MapperContext ctx,
   if (partition.is_index_space) {
     assert(partition.is_index_space);
     const Point<1> point = partition.index_point;
-    if (!sharded)
+    if (!sharded.load(std::memory_order_acquire))
       compute_fake_sharding(ctx);
-    sysmem = sharding_sys_memories[point];
+    sysmem = sharding_sys_memories.at(point);
   } else {
     sysmem = local_sysmem;
   }
@@ -474,6 +605,264 @@ void PennantMapper::memoize_operation(const MapperContext  ctx,
 #endif
 }
 
+void PennantMapper::map_replicate_task(const MapperContext ctx,
+                                       const Task& task,
+                                       const MapTaskInput& input,
+                                       const MapTaskOutput& default_output,
+                                             MapReplicateTaskOutput& output)
+{
+  AutoLock guard(&default_lock);
+  DefaultMapper::map_replicate_task(ctx, task, input, default_output, output);
+}
+
+void PennantMapper::select_task_sources(const MapperContext ctx,
+                                        const Task& task,
+                                        const SelectTaskSrcInput& input,
+                                              SelectTaskSrcOutput& output)
+{
+  AutoLock guard(&default_lock);
+  DefaultMapper::select_task_sources(ctx, task, input, output);
+}
+
+void PennantMapper::select_copy_sources(const MapperContext ctx,
+                                        const Copy& copy,
+                                        const SelectCopySrcInput& input,
+                                              SelectCopySrcOutput& output)
+{
+  AutoLock guard(&default_lock);
+  DefaultMapper::select_copy_sources(ctx, copy, input, output);
+}
+
+void PennantMapper::map_inline(const MapperContext ctx,
+                               const InlineMapping& inline_op,
+                               const MapInlineInput& input,
+                                     MapInlineOutput& output)
+{
+  AutoLock guard(&default_lock);
+  DefaultMapper::map_inline(ctx, inline_op, input, output);
+}
+
+void PennantMapper::select_inline_sources(const MapperContext ctx,
+                                          const InlineMapping& inline_op,
+                                          const SelectInlineSrcInput& input,
+                                                SelectInlineSrcOutput& output)
+{
+  AutoLock guard(&default_lock);
+  DefaultMapper::select_inline_sources(ctx, inline_op, input, output);
+}
+
+void PennantMapper::select_partition_sources(const MapperContext ctx,
+                                             const Partition& partition,
+                                             const SelectPartitionSrcInput& input,
+                                                   SelectPartitionSrcOutput& output)
+{
+  AutoLock guard(&default_lock);
+  DefaultMapper::select_partition_sources(ctx, partition, input, output);
+}
+
+void PennantMapper::map_future_map_reduction(const MapperContext ctx,
+                                             const FutureMapReductionInput& input,
+                                                   FutureMapReductionOutput& output)
+{
+  AutoLock guard(&default_lock);
+  DefaultMapper::map_future_map_reduction(ctx, input, output);
+}
+
+void PennantMapper::configure_context(const MapperContext ctx,
+                                      const Task& task,
+                                            ContextConfigOutput& output)
+{
+  AutoLock guard(&default_lock);
+  DefaultMapper::configure_context(ctx, task, output);
+}
+
+void PennantMapper::select_tasks_to_map(const MapperContext ctx,
+                                        const SelectMappingInput& input,
+                                              SelectMappingOutput& output)
+{
+  AutoLock guard(&default_lock);
+  DefaultMapper::select_tasks_to_map(ctx, input, output);
+}
+
+void PennantMapper::select_steal_targets(const MapperContext ctx,
+                                         const SelectStealingInput& input,
+                                               SelectStealingOutput& output)
+{
+  AutoLock guard(&default_lock);
+  DefaultMapper::select_steal_targets(ctx, input, output);
+}
+
+void PennantMapper::report_profiling(const MapperContext ctx,
+                                     const Task &task,
+                                     const TaskProfilingInfo &input)
+{
+  ProfilingMeasurements::OperationTimeline *timeline = 
+    input.profiling_responses.get_measurement<
+      ProfilingMeasurements::OperationTimeline>();
+  if (timeline == NULL)
+    return;
+  const long long elapsed = timeline->end_time - timeline->start_time;
+  delete timeline;
+  const VariantTuningKey key(task.task_id, find_tuning_role(ctx, task));
+  AutoLock guard(&variant_timing_lock);
+  if ((task.tag & TIME_PIECES) && 
+      (task.index_domain.get_volume() == size_t(numpcx * numpcy)))
+    piece_times[task.index_point[0]] += elapsed;
+  std::map<VariantTuningKey,VariantTiming>::iterator finder = 
+    variant_timings.find(key);
+  if ((finder != variant_timings.end()) && !finder->second.decided) {
+    if (task.target_proc.kind() == Processor::OMP_PROC) {
+      finder->second.omp_time += elapsed;
+      finder->second.omp_samples++;
+    } else {
+      finder->second.cpu_time += elapsed;
+      finder->second.cpu_samples++;
+    }
+  }
+}
+
+void PennantMapper::handle_message(const MapperContext ctx,
+                                   const MapperMessage &message)
+{
+  if (message.kind == PIECE_TIMES_REQUEST_MESSAGE) {
+    unsigned request;
+    memcpy(&request, message.message, sizeof(request));
+    std::vector<std::pair<coord_t,long long> > times;
+    {
+      AutoLock guard(&variant_timing_lock);
+      // The times are shared by the mappers of a process, so only the
+      // first one to see the request answers it, with all of them
+      if (request <= piece_times_requests)
+        return;
+      piece_times_requests = request;
+      times.assign(piece_times.begin(), piece_times.end());
+      piece_times.clear();
+    }
+    runtime->send_message(ctx, message.sender, 
+        times.empty() ? NULL : &times.front(), 
+        times.size() * sizeof(times.front()), PIECE_TIMES_MESSAGE);
+    return;
+  }
+  if (message.kind == PIECE_TIMES_MESSAGE) {
+    const std::pair<coord_t,long long> *times = 
+      (const std::pair<coord_t,long long>*)message.message;
+    const size_t count = message.size / sizeof(*times);
+    bool done;
+    {
+      AutoLock guard(&variant_timing_lock);
+      for (size_t idx = 0; idx < count; idx++)
+        piece_time_totals[times[idx].first] += times[idx].second;
+      assert(piece_time_replies > 0);
+      done = (--piece_time_replies == 0);
+    }
+    if (done)
+      runtime->trigger_mapper_event(ctx, piece_times_event);
+    return;
+  }
+  if (message.kind == FORGET_PIECES_MESSAGE) {
+    forget_piece_instances();
+    return;
+  }
+  if (message.kind == VARIANT_TIMINGS_REQUEST_MESSAGE) {
+    unsigned request;
+    memcpy(&request, message.message, sizeof(request));
+    // Lines of "<task> <trials> <points> <cpu samples> <cpu time>
+    // <omp samples> <omp time> <decided> <use omp> <role>"
+    std::ostringstream oss;
+    {
+      AutoLock guard(&variant_timing_lock);
+      // Like the piece times only the first mapper to see it answers
+      if (request <= variant_timings_requests)
+        return;
+      variant_timings_requests = request;
+      for (std::map<VariantTuningKey,VariantTiming>::const_iterator it = 
+            variant_timings.begin(); it != variant_timings.end(); it++)
+      {
+        const VariantTiming &timing = it->second;
+        if (timing.trials == 0)
+          continue;
+        oss << it->first.first << " " << timing.trials << " " 
+            << timing.points << " " << timing.cpu_samples << " "
+            << timing.cpu_time << " " << timing.omp_samples << " "
+            << timing.omp_time << " " << timing.decided << " "
+            << timing.use_omp << " " << it->first.second << "\n";
+      }
+    }
+    const std::string timings = oss.str();
+    runtime->send_message(ctx, message.sender, timings.c_str(),
+                          timings.size(), VARIANT_TIMINGS_MESSAGE);
+    return;
+  }
+  if (message.kind == VARIANT_TIMINGS_MESSAGE) {
+    std::istringstream iss(std::string((const char*)message.message, message.size));
+    bool done;
+    {
+      AutoLock guard(&variant_timing_lock);
+      unsigned task_id;
+      VariantTiming timing;
+      while (iss >> task_id >> timing.trials >> timing.points
+                 >> timing.cpu_samples >> timing.cpu_time
+                 >> timing.omp_samples >> timing.omp_time
+                 >> timing.decided >> timing.use_omp) {
+        std::string role;
+        iss.get();
+        std::getline(iss, role);
+        VariantTiming &total = variant_timing_totals[VariantTuningKey(task_id, role)];
+        total.trials += timing.trials;
+        // The slowest process is the one that sets the pace
+        total.points = std::max(total.points, timing.points);
+        total.cpu_samples += timing.cpu_samples;
+        total.cpu_time += timing.cpu_time;
+        total.omp_samples += timing.omp_samples;
+        total.omp_time += timing.omp_time;
+        // Choices that were already made (the selecting process's first)
+        if (timing.decided && !total.decided) {
+          total.decided = true;
+          total.use_omp = timing.use_omp;
+        }
+      }
+      assert(variant_replies > 0);
+      done = (--variant_replies == 0);
+    }
+    if (done)
+      runtime->trigger_mapper_event(ctx, variant_replies_event);
+    return;
+  }
+  if (message.kind == VARIANT_CHOICES_MESSAGE) {
+    // The request and then the choices from pack_variant_choices
+    std::istringstream iss(std::string((const char*)message.message, message.size));
+    unsigned request;
+    iss >> request;
+    iss.get();
+    {
+      AutoLock guard(&variant_timing_lock);
+      if (request <= variant_choices_requests)
+        return;
+      variant_choices_requests = request;
+    }
+    const std::string packed = iss.str().substr(iss.tellg());
+    VariantChoices choices;
+    unpack_variant_choices(packed.c_str(), packed.size(), choices);
+    apply_variant_choices(choices);
+    runtime->send_message(ctx, message.sender, NULL, 0,
+                          VARIANT_CHOICES_APPLIED_MESSAGE);
+    return;
+  }
+  if (message.kind == VARIANT_CHOICES_APPLIED_MESSAGE) {
+    bool done;
+    {
+      AutoLock guard(&variant_timing_lock);
+      assert(variant_replies > 0);
+      done = (--variant_replies == 0);
+    }
+    if (done)
+      runtime->trigger_mapper_event(ctx, variant_replies_event);
+    return;
+  }
+  AutoLock guard(&default_lock);
+  DefaultMapper::handle_message(ctx, message);
+}
+
 /*static*/ const char* PennantMapper::get_name(Processor p)
 {
   char *result = (char*)malloc(256);
@@ -504,14 +893,20 @@ void PennantMapper::map_pennant_array(const MapperContext ctx,
                                       bool initialization_instance)
 {
   const std::pair<LogicalRegion,Memory> key(region, target);
-  std::map<std::pair<LogicalRegion,Memory>,PhysicalInstance>::const_iterator
-    finder = local_instances.find(key);
-  if (finder != local_instances.end()) {
-    instances.push_back(finder->second);
-    return;
+  {
+    AutoRWLock guard(&instance_lock, false/*exclusive*/);
+    std::map<std::pair<LogicalRegion,Memory>,PhysicalInstance>::const_iterator
+      finder = local_instances.find(key);
+    if (finder != local_instances.end()) {
+      instances.push_back(finder->second);
+      return;
+    }
   }
   // First time through make an instance
+  // Don't hold the lock while calling into the runtime, if another call 
+  // races with us then find_or_create will give us both the same instance
 
+  std::vector<LogicalRegion> regions;
   // Make a big instance of the top-level region for all
   // single-node CPU runs and any single-node single-GPU runs
   if ((total_nodes == 1) && 
@@ -523,8 +918,18 @@ void PennantMapper::map_pennant_array(const MapperContext ctx,
       LogicalPartition part = runtime->get_parent_logical_partition(ctx, region);
       region = runtime->get_parent_logical_region(ctx, part);
     }
+    regions.push_back(region);
   }
-  std::vector<LogicalRegion> regions(1, region);
+#if defined(ENABLE_NODE_INSTANCES) && !defined(PENNANT_DISABLE_CONTROL_REPLICATION)
+  // Otherwise make one instance covering all the pieces on this node
+  // (or on this NUMA domain or GPU) so ghost points of neighboring
+  // pieces on the same node don't need any copies
+  else if (!find_node_regions(ctx, region, target, regions))
+    regions.push_back(region);
+#else
+  else
+    regions.push_back(region);
+#endif
   LayoutConstraintSet layout_constraints;
   // No specialization
   layout_constraints.add_constraint(SpecializedConstraint());
@@ -541,10 +946,24 @@ void PennantMapper::map_pennant_array(const MapperContext ctx,
   runtime->get_field_space_fields(ctx, region.get_field_space(), all_fields);
   layout_constraints.add_constraint(
       FieldConstraint(all_fields, false/*contiguous*/, false/*inorder*/));
+  const GCPriority priority = 
+    initialization_instance ? 0/*normal GC priority*/ : GC_NEVER_PRIORITY;
   PhysicalInstance result; bool created;
-  if (!runtime->find_or_create_physical_instance(ctx, target, layout_constraints,
-        regions, result, created, true/*acquire*/, 
-        initialization_instance ? 0/*normal GC priority*/ : GC_NEVER_PRIORITY)) {
+  bool found = runtime->find_or_create_physical_instance(ctx, target, 
+      layout_constraints, regions, result, created, true/*acquire*/, priority);
+  if (found && !created) {
+    // Instances from before the setup fields were freed still satisfy the
+    // constraints, but reusing them would keep the freed fields around
+    bool retired;
+    {
+      AutoRWLock guard(&instance_lock, false/*exclusive*/);
+      retired = (setup_instances.find(result) != setup_instances.end());
+    }
+    if (retired)
+      found = runtime->create_physical_instance(ctx, target, layout_constraints,
+          regions, result, true/*acquire*/, priority);
+  }
+  if (!found) {
     fprintf(stderr,"Pennant mapper is out of memory!\n");
     switch (mappable.get_mappable_type())
     {
@@ -578,8 +997,73 @@ void PennantMapper::map_pennant_array(const MapperContext ctx,
     assert(false);
   }
   instances.push_back(result);
+  track_instance(result);
+  const bool whole_region = (regions.size() == 1) &&
+    !runtime->has_parent_index_partition(ctx, regions[0].get_index_space());
   // Save the result for future use
+#if defined(ENABLE_NODE_INSTANCES) && !defined(PENNANT_DISABLE_CONTROL_REPLICATION)
+  // All the pieces in a node instance map to it from now on, any instances
+  // made for them before their partitions were registered can be collected
+  std::vector<PhysicalInstance> stale;
+  {
+    AutoRWLock guard(&instance_lock, true/*exclusive*/);
+    local_instances[key] = result;
+    if (whole_region)
+      whole_region_instances.insert(result);
+    if (regions.size() > 1) {
+      for (std::vector<LogicalRegion>::const_iterator it = 
+            regions.begin(); it != regions.end(); it++) {
+        PhysicalInstance &instance = local_instances[std::make_pair(*it, target)];
+        if (instance.exists() && (instance != result))
+          stale.push_back(instance);
+        instance = result;
+      }
+    }
+  }
+  for (std::vector<PhysicalInstance>::const_iterator it = 
+        stale.begin(); it != stale.end(); it++) {
+    runtime->set_garbage_collection_priority(ctx, *it, 0/*normal*/);
+    untrack_instance(*it);
+  }
+#else
+  AutoRWLock guard(&instance_lock, true/*exclusive*/);
   local_instances[key] = result;
+  if (whole_region)
+    whole_region_instances.insert(result);
+#endif
+}
+
+bool PennantMapper::node_shared_instances(const MapperContext ctx,
+                                          LogicalRegion region, Memory target)
+{
+  // Only worth it when map_pennant_array really does give all the
+  // pieces on the node the same instance, otherwise each piece (or
+  // each NUMA domain or GPU) would reduce into its own normal instance
+  // and then have to copy it out.  With more than one memory of this
+  // kind on the node the pieces are dealt out over them, each of which
+  // gets an instance of its own.
+  Machine::MemoryQuery query(machine);
+  query.local_address_space();
+  query.only_kind(target.kind());
+  if (query.count() > 1)
+    return false;
+  // the same test map_pennant_array makes for one instance of the
+  // whole region
+  if ((total_nodes == 1) && 
+      ((target.kind() != Memory::GPU_FB_MEM) || (local_gpus.size() == 1)))
+    return true;
+#if defined(ENABLE_NODE_INSTANCES) && !defined(PENNANT_DISABLE_CONTROL_REPLICATION)
+  // otherwise only if find_node_regions has a group for the region's
+  // partition to put all the node's pieces of it in one instance
+  if (!runtime->has_parent_index_partition(ctx, region.get_index_space()))
+    return false;
+  const IndexPartition parent = 
+    runtime->get_parent_index_partition(ctx, region.get_index_space());
+  AutoRWLock guard(&instance_lock, false/*exclusive*/);
+  return (node_instance_groups.find(parent) != node_instance_groups.end());
+#else
+  return false;
+#endif
 }
 
 void PennantMapper::create_reduction_instances(const MapperContext ctx,
@@ -587,11 +1071,61 @@ void PennantMapper::create_reduction_instances(const MapperContext ctx,
                                                Memory target_memory,
                                                std::vector<PhysicalInstance> &instances)
 {
-  std::set<FieldID> dummy_fields;
-  TaskLayoutConstraintSet dummy_constraints;
-  if (!default_create_custom_instances(ctx, task.target_proc, target_memory,
-      task.regions[index], index, dummy_fields,
-      dummy_constraints, false/*need check*/, instances)) {
+  const RegionRequirement &req = task.regions[index];
+  const std::pair<std::pair<LogicalRegion,Memory>,ReductionOpID>
+    key(std::make_pair(req.region, target_memory), req.redop);
+  PhysicalInstance cached;
+  {
+    AutoLock guard(&reduction_lock);
+    std::map<std::pair<std::pair<LogicalRegion,Memory>,ReductionOpID>,
+             PhysicalInstance>::const_iterator finder = 
+               reduction_instances.find(key);
+    if (finder != reduction_instances.end())
+      cached = finder->second;
+  }
+  if (cached.exists()) {
+    // Make sure it has all our fields and that it is still valid
+    bool has_fields = true;
+    for (std::set<FieldID>::const_iterator it = req.privilege_fields.begin();
+          it != req.privilege_fields.end(); it++)
+    {
+      if (cached.has_field(*it))
+        continue;
+      has_fields = false;
+      break;
+    }
+    if (has_fields && runtime->acquire_instance(ctx, cached)) {
+      instances.push_back(cached);
+      return;
+    }
+    AutoLock guard(&reduction_lock);
+    std::map<std::pair<std::pair<LogicalRegion,Memory>,ReductionOpID>,
+             PhysicalInstance>::iterator finder = reduction_instances.find(key);
+    if ((finder != reduction_instances.end()) && (finder->second == cached)) {
+      reduction_instance_bytes[target_memory] -= cached.get_instance_size();
+      reduction_instances.erase(finder);
+      untrack_instance(cached);
+    }
+  }
+  // First time through make a reduction instance just for this region
+  std::vector<LogicalRegion> regions(1, req.region);
+  LayoutConstraintSet layout_constraints;
+  layout_constraints.add_constraint(
+      SpecializedConstraint(LEGION_AFFINE_REDUCTION_SPECIALIZE, req.redop));
+  // SOA dimension ordering (all pennant arrays are 1-D)
+  std::vector<DimensionKind> dimension_ordering(2);
+  dimension_ordering[0] = DIM_X;
+  dimension_ordering[1] = DIM_F;
+  layout_constraints.add_constraint(OrderingConstraint(dimension_ordering,
+                                                       false/*contiguous*/));
+  layout_constraints.add_constraint(MemoryConstraint(target_memory.kind()));
+  std::vector<FieldID> fields(req.privilege_fields.begin(), 
+                              req.privilege_fields.end());
+  layout_constraints.add_constraint(
+      FieldConstraint(fields, false/*contiguous*/, false/*inorder*/));
+  PhysicalInstance result;
+  if (!runtime->create_physical_instance(ctx, target_memory, layout_constraints,
+        regions, result, true/*acquire*/, GC_NEVER_PRIORITY)) {
     fprintf(stderr,"Pennant mapper is out of memory!\n");
     fprintf(stderr,"ERROR: Pennant mapper %s failed to allocate reduction instance "
             "in memory " IDFMT " of kind %d for region requirement %d of task %s!\n",
@@ -599,61 +1133,501 @@ void PennantMapper::create_reduction_instances(const MapperContext ctx,
             index, task.get_task_name());
     assert(false);
   }
+  instances.push_back(result);
+  // Save the result for future use
+  AutoLock guard(&reduction_lock);
+  if (reduction_instances.find(key) == reduction_instances.end()) {
+    reduction_instances[key] = result;
+    reduction_instance_bytes[target_memory] += result.get_instance_size();
+    track_instance(result);
+  } else // somebody beat us to it so let this one be collected after use
+    runtime->set_garbage_collection_priority(ctx, result, 0/*normal*/);
 }
 
 VariantID PennantMapper::find_cpu_variant(const MapperContext ctx, TaskID task_id)
 {
-  std::map<TaskID,VariantID>::const_iterator finder = 
-    cpu_variants.find(task_id);
-  if (finder != cpu_variants.end())
-    return finder->second;
+  {
+    AutoLock guard(&variant_lock);
+    std::map<TaskID,VariantID>::const_iterator finder = 
+      cpu_variants.find(task_id);
+    if (finder != cpu_variants.end())
+      return finder->second;
+  }
   std::vector<VariantID> variants;
   runtime->find_valid_variants(ctx, task_id, variants, Processor::LOC_PROC);
   assert(variants.size() == 1); // should be exactly one for pennant 
+  AutoLock guard(&variant_lock);
   cpu_variants[task_id] = variants[0];
   return variants[0];
 }
 
 VariantID PennantMapper::find_omp_variant(const MapperContext ctx, TaskID task_id)
 {
-  std::map<TaskID,VariantID>::const_iterator finder = 
-    omp_variants.find(task_id);
-  if (finder != omp_variants.end())
-    return finder->second;
+  {
+    AutoLock guard(&variant_lock);
+    std::map<TaskID,VariantID>::const_iterator finder = 
+      omp_variants.find(task_id);
+    if (finder != omp_variants.end())
+      return finder->second;
+  }
   std::vector<VariantID> variants;
   runtime->find_valid_variants(ctx, task_id, variants, Processor::OMP_PROC);
   assert(variants.size() == 1); // should be exactly one for pennant 
+  AutoLock guard(&variant_lock);
   omp_variants[task_id] = variants[0];
   return variants[0];
 }
 
 VariantID PennantMapper::find_gpu_variant(const MapperContext ctx, TaskID task_id)
 {
-  std::map<TaskID,VariantID>::const_iterator finder = 
-    gpu_variants.find(task_id);
-  if (finder != gpu_variants.end())
-    return finder->second;
+  {
+    AutoLock guard(&variant_lock);
+    std::map<TaskID,VariantID>::const_iterator finder = 
+      gpu_variants.find(task_id);
+    if (finder != gpu_variants.end())
+      return finder->second;
+  }
   std::vector<VariantID> variants;
   runtime->find_valid_variants(ctx, task_id, variants, Processor::TOC_PROC);
   assert(variants.size() == 1); // should be exactly one for pennant 
+  AutoLock guard(&variant_lock);
   gpu_variants[task_id] = variants[0];
   return variants[0];
 }
 
+bool PennantMapper::select_tuned_variant(const MapperContext ctx,
+                                         const Task &task, const Domain &domain,
+                                         bool prefer_omp)
+{
+  // Only tasks with both kinds of variants can be tuned
+  std::pair<bool,bool> kinds;
+  bool found = false;
+  {
+    AutoLock guard(&variant_lock);
+    std::map<TaskID,std::pair<bool,bool> >::const_iterator finder =
+      tuning_variants.find(task.task_id);
+    if (finder != tuning_variants.end()) {
+      kinds = finder->second;
+      found = true;
+    }
+  }
+  if (!found) {
+    std::vector<VariantID> variants;
+    runtime->find_valid_variants(ctx, task.task_id, variants, Processor::LOC_PROC);
+    kinds.first = !variants.empty();
+    variants.clear();
+    runtime->find_valid_variants(ctx, task.task_id, variants, Processor::OMP_PROC);
+    kinds.second = !variants.empty();
+    AutoLock guard(&variant_lock);
+    tuning_variants[task.task_id] = kinds;
+  }
+  if (!kinds.second)
+    return false;
+  if (!kinds.first)
+    return true;
+  const VariantTuningKey key(task.task_id, find_tuning_role(ctx, task));
+  AutoLock guard(&variant_timing_lock);
+  VariantTiming &timing = variant_timings[key];
+  if (task.tag & TUNE_VARIANT) {
+    // Alternate between the variants while the trial cycles are running
+    timing.points = domain.get_volume();
+    return ((timing.trials++ % 2) == 1);
+  }
+  if (!timing.decided) {
+    if (timing.trials == 0) {
+      // Never tried this one so just do what the application asked for
+      timing.use_omp = prefer_omp;
+    } else if ((timing.cpu_samples > 0) && (timing.omp_samples > 0)) {
+      // Normally decided by the VARIANT_CHOICES_TUNABLE, but a task
+      // that was first timed after it was selected only has our timings
+      double cpu_cost, omp_cost;
+      variant_costs(timing, cpu_cost, omp_cost);
+      timing.use_omp = (omp_cost < cpu_cost);
+      fprintf(stdout,"Pennant mapper: task %s on %s uses %s variant "
+              "(CPU %.1f us, OMP %.1f us)\n", task.get_task_name(),
+              key.second.c_str(),
+              timing.use_omp ? "OMP" : "CPU", cpu_cost, omp_cost);
+    } else {
+      // Never saw both variants run so keep what the application asked for
+      timing.use_omp = prefer_omp;
+      fprintf(stdout,"Pennant mapper: task %s on %s uses %s variant "
+              "(not enough timing samples)\n", task.get_task_name(),
+              key.second.c_str(),
+              timing.use_omp ? "OMP" : "CPU");
+    }
+    timing.decided = true;
+  }
+  return timing.use_omp;
+}
+
+std::string PennantMapper::find_tuning_role(const MapperContext ctx,
+                                           const Task &task)
+{
+  // The same task can be launched over different partitions (e.g. private
+  // and master points) so use the partition to tell the launches apart,
+  // by its name since its handle changes from one run to the next
+  if (task.regions.empty())
+    return std::string("none");
+  const RegionRequirement &req = task.regions.front();
+  LogicalPartition partition = LogicalPartition::NO_PART;
+  if (req.handle_type == LEGION_PARTITION_PROJECTION)
+    partition = req.partition;
+  else if (runtime->has_parent_logical_partition(ctx, req.region))
+    partition = runtime->get_parent_logical_partition(ctx, req.region);
+  const char *name = NULL;
+  if ((partition != LogicalPartition::NO_PART) &&
+      runtime->retrieve_name(ctx, partition, name))
+    return std::string(name);
+  // Unnamed partitions fall back to the fields the launch uses
+  std::ostringstream oss;
+  oss << "fields";
+  for (std::set<FieldID>::const_iterator it = req.privilege_fields.begin();
+        it != req.privilege_fields.end(); it++)
+    oss << ((it == req.privilege_fields.begin()) ? '=' : '+') << *it;
+  return oss.str();
+}
+
+size_t PennantMapper::get_reduction_instance_bytes(Memory memory) const
+{
+  AutoLock guard(&reduction_lock);
+  std::map<Memory,size_t>::const_iterator finder = 
+    reduction_instance_bytes.find(memory);
+  if (finder == reduction_instance_bytes.end())
+    return 0;
+  return finder->second;
+}
+
+/*static*/ void PennantMapper::get_array_memories(Machine machine,
+                                                 std::vector<Memory> &memories)
+{
+  Memory::Kind kind = Memory::SYSTEM_MEM;
+  if (Machine::ProcessorQuery(machine).only_kind(Processor::TOC_PROC).count() > 0)
+    kind = Memory::GPU_FB_MEM;
+  else if ((Machine::ProcessorQuery(machine).only_kind(Processor::OMP_PROC).count() > 0) &&
+           (Machine::MemoryQuery(machine).only_kind(Memory::SOCKET_MEM).count() > 0))
+    kind = Memory::SOCKET_MEM;
+  Machine::MemoryQuery query(machine);
+  query.only_kind(kind);
+  for (Machine::MemoryQuery::iterator it = query.begin(); it != query.end(); it++)
+    memories.push_back(*it);
+}
+
+/*static*/ bool PennantMapper::has_whole_region_arrays(Machine machine)
+{
+  // Same test as map_pennant_array: a single node, unless the pieces
+  // are split over more than one GPU
+  if (machine.get_address_space_count() > 1)
+    return false;
+  return (Machine::ProcessorQuery(machine).only_kind(Processor::TOC_PROC).count() <= 1);
+}
+
+/*static*/ void PennantMapper::set_variant_choices(const VariantChoices &choices)
+{
+  apply_variant_choices(choices);
+}
+
+/*static*/ std::string PennantMapper::pack_variant_choices(
+                                            const VariantChoices &choices)
+{
+  std::ostringstream oss;
+  oss << choices.size() << "\n";
+  for (VariantChoices::const_iterator it = choices.begin(); 
+        it != choices.end(); it++)
+    oss << it->first.first << " " << (it->second ? 1 : 0) << " "
+        << it->first.second << "\n";
+  return oss.str();
+}
+
+/*static*/ void PennantMapper::unpack_variant_choices(const void *buffer,
+                                  size_t size, VariantChoices &choices)
+{
+  std::istringstream iss(std::string((const char*)buffer, size));
+  size_t count = 0;
+  iss >> count;
+  for (size_t idx = 0; idx < count; idx++) {
+    unsigned task_id;
+    int use_omp;
+    if (!(iss >> task_id >> use_omp))
+      break;
+    std::string role;
+    iss.get();
+    std::getline(iss, role);
+    choices[VariantTuningKey(task_id, role)] = (use_omp != 0);
+  }
+}
+
+/*static*/ void PennantMapper::apply_variant_choices(const VariantChoices &choices)
+{
+  AutoLock guard(&variant_timing_lock);
+  for (VariantChoices::const_iterator it = choices.begin(); 
+        it != choices.end(); it++)
+  {
+    VariantTiming &timing = variant_timings[it->first];
+    // Count it as a trial so it is saved again with the next results
+    timing.trials = 1;
+    timing.decided = true;
+    timing.use_omp = it->second;
+  }
+}
+
+void PennantMapper::variant_costs(const VariantTiming &timing,
+                                  double &cpu_cost, double &omp_cost) const
+{
+  // Compare how long it takes to run all the points of a process on
+  // each kind of processor, not just the time for one point
+  const size_t cpu_rounds = 
+    (timing.points + local_cpus.size() - 1) / local_cpus.size();
+  const size_t omp_rounds = 
+    (timing.points + local_omps.size() - 1) / local_omps.size();
+  cpu_cost = 1e-3 * cpu_rounds * (double(timing.cpu_time) / timing.cpu_samples);
+  omp_cost = 1e-3 * omp_rounds * (double(timing.omp_time) / timing.omp_samples);
+}
+
+void PennantMapper::select_variant_choices(const MapperContext ctx,
+                                           SelectTunableOutput &output)
+{
+  // Every other process sends back the timings of its trial runs, the
+  // tuning cycles are fenced first so their profiling has all come in
+  MapperEvent replied = (total_nodes > 1) ?
+    runtime->create_mapper_event(ctx) : MapperEvent();
+  unsigned request;
+  {
+    AutoLock guard(&variant_timing_lock);
+    variant_timing_totals.clear();
+    for (std::map<VariantTuningKey,VariantTiming>::const_iterator it = 
+          variant_timings.begin(); it != variant_timings.end(); it++)
+      if (it->second.trials > 0)
+        variant_timing_totals.insert(*it);
+    request = std::max(variant_timings_requests, variant_choices_requests) + 1;
+    variant_timings_requests = request;
+    variant_choices_requests = request;
+    variant_replies = total_nodes - 1;
+    variant_replies_event = replied;
+  }
+  if (total_nodes > 1) {
+    runtime->broadcast(ctx, &request, sizeof(request), 
+                       VARIANT_TIMINGS_REQUEST_MESSAGE);
+    runtime->wait_on_mapper_event(ctx, replied);
+  }
+  // Decide each task from the timings of all the processes so they
+  // all run the same variant
+  VariantChoices choices;
+  {
+    AutoLock guard(&variant_timing_lock);
+    for (std::map<VariantTuningKey,VariantTiming>::const_iterator it = 
+          variant_timing_totals.begin(); it != variant_timing_totals.end(); it++)
+    {
+      const VariantTiming &timing = it->second;
+      if (timing.decided) {
+        choices[it->first] = timing.use_omp;
+        continue;
+      }
+      // Tasks that didn't run on both get decided on their own later
+      if ((timing.cpu_samples == 0) || (timing.omp_samples == 0))
+        continue;
+      double cpu_cost, omp_cost;
+      variant_costs(timing, cpu_cost, omp_cost);
+      choices[it->first] = (omp_cost < cpu_cost);
+      const char *name = NULL;
+      if (!runtime->retrieve_name(ctx, it->first.first, name))
+        name = "(unnamed)";
+      fprintf(stdout,"Pennant mapper: task %s on %s uses %s variant "
+              "(CPU %.1f us, OMP %.1f us, %u trials)\n", name,
+              it->first.second.c_str(), choices[it->first] ? "OMP" : "CPU",
+              cpu_cost, omp_cost, timing.trials);
+    }
+    variant_timing_totals.clear();
+  }
+  apply_variant_choices(choices);
+  const std::string packed = pack_variant_choices(choices);
+  // Only return once every process uses the choices, so none of them
+  // picks its own for the first TUNED_VARIANT tasks it maps
+  if (total_nodes > 1) {
+    replied = runtime->create_mapper_event(ctx);
+    {
+      AutoLock guard(&variant_timing_lock);
+      variant_replies = total_nodes - 1;
+      variant_replies_event = replied;
+    }
+    std::ostringstream oss;
+    oss << request << "\n" << packed;
+    const std::string message = oss.str();
+    runtime->broadcast(ctx, message.c_str(), message.size(),
+                       VARIANT_CHOICES_MESSAGE);
+    runtime->wait_on_mapper_event(ctx, replied);
+  }
+  output.size = packed.size();
+  output.value = malloc(output.size);
+  memcpy(output.value, packed.c_str(), output.size);
+  output.take_ownership = true;
+}
+
+void PennantMapper::select_piece_times(const MapperContext ctx,
+                                       SelectTunableOutput &output)
+{
+  // Every other process sends back the times its mappers took, Legion
+  // reports the profiling of a task before it counts it as complete,
+  // so fencing the timed tasks first means none are still on the way
+  const MapperEvent replied = (total_nodes > 1) ?
+    runtime->create_mapper_event(ctx) : MapperEvent();
+  unsigned request;
+  {
+    AutoLock guard(&variant_timing_lock);
+    piece_time_totals.assign(numpcx * numpcy, 0.);
+    for (std::map<coord_t,long long>::const_iterator it = 
+          piece_times.begin(); it != piece_times.end(); it++)
+      piece_time_totals[it->first] += it->second;
+    piece_times.clear();
+    request = ++piece_times_requests;
+    piece_time_replies = total_nodes - 1;
+    piece_times_event = replied;
+  }
+  if (total_nodes > 1) {
+    runtime->broadcast(ctx, &request, sizeof(request), 
+                       PIECE_TIMES_REQUEST_MESSAGE);
+    runtime->wait_on_mapper_event(ctx, replied);
+  }
+  AutoLock guard(&variant_timing_lock);
+  output.size = piece_time_totals.size() * sizeof(double);
+  output.value = malloc(output.size);
+  memcpy(output.value, &piece_time_totals.front(), output.size);
+  output.take_ownership = true;
+}
+
+void PennantMapper::forget_piece_instances(void)
+{
+  {
+    AutoRWLock guard(&instance_lock, true/*exclusive*/);
+    // Instances of whole regions are still good after repartitioning
+    for (std::map<std::pair<LogicalRegion,Memory>,PhysicalInstance>::iterator
+          it = local_instances.begin(); it != local_instances.end(); /*nothing*/)
+    {
+      if (whole_region_instances.find(it->second) == 
+            whole_region_instances.end()) {
+        forgotten_instances.insert(it->second);
+        local_instances.erase(it++);
+      } else
+        it++;
+    }
+  }
+  {
+    AutoLock guard(&reduction_lock);
+    AutoRWLock instance_guard(&instance_lock, true/*exclusive*/);
+    for (std::map<std::pair<std::pair<LogicalRegion,Memory>,ReductionOpID>,
+                  PhysicalInstance>::const_iterator it = 
+          reduction_instances.begin(); it != reduction_instances.end(); it++)
+      forgotten_instances.insert(it->second);
+    reduction_instances.clear();
+    reduction_instance_bytes.clear();
+  }
+  has_forgotten_instances.store(true, std::memory_order_release);
+}
+
+void PennantMapper::forget_setup_instances(void)
+{
+  AutoRWLock guard(&instance_lock, true/*exclusive*/);
+  // Reduction instances only have the fields they reduce to so they stay
+  for (std::map<std::pair<LogicalRegion,Memory>,PhysicalInstance>::const_iterator
+        it = local_instances.begin(); it != local_instances.end(); it++) {
+    forgotten_instances.insert(it->second);
+    setup_instances.insert(it->second);
+  }
+  local_instances.clear();
+  whole_region_instances.clear();
+  has_forgotten_instances.store(true, std::memory_order_release);
+}
+
+void PennantMapper::release_forgotten_instances(const MapperContext ctx)
+{
+  std::set<PhysicalInstance> instances;
+  {
+    AutoRWLock guard(&instance_lock, true/*exclusive*/);
+    instances.swap(forgotten_instances);
+    has_forgotten_instances.store(false, std::memory_order_release);
+  }
+  for (std::set<PhysicalInstance>::const_iterator it = 
+        instances.begin(); it != instances.end(); it++) {
+    runtime->set_garbage_collection_priority(ctx, *it, 0/*normal*/);
+    untrack_instance(*it);
+  }
+}
+
+/*static*/ void PennantMapper::track_instance(const PhysicalInstance &instance)
+{
+  const size_t bytes = instance.get_instance_size();
+  AutoLock guard(&memory_usage_lock);
+  if (!tracked_instances.insert(instance).second)
+    return;
+  MemoryUsage &memory = memory_usage[instance.get_location()];
+  memory.current += bytes;
+  memory.peak = std::max(memory.peak, memory.current);
+  MemoryUsage &field_space = field_space_usage[instance.get_field_space()];
+  field_space.current += bytes;
+  field_space.peak = std::max(field_space.peak, field_space.current);
+}
+
+/*static*/ void PennantMapper::untrack_instance(const PhysicalInstance &instance)
+{
+  const size_t bytes = instance.get_instance_size();
+  AutoLock guard(&memory_usage_lock);
+  if (tracked_instances.erase(instance) == 0)
+    return;
+  memory_usage[instance.get_location()].current -= bytes;
+  field_space_usage[instance.get_field_space()].current -= bytes;
+}
+
+/*static*/ void PennantMapper::get_memory_usage(
+                            std::map<Memory,MemoryUsage> &memories,
+                            std::map<FieldSpace,MemoryUsage> &field_spaces)
+{
+  AutoLock guard(&memory_usage_lock);
+  memories = memory_usage;
+  field_spaces = field_space_usage;
+}
+
+/*static*/ void PennantMapper::get_mapping_stats(unsigned long long &calls,
+                                                unsigned long long &time)
+{
+  calls = __sync_fetch_and_add(&mapping_calls, 0);
+  time = __sync_fetch_and_add(&mapping_time, 0);
+}
+
 void PennantMapper::update_mesh_information(coord_t npcx, coord_t npcy)
 {
   assert(numpcx == 0);
   assert(numpcy == 0);
-  assert(!sharded);
+  assert(!sharded.load(std::memory_order_acquire));
   numpcx = npcx;
   numpcy = npcy;
 }
 
+void PennantMapper::add_node_instance_group(
+                                const std::vector<IndexPartition> &partitions)
+{
+  AutoRWLock guard(&instance_lock, true/*exclusive*/);
+  const unsigned group = node_instance_partitions.size();
+  node_instance_partitions.push_back(partitions);
+  for (std::vector<IndexPartition>::const_iterator it = 
+        partitions.begin(); it != partitions.end(); it++) {
+    assert(node_instance_groups.find(*it) == node_instance_groups.end());
+    node_instance_groups[*it] = group;
+  }
+}
+
 #ifdef PENNANT_DISABLE_CONTROL_REPLICATION
 void PennantMapper::compute_fake_sharding(MapperContext ctx)
 {
+#ifndef ENABLE_CONCURRENT_MAPPER
   runtime->disable_reentrant(ctx);
-  assert(!sharded);
+#endif
+  AutoLock guard(&sharding_lock);
+  // Check again in case someone else did it while we waited for the lock
+  if (sharded.load(std::memory_order_relaxed)) {
+#ifndef ENABLE_CONCURRENT_MAPPER
+    runtime->enable_reentrant(ctx);
+#endif
+    return;
+  }
   assert(numpcx > 0);
   assert(numpcy > 0);
   coord_t nsx, nsy;
@@ -745,13 +1719,16 @@ void PennantMapper::compute_fake_sharding(MapperContext ctx)
       sharding_memories = sharding_sys_memories;
     }
   }
-  sharded = true;
+  sharded.store(true, std::memory_order_release);
+#ifndef ENABLE_CONCURRENT_MAPPER
   runtime->enable_reentrant(ctx);
+#endif
 }
 #else
-coord_t PennantMapper::compute_shard_index(Point<1> p)
+const Rect<2>& PennantMapper::get_shard_rect(void)
 {
-  if (!sharded) {
+  AutoLock guard(&sharding_lock);
+  if (!sharded.load(std::memory_order_relaxed)) {
     assert(numpcx > 0);
     assert(numpcy > 0);
     // these are member variables if we are disabling control replication
@@ -767,13 +1744,72 @@ coord_t PennantMapper::compute_shard_index(Point<1> p)
                                 (shard_point[1] + 1) * pershardy - 1));
     const Rect<2> full(Point<2>(0, 0), Point<2>(numpcx-1, numpcy-1));
     shard_rect = rect.intersection(full);
-    sharded = true;
+    sharded.store(true, std::memory_order_release);
   }
+  return shard_rect;
+}
+
+coord_t PennantMapper::compute_shard_index(Point<1> p)
+{
+  const Rect<2> &rect = get_shard_rect();
   const Point<2> point(p[0] % numpcx, p[0] / numpcx);
-  assert(shard_rect.contains(point));
-  const coord_t x = point[0] - shard_rect.lo[0];
-  const coord_t y = point[1] - shard_rect.lo[1];
-  return y * ((shard_rect.hi[0] - shard_rect.lo[0]) + 1) + x;
+  assert(rect.contains(point));
+  const coord_t x = point[0] - rect.lo[0];
+  const coord_t y = point[1] - rect.lo[1];
+  return y * ((rect.hi[0] - rect.lo[0]) + 1) + x;
 }
+
+#ifdef ENABLE_NODE_INSTANCES
+bool PennantMapper::find_node_regions(const MapperContext ctx,
+                                      LogicalRegion region, Memory target,
+                                      std::vector<LogicalRegion> &regions)
+{
+  if (!runtime->has_parent_index_partition(ctx, region.get_index_space()))
+    return false;
+  const IndexPartition parent = 
+    runtime->get_parent_index_partition(ctx, region.get_index_space());
+  std::vector<IndexPartition> partitions;
+  {
+    AutoRWLock guard(&instance_lock, false/*exclusive*/);
+    std::map<IndexPartition,unsigned>::const_iterator finder = 
+      node_instance_groups.find(parent);
+    if (finder == node_instance_groups.end())
+      return false;
+    partitions = node_instance_partitions[finder->second];
+  }
+  const Rect<2> &rect = get_shard_rect();
+  const DomainPoint color = runtime->get_logical_region_color_point(ctx, region);
+  const Point<2> point(color[0] % numpcx, color[0] / numpcx);
+  if (!rect.contains(point))
+    return false;
+  // Pieces are dealt round-robin to the GPUs or NUMA domains on the
+  // node (see map_copy), only the ones sharing our memory go in here
+  coord_t ways = 1;
+  if (target.kind() == Memory::GPU_FB_MEM)
+    ways = local_gpus.size();
+  else if (target.kind() == Memory::SOCKET_MEM)
+    ways = local_omps.size();
+  if (ways == 0)
+    ways = 1;
+  const coord_t width = (rect.hi[0] - rect.lo[0]) + 1;
+  const coord_t way = compute_shard_index(Point<1>(color[0])) % ways;
+  for (std::vector<IndexPartition>::const_iterator it = 
+        partitions.begin(); it != partitions.end(); it++) {
+    const LogicalPartition part = runtime->get_logical_partition_by_tree(ctx,
+        *it, region.get_field_space(), region.get_tree_id());
+    for (coord_t y = rect.lo[1]; y <= rect.hi[1]; y++) {
+      for (coord_t x = rect.lo[0]; x <= rect.hi[0]; x++) {
+        const coord_t index = (y - rect.lo[1]) * width + (x - rect.lo[0]);
+        if ((index % ways) != way)
+          continue;
+        const Point<1> piece(y * numpcx + x);
+        regions.push_back(runtime->get_logical_subregion_by_color(ctx, part,
+                                                          DomainPoint(piece)));
+      }
+    }
+  }
+  return true;
+}
+#endif
 #endif
 
@@ -13,8 +13,12 @@
 #ifndef PENNANTMAPPER_HH_
 #define PENNANTMAPPER_HH_
 
+#include <atomic>
+#include <map>
 #include <set>
+#include <string>
 #include <vector>
+#include <pthread.h>
 
 #include "legion.h"
 #include "default_mapper.h"
@@ -28,6 +32,26 @@ public:
     PREFER_GPU        = 0x0004,
     PREFER_ZCOPY      = 0x0008,
     CRITICAL          = 0x0010,
+    NODE_REDUCE       = 0x0020,
+    TUNE_VARIANT      = 0x0040, // alternate the variants and time them
+    TUNED_VARIANT     = 0x0080, // run the fastest variant that was timed
+    TIME_PIECES       = 0x0100, // time the points for rebalancing pieces
+  };
+  enum {
+    // Nanoseconds each piece spent in TIME_PIECES tasks since the last
+    // time this was selected, summed over every process into an array
+    // of doubles
+    PIECE_TIMES_TUNABLE = 'P' * 100,
+    // Has the mappers in every process drop the instances of the pieces
+    // once they are repartitioned, select it after the last operation on
+    // the old pieces is done; the value is always zero
+    FORGET_PIECES_TUNABLE,
+    // Has the mappers decide the variant of each task timed with
+    // TUNE_VARIANT from the timings of every process, and all use it
+    // for TUNED_VARIANT from then on, along with any choices given to
+    // set_variant_choices; the value is the choices, packed with
+    // pack_variant_choices
+    VARIANT_CHOICES_TUNABLE,
   };
 public:
   PennantMapper(
@@ -102,6 +126,53 @@ public:
                                  const Legion::Mappable& mappable,
                                  const MemoizeInput& input,
                                        MemoizeOutput& output);
+public:
+  // The rest of the default mapper calls that a run gets to, overridden
+  // only so they are serialized with the default_lock
+  virtual void map_replicate_task(const Legion::Mapping::MapperContext ctx,
+                                  const Legion::Task& task,
+                                  const MapTaskInput& input,
+                                  const MapTaskOutput& default_output,
+                                        MapReplicateTaskOutput& output);
+  virtual void select_task_sources(const Legion::Mapping::MapperContext ctx,
+                                   const Legion::Task& task,
+                                   const SelectTaskSrcInput& input,
+                                         SelectTaskSrcOutput& output);
+  virtual void select_copy_sources(const Legion::Mapping::MapperContext ctx,
+                                   const Legion::Copy& copy,
+                                   const SelectCopySrcInput& input,
+                                         SelectCopySrcOutput& output);
+  virtual void map_inline(const Legion::Mapping::MapperContext ctx,
+                          const Legion::InlineMapping& inline_op,
+                          const MapInlineInput& input,
+                                MapInlineOutput& output);
+  virtual void select_inline_sources(const Legion::Mapping::MapperContext ctx,
+                                     const Legion::InlineMapping& inline_op,
+                                     const SelectInlineSrcInput& input,
+                                           SelectInlineSrcOutput& output);
+  virtual void select_partition_sources(const Legion::Mapping::MapperContext ctx,
+                                        const Legion::Partition& partition,
+                                        const SelectPartitionSrcInput& input,
+                                              SelectPartitionSrcOutput& output);
+  virtual void map_future_map_reduction(const Legion::Mapping::MapperContext ctx,
+                                        const FutureMapReductionInput& input,
+                                              FutureMapReductionOutput& output);
+  virtual void configure_context(const Legion::Mapping::MapperContext ctx,
+                                 const Legion::Task& task,
+                                       ContextConfigOutput& output);
+  virtual void select_tasks_to_map(const Legion::Mapping::MapperContext ctx,
+                                   const SelectMappingInput& input,
+                                         SelectMappingOutput& output);
+  virtual void select_steal_targets(const Legion::Mapping::MapperContext ctx,
+                                    const SelectStealingInput& input,
+                                          SelectStealingOutput& output);
+public:
+  virtual void report_profiling(const Legion::Mapping::MapperContext ctx,
+                                const Legion::Task& task,
+                                const TaskProfilingInfo& input);
+public:
+  virtual void handle_message(const Legion::Mapping::MapperContext ctx,
+                              const MapperMessage& message);
 protected:
   static const char* get_name(Legion::Processor p);
   void map_pennant_array(const Legion::Mapping::MapperContext ctx, 
@@ -109,6 +180,10 @@ protected:
                          Legion::LogicalRegion region, Legion::Memory target,
                          std::vector<Legion::Mapping::PhysicalInstance> &instances,
                          bool initialization_instance = false);
+  // Whether map_pennant_array gives every piece on this node the same
+  // instance of region in target
+  bool node_shared_instances(const Legion::Mapping::MapperContext ctx,
+                             Legion::LogicalRegion region, Legion::Memory target);
   void create_reduction_instances(const Legion::Mapping::MapperContext ctx,
                          const Legion::Task &task, unsigned index, Legion::Memory target,
                          std::vector<Legion::Mapping::PhysicalInstance> &instances);
@@ -118,23 +193,185 @@ protected:
                                      Legion::TaskID task_id);
   Legion::VariantID find_gpu_variant(const Legion::Mapping::MapperContext ctx,
                                      Legion::TaskID task_id);
+  bool select_tuned_variant(const Legion::Mapping::MapperContext ctx,
+                            const Legion::Task &task, const Legion::Domain &domain,
+                            bool prefer_omp);
+  std::string find_tuning_role(const Legion::Mapping::MapperContext ctx,
+                               const Legion::Task &task);
 #ifdef PENNANT_DISABLE_CONTROL_REPLICATION
   void compute_fake_sharding(Legion::Mapping::MapperContext ctx);
 #else
+  const Legion::Rect<2>& get_shard_rect(void);
   Legion::coord_t compute_shard_index(Legion::Point<1> point);
+#ifdef ENABLE_NODE_INSTANCES
+  bool find_node_regions(const Legion::Mapping::MapperContext ctx,
+                         Legion::LogicalRegion region, Legion::Memory target,
+                         std::vector<Legion::LogicalRegion> &regions);
 #endif
+#endif
+  void release_forgotten_instances(const Legion::Mapping::MapperContext ctx);
+  void select_piece_times(const Legion::Mapping::MapperContext ctx,
+                          SelectTunableOutput &output);
+  void select_variant_choices(const Legion::Mapping::MapperContext ctx,
+                              SelectTunableOutput &output);
+  // Stop using the instances of the old pieces after they are
+  // repartitioned, they get collected once nothing is using them
+  void forget_piece_instances(void);
 public:
   void update_mesh_information(Legion::coord_t numpcx, Legion::coord_t numpcy);
+  // Partitions whose pieces on the same node (or on the same NUMA domain 
+  // or GPU) should all share one instance when ENABLE_NODE_INSTANCES is set
+  void add_node_instance_group(const std::vector<Legion::IndexPartition> &partitions);
+  size_t get_reduction_instance_bytes(Legion::Memory memory) const;
+  // Locked in variant choices (true for OpenMP) for each task and the
+  // role of its launch, which is the name attached to the partition it
+  // is launched over or else its fields, so it is the same in every run
+  typedef std::map<std::pair<Legion::TaskID,std::string>,bool> VariantChoices;
+  // Choices to use in this process, until they are replaced by the ones
+  // from the next VARIANT_CHOICES_TUNABLE
+  static void set_variant_choices(const VariantChoices &choices);
+  // Lines of "<task> <0 for CPU, 1 for OMP> <role>" after their count
+  static std::string pack_variant_choices(const VariantChoices &choices);
+  static void unpack_variant_choices(const void *buffer, size_t size,
+                                     VariantChoices &choices);
+  // Number of mapping calls and nanoseconds spent in them in this process
+  static void get_mapping_stats(unsigned long long &calls, 
+                                unsigned long long &time);
+  // Bytes of the instances that the Pennant mappers in this process have
+  // made and not yet let be collected, for each memory and field space
+  struct MemoryUsage {
+  public:
+    MemoryUsage(void) : current(0), peak(0) { }
+  public:
+    size_t current, peak;
+  };
+  static void get_memory_usage(std::map<Legion::Memory,MemoryUsage> &memories,
+                          std::map<Legion::FieldSpace,MemoryUsage> &field_spaces);
+  // Memories that map_pennant_array puts the instances of the pieces in
+  // across the whole machine: framebuffers if there are GPUs, NUMA
+  // memories if there are OpenMP processors, otherwise system memories
+  static void get_array_memories(Legion::Machine machine,
+                                 std::vector<Legion::Memory> &memories);
+  // Whether map_pennant_array gives each of those memories one instance
+  // of the whole mesh rather than instances of the pieces mapped there
+  static bool has_whole_region_arrays(Legion::Machine machine);
+  // Stop using all the instances of the mesh regions once the fields
+  // that are only needed during setup are freed, so they get collected
+  // and the new ones only have room for the fields that are left
+  void forget_setup_instances(void);
 public:
   const char *const pennant_mapper_name;
+protected:
+  struct VariantTiming {
+  public:
+    VariantTiming(void)
+      : trials(0), points(0), cpu_samples(0), omp_samples(0),
+        cpu_time(0), omp_time(0), decided(false), use_omp(false) { }
+  public:
+    unsigned trials;
+    size_t points;
+    unsigned cpu_samples, omp_samples;
+    long long cpu_time, omp_time; // nanoseconds
+    bool decided, use_omp;
+  };
+  typedef std::pair<Legion::TaskID,std::string> VariantTuningKey;
+  static std::map<VariantTuningKey,VariantTiming> variant_timings;
+  static pthread_mutex_t variant_timing_lock;
+  static void apply_variant_choices(const VariantChoices &choices);
+  // Rough time in microseconds to run the points of a process on each
+  // kind of processor, from the average time of a point
+  void variant_costs(const VariantTiming &timing,
+                     double &cpu_cost, double &omp_cost) const;
+  enum {
+    VARIANT_CHOICES_MESSAGE = 1,
+    PIECE_TIMES_REQUEST_MESSAGE = 2,
+    PIECE_TIMES_MESSAGE = 3,
+    FORGET_PIECES_MESSAGE = 4,
+    VARIANT_TIMINGS_REQUEST_MESSAGE = 5,
+    VARIANT_TIMINGS_MESSAGE = 6,
+    VARIANT_CHOICES_APPLIED_MESSAGE = 7,
+  };
+  // Last VARIANT_CHOICES_TUNABLE request this process sent its variant
+  // timings for, and the last one whose choices it applied
+  static unsigned variant_timings_requests, variant_choices_requests;
+  // Timings summed so far and replies still to come for the variant
+  // choices this mapper is selecting (all guarded by the
+  // variant_timing_lock)
+  std::map<VariantTuningKey,VariantTiming> variant_timing_totals;
+  unsigned variant_replies;
+  Legion::Mapping::MapperEvent variant_replies_event;
+  // Nanoseconds each piece spent in TIME_PIECES tasks mapped in this
+  // process that haven't been sent for a PIECE_TIMES_TUNABLE yet
+  static std::map<Legion::coord_t,long long> piece_times;
+  // Last PIECE_TIMES_TUNABLE request this process sent its times for
+  static unsigned piece_times_requests;
+  // Times summed so far and replies still to come for the piece times
+  // this mapper is selecting (all guarded by the variant_timing_lock)
+  std::vector<double> piece_time_totals;
+  unsigned piece_time_replies;
+  Legion::Mapping::MapperEvent piece_times_event;
+protected:
+  // Times a mapper call for the mapping throughput statistics
+  class MappingCallTimer {
+  public:
+    MappingCallTimer(void)
+      : start(Realm::Clock::current_time_in_nanoseconds()) { }
+    ~MappingCallTimer(void)
+    {
+      const long long stop = Realm::Clock::current_time_in_nanoseconds();
+      __sync_fetch_and_add(&mapping_calls, 1);
+      __sync_fetch_and_add(&mapping_time, stop - start);
+    }
+  private:
+    const long long start;
+  };
+  static unsigned long long mapping_calls, mapping_time;
+protected:
+  // Count an instance in the memory usage until untrack_instance
+  // (tracking an instance twice only counts it once)
+  static void track_instance(const Legion::Mapping::PhysicalInstance &instance);
+  static void untrack_instance(const Legion::Mapping::PhysicalInstance &instance);
+  static std::set<Legion::Mapping::PhysicalInstance> tracked_instances;
+  static std::map<Legion::Memory,MemoryUsage> memory_usage;
+  static std::map<Legion::FieldSpace,MemoryUsage> field_space_usage;
+  static pthread_mutex_t memory_usage_lock;
+protected:
+  // Locks for our state, mapper calls can run in parallel when we
+  // use the concurrent mapper model (ENABLE_CONCURRENT_MAPPER)
+  mutable pthread_mutex_t variant_lock, reduction_lock, sharding_lock;
+  // The default mapper isn't thread safe so calls into it are serialized
+  mutable pthread_mutex_t default_lock;
+  // Instances are looked up far more often than they are made
+  mutable pthread_rwlock_t instance_lock;
 protected:
   std::map<Legion::TaskID,Legion::VariantID> cpu_variants;
   std::map<Legion::TaskID,Legion::VariantID> omp_variants;
   std::map<Legion::TaskID,Legion::VariantID> gpu_variants;
+  // Whether each task has CPU and OpenMP variants to tune between
+  std::map<Legion::TaskID,std::pair<bool,bool> > tuning_variants;
 protected:
   Legion::Memory local_sysmem, local_numa, local_zerocopy, local_framebuffer;
   std::map<std::pair<Legion::LogicalRegion,Legion::Memory>,
            Legion::Mapping::PhysicalInstance> local_instances;
+  std::map<std::pair<std::pair<Legion::LogicalRegion,Legion::Memory>,
+                     Legion::ReductionOpID>,
+           Legion::Mapping::PhysicalInstance> reduction_instances;
+  // Bytes pinned by the cached reduction instances in each memory
+  std::map<Legion::Memory,size_t> reduction_instance_bytes;
+  // Instances covering a whole region tree, kept by forget_piece_instances
+  // but not by forget_setup_instances
+  std::set<Legion::Mapping::PhysicalInstance> whole_region_instances;
+  // Instances dropped by the forget calls that still need their
+  // garbage collection priority lowered (guarded by the instance_lock)
+  std::set<Legion::Mapping::PhysicalInstance> forgotten_instances;
+  // Checked by map_task without the instance_lock
+  std::atomic<bool> has_forgotten_instances;
+  // Instances dropped by forget_setup_instances, map_pennant_array makes
+  // new instances rather than finding these again
+  std::set<Legion::Mapping::PhysicalInstance> setup_instances;
+  // Groups of partitions registered with add_node_instance_group
+  std::map<Legion::IndexPartition,unsigned> node_instance_groups;
+  std::vector<std::vector<Legion::IndexPartition> > node_instance_partitions;
 #ifdef PENNANT_DISABLE_CONTROL_REPLICATION
   std::vector<std::pair<Legion::Processor,Legion::IndexSpace> > sharding_spaces;
   std::map<Legion::Point<1>,Legion::Memory> sharding_memories, sharding_sys_memories;
@@ -147,7 +384,9 @@ protected:
 #else
   Legion::Rect<2> shard_rect;
 #endif
-  bool sharded;
+  // Set under the sharding_lock once the sharding is computed, and
+  // checked without it before reading the sharding members above
+  std::atomic<bool> sharded;
 };
 
 
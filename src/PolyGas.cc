@@ -12,6 +12,12 @@
 
 #include "PolyGas.hh"
 
+#include <cstdlib>
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+
 #include "legion.h"
 
 #include "Vec2.hh"
@@ -38,6 +44,12 @@ static void __attribute__ ((constructor)) registerTasks() {
       registrar.set_leaf();
       Runtime::preregister_task_variant<PolyGas::calcStateHalfOMPTask>(registrar, "calcstatehalf");
     }
+    {
+      TaskVariantRegistrar registrar(TID_INITEOSTABLE, "CPU init EOS table");
+      registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+      registrar.set_leaf();
+      Runtime::preregister_task_variant<PolyGas::initEOSTableTask>(registrar, "init EOS table");
+    }
     {
       TaskVariantRegistrar registrar(TID_CALCFORCEPGAS, "CPU calcforcepgas");
       registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
@@ -54,9 +66,197 @@ static void __attribute__ ((constructor)) registerTasks() {
 }; // namespace
 
 
-PolyGas::PolyGas(const InputFile* inp, Hydro* h) : hydro(h) {
+PolyGas::PolyGas(const InputFile* inp, Hydro* h)
+        : hydro(h), eosnr(0), eosne(0) {
     gamma = inp->getDouble("gamma", 5. / 3.);
     ssmin = inp->getDouble("ssmin", 0.);
+    const string eos = inp->getString("eos", "gamma");
+    eostable = inp->getString("eostable", "");
+    if (eos == "gamma")
+        eostype = EOS_GAMMA;
+    else if (eos == "table")
+        eostype = EOS_TABLE;
+    else {
+        cerr << "Error:  invalid eos " << eos << endl;
+        exit(1);
+    }
+    if (eostype != EOS_TABLE) return;
+    if (eostable.empty()) {
+        cerr << "Error:  eos table needs an eostable file" << endl;
+        exit(1);
+    }
+
+    Context ctx = hydro->ctx;
+    Runtime* runtime = hydro->runtime;
+    vector<double> tab;
+    readTable(eostable, eosnr, eosne, tab);
+
+    // The table is small next to the mesh, so it is one region that
+    // all the pieces read, and the mapper keeps a copy of it in each
+    // memory that runs calcStateHalf
+    IndexSpace ist = runtime->create_index_space(ctx, Rect<1>(0, tab.size() - 1));
+    FieldSpace fst = runtime->create_field_space(ctx);
+    {
+      FieldAllocator fa = runtime->create_field_allocator(ctx, fst);
+      fa.allocate_field(sizeof(double), FID_EOSTAB);
+      runtime->attach_name(fst, FID_EOSTAB, "EOSTAB");
+    }
+    lreos = runtime->create_logical_region(ctx, ist, fst);
+    runtime->attach_name(lreos, "lreos");
+    {
+      TaskLauncher launcher(TID_INITEOSTABLE,
+          TaskArgument(&tab[0], tab.size() * sizeof(double)));
+      launcher.add_region_requirement(
+          RegionRequirement(lreos, LEGION_WRITE_DISCARD, LEGION_EXCLUSIVE, lreos));
+      launcher.add_field(0/*index*/, FID_EOSTAB);
+      runtime->execute_task(ctx, launcher);
+    }
+
+    // Intervals start at the bottom of the table, after the first
+    // cycle each zone's are where it was last time
+    FieldSpace fsze = runtime->create_field_space(ctx);
+    {
+      FieldAllocator fa = runtime->create_field_allocator(ctx, fsze);
+      fa.allocate_field(sizeof(int), FID_ZEOSIR);
+      runtime->attach_name(fsze, FID_ZEOSIR, "ZEOSIR");
+      fa.allocate_field(sizeof(int), FID_ZEOSIE);
+      runtime->attach_name(fsze, FID_ZEOSIE, "ZEOSIE");
+    }
+    lrzeos = runtime->create_logical_region(ctx,
+        hydro->mesh->lrz.get_index_space(), fsze);
+    runtime->attach_name(lrzeos, "lrzeos");
+    {
+      const int zero = 0;
+      FillLauncher launcher(lrzeos, lrzeos, TaskArgument(&zero, sizeof(zero)));
+      launcher.add_field(FID_ZEOSIR);
+      launcher.add_field(FID_ZEOSIE);
+      runtime->fill_fields(ctx, launcher);
+    }
+
+    LEGION_PRINT_ONCE(runtime, ctx, stdout,
+        "EOS table %s: %d densities x %d energies\n",
+        eostable.c_str(), eosnr, eosne);
+}
+
+
+PolyGas::~PolyGas() {
+    if (eostype != EOS_TABLE) return;
+
+    // lrzeos shares the mesh's zone index space, so only the
+    // table's own index space is ours to destroy
+    Context ctx = hydro->ctx;
+    Runtime* runtime = hydro->runtime;
+    const IndexSpace ist = lreos.get_index_space();
+    const FieldSpace fst = lreos.get_field_space();
+    const FieldSpace fsze = lrzeos.get_field_space();
+    runtime->destroy_logical_region(ctx, lreos);
+    runtime->destroy_logical_region(ctx, lrzeos);
+    runtime->destroy_field_space(ctx, fst);
+    runtime->destroy_field_space(ctx, fsze);
+    runtime->destroy_index_space(ctx, ist);
+}
+
+
+PolyGas::StateHalfArgs PolyGas::stateHalfArgs() const {
+    return StateHalfArgs(gamma, ssmin, eostype, eosnr, eosne);
+}
+
+
+LogicalPartition PolyGas::getZonePieces() const {
+    // The intervals aren't moved when the zones are rebalanced, but
+    // they are only where the search starts, so the first cycle on
+    // the new pieces just takes a few more steps
+    return hydro->runtime->get_logical_partition(lrzeos,
+        hydro->mesh->lpz.get_index_partition());
+}
+
+
+void PolyGas::readTable(
+        const string& filename,
+        int& nr,
+        int& ne,
+        vector<double>& tab) {
+    ifstream ifs(filename.c_str());
+    if (!ifs.good()) {
+        cerr << "Error:  cannot open EOS table " << filename << endl;
+        exit(1);
+    }
+
+    // The file is whitespace-separated numbers, with # comments:
+    //     nr ne
+    //     nr densities, increasing
+    //     ne energies, increasing
+    //     nr * ne pressures, all the energies for each density in turn
+    vector<double> vals;
+    string line;
+    while (getline(ifs, line)) {
+        const size_t hash = line.find('#');
+        if (hash != string::npos) line.erase(hash);
+        istringstream iss(line);
+        double v;
+        while (iss >> v) vals.push_back(v);
+        if (!iss.eof()) {
+            cerr << "Error:  bad value in EOS table " << filename
+                 << ": " << line << endl;
+            exit(1);
+        }
+    }
+    ifs.close();
+
+    if (vals.size() < 2 || vals[0] < 2. || vals[1] < 2.) {
+        cerr << "Error:  EOS table " << filename
+             << " must start with at least 2 densities and 2 energies"
+             << endl;
+        exit(1);
+    }
+    nr = int(vals[0]);
+    ne = int(vals[1]);
+    if (vals.size() != 2 + nr + ne + nr * ne) {
+        cerr << "Error:  EOS table " << filename << " has "
+             << vals.size() - 2 << " values, expected "
+             << nr + ne + nr * ne << endl;
+        exit(1);
+    }
+    const double* rvals = &vals[2];
+    const double* evals = rvals + nr;
+    const double* pvals = evals + ne;
+    for (int i = 1; i < nr; ++i)
+        if (rvals[i] <= rvals[i-1]) {
+            cerr << "Error:  EOS table densities must increase" << endl;
+            exit(1);
+        }
+    for (int i = 1; i < ne; ++i)
+        if (evals[i] <= evals[i-1]) {
+            cerr << "Error:  EOS table energies must increase" << endl;
+            exit(1);
+        }
+
+    // lay it out the way TableEOS reads it
+    tab.resize(TableEOS::tableSize(nr, ne));
+    double* rdinv = &tab[nr + ne];
+    double* edinv = rdinv + nr - 1;
+    double* ptab = edinv + ne - 1;
+    copy(rvals, rvals + nr, &tab[0]);
+    copy(evals, evals + ne, &tab[nr]);
+    for (int i = 0; i < nr - 1; ++i)
+        rdinv[i] = 1. / (rvals[i+1] - rvals[i]);
+    for (int i = 0; i < ne - 1; ++i)
+        edinv[i] = 1. / (evals[i+1] - evals[i]);
+    copy(pvals, pvals + nr * ne, ptab);
+}
+
+
+void PolyGas::initEOSTableTask(
+        const Task *task,
+        const std::vector<PhysicalRegion> &regions,
+        Context ctx,
+        Runtime *runtime) {
+    const double* tab = (const double*) task->args;
+    const AccessorWD<double> acc_tab(regions[0], FID_EOSTAB);
+
+    const IndexSpace& ist = task->regions[0].region.get_index_space();
+    for (PointIterator itt(runtime, ist); itt(); itt++)
+        acc_tab[*itt] = tab[(*itt)[0]];
 }
 
 
@@ -65,9 +265,9 @@ void PolyGas::calcStateHalfTask(
         const std::vector<PhysicalRegion> &regions,
         Context ctx,
         Runtime *runtime) {
-    const double* args = (const double*) task->args;
-    const double gamma = args[0];
-    const double ssmin = args[1];
+    const StateHalfArgs* args = (const StateHalfArgs*) task->args;
+    const double gamma = args->gamma;
+    const double ssmin = args->ssmin;
     const double dt    = task->futures[0].get_result<double>();
 
     const AccessorRO<double> acc_zr(regions[0], FID_ZR);
@@ -75,27 +275,53 @@ void PolyGas::calcStateHalfTask(
     const AccessorRO<double> acc_zvol0(regions[0], FID_ZVOL0);
     const AccessorRO<double> acc_ze(regions[0], FID_ZE);
     const AccessorRO<double> acc_zwrate(regions[0], FID_ZWRATE);
+#ifdef CACHE_INVARIANTS
+    const AccessorRO<double> acc_zminv(regions[2], FID_ZMINV);
+#else
     const AccessorRO<double> acc_zm(regions[0], FID_ZM);
+#endif
     const AccessorWD<double> acc_zp(regions[1], FID_ZP);
     const AccessorWD<double> acc_zss(regions[1], FID_ZSS);
+    // with a table the last two regions are it and the zone intervals
+    const bool usetable = (args->eostype == EOS_TABLE);
+    TableEOS eostab;
+    AccessorRW<int> acc_zeosir, acc_zeosie;
+    if (usetable) {
+        const int nreg = regions.size();
+        const AccessorRO<double> acc_tab(regions[nreg - 2], FID_EOSTAB);
+        eostab = TableEOS(acc_tab.ptr(Pointer(0)), args->nr, args->ne);
+        acc_zeosir = AccessorRW<int>(regions[nreg - 1], FID_ZEOSIR);
+        acc_zeosie = AccessorRW<int>(regions[nreg - 1], FID_ZEOSIE);
+    }
 
     const double dth = 0.5 * dt;
     const double gm1 = gamma - 1.;
     const double ssmin2 = max(ssmin * ssmin, 1.e-99);
+    const GammaEOS eosgam = { gm1 };
     const IndexSpace& isz = task->regions[0].region.get_index_space();
     for (PointIterator itz(runtime, isz); itz(); itz++)
     {
         // compute EOS at beginning of time step
         const double r = acc_zr[*itz];
         const double e = max(acc_ze[*itz], 0.);
-        const double p = gm1 * r * e;
-        const double pre = gm1 * e;
-        const double per = gm1 * r;
+        double p, pre, per;
+        if (usetable) {
+            int ir = acc_zeosir[*itz];
+            int ie = acc_zeosie[*itz];
+            eostab.eval(r, e, ir, ie, p, pre, per);
+            acc_zeosir[*itz] = ir;
+            acc_zeosie[*itz] = ie;
+        } else
+            eosgam.eval(r, e, p, pre, per);
         const double csqd = max(ssmin2, pre + per * p / (r * r));
         const double ss = sqrt(csqd);
 
         // now advance pressure to the half-step
+#ifdef CACHE_INVARIANTS
+        const double minv = acc_zminv[*itz];
+#else
         const double minv = 1. / acc_zm[*itz];
+#endif
         const double volp = acc_zvolp[*itz];
         const double vol0 = acc_zvol0[*itz];
         const double wrate = acc_zwrate[*itz];
@@ -114,9 +340,9 @@ void PolyGas::calcStateHalfOMPTask(
         const std::vector<PhysicalRegion> &regions,
         Context ctx,
         Runtime *runtime) {
-    const double* args = (const double*) task->args;
-    const double gamma = args[0];
-    const double ssmin = args[1];
+    const StateHalfArgs* args = (const StateHalfArgs*) task->args;
+    const double gamma = args->gamma;
+    const double ssmin = args->ssmin;
     const double dt    = task->futures[0].get_result<double>();
 
     const AccessorRO<double> acc_zr(regions[0], FID_ZR);
@@ -124,13 +350,29 @@ void PolyGas::calcStateHalfOMPTask(
     const AccessorRO<double> acc_zvol0(regions[0], FID_ZVOL0);
     const AccessorRO<double> acc_ze(regions[0], FID_ZE);
     const AccessorRO<double> acc_zwrate(regions[0], FID_ZWRATE);
+#ifdef CACHE_INVARIANTS
+    const AccessorRO<double> acc_zminv(regions[2], FID_ZMINV);
+#else
     const AccessorRO<double> acc_zm(regions[0], FID_ZM);
+#endif
     const AccessorWD<double> acc_zp(regions[1], FID_ZP);
     const AccessorWD<double> acc_zss(regions[1], FID_ZSS);
+    // with a table the last two regions are it and the zone intervals
+    const bool usetable = (args->eostype == EOS_TABLE);
+    TableEOS eostab;
+    AccessorRW<int> acc_zeosir, acc_zeosie;
+    if (usetable) {
+        const int nreg = regions.size();
+        const AccessorRO<double> acc_tab(regions[nreg - 2], FID_EOSTAB);
+        eostab = TableEOS(acc_tab.ptr(Pointer(0)), args->nr, args->ne);
+        acc_zeosir = AccessorRW<int>(regions[nreg - 1], FID_ZEOSIR);
+        acc_zeosie = AccessorRW<int>(regions[nreg - 1], FID_ZEOSIE);
+    }
 
     const double dth = 0.5 * dt;
     const double gm1 = gamma - 1.;
     const double ssmin2 = max(ssmin * ssmin, 1.e-99);
+    const GammaEOS eosgam = { gm1 };
     const IndexSpace& isz = task->regions[0].region.get_index_space();
     // This will assert if it is not dense
     const Rect<1> rectz = runtime->get_index_space_domain(isz);
@@ -140,14 +382,24 @@ void PolyGas::calcStateHalfOMPTask(
         // compute EOS at beginning of time step
         const double r = acc_zr[z];
         const double e = max(acc_ze[z], 0.);
-        const double p = gm1 * r * e;
-        const double pre = gm1 * e;
-        const double per = gm1 * r;
+        double p, pre, per;
+        if (usetable) {
+            int ir = acc_zeosir[z];
+            int ie = acc_zeosie[z];
+            eostab.eval(r, e, ir, ie, p, pre, per);
+            acc_zeosir[z] = ir;
+            acc_zeosie[z] = ie;
+        } else
+            eosgam.eval(r, e, p, pre, per);
         const double csqd = max(ssmin2, pre + per * p / (r * r));
         const double ss = sqrt(csqd);
 
         // now advance pressure to the half-step
+#ifdef CACHE_INVARIANTS
+        const double minv = acc_zminv[z];
+#else
         const double minv = 1. / acc_zm[z];
+#endif
         const double volp = acc_zvolp[z];
         const double vol0 = acc_zvol0[z];
         const double wrate = acc_zwrate[z];
@@ -167,9 +419,13 @@ void PolyGas::calcForceTask(
         Context ctx,
         Runtime *runtime) {
     const AccessorRO<Pointer> acc_mapsz(regions[0], FID_MAPSZ);
+#ifdef RECOMPUTE_EDGE_GEOMETRY
+    const SideGeometry geom(regions, 0, 1, 3);
+#else
     const AccessorRO<double2> acc_ssurf(regions[0], FID_SSURFP);
+#endif
     const AccessorRO<double> acc_zp(regions[1], FID_ZP);
-    const AccessorWD<double2> acc_sf(regions[2], FID_SFP);
+    const AccessorWD<TempReal2> acc_sf(regions[2], FID_SFP);
 
     const IndexSpace& iss = task->regions[0].region.get_index_space();
 
@@ -177,7 +433,11 @@ void PolyGas::calcForceTask(
     {
         const Pointer z = acc_mapsz[*its];
         const double p = acc_zp[z];
+#ifdef RECOMPUTE_EDGE_GEOMETRY
+        const double2 surf = geom.ssurf(*its, z);
+#else
         const double2 surf = acc_ssurf[*its];
+#endif
         const double2 sfx = -p * surf;
         acc_sf[*its] = sfx;
     }
@@ -190,9 +450,13 @@ void PolyGas::calcForceOMPTask(
         Context ctx,
         Runtime *runtime) {
     const AccessorRO<Pointer> acc_mapsz(regions[0], FID_MAPSZ);
+#ifdef RECOMPUTE_EDGE_GEOMETRY
+    const SideGeometry geom(regions, 0, 1, 3);
+#else
     const AccessorRO<double2> acc_ssurf(regions[0], FID_SSURFP);
+#endif
     const AccessorRO<double> acc_zp(regions[1], FID_ZP);
-    const AccessorWD<double2> acc_sf(regions[2], FID_SFP);
+    const AccessorWD<TempReal2> acc_sf(regions[2], FID_SFP);
 
     const IndexSpace& iss = task->regions[0].region.get_index_space();
     // This will assert if it is not dense
@@ -202,7 +466,11 @@ void PolyGas::calcForceOMPTask(
     {
         const Pointer z = acc_mapsz[s];
         const double p = acc_zp[z];
+#ifdef RECOMPUTE_EDGE_GEOMETRY
+        const double2 surf = geom.ssurf(s, z);
+#else
         const double2 surf = acc_ssurf[s];
+#endif
         const double2 sfx = -p * surf;
         acc_sf[s] = sfx;
     }
@@ -31,10 +31,19 @@ gpu_state_half(const AccessorRO<double> acc_zr,
                const AccessorRO<double> acc_zvol0,
                const AccessorRO<double> acc_ze,
                const AccessorRO<double> acc_zwrate,
+#ifdef CACHE_INVARIANTS
+               const AccessorRO<double> acc_zminv,
+#else
                const AccessorRO<double> acc_zm,
+#endif
                const AccessorWD<double> acc_zp,
                const AccessorWD<double> acc_zss,
-               const double dth, const double gm1, const double ssmin2,
+               const bool usetable,
+               const GammaEOS eosgam,
+               const TableEOS eostab,
+               const AccessorRW<int> acc_zeosir,
+               const AccessorRW<int> acc_zeosie,
+               const double dth, const double ssmin2,
                const Point<1> origin, const size_t max)
 {
   const size_t offset = blockIdx.x * blockDim.x + threadIdx.x;
@@ -45,15 +54,25 @@ gpu_state_half(const AccessorRO<double> acc_zr,
   const double r = acc_zr[z];
   const double ze = acc_ze[z];
   const double e = (ze > 0.) ? ze : 0.;
-  const double p = gm1 * r * e;
-  const double pre = gm1 * e;
-  const double per = gm1 * r;
+  double p, pre, per;
+  if (usetable) {
+    int ir = acc_zeosir[z];
+    int ie = acc_zeosie[z];
+    eostab.eval(r, e, ir, ie, p, pre, per);
+    acc_zeosir[z] = ir;
+    acc_zeosie[z] = ie;
+  } else
+    eosgam.eval(r, e, p, pre, per);
   const double mt = pre + per * p / (r * r);
   const double csqd = (ssmin2 > mt) ? ssmin2 : mt;
   const double ss = sqrt(csqd);
 
   // now advance pressure to the half-step
+#ifdef CACHE_INVARIANTS
+  const double minv = acc_zminv[z];
+#else
   const double minv = 1. / acc_zm[z];
+#endif
   const double volp = acc_zvolp[z];
   const double vol0 = acc_zvol0[z];
   const double wrate = acc_zwrate[z];
@@ -71,9 +90,9 @@ void PolyGas::calcStateHalfGPUTask(
         const std::vector<PhysicalRegion> &regions,
         Context ctx,
         Runtime *runtime) {
-    const double* args = (const double*) task->args;
-    const double gamma = args[0];
-    const double ssmin = args[1];
+    const StateHalfArgs* args = (const StateHalfArgs*) task->args;
+    const double gamma = args->gamma;
+    const double ssmin = args->ssmin;
     const double dt    = task->futures[0].get_result<double>();
 
     const AccessorRO<double> acc_zr(regions[0], FID_ZR);
@@ -81,13 +100,29 @@ void PolyGas::calcStateHalfGPUTask(
     const AccessorRO<double> acc_zvol0(regions[0], FID_ZVOL0);
     const AccessorRO<double> acc_ze(regions[0], FID_ZE);
     const AccessorRO<double> acc_zwrate(regions[0], FID_ZWRATE);
+#ifdef CACHE_INVARIANTS
+    const AccessorRO<double> acc_zminv(regions[2], FID_ZMINV);
+#else
     const AccessorRO<double> acc_zm(regions[0], FID_ZM);
+#endif
     const AccessorWD<double> acc_zp(regions[1], FID_ZP);
     const AccessorWD<double> acc_zss(regions[1], FID_ZSS);
+    // with a table the last two regions are it and the zone intervals
+    const bool usetable = (args->eostype == EOS_TABLE);
+    TableEOS eostab;
+    AccessorRW<int> acc_zeosir, acc_zeosie;
+    if (usetable) {
+        const int nreg = regions.size();
+        const AccessorRO<double> acc_tab(regions[nreg - 2], FID_EOSTAB);
+        eostab = TableEOS(acc_tab.ptr(Pointer(0)), args->nr, args->ne);
+        acc_zeosir = AccessorRW<int>(regions[nreg - 1], FID_ZEOSIR);
+        acc_zeosie = AccessorRW<int>(regions[nreg - 1], FID_ZEOSIE);
+    }
 
     const double dth = 0.5 * dt;
     const double gm1 = gamma - 1.;
     const double ssmin2 = max(ssmin * ssmin, 1.e-99);
+    const GammaEOS eosgam = { gm1 };
     const IndexSpace& isz = task->regions[0].region.get_index_space();
     // This will assert if it is not dense
     const Rect<1> rectz = runtime->get_index_space_domain(isz);
@@ -95,17 +130,27 @@ void PolyGas::calcStateHalfGPUTask(
     if (volume == 0)
       return;
     const size_t blocks = (volume + THREADS_PER_BLOCK - 1) / THREADS_PER_BLOCK;
+#ifdef CACHE_INVARIANTS
+    gpu_state_half<<<blocks,THREADS_PER_BLOCK>>>(acc_zr, acc_zvolp, acc_zvol0,
+        acc_ze, acc_zwrate, acc_zminv, acc_zp, acc_zss, usetable, eosgam,
+        eostab, acc_zeosir, acc_zeosie, dth, ssmin2, rectz.lo, volume);
+#else
     gpu_state_half<<<blocks,THREADS_PER_BLOCK>>>(acc_zr, acc_zvolp, acc_zvol0,
-        acc_ze, acc_zwrate, acc_zm, acc_zp, acc_zss, dth, gm1, ssmin2,
-        rectz.lo, volume);
+        acc_ze, acc_zwrate, acc_zm, acc_zp, acc_zss, usetable, eosgam,
+        eostab, acc_zeosir, acc_zeosie, dth, ssmin2, rectz.lo, volume);
+#endif
 }
 
 __global__ void
 __launch_bounds__(THREADS_PER_BLOCK,MIN_CTAS_PER_SM)
 gpu_calc_force_pgas(const AccessorRO<Pointer> acc_mapsz,
+#ifdef RECOMPUTE_EDGE_GEOMETRY
+                    const SideGeometry geom,
+#else
                     const AccessorRO<double2> acc_ssurf,
+#endif
                     const AccessorRO<double> acc_zp,
-                    const AccessorWD<double2> acc_sf,
+                    const AccessorWD<TempReal2> acc_sf,
                     const Point<1> origin, const size_t max)
 {
   const size_t offset = blockIdx.x * blockDim.x + threadIdx.x;
@@ -114,7 +159,11 @@ gpu_calc_force_pgas(const AccessorRO<Pointer> acc_mapsz,
   const coord_t s = origin[0] + offset;
   const Pointer z = acc_mapsz[s];
   const double p = acc_zp[z];
+#ifdef RECOMPUTE_EDGE_GEOMETRY
+  const double2 surf = geom.ssurf(s, z);
+#else
   const double2 surf = acc_ssurf[s];
+#endif
   const double2 sfx = -p * surf;
   acc_sf[s] = sfx;
 }
@@ -126,9 +175,13 @@ void PolyGas::calcForceGPUTask(
         Context ctx,
         Runtime *runtime) {
     const AccessorRO<Pointer> acc_mapsz(regions[0], FID_MAPSZ);
+#ifdef RECOMPUTE_EDGE_GEOMETRY
+    const SideGeometry geom(regions, 0, 1, 3);
+#else
     const AccessorRO<double2> acc_ssurf(regions[0], FID_SSURFP);
+#endif
     const AccessorRO<double> acc_zp(regions[1], FID_ZP);
-    const AccessorWD<double2> acc_sf(regions[2], FID_SFP);
+    const AccessorWD<TempReal2> acc_sf(regions[2], FID_SFP);
 
     const IndexSpace& iss = task->regions[0].region.get_index_space();
     // This will assert if it is not dense
@@ -137,7 +190,12 @@ void PolyGas::calcForceGPUTask(
     if (volume == 0)
       return;
     const size_t blocks = (volume + THREADS_PER_BLOCK - 1) / THREADS_PER_BLOCK;
+#ifdef RECOMPUTE_EDGE_GEOMETRY
+    gpu_calc_force_pgas<<<blocks,THREADS_PER_BLOCK>>>(acc_mapsz, geom,
+        acc_zp, acc_sf, rects.lo, volume);
+#else
     gpu_calc_force_pgas<<<blocks,THREADS_PER_BLOCK>>>(acc_mapsz, acc_ssurf,
         acc_zp, acc_sf, rects.lo, volume);
+#endif
 }
 
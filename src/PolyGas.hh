@@ -13,31 +13,73 @@
 #ifndef POLYGAS_HH_
 #define POLYGAS_HH_
 
+#include <string>
+#include <vector>
+
 #include "legion.h"
 
+#include "EOS.hh"
+
 // forward declarations
 class InputFile;
 class Hydro;
 
 
+enum PolyGasFieldID {
+    FID_EOSTAB = 'P' * 100,        // the EOS table, see TableEOS
+    FID_ZEOSIR,                    // zone's density interval in the table
+    FID_ZEOSIE                     // zone's energy interval in the table
+};
+
 enum PolyGasTaskID {
     TID_CALCSTATEHALF = 'P' * 100,
-    TID_CALCFORCEPGAS
+    TID_CALCFORCEPGAS,
+    TID_INITEOSTABLE
 };
 
 
 class PolyGas {
+public:
+    struct StateHalfArgs {
+    public:
+      StateHalfArgs(double g, double s, int t, int r, int e)
+        : gamma(g), ssmin(s), eostype(t), nr(r), ne(e) { }
+    public:
+      double gamma, ssmin;
+      int eostype;
+      int nr, ne;                  // table size, if eostype is EOS_TABLE
+    };
 public:
 
     // parent hydro object
     Hydro* hydro;
 
+    EOSType eostype;               // which equation of state to use
     double gamma;                  // coeff. for ideal gas equation
     double ssmin;                  // minimum sound speed for gas
+    std::string eostable;          // file to read the EOS table from
+    int eosnr, eosne;              // number of densities, energies in it
+
+    // With EOS_TABLE, the table itself (one copy that every piece
+    // reads) and the table intervals each zone was in last cycle
+    Legion::LogicalRegion lreos;
+    Legion::LogicalRegion lrzeos;
 
     PolyGas(const InputFile* inp, Hydro* h);
     ~PolyGas();
 
+    StateHalfArgs stateHalfArgs() const;
+
+    // the zone piece partition of lrzeos, which follows the mesh's
+    // through a rebalance
+    Legion::LogicalPartition getZonePieces() const;
+
+    static void readTable(
+            const std::string& filename,
+            int& nr,
+            int& ne,
+            std::vector<double>& tab);
+
     static void calcStateHalfTask(
             const Legion::Task *task,
             const std::vector<Legion::PhysicalRegion> &regions,
@@ -58,6 +100,12 @@ public:
             Legion::Context ctx,
             Legion::Runtime *runtime);
 
+    static void initEOSTableTask(
+            const Legion::Task *task,
+            const std::vector<Legion::PhysicalRegion> &regions,
+            Legion::Context ctx,
+            Legion::Runtime *runtime);
+
     static void calcForceTask(
             const Legion::Task *task,
             const std::vector<Legion::PhysicalRegion> &regions,
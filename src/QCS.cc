@@ -13,6 +13,8 @@
 #include "QCS.hh"
 
 #include <cmath>
+#include <cstdlib>
+#include <iostream>
 
 #include "legion.h"
 
@@ -52,6 +54,12 @@ static void __attribute__ ((constructor)) registerTasks() {
       registrar.set_leaf();
       Runtime::preregister_task_variant<QCS::setVelDiffTask>(registrar, "setveldiff");
     }
+    {
+      TaskVariantRegistrar registrar(TID_CALCFORCEQCS, "CPU calcforceqcs");
+      registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+      registrar.set_leaf();
+      Runtime::preregister_task_variant<QCS::calcForceTask>(registrar, "calcforceqcs");
+    }
     {
       TaskVariantRegistrar registrar(TID_SETCORNERDIV, "OMP setcornerdiv");
       registrar.add_constraint(ProcessorConstraint(Processor::OMP_PROC));
@@ -76,6 +84,12 @@ static void __attribute__ ((constructor)) registerTasks() {
       registrar.set_leaf();
       Runtime::preregister_task_variant<QCS::setVelDiffOMPTask>(registrar, "setveldiff");
     }
+    {
+      TaskVariantRegistrar registrar(TID_CALCFORCEQCS, "OMP calcforceqcs");
+      registrar.add_constraint(ProcessorConstraint(Processor::OMP_PROC));
+      registrar.set_leaf();
+      Runtime::preregister_task_variant<QCS::calcForceOMPTask>(registrar, "calcforceqcs");
+    }
 }
 }; // namespace
 
@@ -85,11 +99,21 @@ QCS::QCS(const InputFile* inp, Hydro* h) : hydro(h) {
     q1 = inp->getDouble("q1", 0.);
     q2 = inp->getDouble("q2", 2.);
 
+#ifdef FUSED_QCS
+    // calcZoneForce keeps the corners of a zone in fixed-size arrays
+    const int maxsides = hydro->mesh->gmesh->calcMaxZoneSides();
+    if (maxsides > MAXZONESIDES) {
+        cerr << "Error:  " << hydro->mesh->gmesh->meshtype
+             << " zones have up to " << maxsides
+             << " sides, FUSED_QCS handles at most " << MAXZONESIDES << endl;
+        exit(1);
+    }
+#endif
+
     // FieldSpace fsz = hydro->mesh->lrz.get_field_space();
     // FieldAllocator faz = hydro->runtime->create_field_allocator(
     //         hydro->ctx, fsz);
     // faz.allocate_field(sizeof(double2), FID_ZUC);
-    // faz.allocate_field(sizeof(double), FID_ZTMP);
 
     // FieldSpace fss = hydro->mesh->lrs.get_field_space();
     // FieldAllocator fas = hydro->runtime->create_field_allocator(
@@ -137,11 +161,14 @@ void QCS::setCornerDivTask(
         AccessorRO<double2>(regions[3], FID_PXP)
     };
     const AccessorWD<double2> acc_zuc(regions[4], FID_ZUC);
-    const AccessorWD<double> acc_carea(regions[5], FID_CAREA);
-    const AccessorWD<double> acc_ccos(regions[5], FID_CCOS);
-    const AccessorWD<double> acc_cdiv(regions[5], FID_CDIV);
-    const AccessorWD<double> acc_cevol(regions[5], FID_CEVOL);
-    const AccessorWD<double> acc_cdu(regions[5], FID_CDU);
+    const AccessorWD<TempReal> acc_carea(regions[5], FID_CAREA);
+    const AccessorWD<TempReal> acc_ccos(regions[5], FID_CCOS);
+    const AccessorWD<TempReal> acc_cdiv(regions[5], FID_CDIV);
+    const AccessorWD<TempReal> acc_cevol(regions[5], FID_CEVOL);
+    const AccessorWD<TempReal> acc_cdu(regions[5], FID_CDU);
+#ifdef CACHE_INVARIANTS
+    const AccessorRO<double> acc_znumpinv(regions[6], FID_ZNUMPINV);
+#endif
 
     // [1] Compute a zone-centered velocity
     const IndexSpace& isz = task->regions[1].region.get_index_space();
@@ -157,8 +184,12 @@ void QCS::setCornerDivTask(
         const Pointer z = acc_mapsz[s];
         const double2 pu = acc_pu[preg][p];
         const double2 zuc = acc_zuc[z];
+#ifdef CACHE_INVARIANTS
+        acc_zuc[z] = zuc + pu * acc_znumpinv[z];
+#else
         const int n = acc_znump[z];
         acc_zuc[z] = zuc + pu / n;
+#endif
     }
 
     // [2] Divergence at the corner
@@ -260,9 +291,9 @@ void QCS::setQCnForceTask(
     const AccessorRO<int> acc_mapsp1reg(regions[0], FID_MAPSP1REG);
     const AccessorRO<int> acc_mapsp2reg(regions[0], FID_MAPSP2REG);
     const AccessorRO<double> acc_elen(regions[0], FID_ELEN);
-    const AccessorRO<double> acc_cdiv(regions[0], FID_CDIV);
-    const AccessorRO<double> acc_cdu(regions[0], FID_CDU);
-    const AccessorRO<double> acc_cevol(regions[0], FID_CEVOL);
+    const AccessorRO<TempReal> acc_cdiv(regions[0], FID_CDIV);
+    const AccessorRO<TempReal> acc_cdu(regions[0], FID_CDU);
+    const AccessorRO<TempReal> acc_cevol(regions[0], FID_CEVOL);
     const AccessorRO<double> acc_zrp(regions[1], FID_ZRP);
     const AccessorRO<double> acc_zss(regions[1], FID_ZSS);
     const AccessorRO<double2> acc_pu[2] = {
@@ -270,8 +301,8 @@ void QCS::setQCnForceTask(
         AccessorRO<double2>(regions[3], FID_PU0)
     };
     const AccessorWD<double> acc_crmu(regions[4], FID_CRMU);
-    const AccessorWD<double2> acc_cqe1(regions[4], FID_CQE1);
-    const AccessorWD<double2> acc_cqe2(regions[4], FID_CQE2);
+    const AccessorWD<TempReal2> acc_cqe1(regions[4], FID_CQE1);
+    const AccessorWD<TempReal2> acc_cqe2(regions[4], FID_CQE2);
 
     const double gammap1 = qgamma + 1.0;
 
@@ -334,13 +365,13 @@ void QCS::setForceTask(
         Context ctx,
         Runtime *runtime) {
     const AccessorRO<Pointer> acc_mapss4(regions[0], FID_MAPSS4);
-    const AccessorRO<double> acc_carea(regions[0], FID_CAREA);
-    const AccessorRO<double2> acc_cqe1(regions[0], FID_CQE1);
-    const AccessorRO<double2> acc_cqe2(regions[0], FID_CQE2);
+    const AccessorRO<TempReal> acc_carea(regions[0], FID_CAREA);
+    const AccessorRO<TempReal2> acc_cqe1(regions[0], FID_CQE1);
+    const AccessorRO<TempReal2> acc_cqe2(regions[0], FID_CQE2);
     const AccessorRO<double> acc_elen(regions[0], FID_ELEN);
-    const AccessorRW<double> acc_ccos(regions[1], FID_CCOS);
+    const AccessorRW<TempReal> acc_ccos(regions[1], FID_CCOS);
     const AccessorWD<double> acc_cw(regions[2], FID_CW);
-    const AccessorWD<double2> acc_sfq(regions[2], FID_SFQ);
+    const AccessorWD<TempReal2> acc_sfq(regions[2], FID_SFQ);
 
     // [5.1] Preparation of extra variables
     const IndexSpace& iss = task->regions[0].region.get_index_space();
@@ -390,13 +421,14 @@ void QCS::setVelDiffTask(
     const double q1 = args[0];
     const double q2 = args[1];
 
-    const AccessorRO<Pointer> acc_mapsz(regions[0], FID_MAPSZ);
     const AccessorRO<Pointer> acc_mapsp1(regions[0], FID_MAPSP1);
     const AccessorRO<Pointer> acc_mapsp2(regions[0], FID_MAPSP2);
     const AccessorRO<int> acc_mapsp1reg(regions[0], FID_MAPSP1REG);
     const AccessorRO<int> acc_mapsp2reg(regions[0], FID_MAPSP2REG);
     const AccessorRO<double> acc_elen(regions[0], FID_ELEN);
     const AccessorRO<double> acc_zss(regions[1], FID_ZSS);
+    const AccessorRO<int> acc_znump(regions[1], FID_ZNUMP);
+    const AccessorRO<Pointer> acc_mapzs1(regions[1], FID_MAPZS1);
     const AccessorRO<double2> acc_pu[2] = {
         AccessorRO<double2>(regions[2], FID_PU0),
         AccessorRO<double2>(regions[3], FID_PU0)
@@ -405,48 +437,97 @@ void QCS::setVelDiffTask(
         AccessorRO<double2>(regions[2], FID_PXP),
         AccessorRO<double2>(regions[3], FID_PXP)
     };
-    const AccessorWD<double> acc_ztmp(regions[4], FID_ZTMP);
     const AccessorWD<double> acc_zdu(regions[4], FID_ZDU);
 
+    // Take the max over each zone's own sides, which follow its first
     const IndexSpace& isz = task->regions[4].region.get_index_space();
-    for (PointIterator itz(runtime, isz); itz(); itz++)
-        acc_ztmp[*itz] = 0.;
-
-    const IndexSpace& iss = task->regions[0].region.get_index_space();
-    for (PointIterator its(runtime, iss); its(); its++)
-    {
-        const Pointer s = *its;
-        const Pointer p1 = acc_mapsp1[s];
-        const int p1reg = acc_mapsp1reg[s];
-        const Pointer p2 = acc_mapsp2[s];
-        const int p2reg = acc_mapsp2reg[s];
-        const Pointer z = acc_mapsz[s];
-
-        const double2 px1 = acc_px[p1reg][p1];
-        const double2 px2 = acc_px[p2reg][p2];
-        const double2 pu1 = acc_pu[p1reg][p1];
-        const double2 pu2 = acc_pu[p2reg][p2];
-        const double2 dx  = px2 - px1;
-        const double2 du  = pu2 - pu1;
-        const double lenx = acc_elen[s];
-        double dux = dot(du, dx);
-        dux = (lenx > 0. ? abs(dux) / lenx : 0.);
-
-        double ztmp  = acc_ztmp[z];
-        ztmp = max(ztmp, dux);
-        acc_ztmp[z] = ztmp;
-    }
-
     for (PointIterator itz(runtime, isz); itz(); itz++)
     {
         const Pointer z = *itz;
+        const int n = acc_znump[z];
+        const coord_t sfirst = acc_mapzs1[z][0];
+        double ztmp = 0.;
+        for (coord_t s = sfirst; s < sfirst + n; s++)
+        {
+            const Pointer p1 = acc_mapsp1[s];
+            const int p1reg = acc_mapsp1reg[s];
+            const Pointer p2 = acc_mapsp2[s];
+            const int p2reg = acc_mapsp2reg[s];
+
+            const double2 px1 = acc_px[p1reg][p1];
+            const double2 px2 = acc_px[p2reg][p2];
+            const double2 pu1 = acc_pu[p1reg][p1];
+            const double2 pu2 = acc_pu[p2reg][p2];
+            const double2 dx  = px2 - px1;
+            const double2 du  = pu2 - pu1;
+            const double lenx = acc_elen[s];
+            double dux = dot(du, dx);
+            dux = (lenx > 0. ? abs(dux) / lenx : 0.);
+
+            ztmp = max(ztmp, dux);
+        }
+
         const double zss  = acc_zss[z];
-        const double ztmp  = acc_ztmp[z];
         const double zdu = q1 * zss + 2. * q2 * ztmp;
         acc_zdu[z] = zdu;
     }
 }
 
+// Routines [2], [4], [5] and [6] together, one zone at a time
+void QCS::calcForceTask(
+        const Task *task,
+        const std::vector<PhysicalRegion> &regions,
+        Context ctx,
+        Runtime *runtime) {
+    const double* args = (const double*) task->args;
+    const double qgamma = args[0];
+    const double q1     = args[1];
+    const double q2     = args[2];
+
+    const AccessorRO<Pointer> acc_mapsp1(regions[0], FID_MAPSP1);
+    const AccessorRO<Pointer> acc_mapss3(regions[0], FID_MAPSS3);
+    const AccessorRO<Pointer> acc_mapss4(regions[0], FID_MAPSS4);
+    const AccessorRO<int> acc_mapsp1reg(regions[0], FID_MAPSP1REG);
+#ifndef RECOMPUTE_EDGE_GEOMETRY
+    const AccessorRO<double2> acc_ex(regions[0], FID_EXP);
+    const AccessorRO<double> acc_elen(regions[0], FID_ELEN);
+#endif
+    const AccessorRO<int> acc_znump(regions[1], FID_ZNUMP);
+    const AccessorRO<Pointer> acc_mapzs1(regions[1], FID_MAPZS1);
+    const AccessorRO<double2> acc_zx(regions[1], FID_ZXP);
+    const AccessorRO<double> acc_zrp(regions[1], FID_ZRP);
+    const AccessorRO<double> acc_zss(regions[1], FID_ZSS);
+    const AccessorRO<double2> acc_pu[2] = {
+        AccessorRO<double2>(regions[2], FID_PU0),
+        AccessorRO<double2>(regions[3], FID_PU0)
+    };
+    const AccessorRO<double2> acc_px[2] = {
+        AccessorRO<double2>(regions[2], FID_PXP),
+        AccessorRO<double2>(regions[3], FID_PXP)
+    };
+    const AccessorWD<TempReal2> acc_sfq(regions[4], FID_SFQ);
+    const AccessorWD<double> acc_zdu(regions[5], FID_ZDU);
+#ifdef CACHE_INVARIANTS
+    const AccessorRO<double> acc_znumpinv(regions[6], FID_ZNUMPINV);
+#endif
+
+    const IndexSpace& isz = task->regions[5].region.get_index_space();
+    // This will assert if it is not dense
+    const Rect<1> rectz = runtime->get_index_space_domain(isz);
+    for (coord_t z = rectz.lo[0]; z <= rectz.hi[0]; z++)
+        calcZoneForce(z, qgamma, q1, q2, acc_mapsp1, acc_mapss3, acc_mapss4,
+                acc_mapsp1reg,
+#ifndef RECOMPUTE_EDGE_GEOMETRY
+                acc_ex, acc_elen,
+#endif
+                acc_znump,
+#ifdef CACHE_INVARIANTS
+                acc_znumpinv,
+#endif
+                acc_mapzs1, acc_zx, acc_zrp, acc_zss,
+                acc_pu[0], acc_pu[1], acc_px[0], acc_px[1], acc_sfq, acc_zdu);
+}
+
 // Routine number [2]  in the full algorithm
 //     [2.1] Find the corner divergence
 //     [2.2] Compute the cos angle for c
@@ -466,6 +547,7 @@ void QCS::setCornerDivOMPTask(
     const AccessorRO<double2> acc_ex(regions[0], FID_EXP);
     const AccessorRO<double> acc_elen(regions[0], FID_ELEN);
     const AccessorRO<int> acc_znump(regions[1], FID_ZNUMP);
+    const AccessorRO<Pointer> acc_mapzs1(regions[1], FID_MAPZS1);
     const AccessorRO<double2> acc_zx(regions[1], FID_ZXP);
     const AccessorRO<double2> acc_pu[2] = {
         AccessorRO<double2>(regions[2], FID_PU0),
@@ -476,33 +558,43 @@ void QCS::setCornerDivOMPTask(
         AccessorRO<double2>(regions[3], FID_PXP)
     };
     const AccessorWD<double2> acc_zuc(regions[4], FID_ZUC);
-    const AccessorWD<double> acc_carea(regions[5], FID_CAREA);
-    const AccessorRW<double> acc_ccos(regions[5], FID_CCOS);
-    const AccessorWD<double> acc_cdiv(regions[5], FID_CDIV);
-    const AccessorWD<double> acc_cevol(regions[5], FID_CEVOL);
-    const AccessorWD<double> acc_cdu(regions[5], FID_CDU);
+    const AccessorWD<TempReal> acc_carea(regions[5], FID_CAREA);
+    const AccessorRW<TempReal> acc_ccos(regions[5], FID_CCOS);
+    const AccessorWD<TempReal> acc_cdiv(regions[5], FID_CDIV);
+    const AccessorWD<TempReal> acc_cevol(regions[5], FID_CEVOL);
+    const AccessorWD<TempReal> acc_cdu(regions[5], FID_CDU);
+#ifdef CACHE_INVARIANTS
+    const AccessorRO<double> acc_znumpinv(regions[6], FID_ZNUMPINV);
+#endif
 
     // [1] Compute a zone-centered velocity
+    // (a thread sums all the sides of its zones, so no atomics)
     const IndexSpace& isz = task->regions[1].region.get_index_space();
     // This will assert if it is not dense
     const Rect<1> rectz = runtime->get_index_space_domain(isz);
     #pragma omp parallel for
     for (coord_t z = rectz.lo[0]; z <= rectz.hi[0]; z++)
-        acc_zuc[z] = double2(0., 0.);
+    {
+        const int n = acc_znump[z];
+        const coord_t sfirst = acc_mapzs1[z][0];
+        double2 zuc(0., 0.);
+        for (coord_t s = sfirst; s < sfirst + n; s++)
+        {
+            const Pointer p = acc_mapsp1[s];
+            const int preg = acc_mapsp1reg[s];
+            const double2 pu = acc_pu[preg][p];
+#ifdef CACHE_INVARIANTS
+            zuc += pu * acc_znumpinv[z];
+#else
+            zuc += pu / n;
+#endif
+        }
+        acc_zuc[z] = zuc;
+    }
 
     const IndexSpace& iss = task->regions[0].region.get_index_space();
     // This will assert if it is not dense
     const Rect<1> rects = runtime->get_index_space_domain(iss);
-    #pragma omp parallel for
-    for (coord_t s = rects.lo[0]; s <= rects.hi[0]; s++)
-    {
-        const Pointer p = acc_mapsp1[s];
-        const int preg = acc_mapsp1reg[s];
-        const Pointer z = acc_mapsz[s];
-        const double2 pu = acc_pu[preg][p];
-        const int n = acc_znump[z];
-        SumOp<double2>::apply<false/*exclusive*/>(acc_zuc[z], pu / n);
-    }
 
     // [2] Divergence at the corner
     #pragma omp parallel for
@@ -603,9 +695,9 @@ void QCS::setQCnForceOMPTask(
     const AccessorRO<int> acc_mapsp1reg(regions[0], FID_MAPSP1REG);
     const AccessorRO<int> acc_mapsp2reg(regions[0], FID_MAPSP2REG);
     const AccessorRO<double> acc_elen(regions[0], FID_ELEN);
-    const AccessorRO<double> acc_cdiv(regions[0], FID_CDIV);
-    const AccessorRO<double> acc_cdu(regions[0], FID_CDU);
-    const AccessorRO<double> acc_cevol(regions[0], FID_CEVOL);
+    const AccessorRO<TempReal> acc_cdiv(regions[0], FID_CDIV);
+    const AccessorRO<TempReal> acc_cdu(regions[0], FID_CDU);
+    const AccessorRO<TempReal> acc_cevol(regions[0], FID_CEVOL);
     const AccessorRO<double> acc_zrp(regions[1], FID_ZRP);
     const AccessorRO<double> acc_zss(regions[1], FID_ZSS);
     const AccessorRO<double2> acc_pu[2] = {
@@ -613,8 +705,8 @@ void QCS::setQCnForceOMPTask(
         AccessorRO<double2>(regions[3], FID_PU0)
     };
     const AccessorWD<double> acc_crmu(regions[4], FID_CRMU);
-    const AccessorWD<double2> acc_cqe1(regions[4], FID_CQE1);
-    const AccessorWD<double2> acc_cqe2(regions[4], FID_CQE2);
+    const AccessorWD<TempReal2> acc_cqe1(regions[4], FID_CQE1);
+    const AccessorWD<TempReal2> acc_cqe2(regions[4], FID_CQE2);
 
     const double gammap1 = qgamma + 1.0;
 
@@ -679,13 +771,13 @@ void QCS::setForceOMPTask(
         Context ctx,
         Runtime *runtime) {
     const AccessorRO<Pointer> acc_mapss4(regions[0], FID_MAPSS4);
-    const AccessorRO<double> acc_carea(regions[0], FID_CAREA);
-    const AccessorRO<double2> acc_cqe1(regions[0], FID_CQE1);
-    const AccessorRO<double2> acc_cqe2(regions[0], FID_CQE2);
+    const AccessorRO<TempReal> acc_carea(regions[0], FID_CAREA);
+    const AccessorRO<TempReal2> acc_cqe1(regions[0], FID_CQE1);
+    const AccessorRO<TempReal2> acc_cqe2(regions[0], FID_CQE2);
     const AccessorRO<double> acc_elen(regions[0], FID_ELEN);
-    const AccessorWD<double> acc_ccos(regions[1], FID_CCOS);
+    const AccessorWD<TempReal> acc_ccos(regions[1], FID_CCOS);
     const AccessorWD<double> acc_cw(regions[2], FID_CW);
-    const AccessorWD<double2> acc_sfq(regions[2], FID_SFQ);
+    const AccessorWD<TempReal2> acc_sfq(regions[2], FID_SFQ);
 
     // [5.1] Preparation of extra variables
     const IndexSpace& iss = task->regions[0].region.get_index_space();
@@ -737,13 +829,14 @@ void QCS::setVelDiffOMPTask(
     const double q1 = args[0];
     const double q2 = args[1];
 
-    const AccessorRO<Pointer> acc_mapsz(regions[0], FID_MAPSZ);
     const AccessorRO<Pointer> acc_mapsp1(regions[0], FID_MAPSP1);
     const AccessorRO<Pointer> acc_mapsp2(regions[0], FID_MAPSP2);
     const AccessorRO<int> acc_mapsp1reg(regions[0], FID_MAPSP1REG);
     const AccessorRO<int> acc_mapsp2reg(regions[0], FID_MAPSP2REG);
     const AccessorRO<double> acc_elen(regions[0], FID_ELEN);
     const AccessorRO<double> acc_zss(regions[1], FID_ZSS);
+    const AccessorRO<int> acc_znump(regions[1], FID_ZNUMP);
+    const AccessorRO<Pointer> acc_mapzs1(regions[1], FID_MAPZS1);
     const AccessorRO<double2> acc_pu[2] = {
         AccessorRO<double2>(regions[2], FID_PU0),
         AccessorRO<double2>(regions[3], FID_PU0)
@@ -752,48 +845,98 @@ void QCS::setVelDiffOMPTask(
         AccessorRO<double2>(regions[2], FID_PXP),
         AccessorRO<double2>(regions[3], FID_PXP)
     };
-    const AccessorWD<double> acc_ztmp(regions[4], FID_ZTMP);
     const AccessorWD<double> acc_zdu(regions[4], FID_ZDU);
 
+    // Each thread finds the max over the sides of its own zones, so
+    // the max never has to go through a zone field with atomics
     const IndexSpace& isz = task->regions[4].region.get_index_space();
     // This will assert if it is not dense
     const Rect<1> rectz = runtime->get_index_space_domain(isz);
     #pragma omp parallel for
     for (coord_t z = rectz.lo[0]; z <= rectz.hi[0]; z++)
-        acc_ztmp[z] = 0.;
-
-    const IndexSpace& iss = task->regions[0].region.get_index_space();
-    // This will assert if it is not dense
-    const Rect<1> rects = runtime->get_index_space_domain(iss);
-    #pragma omp parallel for
-    for (coord_t s = rects.lo[0]; s <= rects.hi[0]; s++)
     {
-        const Pointer p1 = acc_mapsp1[s];
-        const int p1reg = acc_mapsp1reg[s];
-        const Pointer p2 = acc_mapsp2[s];
-        const int p2reg = acc_mapsp2reg[s];
-        const Pointer z = acc_mapsz[s];
-
-        const double2 px1 = acc_px[p1reg][p1];
-        const double2 px2 = acc_px[p2reg][p2];
-        const double2 pu1 = acc_pu[p1reg][p1];
-        const double2 pu2 = acc_pu[p2reg][p2];
-        const double2 dx  = px2 - px1;
-        const double2 du  = pu2 - pu1;
-        const double lenx = acc_elen[s];
-        double dux = dot(du, dx);
-        dux = (lenx > 0. ? abs(dux) / lenx : 0.);
-
-        MaxOp<double>::apply<false/*exclusive*/>(acc_ztmp[z], dux);
-    }
+        const int n = acc_znump[z];
+        const coord_t sfirst = acc_mapzs1[z][0];
+        double ztmp = 0.;
+        for (coord_t s = sfirst; s < sfirst + n; s++)
+        {
+            const Pointer p1 = acc_mapsp1[s];
+            const int p1reg = acc_mapsp1reg[s];
+            const Pointer p2 = acc_mapsp2[s];
+            const int p2reg = acc_mapsp2reg[s];
+
+            const double2 px1 = acc_px[p1reg][p1];
+            const double2 px2 = acc_px[p2reg][p2];
+            const double2 pu1 = acc_pu[p1reg][p1];
+            const double2 pu2 = acc_pu[p2reg][p2];
+            const double2 dx  = px2 - px1;
+            const double2 du  = pu2 - pu1;
+            const double lenx = acc_elen[s];
+            double dux = dot(du, dx);
+            dux = (lenx > 0. ? abs(dux) / lenx : 0.);
+
+            ztmp = max(ztmp, dux);
+        }
 
-    #pragma omp parallel for
-    for (coord_t z = rectz.lo[0]; z <= rectz.hi[0]; z++)
-    {
         const double zss  = acc_zss[z];
-        const double ztmp  = acc_ztmp[z];
         const double zdu = q1 * zss + 2. * q2 * ztmp;
         acc_zdu[z] = zdu;
     }
 }
 
+
+// Routines [2], [4], [5] and [6] together, one zone at a time
+void QCS::calcForceOMPTask(
+        const Task *task,
+        const std::vector<PhysicalRegion> &regions,
+        Context ctx,
+        Runtime *runtime) {
+    const double* args = (const double*) task->args;
+    const double qgamma = args[0];
+    const double q1     = args[1];
+    const double q2     = args[2];
+
+    const AccessorRO<Pointer> acc_mapsp1(regions[0], FID_MAPSP1);
+    const AccessorRO<Pointer> acc_mapss3(regions[0], FID_MAPSS3);
+    const AccessorRO<Pointer> acc_mapss4(regions[0], FID_MAPSS4);
+    const AccessorRO<int> acc_mapsp1reg(regions[0], FID_MAPSP1REG);
+#ifndef RECOMPUTE_EDGE_GEOMETRY
+    const AccessorRO<double2> acc_ex(regions[0], FID_EXP);
+    const AccessorRO<double> acc_elen(regions[0], FID_ELEN);
+#endif
+    const AccessorRO<int> acc_znump(regions[1], FID_ZNUMP);
+    const AccessorRO<Pointer> acc_mapzs1(regions[1], FID_MAPZS1);
+    const AccessorRO<double2> acc_zx(regions[1], FID_ZXP);
+    const AccessorRO<double> acc_zrp(regions[1], FID_ZRP);
+    const AccessorRO<double> acc_zss(regions[1], FID_ZSS);
+    const AccessorRO<double2> acc_pu[2] = {
+        AccessorRO<double2>(regions[2], FID_PU0),
+        AccessorRO<double2>(regions[3], FID_PU0)
+    };
+    const AccessorRO<double2> acc_px[2] = {
+        AccessorRO<double2>(regions[2], FID_PXP),
+        AccessorRO<double2>(regions[3], FID_PXP)
+    };
+    const AccessorWD<TempReal2> acc_sfq(regions[4], FID_SFQ);
+    const AccessorWD<double> acc_zdu(regions[5], FID_ZDU);
+#ifdef CACHE_INVARIANTS
+    const AccessorRO<double> acc_znumpinv(regions[6], FID_ZNUMPINV);
+#endif
+
+    const IndexSpace& isz = task->regions[5].region.get_index_space();
+    // This will assert if it is not dense
+    const Rect<1> rectz = runtime->get_index_space_domain(isz);
+    #pragma omp parallel for
+    for (coord_t z = rectz.lo[0]; z <= rectz.hi[0]; z++)
+        calcZoneForce(z, qgamma, q1, q2, acc_mapsp1, acc_mapss3, acc_mapss4,
+                acc_mapsp1reg,
+#ifndef RECOMPUTE_EDGE_GEOMETRY
+                acc_ex, acc_elen,
+#endif
+                acc_znump,
+#ifdef CACHE_INVARIANTS
+                acc_znumpinv,
+#endif
+                acc_mapzs1, acc_zx, acc_zrp, acc_zss,
+                acc_pu[0], acc_pu[1], acc_px[0], acc_px[1], acc_sfq, acc_zdu);
+}
@@ -36,6 +36,12 @@ static void __attribute__ ((constructor)) registerTasks() {
       registrar.set_leaf();
       Runtime::preregister_task_variant<QCS::setVelDiffGPUTask>(registrar, "setveldiff");
     }
+    {
+      TaskVariantRegistrar registrar(TID_CALCFORCEQCS, "GPU calcforceqcs");
+      registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+      registrar.set_leaf();
+      Runtime::preregister_task_variant<QCS::calcForceGPUTask>(registrar, "calcforceqcs");
+    }
 }
 }; // namespace
 
@@ -47,6 +53,9 @@ gpu_zone_centered_velocity(const AccessorRO<Pointer> acc_mapsp1,
                            const AccessorRO<double2> acc_pu0,
                            const AccessorRO<double2> acc_pu1,
                            const AccessorRO<int> acc_znump,
+#ifdef CACHE_INVARIANTS
+                           const AccessorRO<double> acc_znumpinv,
+#endif
                            const AccessorWD<double2> acc_zuc,
                            const Point<1> origin, const size_t max)
 {
@@ -58,8 +67,12 @@ gpu_zone_centered_velocity(const AccessorRO<Pointer> acc_mapsp1,
   const int preg = acc_mapsp1reg[s];
   const Pointer z = acc_mapsz[s];
   const double2 pu = (preg == 0) ? acc_pu0[p] : acc_pu1[p];
+#ifdef CACHE_INVARIANTS
+  SumOp<double2>::apply<false/*exclusive*/>(acc_zuc[z], pu * acc_znumpinv[z]);
+#else
   const int n = acc_znump[z];
   SumOp<double2>::apply<false/*exclusive*/>(acc_zuc[z], pu / n);
+#endif
 }
 
 __global__ void
@@ -79,11 +92,11 @@ gpu_corner_divergence(const AccessorRO<Pointer> acc_mapsz,
                       const AccessorRO<double2> acc_px0,
                       const AccessorRO<double2> acc_px1,
                       const AccessorWD<double2> acc_zuc,
-                      const AccessorWD<double> acc_carea,
-                      const AccessorWD<double> acc_ccos,
-                      const AccessorWD<double> acc_cdiv,
-                      const AccessorWD<double> acc_cevol,
-                      const AccessorWD<double> acc_cdu,
+                      const AccessorWD<TempReal> acc_carea,
+                      const AccessorWD<TempReal> acc_ccos,
+                      const AccessorWD<TempReal> acc_cdiv,
+                      const AccessorWD<TempReal> acc_cevol,
+                      const AccessorWD<TempReal> acc_cdu,
                       const Point<1> origin, const size_t max)
 {
   const size_t offset = blockIdx.x * blockDim.x + threadIdx.x;
@@ -195,11 +208,14 @@ void QCS::setCornerDivGPUTask(
         AccessorRO<double2>(regions[3], FID_PXP)
     };
     const AccessorWD<double2> acc_zuc(regions[4], FID_ZUC);
-    const AccessorWD<double> acc_carea(regions[5], FID_CAREA);
-    const AccessorWD<double> acc_ccos(regions[5], FID_CCOS);
-    const AccessorWD<double> acc_cdiv(regions[5], FID_CDIV);
-    const AccessorWD<double> acc_cevol(regions[5], FID_CEVOL);
-    const AccessorWD<double> acc_cdu(regions[5], FID_CDU);
+    const AccessorWD<TempReal> acc_carea(regions[5], FID_CAREA);
+    const AccessorWD<TempReal> acc_ccos(regions[5], FID_CCOS);
+    const AccessorWD<TempReal> acc_cdiv(regions[5], FID_CDIV);
+    const AccessorWD<TempReal> acc_cevol(regions[5], FID_CEVOL);
+    const AccessorWD<TempReal> acc_cdu(regions[5], FID_CDU);
+#ifdef CACHE_INVARIANTS
+    const AccessorRO<double> acc_znumpinv(regions[6], FID_ZNUMPINV);
+#endif
 
     // [1] Compute a zone-centered velocity
     const IndexSpace& isz = task->regions[1].region.get_index_space();
@@ -217,8 +233,11 @@ void QCS::setCornerDivGPUTask(
       return;
     const size_t blocks = (volume + THREADS_PER_BLOCK - 1) / THREADS_PER_BLOCK;
     gpu_zone_centered_velocity<<<blocks,THREADS_PER_BLOCK>>>(acc_mapsp1,
-        acc_mapsp1reg, acc_mapsz, acc_pu[0], acc_pu[1], acc_znump, acc_zuc,
-        rects.lo, volume);
+        acc_mapsp1reg, acc_mapsz, acc_pu[0], acc_pu[1], acc_znump,
+#ifdef CACHE_INVARIANTS
+        acc_znumpinv,
+#endif
+        acc_zuc, rects.lo, volume);
 
     // [2] Divergence at the corner
     gpu_corner_divergence<<<blocks,THREADS_PER_BLOCK>>>(acc_mapsz, acc_mapsp1,
@@ -230,11 +249,11 @@ void QCS::setCornerDivGPUTask(
 __global__ void
 __launch_bounds__(THREADS_PER_BLOCK,MIN_CTAS_PER_SM)
 gpu_compute_crmu(const AccessorRO<Pointer> acc_mapsz,
-                 const AccessorRO<double> acc_cdu,
+                 const AccessorRO<TempReal> acc_cdu,
                  const AccessorRO<double> acc_zss,
                  const AccessorRO<double> acc_zrp,
-                 const AccessorRO<double> acc_cevol,
-                 const AccessorRO<double> acc_cdiv,
+                 const AccessorRO<TempReal> acc_cevol,
+                 const AccessorRO<TempReal> acc_cdiv,
                  const AccessorWD<double> acc_crmu,
                  const double q1, const double q2, const double gammap1,
                  const Point<1> origin, const size_t max)
@@ -270,8 +289,8 @@ gpu_compute_cqe(const AccessorRO<Pointer> acc_mapsp1,
                 const AccessorRO<double2> acc_pu1,
                 const AccessorRO<double> acc_elen,
                 const AccessorWD<double> acc_crmu,
-                const AccessorWD<double2> acc_cqe1,
-                const AccessorWD<double2> acc_cqe2,
+                const AccessorWD<TempReal2> acc_cqe1,
+                const AccessorWD<TempReal2> acc_cqe2,
                 const Point<1> origin, const size_t max)
 {
   const size_t offset = blockIdx.x * blockDim.x + threadIdx.x;
@@ -322,9 +341,9 @@ void QCS::setQCnForceGPUTask(
     const AccessorRO<int> acc_mapsp1reg(regions[0], FID_MAPSP1REG);
     const AccessorRO<int> acc_mapsp2reg(regions[0], FID_MAPSP2REG);
     const AccessorRO<double> acc_elen(regions[0], FID_ELEN);
-    const AccessorRO<double> acc_cdiv(regions[0], FID_CDIV);
-    const AccessorRO<double> acc_cdu(regions[0], FID_CDU);
-    const AccessorRO<double> acc_cevol(regions[0], FID_CEVOL);
+    const AccessorRO<TempReal> acc_cdiv(regions[0], FID_CDIV);
+    const AccessorRO<TempReal> acc_cdu(regions[0], FID_CDU);
+    const AccessorRO<TempReal> acc_cevol(regions[0], FID_CEVOL);
     const AccessorRO<double> acc_zrp(regions[1], FID_ZRP);
     const AccessorRO<double> acc_zss(regions[1], FID_ZSS);
     const AccessorRO<double2> acc_pu[2] = {
@@ -332,8 +351,8 @@ void QCS::setQCnForceGPUTask(
         AccessorRO<double2>(regions[3], FID_PU0)
     };
     const AccessorWD<double> acc_crmu(regions[4], FID_CRMU);
-    const AccessorWD<double2> acc_cqe1(regions[4], FID_CQE1);
-    const AccessorWD<double2> acc_cqe2(regions[4], FID_CQE2);
+    const AccessorWD<TempReal2> acc_cqe1(regions[4], FID_CQE1);
+    const AccessorWD<TempReal2> acc_cqe2(regions[4], FID_CQE2);
 
     const double gammap1 = qgamma + 1.0;
 
@@ -356,8 +375,8 @@ void QCS::setQCnForceGPUTask(
 
 __global__ void
 __launch_bounds__(THREADS_PER_BLOCK,MIN_CTAS_PER_SM)
-gpu_set_force1(const AccessorRW<double> acc_ccos,
-               const AccessorRO<double> acc_carea,
+gpu_set_force1(const AccessorRW<TempReal> acc_ccos,
+               const AccessorRO<TempReal> acc_carea,
                const AccessorWD<double> acc_cw,
                const Point<1> origin, const size_t max)
 {
@@ -376,12 +395,12 @@ gpu_set_force1(const AccessorRW<double> acc_ccos,
 __global__ void
 __launch_bounds__(THREADS_PER_BLOCK,MIN_CTAS_PER_SM)
 gpu_set_force2(const AccessorRO<Pointer> acc_mapss4,
-               const AccessorRO<double2> acc_cqe1,
-               const AccessorRO<double2> acc_cqe2,
+               const AccessorRO<TempReal2> acc_cqe1,
+               const AccessorRO<TempReal2> acc_cqe2,
                const AccessorRO<double> acc_elen,
-               const AccessorRW<double> acc_ccos,
+               const AccessorRW<TempReal> acc_ccos,
                const AccessorWD<double> acc_cw,
-               const AccessorWD<double2> acc_sfq,
+               const AccessorWD<TempReal2> acc_sfq,
                const Point<1> origin, const size_t max)
 {
   const size_t offset = blockIdx.x * blockDim.x + threadIdx.x;
@@ -415,13 +434,13 @@ void QCS::setForceGPUTask(
         Context ctx,
         Runtime *runtime) {
     const AccessorRO<Pointer> acc_mapss4(regions[0], FID_MAPSS4);
-    const AccessorRO<double> acc_carea(regions[0], FID_CAREA);
-    const AccessorRO<double2> acc_cqe1(regions[0], FID_CQE1);
-    const AccessorRO<double2> acc_cqe2(regions[0], FID_CQE2);
+    const AccessorRO<TempReal> acc_carea(regions[0], FID_CAREA);
+    const AccessorRO<TempReal2> acc_cqe1(regions[0], FID_CQE1);
+    const AccessorRO<TempReal2> acc_cqe2(regions[0], FID_CQE2);
     const AccessorRO<double> acc_elen(regions[0], FID_ELEN);
-    const AccessorRW<double> acc_ccos(regions[1], FID_CCOS);
+    const AccessorRW<TempReal> acc_ccos(regions[1], FID_CCOS);
     const AccessorWD<double> acc_cw(regions[2], FID_CW);
-    const AccessorWD<double2> acc_sfq(regions[2], FID_SFQ);
+    const AccessorWD<TempReal2> acc_sfq(regions[2], FID_SFQ);
 
     // [5.1] Preparation of extra variables
     const IndexSpace& iss = task->regions[0].region.get_index_space();
@@ -441,56 +460,49 @@ void QCS::setForceGPUTask(
 
 __global__ void
 __launch_bounds__(THREADS_PER_BLOCK,MIN_CTAS_PER_SM)
-gpu_set_vel_diff1(const AccessorRO<Pointer> acc_mapsz,
-                  const AccessorRO<Pointer> acc_mapsp1,
-                  const AccessorRO<Pointer> acc_mapsp2,
-                  const AccessorRO<int> acc_mapsp1reg,
-                  const AccessorRO<int> acc_mapsp2reg,
-                  const AccessorRO<double> acc_elen,
-                  const AccessorRO<double2> acc_pu0,
-                  const AccessorRO<double2> acc_pu1,
-                  const AccessorRO<double2> acc_px0,
-                  const AccessorRO<double2> acc_px1,
-                  const AccessorWD<double> acc_ztmp,
-                  const Point<1> origin, const size_t max)
-{
-  const size_t offset = blockIdx.x * blockDim.x + threadIdx.x;
-  if (offset >= max)
-    return;
-  const coord_t s = origin[0] + offset;
-  const Pointer p1 = acc_mapsp1[s];
-  const int p1reg = acc_mapsp1reg[s];
-  const Pointer p2 = acc_mapsp2[s];
-  const int p2reg = acc_mapsp2reg[s];
-  const Pointer z = acc_mapsz[s];
-
-  const double2 px1 = (p1reg == 0) ? acc_px0[p1] : acc_px1[p1];
-  const double2 px2 = (p2reg == 0) ? acc_px0[p2] : acc_px1[p2];
-  const double2 pu1 = (p1reg == 0) ? acc_pu0[p1] : acc_pu1[p1];
-  const double2 pu2 = (p2reg == 0) ? acc_pu0[p2] : acc_pu1[p2];
-  const double2 dx  = px2 - px1;
-  const double2 du  = pu2 - pu1;
-  const double lenx = acc_elen[s];
-  double dux = dot(du, dx);
-  dux = (lenx > 0. ? abs(dux) / lenx : 0.);
-
-  MaxOp<double>::apply<false/*exclusive*/>(acc_ztmp[z], dux);
-}
-
-__global__ void
-__launch_bounds__(THREADS_PER_BLOCK,MIN_CTAS_PER_SM)
-gpu_set_vel_diff2(const AccessorRO<double> acc_zss,
-                  const AccessorWD<double> acc_ztmp,
-                  const AccessorWD<double> acc_zdu,
-                  const double q1, const double q2,
-                  const Point<1> origin, const size_t max)
+gpu_set_vel_diff(const AccessorRO<Pointer> acc_mapsp1,
+                 const AccessorRO<Pointer> acc_mapsp2,
+                 const AccessorRO<int> acc_mapsp1reg,
+                 const AccessorRO<int> acc_mapsp2reg,
+                 const AccessorRO<double> acc_elen,
+                 const AccessorRO<double> acc_zss,
+                 const AccessorRO<int> acc_znump,
+                 const AccessorRO<Pointer> acc_mapzs1,
+                 const AccessorRO<double2> acc_pu0,
+                 const AccessorRO<double2> acc_pu1,
+                 const AccessorRO<double2> acc_px0,
+                 const AccessorRO<double2> acc_px1,
+                 const AccessorWD<double> acc_zdu,
+                 const double q1, const double q2,
+                 const Point<1> origin, const size_t max)
 {
   const size_t offset = blockIdx.x * blockDim.x + threadIdx.x;
   if (offset >= max)
     return;
   const coord_t z = origin[0] + offset;
+  // Each thread takes the max over the sides of its own zone
+  const int n = acc_znump[z];
+  const coord_t sfirst = acc_mapzs1[z][0];
+  double ztmp = 0.;
+  for (coord_t s = sfirst; s < sfirst + n; s++) {
+    const Pointer p1 = acc_mapsp1[s];
+    const int p1reg = acc_mapsp1reg[s];
+    const Pointer p2 = acc_mapsp2[s];
+    const int p2reg = acc_mapsp2reg[s];
+
+    const double2 px1 = (p1reg == 0) ? acc_px0[p1] : acc_px1[p1];
+    const double2 px2 = (p2reg == 0) ? acc_px0[p2] : acc_px1[p2];
+    const double2 pu1 = (p1reg == 0) ? acc_pu0[p1] : acc_pu1[p1];
+    const double2 pu2 = (p2reg == 0) ? acc_pu0[p2] : acc_pu1[p2];
+    const double2 dx  = px2 - px1;
+    const double2 du  = pu2 - pu1;
+    const double lenx = acc_elen[s];
+    double dux = dot(du, dx);
+    dux = (lenx > 0. ? abs(dux) / lenx : 0.);
+    ztmp = (dux > ztmp) ? dux : ztmp;
+  }
+
   const double zss  = acc_zss[z];
-  const double ztmp  = acc_ztmp[z];
   const double zdu = q1 * zss + 2. * q2 * ztmp;
   acc_zdu[z] = zdu;
 }
@@ -506,13 +518,14 @@ void QCS::setVelDiffGPUTask(
     const double q1 = args[0];
     const double q2 = args[1];
 
-    const AccessorRO<Pointer> acc_mapsz(regions[0], FID_MAPSZ);
     const AccessorRO<Pointer> acc_mapsp1(regions[0], FID_MAPSP1);
     const AccessorRO<Pointer> acc_mapsp2(regions[0], FID_MAPSP2);
     const AccessorRO<int> acc_mapsp1reg(regions[0], FID_MAPSP1REG);
     const AccessorRO<int> acc_mapsp2reg(regions[0], FID_MAPSP2REG);
     const AccessorRO<double> acc_elen(regions[0], FID_ELEN);
     const AccessorRO<double> acc_zss(regions[1], FID_ZSS);
+    const AccessorRO<int> acc_znump(regions[1], FID_ZNUMP);
+    const AccessorRO<Pointer> acc_mapzs1(regions[1], FID_MAPZS1);
     const AccessorRO<double2> acc_pu[2] = {
         AccessorRO<double2>(regions[2], FID_PU0),
         AccessorRO<double2>(regions[3], FID_PU0)
@@ -521,7 +534,6 @@ void QCS::setVelDiffGPUTask(
         AccessorRO<double2>(regions[2], FID_PXP),
         AccessorRO<double2>(regions[3], FID_PXP)
     };
-    const AccessorWD<double> acc_ztmp(regions[4], FID_ZTMP);
     const AccessorWD<double> acc_zdu(regions[4], FID_ZDU);
 
     const IndexSpace& isz = task->regions[4].region.get_index_space();
@@ -530,21 +542,113 @@ void QCS::setVelDiffGPUTask(
     const size_t volumez = rectz.volume();
     if (volumez == 0)
       return;
-    cudaMemset(acc_ztmp.ptr(rectz), 0, volumez * sizeof(double));
+    const size_t blockz = (volumez + THREADS_PER_BLOCK - 1) / THREADS_PER_BLOCK;
+    gpu_set_vel_diff<<<blockz,THREADS_PER_BLOCK>>>(acc_mapsp1, acc_mapsp2,
+        acc_mapsp1reg, acc_mapsp2reg, acc_elen, acc_zss, acc_znump, acc_mapzs1,
+        acc_pu[0], acc_pu[1], acc_px[0], acc_px[1], acc_zdu, q1, q2,
+        rectz.lo, volumez);
+}
 
-    const IndexSpace& iss = task->regions[0].region.get_index_space();
+__global__ void
+__launch_bounds__(THREADS_PER_BLOCK,MIN_CTAS_PER_SM)
+gpu_calc_force_qcs(const AccessorRO<Pointer> acc_mapsp1,
+                   const AccessorRO<Pointer> acc_mapss3,
+                   const AccessorRO<Pointer> acc_mapss4,
+                   const AccessorRO<int> acc_mapsp1reg,
+#ifndef RECOMPUTE_EDGE_GEOMETRY
+                   const AccessorRO<double2> acc_ex,
+                   const AccessorRO<double> acc_elen,
+#endif
+                   const AccessorRO<int> acc_znump,
+#ifdef CACHE_INVARIANTS
+                   const AccessorRO<double> acc_znumpinv,
+#endif
+                   const AccessorRO<Pointer> acc_mapzs1,
+                   const AccessorRO<double2> acc_zx,
+                   const AccessorRO<double> acc_zrp,
+                   const AccessorRO<double> acc_zss,
+                   const AccessorRO<double2> acc_pu0,
+                   const AccessorRO<double2> acc_pu1,
+                   const AccessorRO<double2> acc_px0,
+                   const AccessorRO<double2> acc_px1,
+                   const AccessorWD<TempReal2> acc_sfq,
+                   const AccessorWD<double> acc_zdu,
+                   const double qgamma, const double q1, const double q2,
+                   const Point<1> origin, const size_t max)
+{
+  const size_t offset = blockIdx.x * blockDim.x + threadIdx.x;
+  if (offset >= max)
+    return;
+  const coord_t z = origin[0] + offset;
+  QCS::calcZoneForce(z, qgamma, q1, q2, acc_mapsp1, acc_mapss3, acc_mapss4,
+      acc_mapsp1reg,
+#ifndef RECOMPUTE_EDGE_GEOMETRY
+      acc_ex, acc_elen,
+#endif
+      acc_znump,
+#ifdef CACHE_INVARIANTS
+      acc_znumpinv,
+#endif
+      acc_mapzs1, acc_zx, acc_zrp, acc_zss,
+      acc_pu0, acc_pu1, acc_px0, acc_px1, acc_sfq, acc_zdu);
+}
+
+// Routines [2], [4], [5] and [6] together, one thread per zone
+__host__
+void QCS::calcForceGPUTask(
+        const Task *task,
+        const std::vector<PhysicalRegion> &regions,
+        Context ctx,
+        Runtime *runtime) {
+    const double* args = (const double*) task->args;
+    const double qgamma = args[0];
+    const double q1     = args[1];
+    const double q2     = args[2];
+
+    const AccessorRO<Pointer> acc_mapsp1(regions[0], FID_MAPSP1);
+    const AccessorRO<Pointer> acc_mapss3(regions[0], FID_MAPSS3);
+    const AccessorRO<Pointer> acc_mapss4(regions[0], FID_MAPSS4);
+    const AccessorRO<int> acc_mapsp1reg(regions[0], FID_MAPSP1REG);
+#ifndef RECOMPUTE_EDGE_GEOMETRY
+    const AccessorRO<double2> acc_ex(regions[0], FID_EXP);
+    const AccessorRO<double> acc_elen(regions[0], FID_ELEN);
+#endif
+    const AccessorRO<int> acc_znump(regions[1], FID_ZNUMP);
+    const AccessorRO<Pointer> acc_mapzs1(regions[1], FID_MAPZS1);
+    const AccessorRO<double2> acc_zx(regions[1], FID_ZXP);
+    const AccessorRO<double> acc_zrp(regions[1], FID_ZRP);
+    const AccessorRO<double> acc_zss(regions[1], FID_ZSS);
+    const AccessorRO<double2> acc_pu[2] = {
+        AccessorRO<double2>(regions[2], FID_PU0),
+        AccessorRO<double2>(regions[3], FID_PU0)
+    };
+    const AccessorRO<double2> acc_px[2] = {
+        AccessorRO<double2>(regions[2], FID_PXP),
+        AccessorRO<double2>(regions[3], FID_PXP)
+    };
+    const AccessorWD<TempReal2> acc_sfq(regions[4], FID_SFQ);
+    const AccessorWD<double> acc_zdu(regions[5], FID_ZDU);
+#ifdef CACHE_INVARIANTS
+    const AccessorRO<double> acc_znumpinv(regions[6], FID_ZNUMPINV);
+#endif
+
+    const IndexSpace& isz = task->regions[5].region.get_index_space();
     // This will assert if it is not dense
-    const Rect<1> rects = runtime->get_index_space_domain(iss);
-    const size_t volume = rects.volume();
-    if (volume == 0)
+    const Rect<1> rectz = runtime->get_index_space_domain(isz);
+    const size_t volumez = rectz.volume();
+    if (volumez == 0)
       return;
-    const size_t blocks = (volume + THREADS_PER_BLOCK - 1) / THREADS_PER_BLOCK;
-    gpu_set_vel_diff1<<<blocks,THREADS_PER_BLOCK>>>(acc_mapsz, acc_mapsp1,
-        acc_mapsp2, acc_mapsp1reg, acc_mapsp2reg, acc_elen, acc_pu[0], acc_pu[1],
-        acc_px[0], acc_px[1], acc_ztmp, rects.lo, volume);
-
     const size_t blockz = (volumez + THREADS_PER_BLOCK - 1) / THREADS_PER_BLOCK;
-    gpu_set_vel_diff2<<<blockz,THREADS_PER_BLOCK>>>(acc_zss, acc_ztmp,
-        acc_zdu, q1, q2, rectz.lo, volumez);
+    gpu_calc_force_qcs<<<blockz,THREADS_PER_BLOCK>>>(acc_mapsp1, acc_mapss3,
+        acc_mapss4, acc_mapsp1reg,
+#ifndef RECOMPUTE_EDGE_GEOMETRY
+        acc_ex, acc_elen,
+#endif
+        acc_znump,
+#ifdef CACHE_INVARIANTS
+        acc_znumpinv,
+#endif
+        acc_mapzs1, acc_zx, acc_zrp, acc_zss, acc_pu[0], acc_pu[1],
+        acc_px[0], acc_px[1], acc_sfq, acc_zdu, qgamma, q1, q2, rectz.lo,
+        volumez);
 }
-
@@ -13,8 +13,13 @@
 #ifndef QCS_HH_
 #define QCS_HH_
 
+#include <cstdio>
+#include <cstdlib>
+
 #include "legion.h"
 
+#include "MyLegion.hh"
+#include "Vec2.hh"
 #include "Mesh.hh"
 
 // forward declarations
@@ -26,9 +31,15 @@ enum QCSTaskID {
     TID_SETCORNERDIV = 'Q' * 100,
     TID_SETQCNFORCE,
     TID_SETFORCEQCS,
-    TID_SETVELDIFF
+    TID_SETVELDIFF,
+    TID_CALCFORCEQCS
 };
 
+// Largest number of sides in a zone that the fused QCS task can
+// handle; it keeps the corner quantities of one zone in arrays
+// of this size.  Generated meshes have at most 6.
+const int MAXZONESIDES = 8;
+
 
 class QCS {
 public:
@@ -67,6 +78,13 @@ public:
             Legion::Context ctx,
             Legion::Runtime *runtime);
 
+    // fused version of the four tasks above, used with FUSED_QCS
+    static void calcForceTask(
+            const Legion::Task *task,
+            const std::vector<Legion::PhysicalRegion> &regions,
+            Legion::Context ctx,
+            Legion::Runtime *runtime);
+
     // OpenMP variants
     static void setCornerDivOMPTask(
             const Legion::Task *task,
@@ -92,6 +110,12 @@ public:
             Legion::Context ctx,
             Legion::Runtime *runtime);
 
+    static void calcForceOMPTask(
+            const Legion::Task *task,
+            const std::vector<Legion::PhysicalRegion> &regions,
+            Legion::Context ctx,
+            Legion::Runtime *runtime);
+
     // GPU variants
     static void setCornerDivGPUTask(
             const Legion::Task *task,
@@ -117,7 +141,221 @@ public:
             Legion::Context ctx,
             Legion::Runtime *runtime);
 
+    static void calcForceGPUTask(
+            const Legion::Task *task,
+            const std::vector<Legion::PhysicalRegion> &regions,
+            Legion::Context ctx,
+            Legion::Runtime *runtime);
+
+    // Does all of setCornerDiv, setQCnForce, setForce and setVelDiff
+    // for one zone, and writes only its sfq and zdu.  The sides of a
+    // zone are contiguous starting at mapzs1, so mapss3/mapss4 stay
+    // inside the zone, and point p2 of a side is point p1 of the
+    // next side, so each point of the zone is loaded only once.
+    __CUDA_HD__
+    static inline void calcZoneForce(
+            const Legion::coord_t z,
+            const double qgamma,
+            const double q1,
+            const double q2,
+            const AccessorRO<Pointer>& acc_mapsp1,
+            const AccessorRO<Pointer>& acc_mapss3,
+            const AccessorRO<Pointer>& acc_mapss4,
+            const AccessorRO<int>& acc_mapsp1reg,
+#ifndef RECOMPUTE_EDGE_GEOMETRY
+            const AccessorRO<double2>& acc_ex,
+            const AccessorRO<double>& acc_elen,
+#endif
+            const AccessorRO<int>& acc_znump,
+#ifdef CACHE_INVARIANTS
+            const AccessorRO<double>& acc_znumpinv,
+#endif
+            const AccessorRO<Pointer>& acc_mapzs1,
+            const AccessorRO<double2>& acc_zx,
+            const AccessorRO<double>& acc_zrp,
+            const AccessorRO<double>& acc_zss,
+            const AccessorRO<double2>& acc_pu0,
+            const AccessorRO<double2>& acc_pu1,
+            const AccessorRO<double2>& acc_px0,
+            const AccessorRO<double2>& acc_px1,
+            const AccessorWD<TempReal2>& acc_sfq,
+            const AccessorWD<double>& acc_zdu);
+
 };  // class QCS
 
 
+__CUDA_HD__
+inline void QCS::calcZoneForce(
+        const Legion::coord_t z,
+        const double qgamma,
+        const double q1,
+        const double q2,
+        const AccessorRO<Pointer>& acc_mapsp1,
+        const AccessorRO<Pointer>& acc_mapss3,
+        const AccessorRO<Pointer>& acc_mapss4,
+        const AccessorRO<int>& acc_mapsp1reg,
+#ifndef RECOMPUTE_EDGE_GEOMETRY
+        const AccessorRO<double2>& acc_ex,
+        const AccessorRO<double>& acc_elen,
+#endif
+        const AccessorRO<int>& acc_znump,
+#ifdef CACHE_INVARIANTS
+        const AccessorRO<double>& acc_znumpinv,
+#endif
+        const AccessorRO<Pointer>& acc_mapzs1,
+        const AccessorRO<double2>& acc_zx,
+        const AccessorRO<double>& acc_zrp,
+        const AccessorRO<double>& acc_zss,
+        const AccessorRO<double2>& acc_pu0,
+        const AccessorRO<double2>& acc_pu1,
+        const AccessorRO<double2>& acc_px0,
+        const AccessorRO<double2>& acc_px1,
+        const AccessorWD<TempReal2>& acc_sfq,
+        const AccessorWD<double>& acc_zdu) {
+    const int n = acc_znump[z];
+    if (n > MAXZONESIDES) {
+        // the setup check in the QCS constructor should make this
+        // impossible, but writing past the arrays would be silent
+        printf("Error:  zone %lld has %d sides, FUSED_QCS handles at most %d\n",
+               (long long)z, n, MAXZONESIDES);
+#ifdef __CUDA_ARCH__
+        asm("trap;");
+#else
+        abort();
+#endif
+    }
+    const Legion::coord_t sfirst = acc_mapzs1[z][0];
+
+    // Index i below is side sfirst + i, corner sfirst + i, and point
+    // p1 of that side, which is also point p2 of side prev[i]
+    int prev[MAXZONESIDES], next[MAXZONESIDES];
+    double2 up[MAXZONESIDES], xp[MAXZONESIDES], ex[MAXZONESIDES];
+    double elen[MAXZONESIDES];
+
+    // [1] Compute a zone-centered velocity
+    double2 zuc = make_double2(0., 0.);
+    for (int i = 0; i < n; i++)
+    {
+        const Legion::coord_t s = sfirst + i;
+        const Pointer p = acc_mapsp1[s];
+        const int preg = acc_mapsp1reg[s];
+        up[i] = (preg == 0) ? acc_pu0[p] : acc_pu1[p];
+        xp[i] = (preg == 0) ? acc_px0[p] : acc_px1[p];
+#ifndef RECOMPUTE_EDGE_GEOMETRY
+        ex[i] = acc_ex[s];
+        elen[i] = acc_elen[s];
+#endif
+        prev[i] = acc_mapss3[s][0] - sfirst;
+        next[i] = acc_mapss4[s][0] - sfirst;
+#ifdef CACHE_INVARIANTS
+        zuc = zuc + up[i] * acc_znumpinv[z];
+#else
+        zuc = zuc + up[i] / n;
+#endif
+    }
+#ifdef RECOMPUTE_EDGE_GEOMETRY
+    // the points of the zone are all loaded, so the edge centers and
+    // lengths come almost for free
+    for (int i = 0; i < n; i++)
+    {
+        ex[i] = 0.5 * (xp[i] + xp[next[i]]);
+        elen[i] = length(xp[next[i]] - xp[i]);
+    }
+#endif
+
+    const double2 zx = acc_zx[z];
+    const double zrp = acc_zrp[z];
+    const double zss = acc_zss[z];
+    const double gammap1 = qgamma + 1.0;
+    const double ztmp1 = q1 * zss;
+
+    double ccos[MAXZONESIDES], cw[MAXZONESIDES];
+    double2 cqe1[MAXZONESIDES], cqe2[MAXZONESIDES];
+    double ztmp = 0.;
+    for (int c = 0; c < n; c++)
+    {
+        // corner c is between side s = prev[c] and side s2 = c,
+        // at point p = c; p1 = s and p2 = next[c]
+        const int s = prev[c];
+        const int p2 = next[c];
+
+        // [2] Divergence at the corner
+        const double2 up0 = up[c];
+        const double2 xp0 = xp[c];
+        const double2 up1 = 0.5 * (up0 + up[p2]);
+        const double2 xp1 = ex[c];
+        const double2 up2 = zuc;
+        const double2 xp2 = zx;
+        const double2 up3 = 0.5 * (up[s] + up0);
+        const double2 xp3 = ex[s];
+
+        const double cvolume = 0.5 * cross(xp2 - xp0, xp3 - xp1);
+
+        const double2 v1 = xp3 - xp0;
+        const double2 v2 = xp1 - xp0;
+        const double de1 = elen[s];
+        const double de2 = elen[c];
+        const double minelen = fmin(de1, de2);
+        const double cosc = ((minelen < 1.e-12) ?
+                0. :
+                4. * dot(v1, v2) / (de1 * de2));
+
+        const double cdiv = (cross(up2 - up0, xp3 - xp1) -
+                cross(up3 - up1, xp2 - xp0)) /
+                (2.0 * cvolume);
+
+        const double2 dxx1 = 0.5 * (xp1 + xp2 - xp0 - xp3);
+        const double2 dxx2 = 0.5 * (xp2 + xp3 - xp0 - xp1);
+        const double dx1 = length(dxx1);
+        const double dx2 = length(dxx2);
+        const double2 duav = 0.25 * (up0 + up1 + up2 + up3);
+        const double test1 = fabs(dot(dxx1, duav) * dx2);
+        const double test2 = fabs(dot(dxx2, duav) * dx1);
+        const double num = (test1 > test2 ? dx1 : dx2);
+        const double den = (test1 > test2 ? dx2 : dx1);
+        const double r = num / den;
+        double evol = sqrt(4.0 * cvolume * r);
+        evol = fmin(evol, 2.0 * minelen);
+
+        const double dv1 = length2(up1 + up2 - up0 - up3);
+        const double dv2 = length2(up2 + up3 - up0 - up1);
+        double du = sqrt(fmax(dv1, dv2));
+
+        evol = (cdiv < 0.0 ? evol : 0.);
+        du   = (cdiv < 0.0 ? du   : 0.);
+
+        // [4] Kurapatenko viscous scalar and cqe
+        const double ztmp2 = q2 * 0.25 * gammap1 * du;
+        const double zkur = ztmp2 + sqrt(ztmp2 * ztmp2 + ztmp1 * ztmp1);
+        const double crmu = ((cdiv > 0.0) ? 0. : zkur * zrp * evol);
+        cqe1[c] = crmu * (up0 - up[s]) / de1;
+        cqe2[c] = crmu * (up[p2] - up0) / de2;
+
+        // [5.1] Preparation of extra variables
+        const double csin2 = 1.0 - cosc * cosc;
+        cw[c] = ((csin2 < 1.e-4) ? 0. : cvolume / csin2);
+        ccos[c] = ((csin2 < 1.e-4) ? 0. : cosc);
+
+        // [6] Velocity difference along side c
+        const double2 dx = xp[p2] - xp0;
+        const double2 dv = up[p2] - up0;
+        double dux = dot(dv, dx);
+        dux = (de2 > 0. ? fabs(dux) / de2 : 0.);
+        ztmp = fmax(ztmp, dux);
+    }
+
+    // [5.2] Set-Up the forces on corners
+    for (int s = 0; s < n; s++)
+    {
+        const int c1 = s;
+        const int c2 = next[s];
+        const double2 sfq = (cw[c1] * (cqe2[c1] + ccos[c1] * cqe1[c1]) +
+                       cw[c2] * (cqe1[c2] + ccos[c2] * cqe2[c2])) / elen[s];
+        acc_sfq[sfirst + s] = sfq;
+    }
+
+    acc_zdu[z] = q1 * zss + 2. * q2 * ztmp;
+}
+
+
 #endif /* QCS_HH_ */
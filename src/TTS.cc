@@ -62,13 +62,17 @@ void TTS::calcForceTask(
     const double ssmin = args[1];
 
     const AccessorRO<Pointer> acc_mapsz(regions[0], FID_MAPSZ);
-    const AccessorRO<double> acc_sarea(regions[0], FID_SAREAP);
     const AccessorRO<double> acc_smf(regions[0], FID_SMF);
+#ifdef RECOMPUTE_EDGE_GEOMETRY
+    const SideGeometry geom(regions, 0, 1, 3);
+#else
+    const AccessorRO<double> acc_sarea(regions[0], FID_SAREAP);
     const AccessorRO<double2> acc_ssurf(regions[0], FID_SSURFP);
+#endif
     const AccessorRO<double> acc_zarea(regions[1], FID_ZAREAP);
     const AccessorRO<double> acc_zr(regions[1], FID_ZRP);
     const AccessorRO<double> acc_zss(regions[1], FID_ZSS);
-    const AccessorWD<double2> acc_sf(regions[2], FID_SFT);
+    const AccessorWD<TempReal2> acc_sf(regions[2], FID_SFT);
 
     //  Side density:
     //    srho = sm/sv = zr (sm/zm) / (sv/zv)
@@ -87,7 +91,11 @@ void TTS::calcForceTask(
     {
         const Pointer s = *its;
         const Pointer z = acc_mapsz[s];
+#ifdef RECOMPUTE_EDGE_GEOMETRY
+        const double sarea = geom.sarea(s, z);
+#else
         const double sarea = acc_sarea[s];
+#endif
         const double zarea = acc_zarea[z];
         const double vfacinv = zarea / sarea;
         const double r = acc_zr[z];
@@ -97,7 +105,11 @@ void TTS::calcForceTask(
         double sstmp = max(ss, ssmin);
         sstmp = alfa * sstmp * sstmp;
         const double sdp = sstmp * (srho - r);
+#ifdef RECOMPUTE_EDGE_GEOMETRY
+        const double2 surf = geom.ssurf(s, z);
+#else
         const double2 surf = acc_ssurf[s];
+#endif
         const double2 sqq = -sdp * surf;
         acc_sf[s] = sqq;
     }
@@ -113,13 +125,17 @@ void TTS::calcForceOMPTask(
     const double ssmin = args[1];
 
     const AccessorRO<Pointer> acc_mapsz(regions[0], FID_MAPSZ);
-    const AccessorRO<double> acc_sarea(regions[0], FID_SAREAP);
     const AccessorRO<double> acc_smf(regions[0], FID_SMF);
+#ifdef RECOMPUTE_EDGE_GEOMETRY
+    const SideGeometry geom(regions, 0, 1, 3);
+#else
+    const AccessorRO<double> acc_sarea(regions[0], FID_SAREAP);
     const AccessorRO<double2> acc_ssurf(regions[0], FID_SSURFP);
+#endif
     const AccessorRO<double> acc_zarea(regions[1], FID_ZAREAP);
     const AccessorRO<double> acc_zr(regions[1], FID_ZRP);
     const AccessorRO<double> acc_zss(regions[1], FID_ZSS);
-    const AccessorWD<double2> acc_sf(regions[2], FID_SFT);
+    const AccessorWD<TempReal2> acc_sf(regions[2], FID_SFT);
 
     //  Side density:
     //    srho = sm/sv = zr (sm/zm) / (sv/zv)
@@ -140,7 +156,11 @@ void TTS::calcForceOMPTask(
     for (coord_t s = rects.lo[0]; s <= rects.hi[0]; s++)
     {
         const Pointer z = acc_mapsz[s];
+#ifdef RECOMPUTE_EDGE_GEOMETRY
+        const double sarea = geom.sarea(s, z);
+#else
         const double sarea = acc_sarea[s];
+#endif
         const double zarea = acc_zarea[z];
         const double vfacinv = zarea / sarea;
         const double r = acc_zr[z];
@@ -150,7 +170,11 @@ void TTS::calcForceOMPTask(
         double sstmp = max(ss, ssmin);
         sstmp = alfa * sstmp * sstmp;
         const double sdp = sstmp * (srho - r);
+#ifdef RECOMPUTE_EDGE_GEOMETRY
+        const double2 surf = geom.ssurf(s, z);
+#else
         const double2 surf = acc_ssurf[s];
+#endif
         const double2 sqq = -sdp * surf;
         acc_sf[s] = sqq;
     }
@@ -22,13 +22,17 @@ static void __attribute__ ((constructor)) registerTasks() {
 __global__ void
 __launch_bounds__(THREADS_PER_BLOCK,MIN_CTAS_PER_SM)
 gpu_calc_force_tts(const AccessorRO<Pointer> acc_mapsz,
+#ifdef RECOMPUTE_EDGE_GEOMETRY
+                   const SideGeometry geom,
+#else
                    const AccessorRO<double> acc_sarea,
-                   const AccessorRO<double> acc_smf,
                    const AccessorRO<double2> acc_ssurf,
+#endif
+                   const AccessorRO<double> acc_smf,
                    const AccessorRO<double> acc_zarea,
                    const AccessorRO<double> acc_zr,
                    const AccessorRO<double> acc_zss,
-                   const AccessorWD<double2> acc_sf,
+                   const AccessorWD<TempReal2> acc_sf,
                    const double alfa, const double ssmin,
                    const Point<1> origin, const size_t max)
 {
@@ -37,7 +41,11 @@ gpu_calc_force_tts(const AccessorRO<Pointer> acc_mapsz,
     return;
   const coord_t s = origin[0] + offset;
   const Pointer z = acc_mapsz[s];
+#ifdef RECOMPUTE_EDGE_GEOMETRY
+  const double sarea = geom.sarea(s, z);
+#else
   const double sarea = acc_sarea[s];
+#endif
   const double zarea = acc_zarea[z];
   const double vfacinv = zarea / sarea;
   const double r = acc_zr[z];
@@ -47,7 +55,11 @@ gpu_calc_force_tts(const AccessorRO<Pointer> acc_mapsz,
   double sstmp = (ss > ssmin) ? ss : ssmin;
   sstmp = alfa * sstmp * sstmp;
   const double sdp = sstmp * (srho - r);
+#ifdef RECOMPUTE_EDGE_GEOMETRY
+  const double2 surf = geom.ssurf(s, z);
+#else
   const double2 surf = acc_ssurf[s];
+#endif
   const double2 sqq = -sdp * surf;
   acc_sf[s] = sqq;
 }
@@ -63,13 +75,17 @@ void TTS::calcForceGPUTask(
     const double ssmin = args[1];
 
     const AccessorRO<Pointer> acc_mapsz(regions[0], FID_MAPSZ);
-    const AccessorRO<double> acc_sarea(regions[0], FID_SAREAP);
     const AccessorRO<double> acc_smf(regions[0], FID_SMF);
+#ifdef RECOMPUTE_EDGE_GEOMETRY
+    const SideGeometry geom(regions, 0, 1, 3);
+#else
+    const AccessorRO<double> acc_sarea(regions[0], FID_SAREAP);
     const AccessorRO<double2> acc_ssurf(regions[0], FID_SSURFP);
+#endif
     const AccessorRO<double> acc_zarea(regions[1], FID_ZAREAP);
     const AccessorRO<double> acc_zr(regions[1], FID_ZRP);
     const AccessorRO<double> acc_zss(regions[1], FID_ZSS);
-    const AccessorWD<double2> acc_sf(regions[2], FID_SFT);
+    const AccessorWD<TempReal2> acc_sf(regions[2], FID_SFT);
 
     //  Side density:
     //    srho = sm/sv = zr (sm/zm) / (sv/zv)
@@ -90,8 +106,14 @@ void TTS::calcForceGPUTask(
     if (volume == 0)
       return;
     const size_t blocks = (volume + THREADS_PER_BLOCK - 1) / THREADS_PER_BLOCK;
+#ifdef RECOMPUTE_EDGE_GEOMETRY
+    gpu_calc_force_tts<<<blocks,THREADS_PER_BLOCK>>>(acc_mapsz, geom,
+        acc_smf, acc_zarea, acc_zr, acc_zss, acc_sf, alfa, ssmin,
+        rects.lo, volume);
+#else
     gpu_calc_force_tts<<<blocks,THREADS_PER_BLOCK>>>(acc_mapsz, acc_sarea, 
-        acc_smf, acc_ssurf, acc_zarea, acc_zr, acc_zss, acc_sf, alfa, ssmin,
+        acc_ssurf, acc_smf, acc_zarea, acc_zr, acc_zss, acc_sf, alfa, ssmin,
         rects.lo, volume);
+#endif
 }
 
@@ -0,0 +1,161 @@
+/*
+ * TuningDB.cc
+ *
+ * Copyright (c) 2012, Los Alamos National Security, LLC.
+ * All rights reserved.
+ * Use of this source code is governed by a BSD-style open-source
+ * license; see top-level LICENSE file for full license text.
+ */
+
+#include "TuningDB.hh"
+
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include "InputFile.hh"
+
+using namespace std;
+using namespace Legion;
+
+
+TuningDB::TuningDB(
+        const char* fname,
+        const InputFile* inp)
+        : filename(fname) {
+    probkey = problemKey(inp);
+    machkey = machineFingerprint();
+    read();
+}
+
+
+TuningDB::~TuningDB() {}
+
+
+bool TuningDB::lookup(Entry& entry) const {
+    entrytype::const_iterator itr =
+            entries.find(make_pair(probkey, machkey));
+    if (itr == entries.end())
+        return false;
+    entry = itr->second;
+    return true;
+}
+
+
+void TuningDB::record(const Entry& entry) {
+    // read again in case another run has updated the file
+    read();
+    const pair<string, string> key(probkey, machkey);
+    entrytype::const_iterator itr = entries.find(key);
+    if (itr != entries.end() && itr->second.walltime <= entry.walltime)
+        return;
+    entries[key] = entry;
+    write();
+}
+
+
+string TuningDB::problemKey(const InputFile* inp) {
+    ostringstream oss;
+    oss << inp->getString("meshtype", "");
+    const vector<double> params =
+            inp->getDoubleList("meshparams", vector<double>());
+    for (int i = 0; i < params.size(); ++i)
+        oss << (i == 0 ? ':' : ',') << params[i];
+    return oss.str();
+}
+
+
+string TuningDB::machineFingerprint() {
+    // number of nodes and the kinds of processors on each of them,
+    // which is what the mapper and the piece count care about
+    Machine machine = Machine::get_machine();
+    const Processor::Kind kinds[3] =
+        { Processor::LOC_PROC, Processor::OMP_PROC, Processor::TOC_PROC };
+    size_t counts[3];
+    for (int k = 0; k < 3; ++k) {
+        Machine::ProcessorQuery query(machine);
+        query.local_address_space();
+        query.only_kind(kinds[k]);
+        counts[k] = query.count();
+    }
+    ostringstream oss;
+    oss << "nodes=" << machine.get_address_space_count()
+        << ",cores=" << sysconf(_SC_NPROCESSORS_ONLN)
+        << ",cpus=" << counts[0]
+        << ",omps=" << counts[1]
+        << ",gpus=" << counts[2];
+    return oss.str();
+}
+
+
+void TuningDB::read() {
+    entries.clear();
+    ifstream ifs(filename.c_str());
+    if (!ifs.good()) return;
+
+    while (true)
+    {
+        string line;
+        getline(ifs, line);
+        if (ifs.eof()) break;
+
+        istringstream iss(line);
+        string pkey, mkey;
+        iss >> pkey;
+        if (pkey.empty() || pkey[0] == '#')
+            continue;
+        Entry entry;
+        iss >> mkey >> entry.numpcs >> entry.chunksize >> entry.walltime;
+        if (iss.fail()) {
+            cerr << "Ignoring bad entry in tuning database "
+                 << filename << ": " << line << endl;
+            continue;
+        }
+        string variant;
+        while (iss >> variant) {
+            // <task>:<role>:<cpu|omp>, the role may not have a colon
+            const size_t first = variant.find(':');
+            const size_t last = variant.rfind(':');
+            if (first == string::npos || last == first)
+                continue;
+            const TaskID taskid = atoi(variant.substr(0, first).c_str());
+            const string role = variant.substr(first + 1, last - first - 1);
+            const string kind = variant.substr(last + 1);
+            entry.variants[make_pair(taskid, role)] = (kind == "omp");
+        }
+        entries[make_pair(pkey, mkey)] = entry;
+    } // while true
+
+    ifs.close();
+}
+
+
+void TuningDB::write() const {
+    // write to a temporary file first so readers never see a partial file
+    const string tmpname = filename + ".tmp";
+    ofstream ofs(tmpname.c_str());
+    if (!ofs.good()) {
+        cerr << "Unable to write tuning database " << filename << endl;
+        return;
+    }
+    ofs << "# problem machine numpcs chunksize walltime(us) "
+        << "[task:role:variant ...]" << endl;
+    for (entrytype::const_iterator itr = entries.begin();
+            itr != entries.end(); ++itr) {
+        const Entry& entry = itr->second;
+        ofs << itr->first.first << " " << itr->first.second << " "
+            << entry.numpcs << " " << entry.chunksize << " "
+            << entry.walltime;
+        for (PennantMapper::VariantChoices::const_iterator vitr =
+                entry.variants.begin(); vitr != entry.variants.end(); ++vitr)
+            ofs << " " << vitr->first.first << ":" << vitr->first.second
+                << ":" << (vitr->second ? "omp" : "cpu");
+        ofs << endl;
+    }
+    ofs.close();
+    rename(tmpname.c_str(), filename.c_str());
+}
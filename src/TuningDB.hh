@@ -0,0 +1,73 @@
+/*
+ * TuningDB.hh
+ *
+ * Copyright (c) 2012, Los Alamos National Security, LLC.
+ * All rights reserved.
+ * Use of this source code is governed by a BSD-style open-source
+ * license; see top-level LICENSE file for full license text.
+ */
+
+#ifndef TUNINGDB_HH_
+#define TUNINGDB_HH_
+
+#include <string>
+#include <map>
+
+#include "legion.h"
+
+#include "PennantMapper.hh"
+
+// forward declarations
+class InputFile;
+
+
+// Database of the fastest settings found for each problem on each
+// machine, kept in a local text file with one entry per line:
+//   <problem key> <machine fingerprint> <numpcs> <chunksize> <walltime>
+//       [<task>:<role>:<cpu|omp> ...]
+// where the role is the name of the partition the task was launched
+// over (or the fields it used), see PennantMapper::VariantChoices
+class TuningDB {
+public:
+    struct Entry {
+    public:
+        Entry(void) : numpcs(0), chunksize(0), walltime(0.) { }
+    public:
+        int numpcs;
+        int chunksize;
+        double walltime;           // run time (us) past the tuning cycles
+        PennantMapper::VariantChoices variants;
+    };
+public:
+
+    std::string filename;          // file backing the database
+    std::string probkey;           // meshtype and meshparams of problem
+    std::string machkey;           // fingerprint of machine we run on
+
+    TuningDB(
+            const char* fname,
+            const InputFile* inp);
+    ~TuningDB();
+
+    // returns false if there is no entry for this problem and machine
+    bool lookup(Entry& entry) const;
+
+    // saves the entry if it is faster than the one already stored
+    void record(const Entry& entry);
+
+    static std::string problemKey(const InputFile* inp);
+
+    static std::string machineFingerprint();
+
+private:
+    typedef std::map<std::pair<std::string, std::string>, Entry> entrytype;
+
+    entrytype entries;
+
+    void read();
+    void write() const;
+
+}; // class TuningDB
+
+
+#endif /* TUNINGDB_HH_ */
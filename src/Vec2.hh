@@ -202,4 +202,21 @@ inline double2 project(const double2& v, const double2& u)
     return v - dot(v, u) * u;
 }
 
+
+// Storage-only single precision vector, for fields that are written
+// by one task and read by another.  It converts to and from double2
+// and has no arithmetic of its own, so all math is done in double.
+struct single2
+{
+    float x, y;
+    __CUDA_HD__
+    inline single2() : x(0.f), y(0.f) {}
+    __CUDA_HD__
+    inline single2(const double2& v2) : x(v2.x), y(v2.y) {}
+
+    __CUDA_HD__
+    inline operator double2() const { return make_double2(x, y); }
+
+}; // single2
+
 #endif /* VEC2_HH_ */
@@ -12,6 +12,7 @@
 
 #include <cstdlib>
 #include <string>
+#include <sstream>
 #include <iostream>
 
 #include "legion.h"
@@ -20,6 +21,7 @@
 #include "InputFile.hh"
 #include "Driver.hh"
 #include "Mesh.hh"
+#include "TuningDB.hh"
 
 using namespace std;
 using namespace Legion;
@@ -59,7 +61,10 @@ void mainTask(const Task *task,
     
     volatile bool debug = false;
     int numpcs = 1;
+    bool numpcs_set = false;
     const char* filename = NULL;
+    const char* tunefile = "pennant.tuning";
+    bool tunerecord = false;
     bool warn = true;
     while (i < iargs.argc) { 
       if (iargs.argv[i] == string("-f")) { 
@@ -72,12 +77,17 @@ void mainTask(const Task *task,
       }
       else if (iargs.argv[i] == string("-n")) {
         numpcs = atoi(iargs.argv[i + 1]);
+        numpcs_set = true;
         i += 2;
       }
+      else if (iargs.argv[i] == string("-t")) {
+        tunerecord = true;
+        i++;
+      }
       else {
         if (warn) {
           LEGION_PRINT_ONCE(runtime, ctx, stderr, "Usage: pennant [legion args] "
-                                                   "[-n <numpcs>] -f <filename>\n");
+                                                   "[-n <numpcs>] [-t] -f <filename>\n");
           warn = false;
         }
         i++;
@@ -94,13 +104,31 @@ void mainTask(const Task *task,
     
     InputFile inp(filename);
 
+    // Use the fastest settings found so far for this problem on this
+    // machine for anything that wasn't given explicitly
+    TuningDB tunedb(tunefile, &inp);
+    TuningDB::Entry tuned;
+    if (tunedb.lookup(tuned)) {
+      LEGION_PRINT_ONCE(runtime, ctx, stdout, "Using tuned settings from %s\n",
+                        tunefile);
+      if (!numpcs_set)
+        numpcs = tuned.numpcs;
+      ostringstream oss;
+      oss << tuned.chunksize;
+      inp.setDefault("chunksize", oss.str());
+      // Variant choices are only good for the same pieces
+      if ((inp.getInt("autotunecycles", 0) == 0) && (numpcs == tuned.numpcs))
+        PennantMapper::set_variant_choices(tuned.variants);
+    }
+
     string probname(filename);
     // strip .pnt suffix from filename
     int len = probname.length();
     if (probname.substr(len - 4, 4) == ".pnt")
         probname = probname.substr(0, len - 4);
 
-    Driver drv(&inp, probname, numpcs, ctx, runtime);
+    Driver drv(&inp, probname, numpcs, 
+               tunerecord ? &tunedb : NULL, ctx, runtime);
 
     drv.run();
 
@@ -0,0 +1,34 @@
+#!/bin/sh
+# Sweep piece counts and chunk sizes for a deck on this machine and
+# record the fastest settings in the tuning database (pennant.tuning).
+# Later runs of the same problem pick those settings up automatically
+# unless -n or chunksize are given explicitly.
+#
+# usage: tune.sh <deck.pnt> [legion args...]
+# PIECES, CHUNKS and TUNECYCLES can be set in the environment.
+
+DECK=$1
+shift
+PIECES=${PIECES:-"1 2 4 8 16 32"}
+CHUNKS=${CHUNKS:-"128 256 512 1024"}
+TUNECYCLES=${TUNECYCLES:-5}
+PENNANT=${PENNANT:-./pennant}
+
+if [ ! -f "$DECK" ]; then
+    echo "usage: tune.sh <deck.pnt> [legion args...]"
+    exit 1
+fi
+
+# Run a copy of the deck so its outputs don't land next to the gold ones
+RUNDIR=`mktemp -d`
+TUNEDECK=$RUNDIR/`basename "$DECK"`
+for n in $PIECES; do
+    for c in $CHUNKS; do
+        grep -v -e '^chunksize' -e '^autotunecycles' "$DECK" > "$TUNEDECK"
+        echo "chunksize $c" >> "$TUNEDECK"
+        echo "autotunecycles $TUNECYCLES" >> "$TUNEDECK"
+        echo "=== numpcs $n chunksize $c ==="
+        $PENNANT "$@" -t -n $n -f "$TUNEDECK" | grep "hydro cycle run time"
+    done
+done
+rm -rf "$RUNDIR"